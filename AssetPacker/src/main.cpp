@@ -0,0 +1,406 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "asset_pack_format.h"
+#include "mesh_import.h"
+#include "mesh_optimizer.h"
+#include "vertex_format.h"
+
+struct InputAsset
+{
+	std::string name;
+	AssetType type;
+	std::vector<char> data;
+};
+
+static bool EndsWith(const std::string& value, const char* suffix)
+{
+	size_t suffixLength = strlen(suffix);
+	return value.size() >= suffixLength && value.compare(value.size() - suffixLength, suffixLength, suffix) == 0;
+}
+
+static AssetType GetAssetType(const std::string& path)
+{
+	if (EndsWith(path, ".ktx2") || EndsWith(path, ".dds"))
+	{
+		return AssetType_Texture;
+	}
+
+	if (EndsWith(path, ".mesh") || IsMeshSourceFile(path.c_str()))
+	{
+		return AssetType_Mesh;
+	}
+
+	return AssetType_Raw;
+}
+
+// Catches inputs that would only fail once the runtime tried to use them
+static bool ValidateAsset(const InputAsset& asset)
+{
+	switch (asset.type)
+	{
+	case AssetType_Texture:
+	{
+		static const unsigned char ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+		bool isKTX2 = asset.data.size() >= sizeof(ktx2Identifier) && memcmp(asset.data.data(), ktx2Identifier, sizeof(ktx2Identifier)) == 0;
+		bool isDDS = asset.data.size() >= 4 && memcmp(asset.data.data(), "DDS ", 4) == 0;
+
+		if (isKTX2 == false && isDDS == false)
+		{
+			std::cout << asset.name << ": not a KTX2 or DDS file" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	case AssetType_Mesh:
+	{
+		AssetPackMeshHeader header;
+
+		if (asset.data.size() < sizeof(header))
+		{
+			std::cout << asset.name << ": truncated mesh" << std::endl;
+			return false;
+		}
+
+		memcpy(&header, asset.data.data(), sizeof(header));
+
+		if ((header.indexSize != 2 && header.indexSize != 4)
+			|| header.positionFormat > VertexPositionFormat_Half
+			|| header.attributeFormat > VertexAttributeFormat_Unorm10
+			|| header.vertexStride != GetPositionSize((VertexPositionFormat)header.positionFormat) + GetAttributeSize((VertexAttributeFormat)header.attributeFormat)
+			|| asset.data.size() != GetMeshDataSize(header))
+		{
+			std::cout << asset.name << ": mesh size doesn't match its header" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	default:
+		return true;
+	}
+}
+
+// Imports, optimises and serialises a mesh source file into the pack's mesh layout
+static bool BuildMesh(const std::string& path, VertexFormat vertexFormat, InputAsset* asset)
+{
+	Mesh mesh;
+
+	if (ImportMesh(path.c_str(), &mesh) == false)
+	{
+		return false;
+	}
+
+	uint32_t vertexCount = (uint32_t)mesh.vertices.size();
+	float inputACMR = ComputeACMR(mesh.indices, vertexCount, DefaultVertexCacheSize);
+
+	// Cache order first, overdraw only moves whole clusters so keeps most of the cache gains,
+	// then fetch order follows the final index order
+	std::vector<uint32_t> clusters;
+	OptimizeVertexCache(&mesh.indices, vertexCount, DefaultVertexCacheSize, &clusters);
+	OptimizeOverdraw(&mesh.indices, mesh.vertices, clusters);
+	OptimizeVertexFetch(&mesh);
+
+	float outputACMR = ComputeACMR(mesh.indices, (uint32_t)mesh.vertices.size(), DefaultVertexCacheSize);
+
+	std::cout << asset->name << ": " << mesh.vertices.size() << " vertices, " << mesh.indices.size() / 3 << " triangles, "
+		<< clusters.size() << " clusters, ACMR " << inputACMR << " -> " << outputACMR << std::endl;
+
+	ComputePositionQuantization(mesh.vertices[0].position, (uint32_t)mesh.vertices.size(), sizeof(MeshVertex), &vertexFormat);
+
+	AssetPackMeshHeader header;
+	header.vertexCount = (uint32_t)mesh.vertices.size();
+	header.vertexStride = GetVertexStride(vertexFormat);
+	header.indexCount = (uint32_t)mesh.indices.size();
+	header.indexSize = header.vertexCount <= 0xffff ? 2 : 4;
+	header.positionFormat = vertexFormat.position;
+	header.attributeFormat = vertexFormat.attribute;
+	memcpy(header.positionScale, vertexFormat.positionScale, sizeof(header.positionScale));
+	memcpy(header.positionOffset, vertexFormat.positionOffset, sizeof(header.positionOffset));
+
+	asset->data.assign((size_t)GetMeshDataSize(header), 0);
+	memcpy(asset->data.data(), &header, sizeof(header));
+
+	unsigned char* vertexData = (unsigned char*)asset->data.data() + sizeof(header);
+
+	for (size_t i = 0; i < mesh.vertices.size(); ++i)
+	{
+		EncodeVertex(vertexFormat, mesh.vertices[i].position, mesh.vertices[i].attribute, vertexData + i * header.vertexStride);
+	}
+
+	std::cout << asset->name << ": " << header.vertexStride << " byte vertices, " << (size_t)header.vertexCount * header.vertexStride << " bytes ("
+		<< (size_t)header.vertexCount * sizeof(MeshVertex) << " unquantised)" << std::endl;
+
+	char* indexData = asset->data.data() + GetMeshIndexDataOffset(header);
+
+	for (size_t i = 0; i < mesh.indices.size(); ++i)
+	{
+		if (header.indexSize == 2)
+		{
+			uint16_t index = (uint16_t)mesh.indices[i];
+			memcpy(indexData + i * 2, &index, 2);
+		}
+		else
+		{
+			memcpy(indexData + i * 4, &mesh.indices[i], 4);
+		}
+	}
+
+	return true;
+}
+
+static bool ReadAsset(const char* argument, const VertexFormat& vertexFormat, InputAsset* asset)
+{
+	const char* separator = strchr(argument, '=');
+
+	if (separator == NULL || separator == argument)
+	{
+		std::cout << "Expected <name>=<file>, got " << argument << std::endl;
+		return false;
+	}
+
+	asset->name.assign(argument, separator);
+	std::string path = separator + 1;
+
+	if (asset->name.size() > AssetPackMaxNameLength)
+	{
+		std::cout << asset->name << ": names are limited to " << AssetPackMaxNameLength << " characters" << std::endl;
+		return false;
+	}
+
+	if (EndsWith(path, ".spv"))
+	{
+		std::cout << asset->name << ": shaders are embedded at build time with --embed, not packed" << std::endl;
+		return false;
+	}
+
+	asset->type = GetAssetType(path);
+
+	if (IsMeshSourceFile(path.c_str()))
+	{
+		return BuildMesh(path, vertexFormat, asset);
+	}
+
+	std::ifstream file(path.c_str(), std::ios::binary);
+
+	if (file.is_open() == false)
+	{
+		std::cout << "Couldn't read " << path << std::endl;
+		return false;
+	}
+
+	asset->data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	return ValidateAsset(*asset);
+}
+
+static uint64_t AlignOffset(uint64_t offset)
+{
+	return (offset + AssetPackAlignment - 1) & ~(uint64_t)(AssetPackAlignment - 1);
+}
+
+static bool WritePack(const char* path, std::vector<InputAsset>& assets)
+{
+	// The runtime binary searches the table of contents
+	std::sort(assets.begin(), assets.end(), [](const InputAsset& a, const InputAsset& b) { return a.name < b.name; });
+
+	for (size_t i = 1; i < assets.size(); ++i)
+	{
+		if (assets[i - 1].name == assets[i].name)
+		{
+			std::cout << "Duplicate asset name " << assets[i].name << std::endl;
+			return false;
+		}
+	}
+
+	std::vector<AssetPackEntry> entries(assets.size());
+	uint64_t offset = sizeof(AssetPackHeader) + sizeof(AssetPackEntry) * entries.size();
+
+	for (size_t i = 0; i < assets.size(); ++i)
+	{
+		offset = AlignOffset(offset);
+
+		memset(&entries[i], 0, sizeof(AssetPackEntry));
+		memcpy(entries[i].name, assets[i].name.data(), assets[i].name.size());
+		entries[i].type = assets[i].type;
+		entries[i].offset = offset;
+		entries[i].size = assets[i].data.size();
+
+		offset += assets[i].data.size();
+	}
+
+	AssetPackHeader header;
+	header.magic = AssetPackMagic;
+	header.version = AssetPackVersion;
+	header.entryCount = (uint32_t)entries.size();
+	header.reserved = 0;
+	header.fileSize = offset;
+
+	std::ofstream file(path, std::ios::binary);
+
+	if (file.is_open() == false)
+	{
+		std::cout << "Couldn't write " << path << std::endl;
+		return false;
+	}
+
+	file.write((const char*)&header, sizeof(header));
+
+	if (entries.empty() == false)
+	{
+		file.write((const char*)entries.data(), sizeof(AssetPackEntry) * entries.size());
+	}
+
+	const char padding[AssetPackAlignment] = {};
+
+	for (size_t i = 0; i < assets.size(); ++i)
+	{
+		uint64_t position = (uint64_t)file.tellp();
+		file.write(padding, (std::streamsize)(entries[i].offset - position));
+		file.write(assets[i].data.data(), (std::streamsize)assets[i].data.size());
+	}
+
+	return file.good();
+}
+
+static bool ParsePositionFormat(const char* name, VertexPositionFormat* format)
+{
+	if (strcmp(name, "float") == 0) { *format = VertexPositionFormat_Float32; return true; }
+	if (strcmp(name, "snorm16") == 0) { *format = VertexPositionFormat_Snorm16; return true; }
+	if (strcmp(name, "half") == 0) { *format = VertexPositionFormat_Half; return true; }
+	return false;
+}
+
+static bool ParseAttributeFormat(const char* name, VertexAttributeFormat* format)
+{
+	if (strcmp(name, "float") == 0) { *format = VertexAttributeFormat_Float32; return true; }
+	if (strcmp(name, "rgba8") == 0) { *format = VertexAttributeFormat_Unorm8; return true; }
+	if (strcmp(name, "rgb10a2") == 0) { *format = VertexAttributeFormat_Unorm10; return true; }
+	return false;
+}
+
+// Writes a SPIR-V module as a constexpr array so it can be compiled into the application
+static bool EmbedShader(const char* inputPath, const char* outputPath, const char* symbol)
+{
+	std::ifstream input(inputPath, std::ios::binary);
+
+	if (input.is_open() == false)
+	{
+		std::cout << "Couldn't read " << inputPath << std::endl;
+		return false;
+	}
+
+	std::vector<char> code((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+	uint32_t magic = 0;
+
+	if (code.size() >= sizeof(magic))
+	{
+		memcpy(&magic, code.data(), sizeof(magic));
+	}
+
+	if (magic != 0x07230203 || code.size() % 4 != 0)
+	{
+		std::cout << inputPath << ": not a SPIR-V module" << std::endl;
+		return false;
+	}
+
+	std::ofstream output(outputPath);
+
+	if (output.is_open() == false)
+	{
+		std::cout << "Couldn't write " << outputPath << std::endl;
+		return false;
+	}
+
+	output << "// Generated from " << inputPath << " by AssetPacker --embed, do not edit\n";
+	output << "#pragma once\n\n#include <cstdint>\n\n";
+	output << "constexpr uint32_t " << symbol << "[] = {";
+
+	size_t wordCount = code.size() / 4;
+
+	for (size_t i = 0; i < wordCount; ++i)
+	{
+		uint32_t word;
+		memcpy(&word, &code[i * 4], 4);
+
+		char text[16];
+		snprintf(text, sizeof(text), "0x%08x", word);
+		output << (i % 8 == 0 ? "\n\t" : " ") << text << (i + 1 < wordCount ? "," : "");
+	}
+
+	output << "\n};\n";
+
+	return output.good();
+}
+
+int main(int argc, char** argv)
+{
+	if (argc == 5 && strcmp(argv[1], "--embed") == 0)
+	{
+		return EmbedShader(argv[2], argv[3], argv[4]) ? 0 : 1;
+	}
+
+	// Meshes default to the compact layout, 12 byte vertices instead of 24
+	VertexFormat vertexFormat = GetDefaultVertexFormat();
+	vertexFormat.position = VertexPositionFormat_Snorm16;
+	vertexFormat.attribute = VertexAttributeFormat_Unorm8;
+
+	int firstArgument = 1;
+
+	for (; firstArgument + 1 < argc && strncmp(argv[firstArgument], "--", 2) == 0; firstArgument += 2)
+	{
+		bool valid = false;
+
+		if (strcmp(argv[firstArgument], "--positions") == 0)
+		{
+			valid = ParsePositionFormat(argv[firstArgument + 1], &vertexFormat.position);
+		}
+		else if (strcmp(argv[firstArgument], "--attributes") == 0)
+		{
+			valid = ParseAttributeFormat(argv[firstArgument + 1], &vertexFormat.attribute);
+		}
+
+		if (valid == false)
+		{
+			std::cout << "Unknown option " << argv[firstArgument] << " " << argv[firstArgument + 1] << std::endl;
+			return 1;
+		}
+	}
+
+	if (argc - firstArgument < 1)
+	{
+		std::cout << "Usage: AssetPacker [--positions float|snorm16|half] [--attributes float|rgba8|rgb10a2] <output.pack> [<name>=<file> ...]" << std::endl;
+		std::cout << "       AssetPacker --embed <input.spv> <output.h> <symbol>" << std::endl;
+		std::cout << "Asset types come from the file extension: .ktx2/.dds texture, .obj/.gltf/.glb/.mesh mesh, anything else raw" << std::endl;
+		return 1;
+	}
+
+	const char* outputPath = argv[firstArgument];
+	std::vector<InputAsset> assets(argc - firstArgument - 1);
+
+	for (int i = firstArgument + 1; i < argc; ++i)
+	{
+		if (ReadAsset(argv[i], vertexFormat, &assets[i - firstArgument - 1]) == false)
+		{
+			return 1;
+		}
+	}
+
+	if (WritePack(outputPath, assets) == false)
+	{
+		return 1;
+	}
+
+	std::cout << "Packed " << assets.size() << " assets into " << outputPath << std::endl;
+	return 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Matches the application's vertex layout, position followed by a colour attribute
+struct MeshVertex
+{
+	float position[3];
+	float attribute[3];
+};
+
+// Indexed triangle list
+struct Mesh
+{
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+};
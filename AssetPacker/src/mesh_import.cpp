@@ -0,0 +1,801 @@
+#include "mesh_import.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+static bool EndsWith(const std::string& value, const char* suffix)
+{
+	size_t suffixLength = strlen(suffix);
+	return value.size() >= suffixLength && value.compare(value.size() - suffixLength, suffixLength, suffix) == 0;
+}
+
+bool IsMeshSourceFile(const char* path)
+{
+	std::string name = path;
+	return EndsWith(name, ".obj") || EndsWith(name, ".gltf") || EndsWith(name, ".glb");
+}
+
+// Merges bitwise identical vertices
+class VertexWelder
+{
+public:
+	VertexWelder(Mesh* mesh) : mesh(mesh)
+	{
+	}
+
+	uint32_t Add(const MeshVertex& vertex)
+	{
+		std::string key((const char*)&vertex, sizeof(vertex));
+		std::unordered_map<std::string, uint32_t>::const_iterator existing = lookup.find(key);
+
+		if (existing != lookup.end())
+		{
+			return existing->second;
+		}
+
+		uint32_t index = (uint32_t)mesh->vertices.size();
+		mesh->vertices.push_back(vertex);
+		lookup[key] = index;
+		return index;
+	}
+
+private:
+	Mesh* mesh;
+	std::unordered_map<std::string, uint32_t> lookup;
+};
+
+static void SetNormalAttribute(MeshVertex* vertex, const float* normal)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		vertex->attribute[i] = normal[i] * 0.5f + 0.5f;
+	}
+}
+
+// OBJ indices are 1 based, negative values count back from the most recent element
+static bool ResolveOBJIndex(long index, size_t count, size_t* resolved)
+{
+	if (index > 0 && (size_t)index <= count)
+	{
+		*resolved = (size_t)index - 1;
+		return true;
+	}
+
+	if (index < 0 && (size_t)-index <= count)
+	{
+		*resolved = count + index;
+		return true;
+	}
+
+	return false;
+}
+
+static bool ImportOBJ(const char* path, Mesh* mesh)
+{
+	std::ifstream file(path);
+
+	if (file.is_open() == false)
+	{
+		std::cout << "Couldn't read " << path << std::endl;
+		return false;
+	}
+
+	std::vector<float> positions;
+	std::vector<float> colors;
+	std::vector<float> normals;
+	VertexWelder welder(mesh);
+
+	std::string line;
+	size_t lineNumber = 0;
+
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+		std::istringstream stream(line);
+		std::string keyword;
+		stream >> keyword;
+
+		if (keyword == "v")
+		{
+			// Optional per vertex colour extension: v x y z r g b
+			float values[6] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+			int count = 0;
+
+			while (count < 6 && (stream >> values[count]))
+			{
+				++count;
+			}
+
+			positions.insert(positions.end(), values, values + 3);
+			colors.insert(colors.end(), values + 3, values + 6);
+		}
+		else if (keyword == "vn")
+		{
+			float normal[3] = { 0.0f, 0.0f, 1.0f };
+			stream >> normal[0] >> normal[1] >> normal[2];
+			normals.insert(normals.end(), normal, normal + 3);
+		}
+		else if (keyword == "f")
+		{
+			std::vector<uint32_t> polygon;
+			std::string corner;
+
+			while (stream >> corner)
+			{
+				// v, v/vt, v//vn or v/vt/vn
+				const char* text = corner.c_str();
+				char* end;
+				long positionIndex = strtol(text, &end, 10);
+				long normalIndex = 0;
+
+				if (*end == '/')
+				{
+					const char* normalText = strchr(end + 1, '/');
+
+					if (normalText != NULL)
+					{
+						normalIndex = strtol(normalText + 1, NULL, 10);
+					}
+				}
+
+				size_t position;
+
+				if (ResolveOBJIndex(positionIndex, positions.size() / 3, &position) == false)
+				{
+					std::cout << path << "(" << lineNumber << "): bad vertex index" << std::endl;
+					return false;
+				}
+
+				MeshVertex vertex;
+				memcpy(vertex.position, &positions[position * 3], sizeof(vertex.position));
+				memcpy(vertex.attribute, &colors[position * 3], sizeof(vertex.attribute));
+
+				size_t normal;
+
+				if (normalIndex != 0 && ResolveOBJIndex(normalIndex, normals.size() / 3, &normal))
+				{
+					SetNormalAttribute(&vertex, &normals[normal * 3]);
+				}
+
+				polygon.push_back(welder.Add(vertex));
+			}
+
+			// Fan triangulate, faces are assumed convex
+			for (size_t i = 2; i < polygon.size(); ++i)
+			{
+				mesh->indices.push_back(polygon[0]);
+				mesh->indices.push_back(polygon[i - 1]);
+				mesh->indices.push_back(polygon[i]);
+			}
+		}
+	}
+
+	return true;
+}
+
+// Just enough JSON for glTF
+struct JsonValue
+{
+	enum Type { Null, Bool, Number, String, Array, Object };
+
+	Type type;
+	double number;
+	std::string string;
+	std::vector<JsonValue> elements;
+	std::vector<std::string> keys;
+
+	JsonValue() : type(Null), number(0.0)
+	{
+	}
+
+	const JsonValue* Find(const char* key) const
+	{
+		for (size_t i = 0; i < keys.size(); ++i)
+		{
+			if (keys[i] == key)
+			{
+				return &elements[i];
+			}
+		}
+
+		return NULL;
+	}
+
+	double GetNumber(const char* key, double fallback) const
+	{
+		const JsonValue* value = Find(key);
+		return value != NULL && value->type == Number ? value->number : fallback;
+	}
+};
+
+class JsonParser
+{
+public:
+	JsonParser(const char* text, size_t length) : current(text), end(text + length)
+	{
+	}
+
+	bool Parse(JsonValue* value)
+	{
+		return ParseValue(value, 0);
+	}
+
+private:
+	static const int MaxDepth = 64;
+
+	void SkipWhitespace()
+	{
+		while (current < end && (*current == ' ' || *current == '\t' || *current == '\n' || *current == '\r'))
+		{
+			++current;
+		}
+	}
+
+	bool Consume(const char* literal)
+	{
+		size_t length = strlen(literal);
+
+		if ((size_t)(end - current) < length || strncmp(current, literal, length) != 0)
+		{
+			return false;
+		}
+
+		current += length;
+		return true;
+	}
+
+	bool ParseString(std::string* string)
+	{
+		if (current >= end || *current != '"')
+		{
+			return false;
+		}
+
+		++current;
+
+		while (current < end && *current != '"')
+		{
+			if (*current == '\\')
+			{
+				if (++current >= end)
+				{
+					return false;
+				}
+
+				// Only the escapes glTF names and URIs realistically use, \u is passed through
+				switch (*current)
+				{
+				case 'n': string->push_back('\n'); break;
+				case 't': string->push_back('\t'); break;
+				case 'r': string->push_back('\r'); break;
+				case 'b': string->push_back('\b'); break;
+				case 'f': string->push_back('\f'); break;
+				case 'u': string->append("\\u"); break;
+				default: string->push_back(*current); break;
+				}
+			}
+			else
+			{
+				string->push_back(*current);
+			}
+
+			++current;
+		}
+
+		if (current >= end)
+		{
+			return false;
+		}
+
+		++current;
+		return true;
+	}
+
+	bool ParseValue(JsonValue* value, int depth)
+	{
+		SkipWhitespace();
+
+		if (current >= end || depth > MaxDepth)
+		{
+			return false;
+		}
+
+		if (*current == '{')
+		{
+			value->type = JsonValue::Object;
+			++current;
+			SkipWhitespace();
+
+			if (current < end && *current == '}')
+			{
+				++current;
+				return true;
+			}
+
+			for (;;)
+			{
+				SkipWhitespace();
+				value->keys.push_back(std::string());
+
+				if (ParseString(&value->keys.back()) == false)
+				{
+					return false;
+				}
+
+				SkipWhitespace();
+
+				if (Consume(":") == false)
+				{
+					return false;
+				}
+
+				value->elements.push_back(JsonValue());
+
+				if (ParseValue(&value->elements.back(), depth + 1) == false)
+				{
+					return false;
+				}
+
+				SkipWhitespace();
+
+				if (Consume("}"))
+				{
+					return true;
+				}
+
+				if (Consume(",") == false)
+				{
+					return false;
+				}
+			}
+		}
+
+		if (*current == '[')
+		{
+			value->type = JsonValue::Array;
+			++current;
+			SkipWhitespace();
+
+			if (current < end && *current == ']')
+			{
+				++current;
+				return true;
+			}
+
+			for (;;)
+			{
+				value->elements.push_back(JsonValue());
+
+				if (ParseValue(&value->elements.back(), depth + 1) == false)
+				{
+					return false;
+				}
+
+				SkipWhitespace();
+
+				if (Consume("]"))
+				{
+					return true;
+				}
+
+				if (Consume(",") == false)
+				{
+					return false;
+				}
+			}
+		}
+
+		if (*current == '"')
+		{
+			value->type = JsonValue::String;
+			return ParseString(&value->string);
+		}
+
+		if (Consume("true"))
+		{
+			value->type = JsonValue::Bool;
+			value->number = 1.0;
+			return true;
+		}
+
+		if (Consume("false"))
+		{
+			value->type = JsonValue::Bool;
+			value->number = 0.0;
+			return true;
+		}
+
+		if (Consume("null"))
+		{
+			value->type = JsonValue::Null;
+			return true;
+		}
+
+		// strtod needs a terminated string, numbers are short so copy them out
+		char number[64];
+		size_t length = 0;
+
+		while (current + length < end && length < sizeof(number) - 1 && strchr("+-0123456789.eE", current[length]) != NULL)
+		{
+			number[length] = current[length];
+			++length;
+		}
+
+		if (length == 0)
+		{
+			return false;
+		}
+
+		number[length] = '\0';
+		value->type = JsonValue::Number;
+		value->number = strtod(number, NULL);
+		current += length;
+		return true;
+	}
+
+	const char* current;
+	const char* end;
+};
+
+static bool DecodeBase64(const char* text, std::vector<unsigned char>* data)
+{
+	uint32_t accumulator = 0;
+	int bits = 0;
+
+	for (; *text != '\0' && *text != '='; ++text)
+	{
+		const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		const char* position = strchr(alphabet, *text);
+
+		if (position == NULL)
+		{
+			return false;
+		}
+
+		accumulator = (accumulator << 6) | (uint32_t)(position - alphabet);
+		bits += 6;
+
+		if (bits >= 8)
+		{
+			bits -= 8;
+			data->push_back((unsigned char)(accumulator >> bits));
+		}
+	}
+
+	return true;
+}
+
+static bool ReadBinaryFile(const std::string& path, std::vector<unsigned char>* data)
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+
+	if (file.is_open() == false)
+	{
+		std::cout << "Couldn't read " << path << std::endl;
+		return false;
+	}
+
+	data->assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return true;
+}
+
+struct GLTFDocument
+{
+	JsonValue root;
+	std::vector<std::vector<unsigned char> > buffers;
+};
+
+// Reads count elements of an accessor, normalising integer components when the accessor asks for it.
+// Doubles keep 32 bit indices exact.
+// Returns false if the accessor is out of bounds or has an unexpected component count.
+static bool ReadAccessor(const GLTFDocument& document, uint32_t accessorIndex, uint32_t components, std::vector<double>* values, uint32_t* count)
+{
+	const JsonValue* accessors = document.root.Find("accessors");
+	const JsonValue* bufferViews = document.root.Find("bufferViews");
+
+	if (accessors == NULL || bufferViews == NULL || accessorIndex >= accessors->elements.size())
+	{
+		return false;
+	}
+
+	const JsonValue& accessor = accessors->elements[accessorIndex];
+	const JsonValue* typeValue = accessor.Find("type");
+	std::string type = typeValue != NULL ? typeValue->string : "";
+	uint32_t accessorComponents = type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3 : type == "VEC4" ? 4 : 0;
+
+	if (accessorComponents < components || accessor.Find("bufferView") == NULL || accessor.Find("sparse") != NULL)
+	{
+		return false;
+	}
+
+	uint32_t componentType = (uint32_t)accessor.GetNumber("componentType", 0);
+	uint32_t componentSize = componentType == 5126 || componentType == 5125 ? 4 : componentType == 5123 || componentType == 5122 ? 2 : 1;
+	const JsonValue* normalizedValue = accessor.Find("normalized");
+	bool normalized = normalizedValue != NULL && normalizedValue->number != 0.0;
+
+	uint32_t viewIndex = (uint32_t)accessor.GetNumber("bufferView", 0);
+
+	if (viewIndex >= bufferViews->elements.size())
+	{
+		return false;
+	}
+
+	const JsonValue& view = bufferViews->elements[viewIndex];
+	uint32_t bufferIndex = (uint32_t)view.GetNumber("buffer", 0);
+
+	if (bufferIndex >= document.buffers.size())
+	{
+		return false;
+	}
+
+	const std::vector<unsigned char>& buffer = document.buffers[bufferIndex];
+	size_t offset = (size_t)view.GetNumber("byteOffset", 0) + (size_t)accessor.GetNumber("byteOffset", 0);
+	size_t stride = (size_t)view.GetNumber("byteStride", accessorComponents * componentSize);
+	*count = (uint32_t)accessor.GetNumber("count", 0);
+
+	if (*count > 0 && offset + (size_t)(*count - 1) * stride + accessorComponents * componentSize > buffer.size())
+	{
+		return false;
+	}
+
+	values->resize((size_t)*count * components);
+
+	for (uint32_t element = 0; element < *count; ++element)
+	{
+		const unsigned char* source = &buffer[offset + element * stride];
+
+		for (uint32_t component = 0; component < components; ++component)
+		{
+			const unsigned char* data = source + component * componentSize;
+			double value;
+
+			switch (componentType)
+			{
+			case 5126: { float f; memcpy(&f, data, 4); value = f; break; }
+			case 5125: { uint32_t u; memcpy(&u, data, 4); value = u; break; }
+			case 5123: { uint16_t u; memcpy(&u, data, 2); value = normalized ? u / 65535.0 : u; break; }
+			case 5121: { value = normalized ? data[0] / 255.0 : data[0]; break; }
+			default: return false;
+			}
+
+			(*values)[(size_t)element * components + component] = value;
+		}
+	}
+
+	return true;
+}
+
+static bool LoadGLTFDocument(const char* path, GLTFDocument* document)
+{
+	std::vector<unsigned char> file;
+
+	if (ReadBinaryFile(path, &file) == false)
+	{
+		return false;
+	}
+
+	const char* json = (const char*)file.data();
+	size_t jsonLength = file.size();
+	std::vector<unsigned char> binaryChunk;
+
+	// GLB: 12 byte header, JSON chunk, optional BIN chunk
+	if (file.size() >= 20 && memcmp(file.data(), "glTF", 4) == 0)
+	{
+		uint32_t chunkLength;
+		memcpy(&chunkLength, &file[12], 4);
+
+		if (memcmp(&file[16], "JSON", 4) != 0 || 20 + (size_t)chunkLength > file.size())
+		{
+			std::cout << path << ": malformed GLB" << std::endl;
+			return false;
+		}
+
+		json = (const char*)&file[20];
+		jsonLength = chunkLength;
+
+		size_t binaryOffset = 20 + (size_t)chunkLength;
+
+		if (binaryOffset + 8 <= file.size() && memcmp(&file[binaryOffset + 4], "BIN\0", 4) == 0)
+		{
+			uint32_t binaryLength;
+			memcpy(&binaryLength, &file[binaryOffset], 4);
+
+			if (binaryOffset + 8 + binaryLength > file.size())
+			{
+				std::cout << path << ": malformed GLB" << std::endl;
+				return false;
+			}
+
+			binaryChunk.assign(file.begin() + binaryOffset + 8, file.begin() + binaryOffset + 8 + binaryLength);
+		}
+	}
+
+	JsonParser parser(json, jsonLength);
+
+	if (parser.Parse(&document->root) == false || document->root.type != JsonValue::Object)
+	{
+		std::cout << path << ": couldn't parse JSON" << std::endl;
+		return false;
+	}
+
+	std::string directory = path;
+	size_t separator = directory.find_last_of("/\\");
+	directory = separator != std::string::npos ? directory.substr(0, separator + 1) : "";
+
+	const JsonValue* buffers = document->root.Find("buffers");
+	document->buffers.resize(buffers != NULL ? buffers->elements.size() : 0);
+
+	for (size_t i = 0; i < document->buffers.size(); ++i)
+	{
+		const JsonValue* uri = buffers->elements[i].Find("uri");
+
+		if (uri == NULL)
+		{
+			document->buffers[i] = binaryChunk;
+		}
+		else if (uri->string.compare(0, 5, "data:") == 0)
+		{
+			size_t comma = uri->string.find(";base64,");
+
+			if (comma == std::string::npos || DecodeBase64(uri->string.c_str() + comma + 8, &document->buffers[i]) == false)
+			{
+				std::cout << path << ": unsupported data URI" << std::endl;
+				return false;
+			}
+		}
+		else if (ReadBinaryFile(directory + uri->string, &document->buffers[i]) == false)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Every triangle primitive of every mesh is merged, node transforms are not applied
+static bool ImportGLTF(const char* path, Mesh* mesh)
+{
+	GLTFDocument document;
+
+	if (LoadGLTFDocument(path, &document) == false)
+	{
+		return false;
+	}
+
+	const JsonValue* meshes = document.root.Find("meshes");
+	VertexWelder welder(mesh);
+
+	for (size_t m = 0; meshes != NULL && m < meshes->elements.size(); ++m)
+	{
+		const JsonValue* primitives = meshes->elements[m].Find("primitives");
+
+		for (size_t p = 0; primitives != NULL && p < primitives->elements.size(); ++p)
+		{
+			const JsonValue& primitive = primitives->elements[p];
+			const JsonValue* attributes = primitive.Find("attributes");
+
+			// Triangle lists only
+			if (primitive.GetNumber("mode", 4) != 4 || attributes == NULL || attributes->Find("POSITION") == NULL)
+			{
+				std::cout << path << ": skipping non triangle list primitive" << std::endl;
+				continue;
+			}
+
+			std::vector<double> positions;
+			std::vector<double> colors;
+			std::vector<double> normals;
+			uint32_t vertexCount;
+			uint32_t attributeCount;
+
+			if (ReadAccessor(document, (uint32_t)attributes->GetNumber("POSITION", 0), 3, &positions, &vertexCount) == false)
+			{
+				std::cout << path << ": bad POSITION accessor" << std::endl;
+				return false;
+			}
+
+			if (attributes->Find("COLOR_0") != NULL && (ReadAccessor(document, (uint32_t)attributes->GetNumber("COLOR_0", 0), 3, &colors, &attributeCount) == false || attributeCount != vertexCount))
+			{
+				std::cout << path << ": bad COLOR_0 accessor" << std::endl;
+				return false;
+			}
+
+			if (attributes->Find("NORMAL") != NULL && (ReadAccessor(document, (uint32_t)attributes->GetNumber("NORMAL", 0), 3, &normals, &attributeCount) == false || attributeCount != vertexCount))
+			{
+				std::cout << path << ": bad NORMAL accessor" << std::endl;
+				return false;
+			}
+
+			std::vector<uint32_t> remap(vertexCount);
+
+			for (uint32_t v = 0; v < vertexCount; ++v)
+			{
+				MeshVertex vertex;
+
+				for (int i = 0; i < 3; ++i)
+				{
+					vertex.position[i] = (float)positions[v * 3 + i];
+				}
+
+				if (colors.empty() == false)
+				{
+					for (int i = 0; i < 3; ++i)
+					{
+						vertex.attribute[i] = (float)colors[v * 3 + i];
+					}
+				}
+				else if (normals.empty() == false)
+				{
+					float normal[3] = { (float)normals[v * 3], (float)normals[v * 3 + 1], (float)normals[v * 3 + 2] };
+					SetNormalAttribute(&vertex, normal);
+				}
+				else
+				{
+					vertex.attribute[0] = vertex.attribute[1] = vertex.attribute[2] = 1.0f;
+				}
+
+				remap[v] = welder.Add(vertex);
+			}
+
+			if (primitive.Find("indices") != NULL)
+			{
+				std::vector<double> indices;
+				uint32_t indexCount;
+
+				if (ReadAccessor(document, (uint32_t)primitive.GetNumber("indices", 0), 1, &indices, &indexCount) == false)
+				{
+					std::cout << path << ": bad indices accessor" << std::endl;
+					return false;
+				}
+
+				for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+				{
+					for (uint32_t corner = 0; corner < 3; ++corner)
+					{
+						uint32_t index = (uint32_t)indices[i + corner];
+
+						if (index >= vertexCount)
+						{
+							std::cout << path << ": index out of range" << std::endl;
+							return false;
+						}
+
+						mesh->indices.push_back(remap[index]);
+					}
+				}
+			}
+			else
+			{
+				for (uint32_t v = 0; v + 2 < vertexCount; v += 3)
+				{
+					mesh->indices.push_back(remap[v]);
+					mesh->indices.push_back(remap[v + 1]);
+					mesh->indices.push_back(remap[v + 2]);
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+bool ImportMesh(const char* path, Mesh* mesh)
+{
+	mesh->vertices.clear();
+	mesh->indices.clear();
+
+	bool imported = EndsWith(path, ".obj") ? ImportOBJ(path, mesh) : ImportGLTF(path, mesh);
+
+	if (imported && mesh->indices.empty())
+	{
+		std::cout << path << ": no triangles" << std::endl;
+		return false;
+	}
+
+	return imported;
+}
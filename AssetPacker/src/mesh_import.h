@@ -0,0 +1,10 @@
+#pragma once
+
+#include "mesh.h"
+
+// Loads a Wavefront OBJ, glTF or GLB file as a single indexed triangle list with identical
+// vertices merged. The vertex attribute is the vertex colour when present, otherwise the
+// normal remapped to 0-1.
+bool ImportMesh(const char* path, Mesh* mesh);
+
+bool IsMeshSourceFile(const char* path);
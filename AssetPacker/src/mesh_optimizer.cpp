@@ -0,0 +1,311 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Next fanning vertex: the candidate that stays in cache longest while still having live
+// triangles, or failing that a dead end vertex or the next unprocessed one in input order.
+static int GetNextVertex(const std::vector<uint32_t>& candidates, const std::vector<uint32_t>& liveTriangles, const std::vector<uint32_t>& cacheTime, uint32_t timeStamp, uint32_t cacheSize, std::vector<uint32_t>* deadEnd, uint32_t* cursor, bool* coldStart)
+{
+	int best = -1;
+	int bestPriority = -1;
+
+	for (size_t i = 0; i < candidates.size(); ++i)
+	{
+		uint32_t vertex = candidates[i];
+
+		if (liveTriangles[vertex] == 0)
+		{
+			continue;
+		}
+
+		// Prefer the oldest vertex that will still be in the cache after emitting its triangles
+		int priority = 0;
+
+		if (timeStamp - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+		{
+			priority = (int)(timeStamp - cacheTime[vertex]);
+		}
+
+		if (priority > bestPriority)
+		{
+			best = (int)vertex;
+			bestPriority = priority;
+		}
+	}
+
+	if (best >= 0)
+	{
+		*coldStart = false;
+		return best;
+	}
+
+	*coldStart = true;
+
+	while (deadEnd->empty() == false)
+	{
+		uint32_t vertex = deadEnd->back();
+		deadEnd->pop_back();
+
+		if (liveTriangles[vertex] > 0)
+		{
+			return (int)vertex;
+		}
+	}
+
+	while (*cursor < liveTriangles.size())
+	{
+		uint32_t vertex = (*cursor)++;
+
+		if (liveTriangles[vertex] > 0)
+		{
+			return (int)vertex;
+		}
+	}
+
+	return -1;
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>* indices, uint32_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>* clusters)
+{
+	uint32_t triangleCount = (uint32_t)(indices->size() / 3);
+	clusters->clear();
+
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Vertex to triangle adjacency in compressed rows
+	std::vector<uint32_t> liveTriangles(vertexCount, 0);
+
+	for (size_t i = 0; i < indices->size(); ++i)
+	{
+		++liveTriangles[(*indices)[i]];
+	}
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+
+	for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+	{
+		adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+	}
+
+	std::vector<uint32_t> adjacency(indices->size());
+	std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+	for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+	{
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			adjacency[adjacencyFill[(*indices)[triangle * 3 + corner]]++] = triangle;
+		}
+	}
+
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnd;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	output.reserve(indices->size());
+
+	uint32_t timeStamp = cacheSize + 1;
+	uint32_t cursor = 1;
+	bool coldStart = true;
+	int fanningVertex = liveTriangles[0] > 0 ? 0 : GetNextVertex(candidates, liveTriangles, cacheTime, timeStamp, cacheSize, &deadEnd, &cursor, &coldStart);
+
+	while (fanningVertex >= 0)
+	{
+		if (coldStart)
+		{
+			clusters->push_back((uint32_t)(output.size() / 3));
+		}
+
+		candidates.clear();
+
+		for (uint32_t i = adjacencyOffsets[fanningVertex]; i < adjacencyOffsets[fanningVertex + 1]; ++i)
+		{
+			uint32_t triangle = adjacency[i];
+
+			if (emitted[triangle])
+			{
+				continue;
+			}
+
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				uint32_t vertex = (*indices)[triangle * 3 + corner];
+				output.push_back(vertex);
+				deadEnd.push_back(vertex);
+				candidates.push_back(vertex);
+				--liveTriangles[vertex];
+
+				if (timeStamp - cacheTime[vertex] > cacheSize)
+				{
+					cacheTime[vertex] = timeStamp++;
+				}
+			}
+
+			emitted[triangle] = true;
+		}
+
+		fanningVertex = GetNextVertex(candidates, liveTriangles, cacheTime, timeStamp, cacheSize, &deadEnd, &cursor, &coldStart);
+	}
+
+	indices->swap(output);
+}
+
+void OptimizeOverdraw(std::vector<uint32_t>* indices, const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& clusters)
+{
+	uint32_t triangleCount = (uint32_t)(indices->size() / 3);
+
+	if (clusters.size() < 2)
+	{
+		return;
+	}
+
+	struct Cluster
+	{
+		uint32_t firstTriangle;
+		uint32_t triangleCount;
+		float sortKey;
+	};
+
+	std::vector<Cluster> sortedClusters(clusters.size());
+	float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+	float meshArea = 0.0f;
+
+	std::vector<float> clusterCentroids(clusters.size() * 3, 0.0f);
+	std::vector<float> clusterNormals(clusters.size() * 3, 0.0f);
+
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		uint32_t first = clusters[c];
+		uint32_t last = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+		float clusterArea = 0.0f;
+
+		sortedClusters[c].firstTriangle = first;
+		sortedClusters[c].triangleCount = last - first;
+
+		for (uint32_t triangle = first; triangle < last; ++triangle)
+		{
+			const float* p0 = vertices[(*indices)[triangle * 3 + 0]].position;
+			const float* p1 = vertices[(*indices)[triangle * 3 + 1]].position;
+			const float* p2 = vertices[(*indices)[triangle * 3 + 2]].position;
+
+			float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float normal[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+
+			// Twice the area, the scale cancels out
+			float area = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float centroid = (p0[axis] + p1[axis] + p2[axis]) / 3.0f;
+				clusterCentroids[c * 3 + axis] += centroid * area;
+				clusterNormals[c * 3 + axis] += normal[axis];
+				meshCentroid[axis] += centroid * area;
+			}
+
+			clusterArea += area;
+		}
+
+		if (clusterArea > 0.0f)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				clusterCentroids[c * 3 + axis] /= clusterArea;
+			}
+		}
+
+		meshArea += clusterArea;
+	}
+
+	if (meshArea > 0.0f)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			meshCentroid[axis] /= meshArea;
+		}
+	}
+
+	// Clusters facing away from the centre are likely occluders, draw them first
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		const float* normal = &clusterNormals[c * 3];
+		float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		float key = 0.0f;
+
+		if (length > 0.0f)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				key += (clusterCentroids[c * 3 + axis] - meshCentroid[axis]) * normal[axis] / length;
+			}
+		}
+
+		sortedClusters[c].sortKey = key;
+	}
+
+	std::stable_sort(sortedClusters.begin(), sortedClusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+	std::vector<uint32_t> output;
+	output.reserve(indices->size());
+
+	for (size_t c = 0; c < sortedClusters.size(); ++c)
+	{
+		std::vector<uint32_t>::const_iterator first = indices->begin() + sortedClusters[c].firstTriangle * 3;
+		output.insert(output.end(), first, first + sortedClusters[c].triangleCount * 3);
+	}
+
+	indices->swap(output);
+}
+
+void OptimizeVertexFetch(Mesh* mesh)
+{
+	const uint32_t unassigned = 0xffffffff;
+	std::vector<uint32_t> remap(mesh->vertices.size(), unassigned);
+	std::vector<MeshVertex> vertices;
+	vertices.reserve(mesh->vertices.size());
+
+	for (size_t i = 0; i < mesh->indices.size(); ++i)
+	{
+		uint32_t& index = mesh->indices[i];
+
+		if (remap[index] == unassigned)
+		{
+			remap[index] = (uint32_t)vertices.size();
+			vertices.push_back(mesh->vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	mesh->vertices.swap(vertices);
+}
+
+float ComputeACMR(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+	if (indices.size() < 3)
+	{
+		return 0.0f;
+	}
+
+	// FIFO cache, a vertex is in the cache if it was inserted within the last cacheSize misses
+	std::vector<uint32_t> insertedAt(vertexCount, 0);
+	uint32_t misses = 0;
+
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		uint32_t vertex = indices[i];
+
+		if (insertedAt[vertex] == 0 || misses + 1 - insertedAt[vertex] > cacheSize)
+		{
+			++misses;
+			insertedAt[vertex] = misses;
+		}
+	}
+
+	return (float)misses / (float)(indices.size() / 3);
+}
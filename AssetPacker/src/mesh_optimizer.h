@@ -0,0 +1,23 @@
+#pragma once
+
+#include "mesh.h"
+
+// Post transform cache size the optimisations target. Most hardware behaves like a FIFO of
+// roughly this many entries.
+const uint32_t DefaultVertexCacheSize = 16;
+
+// Reorders triangles for post transform vertex cache locality using Tipsify
+// (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+// clusters receives the first triangle of each run that starts with a cold cache, for OptimizeOverdraw.
+void OptimizeVertexCache(std::vector<uint32_t>* indices, uint32_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>* clusters);
+
+// Reorders the clusters from OptimizeVertexCache so outward facing ones are drawn first and occlude
+// the rest. Triangle order within clusters, and so cache efficiency, is preserved.
+void OptimizeOverdraw(std::vector<uint32_t>* indices, const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& clusters);
+
+// Sorts vertices into first use order so fetches walk memory linearly, dropping unused vertices
+void OptimizeVertexFetch(Mesh* mesh);
+
+// Average cache miss ratio, vertex shader invocations per triangle for a FIFO cache of cacheSize.
+// 3.0 is the worst case, 0.5 the best achievable on a regular grid.
+float ComputeACMR(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize);
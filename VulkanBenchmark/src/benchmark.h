@@ -0,0 +1,137 @@
+#pragma once
+
+#include <vector>
+
+#include "vulkan_helpers.h"
+
+// Everything a scenario renders with: an offscreen colour target, the tri shaders with their
+// layout and a triangle. No surface or swapchain, so it runs without a display.
+struct BenchmarkContext
+{
+	VkInstance instance;
+	VkDebugReportCallbackEXT debugCallback;	// Only with --validation
+	VkPhysicalDevice physicalDevice;
+	VkPhysicalDeviceProperties properties;
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	VkDevice device;
+	VkQueue queue;
+	uint32_t queueFamily;
+	VkCommandPool commandPool;
+	VkCommandBuffer commandBuffer;
+	VkFence frameFence;
+
+	uint32_t width;
+	uint32_t height;
+	VkImage colorImage;
+	VkDeviceMemory colorMemory;
+	VkImageView colorView;
+	VkRenderPass renderPass;
+	VkFramebuffer framebuffer;
+
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkPipelineLayout pipelineLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet descriptorSet;
+	VkBuffer uniformBuffer;
+	VkDeviceMemory uniformMemory;
+	VkShaderModule vertModule;
+	VkShaderModule fragModule;
+	VkPipelineCache pipelineCache;
+	VkPipeline pipeline;
+	VertexFormat vertexFormat;
+
+	// Opaque white, bound where the mesh shaders sample the application's streamed texture
+	VkImage textureImage;
+	VkDeviceMemory textureMemory;
+	VkImageView textureView;
+	VkSampler textureSampler;
+
+	VkBuffer vertexBuffer;
+	VkDeviceMemory vertexMemory;
+	VkBuffer indexBuffer;
+	VkDeviceMemory indexMemory;
+
+	// One identity matrix, the mesh pipelines read it for every instance
+	VkBuffer instanceBuffer;
+	VkDeviceMemory instanceMemory;
+
+	// Running totals, sampled into BenchmarkStats around each scenario
+	uint32_t submitCount;
+	uint32_t objectsCreated;
+	VkDeviceSize deviceMemoryBytes;
+	VkDeviceSize peakDeviceMemoryBytes;
+};
+
+struct BenchmarkOptions
+{
+	const char* deviceName;
+	int deviceIndex;
+	bool allowSoftware;
+	bool validation;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct BenchmarkStats
+{
+	const char* scenario;
+	std::vector<double> cpuMilliseconds;	// Recording and submission
+	std::vector<double> frameMilliseconds;	// Including the wait for the GPU
+	uint32_t submits;
+	uint32_t objectsCreated;
+	VkDeviceSize peakDeviceMemoryBytes;
+	VkDeviceSize bytesUploaded;
+	uint64_t drawCalls;
+	uint64_t stateChanges;		// Pipeline, descriptor set and buffer binds
+	uint64_t culledObjects;		// Objects tested by CPU culling
+	double cullMilliseconds;
+};
+
+class BenchmarkScenario
+{
+public:
+	virtual ~BenchmarkScenario() {}
+
+	virtual const char* GetName() const = 0;
+	virtual const char* GetDescription() const = 0;
+
+	virtual bool Setup(BenchmarkContext* context) = 0;
+
+	// Records one frame into the context's command buffer, which is already begun
+	virtual bool RecordFrame(BenchmarkContext* context, BenchmarkStats* stats) = 0;
+
+	// Called after the frame's fence has signalled
+	virtual void EndFrame(BenchmarkContext* context) {}
+
+	virtual void Teardown(BenchmarkContext* context) = 0;
+};
+
+bool CreateBenchmarkContext(const BenchmarkOptions& options, BenchmarkContext* context);
+void DestroyBenchmarkContext(BenchmarkContext* context);
+
+// Host visible buffer through CreateBuffer, counted in the context's object and memory totals
+bool CreateTrackedBuffer(BenchmarkContext* context, VkBufferUsageFlags usage, const void* data, size_t dataSize, VkBuffer* buffer, VkDeviceMemory* memory);
+
+// Device local buffer, for upload destinations
+bool CreateTrackedDeviceBuffer(BenchmarkContext* context, VkBufferUsageFlags usage, VkDeviceSize size, VkBuffer* buffer, VkDeviceMemory* memory);
+
+void DestroyTrackedBuffer(BenchmarkContext* context, VkBuffer buffer, VkDeviceMemory memory);
+
+bool WriteUniforms(BenchmarkContext* context, float scale);
+
+// Points binding 1 of a set allocated with the context's layout at the white texture
+void WriteTextureDescriptor(BenchmarkContext* context, VkDescriptorSet descriptorSet);
+
+void BeginBenchmarkRenderPass(BenchmarkContext* context);
+void EndBenchmarkRenderPass(BenchmarkContext* context);
+
+// Binds the descriptor set and triangle buffers for pipeline and draws instanceCount copies
+void DrawTriangle(BenchmarkContext* context, VkPipeline pipeline, uint32_t instanceCount, BenchmarkStats* stats);
+
+// Runs frameCount frames after warmupFrames untimed ones
+bool RunBenchmarkScenario(BenchmarkContext* context, BenchmarkScenario* scenario, uint32_t warmupFrames, uint32_t frameCount, BenchmarkStats* stats);
+
+void GetBenchmarkScenarios(std::vector<BenchmarkScenario*>* scenarios);
+
+// Replays a frame captured by the test application with --capture, see frame_capture.h
+BenchmarkScenario* CreateCaptureReplayScenario(const char* path);
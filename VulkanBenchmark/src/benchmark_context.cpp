@@ -0,0 +1,847 @@
+#include "benchmark.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "device_selection.h"
+#include "device_profile.h"
+#include "logger.h"
+#include "mesh_pipeline.h"
+
+// Optimised SPIR-V generated from VulkanTestApplication/shaders by the build
+#include "tri.vert.h"
+#include "tri.frag.h"
+
+static const VkFormat colorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+VKAPI_ATTR VkBool32 VKAPI_CALL benchmark_debug_callback(VkFlags msgFlags, VkDebugReportObjectTypeEXT objType, uint64_t srcObject, size_t location, int32_t msgCode, const char *pLayerPrefix, const char *pMsg, void *pUserData)
+{
+	Log(msgFlags & VK_DEBUG_REPORT_ERROR_BIT_EXT ? LogSeverity_Error : LogSeverity_Warning, "%s: %s", pLayerPrefix, pMsg);
+	return false;
+}
+
+static void AddDeviceMemory(BenchmarkContext* context, VkDeviceSize size)
+{
+	context->deviceMemoryBytes += size;
+
+	if (context->deviceMemoryBytes > context->peakDeviceMemoryBytes)
+	{
+		context->peakDeviceMemoryBytes = context->deviceMemoryBytes;
+	}
+}
+
+static bool CreateInstance(const BenchmarkOptions& options, BenchmarkContext* context)
+{
+	VkApplicationInfo appInfo;
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pNext = NULL;
+	appInfo.pApplicationName = "VulkanBenchmark";
+	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+	appInfo.pEngineName = "VulkanTestApplication";
+	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+	appInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
+
+	// Headless, so no surface extensions
+	std::vector<const char*> enabledExtensions;
+	std::vector<const char*> enabledLayers;
+
+	if (options.validation)
+	{
+		enabledExtensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+		enabledLayers.push_back("VK_LAYER_LUNARG_standard_validation");
+	}
+
+	VkInstanceCreateInfo createInfo;
+	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	createInfo.pNext = NULL;
+	createInfo.flags = 0;
+	createInfo.pApplicationInfo = &appInfo;
+	createInfo.enabledLayerCount = (uint32_t)enabledLayers.size();
+	createInfo.ppEnabledLayerNames = enabledLayers.data();
+	createInfo.enabledExtensionCount = (uint32_t)enabledExtensions.size();
+	createInfo.ppEnabledExtensionNames = enabledExtensions.data();
+
+	if (vkCreateInstance(&createInfo, NULL, &context->instance) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to create instance" << std::endl;
+		return false;
+	}
+
+	if (options.validation)
+	{
+		VkDebugReportCallbackCreateInfoEXT debugReportCallbackCreateInfo;
+		debugReportCallbackCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CREATE_INFO_EXT;
+		debugReportCallbackCreateInfo.pNext = NULL;
+		debugReportCallbackCreateInfo.flags = VK_DEBUG_REPORT_ERROR_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT;
+		debugReportCallbackCreateInfo.pfnCallback = benchmark_debug_callback;
+		debugReportCallbackCreateInfo.pUserData = NULL;
+
+		PFN_vkCreateDebugReportCallbackEXT vkCreateDebugReportCallbackEXT = (PFN_vkCreateDebugReportCallbackEXT)vkGetInstanceProcAddr(context->instance, "vkCreateDebugReportCallbackEXT");
+
+		if (vkCreateDebugReportCallbackEXT == NULL || vkCreateDebugReportCallbackEXT(context->instance, &debugReportCallbackCreateInfo, NULL, &context->debugCallback) != VK_SUCCESS)
+		{
+			std::cerr << "Failed to install debug report callback" << std::endl;
+			context->debugCallback = VK_NULL_HANDLE;
+		}
+	}
+
+	return true;
+}
+
+static bool CreateDevice(const BenchmarkOptions& options, BenchmarkContext* context)
+{
+	// Nothing optional is used, textures aren't part of any scenario
+	DeviceProfile deviceProfile;
+
+	DeviceSelectionOptions deviceSelectionOptions;
+	deviceSelectionOptions.deviceName = options.deviceName;
+	deviceSelectionOptions.deviceIndex = options.deviceIndex;
+	deviceSelectionOptions.allowSoftware = options.allowSoftware;
+	deviceSelectionOptions.requiredFeatures = NULL;
+
+	std::vector<PhysicalDeviceCandidate> candidates;
+	uint32_t selected = 0;
+
+	if (EnumeratePhysicalDeviceCandidates(context->instance, deviceSelectionOptions, &candidates) == false
+		|| SelectPhysicalDevice(candidates, deviceSelectionOptions, &selected) == false)
+	{
+		std::cerr << "No suitable device found" << std::endl;
+		return false;
+	}
+
+	context->physicalDevice = candidates[selected].physicalDevice;
+	context->properties = candidates[selected].properties;
+	context->queueFamily = candidates[selected].graphicsQueueFamily;
+	vkGetPhysicalDeviceMemoryProperties(context->physicalDevice, &context->memoryProperties);
+
+	DeviceCapabilities deviceCapabilities;
+	NegotiateDeviceProfile(context->physicalDevice, deviceProfile, &deviceCapabilities);
+
+	const float queuePriorities[] = { 1.0f };
+	VkDeviceQueueCreateInfo deviceQueueCreateInfo;
+	deviceQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	deviceQueueCreateInfo.pNext = NULL;
+	deviceQueueCreateInfo.flags = 0;
+	deviceQueueCreateInfo.queueFamilyIndex = context->queueFamily;
+	deviceQueueCreateInfo.queueCount = 1;
+	deviceQueueCreateInfo.pQueuePriorities = queuePriorities;
+
+	VkDeviceCreateInfo deviceCreateInfo;
+	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceCreateInfo.pNext = NULL;
+	deviceCreateInfo.flags = 0;
+	deviceCreateInfo.queueCreateInfoCount = 1;
+	deviceCreateInfo.pQueueCreateInfos = &deviceQueueCreateInfo;
+	deviceCreateInfo.enabledLayerCount = 0;
+	deviceCreateInfo.ppEnabledLayerNames = NULL;
+	deviceCreateInfo.enabledExtensionCount = (uint32_t)deviceCapabilities.enabledExtensions.size();
+	deviceCreateInfo.ppEnabledExtensionNames = deviceCapabilities.enabledExtensions.data();
+	deviceCreateInfo.pEnabledFeatures = &deviceCapabilities.enabledFeatures;
+
+	if (vkCreateDevice(context->physicalDevice, &deviceCreateInfo, NULL, &context->device) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to create logical device" << std::endl;
+		return false;
+	}
+
+	vkGetDeviceQueue(context->device, context->queueFamily, 0, &context->queue);
+
+	VkCommandPoolCreateInfo commandPoolCreateInfo;
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.pNext = NULL;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	commandPoolCreateInfo.queueFamilyIndex = context->queueFamily;
+
+	if (vkCreateCommandPool(context->device, &commandPoolCreateInfo, NULL, &context->commandPool) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to create command pool" << std::endl;
+		return false;
+	}
+
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo;
+	commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	commandBufferAllocateInfo.pNext = NULL;
+	commandBufferAllocateInfo.commandPool = context->commandPool;
+	commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	commandBufferAllocateInfo.commandBufferCount = 1;
+
+	if (vkAllocateCommandBuffers(context->device, &commandBufferAllocateInfo, &context->commandBuffer) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to allocate command buffer" << std::endl;
+		return false;
+	}
+
+	VkFenceCreateInfo fenceCreateInfo;
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceCreateInfo.pNext = NULL;
+	fenceCreateInfo.flags = 0;
+
+	if (vkCreateFence(context->device, &fenceCreateInfo, NULL, &context->frameFence) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to create fence" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+static bool CreateRenderTarget(BenchmarkContext* context)
+{
+	VkImageCreateInfo imageCreateInfo;
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.pNext = NULL;
+	imageCreateInfo.flags = 0;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format = colorFormat;
+	imageCreateInfo.extent.width = context->width;
+	imageCreateInfo.extent.height = context->height;
+	imageCreateInfo.extent.depth = 1;
+	imageCreateInfo.mipLevels = 1;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.queueFamilyIndexCount = 0;
+	imageCreateInfo.pQueueFamilyIndices = NULL;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(context->device, &imageCreateInfo, NULL, &context->colorImage) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(context->device, context->colorImage, &memoryRequirements);
+
+	if (CreateDeviceMemory(context->device, context->memoryProperties.memoryTypes, &memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, (size_t)memoryRequirements.size, &context->colorMemory) == false
+		|| vkBindImageMemory(context->device, context->colorImage, context->colorMemory, 0) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	AddDeviceMemory(context, memoryRequirements.size);
+
+	VkImageViewCreateInfo imageViewCreateInfo;
+	imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	imageViewCreateInfo.pNext = NULL;
+	imageViewCreateInfo.flags = 0;
+	imageViewCreateInfo.image = context->colorImage;
+	imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	imageViewCreateInfo.format = colorFormat;
+	imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_R;
+	imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_G;
+	imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_B;
+	imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_A;
+	imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+	imageViewCreateInfo.subresourceRange.levelCount = 1;
+	imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+	imageViewCreateInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(context->device, &imageViewCreateInfo, NULL, &context->colorView) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	// Cleared every frame, so the previous contents never need preserving
+	VkAttachmentDescription attachmentDescription;
+	attachmentDescription.flags = 0;
+	attachmentDescription.format = colorFormat;
+	attachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
+	attachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	attachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachmentDescription.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference colorAttachmentReference;
+	colorAttachmentReference.attachment = 0;
+	colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpassDescription;
+	subpassDescription.flags = 0;
+	subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpassDescription.inputAttachmentCount = 0;
+	subpassDescription.pInputAttachments = NULL;
+	subpassDescription.colorAttachmentCount = 1;
+	subpassDescription.pColorAttachments = &colorAttachmentReference;
+	subpassDescription.pResolveAttachments = NULL;
+	subpassDescription.pDepthStencilAttachment = NULL;
+	subpassDescription.preserveAttachmentCount = 0;
+	subpassDescription.pPreserveAttachments = NULL;
+
+	VkRenderPassCreateInfo renderPassCreateInfo;
+	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassCreateInfo.pNext = NULL;
+	renderPassCreateInfo.flags = 0;
+	renderPassCreateInfo.attachmentCount = 1;
+	renderPassCreateInfo.pAttachments = &attachmentDescription;
+	renderPassCreateInfo.subpassCount = 1;
+	renderPassCreateInfo.pSubpasses = &subpassDescription;
+	renderPassCreateInfo.dependencyCount = 0;
+	renderPassCreateInfo.pDependencies = NULL;
+
+	if (vkCreateRenderPass(context->device, &renderPassCreateInfo, NULL, &context->renderPass) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkFramebufferCreateInfo framebufferCreateInfo;
+	framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferCreateInfo.pNext = NULL;
+	framebufferCreateInfo.flags = 0;
+	framebufferCreateInfo.renderPass = context->renderPass;
+	framebufferCreateInfo.attachmentCount = 1;
+	framebufferCreateInfo.pAttachments = &context->colorView;
+	framebufferCreateInfo.width = context->width;
+	framebufferCreateInfo.height = context->height;
+	framebufferCreateInfo.layers = 1;
+
+	return vkCreateFramebuffer(context->device, &framebufferCreateInfo, NULL, &context->framebuffer) == VK_SUCCESS;
+}
+
+// A single texel multiplies the mesh colour by one, so scenarios draw as if untextured
+static bool CreateWhiteTexture(BenchmarkContext* context)
+{
+	const unsigned char white[4] = { 255, 255, 255, 255 };
+	ImageMipData mipData = { white, sizeof(white) };
+
+	if (CreateImage2D(context->device, context->queue, context->commandPool, context->memoryProperties.memoryTypes, 1, 1, 1, VK_FORMAT_R8G8B8A8_UNORM, &mipData, 1,
+		&context->textureImage, &context->textureMemory) == false)
+	{
+		return false;
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(context->device, context->textureImage, &memoryRequirements);
+	AddDeviceMemory(context, memoryRequirements.size);
+
+	VkImageViewCreateInfo imageViewCreateInfo;
+	imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	imageViewCreateInfo.pNext = NULL;
+	imageViewCreateInfo.flags = 0;
+	imageViewCreateInfo.image = context->textureImage;
+	imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	imageViewCreateInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+	imageViewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+	imageViewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	if (vkCreateImageView(context->device, &imageViewCreateInfo, NULL, &context->textureView) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkSamplerCreateInfo samplerCreateInfo;
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.pNext = NULL;
+	samplerCreateInfo.flags = 0;
+	samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.mipLodBias = 0.0f;
+	samplerCreateInfo.anisotropyEnable = VK_FALSE;
+	samplerCreateInfo.maxAnisotropy = 1.0f;
+	samplerCreateInfo.compareEnable = VK_FALSE;
+	samplerCreateInfo.compareOp = VK_COMPARE_OP_NEVER;
+	samplerCreateInfo.minLod = 0.0f;
+	samplerCreateInfo.maxLod = 0.0f;
+	samplerCreateInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_WHITE;
+	samplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
+
+	if (vkCreateSampler(context->device, &samplerCreateInfo, NULL, &context->textureSampler) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	context->objectsCreated += 4;
+
+	return true;
+}
+
+static bool CreateDrawResources(BenchmarkContext* context)
+{
+	// Same layout as the application's mesh pipelines, binding 1 holds the white texture
+	VkDescriptorSetLayoutBinding descriptorSetLayoutBindings[2];
+	descriptorSetLayoutBindings[0].binding = 0;
+	descriptorSetLayoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	descriptorSetLayoutBindings[0].descriptorCount = 1;
+	descriptorSetLayoutBindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	descriptorSetLayoutBindings[0].pImmutableSamplers = NULL;
+
+	descriptorSetLayoutBindings[1].binding = 1;
+	descriptorSetLayoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorSetLayoutBindings[1].descriptorCount = 1;
+	descriptorSetLayoutBindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	descriptorSetLayoutBindings[1].pImmutableSamplers = NULL;
+
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo;
+	descriptorSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptorSetLayoutCreateInfo.pNext = NULL;
+	descriptorSetLayoutCreateInfo.flags = 0;
+	descriptorSetLayoutCreateInfo.bindingCount = 2;
+	descriptorSetLayoutCreateInfo.pBindings = descriptorSetLayoutBindings;
+
+	if (vkCreateDescriptorSetLayout(context->device, &descriptorSetLayoutCreateInfo, NULL, &context->descriptorSetLayout) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo;
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.pNext = NULL;
+	pipelineLayoutCreateInfo.flags = 0;
+	pipelineLayoutCreateInfo.setLayoutCount = 1;
+	pipelineLayoutCreateInfo.pSetLayouts = &context->descriptorSetLayout;
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
+	pipelineLayoutCreateInfo.pPushConstantRanges = NULL;
+
+	if (vkCreatePipelineLayout(context->device, &pipelineLayoutCreateInfo, NULL, &context->pipelineLayout) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkDescriptorPoolSize descriptorPoolSizes[2];
+	descriptorPoolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	descriptorPoolSizes[0].descriptorCount = 1;
+	descriptorPoolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorPoolSizes[1].descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo;
+	descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	descriptorPoolCreateInfo.pNext = NULL;
+	descriptorPoolCreateInfo.flags = 0;
+	descriptorPoolCreateInfo.maxSets = 1;
+	descriptorPoolCreateInfo.poolSizeCount = 2;
+	descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes;
+
+	if (vkCreateDescriptorPool(context->device, &descriptorPoolCreateInfo, NULL, &context->descriptorPool) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkDescriptorSetAllocateInfo descriptorSetAllocateInfo;
+	descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	descriptorSetAllocateInfo.pNext = NULL;
+	descriptorSetAllocateInfo.descriptorPool = context->descriptorPool;
+	descriptorSetAllocateInfo.descriptorSetCount = 1;
+	descriptorSetAllocateInfo.pSetLayouts = &context->descriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(context->device, &descriptorSetAllocateInfo, &context->descriptorSet) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	// View projection followed by the position dequantisation scale and offset, as in tri.vert
+	if (CreateTrackedBuffer(context, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, NULL, 24 * sizeof(float), &context->uniformBuffer, &context->uniformMemory) == false
+		|| WriteUniforms(context, 1.0f) == false
+		|| CreateWhiteTexture(context) == false)
+	{
+		return false;
+	}
+
+	VkDescriptorBufferInfo uniformBufferInfo;
+	uniformBufferInfo.buffer = context->uniformBuffer;
+	uniformBufferInfo.offset = 0;
+	uniformBufferInfo.range = 24 * sizeof(float);
+
+	VkWriteDescriptorSet uniformWrite;
+	uniformWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	uniformWrite.pNext = NULL;
+	uniformWrite.dstSet = context->descriptorSet;
+	uniformWrite.dstBinding = 0;
+	uniformWrite.dstArrayElement = 0;
+	uniformWrite.descriptorCount = 1;
+	uniformWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	uniformWrite.pImageInfo = NULL;
+	uniformWrite.pBufferInfo = &uniformBufferInfo;
+	uniformWrite.pTexelBufferView = NULL;
+	vkUpdateDescriptorSets(context->device, 1, &uniformWrite, 0, NULL);
+	WriteTextureDescriptor(context, context->descriptorSet);
+
+	if (CreateShaderModule(context->device, tri_vert_spv, sizeof(tri_vert_spv), &context->vertModule) == false
+		|| CreateShaderModule(context->device, tri_frag_spv, sizeof(tri_frag_spv), &context->fragModule) == false)
+	{
+		return false;
+	}
+
+	VkPipelineCacheCreateInfo pipelineCacheCreateInfo;
+	pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	pipelineCacheCreateInfo.pNext = NULL;
+	pipelineCacheCreateInfo.flags = 0;
+	pipelineCacheCreateInfo.initialDataSize = 0;
+	pipelineCacheCreateInfo.pInitialData = NULL;
+
+	if (vkCreatePipelineCache(context->device, &pipelineCacheCreateInfo, NULL, &context->pipelineCache) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	context->vertexFormat = GetDefaultVertexFormat();
+
+	if (CreateMeshPipeline(context->device, context->pipelineCache, context->pipelineLayout, context->renderPass, context->vertModule, context->fragModule, context->vertexFormat, GetMeshShaderVariant(context->vertexFormat), MeshDepthMode_None, false, &context->pipeline) == false)
+	{
+		return false;
+	}
+
+	const float vertices[3][6] = {
+		{ -1.0f, -1.0f,  0.25f,     1.0f, 0.0f, 0.0f },
+		{ 1.0f, -1.0f,  0.25f,      0.0f, 1.0f, 0.0f },
+		{ 0.0f,  1.0f,  1.0f,       0.0f, 0.0f, 1.0f },
+	};
+	const uint16_t indices[3] = { 0, 1, 2 };
+	const float identity[16] = { 1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f };
+
+	return CreateTrackedBuffer(context, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertices, sizeof(vertices), &context->vertexBuffer, &context->vertexMemory)
+		&& CreateTrackedBuffer(context, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indices, sizeof(indices), &context->indexBuffer, &context->indexMemory)
+		&& CreateTrackedBuffer(context, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, identity, sizeof(identity), &context->instanceBuffer, &context->instanceMemory);
+}
+
+bool CreateBenchmarkContext(const BenchmarkOptions& options, BenchmarkContext* context)
+{
+	memset(context, 0, sizeof(*context));
+	context->width = options.width;
+	context->height = options.height;
+
+	if (CreateInstance(options, context) == false || CreateDevice(options, context) == false)
+	{
+		return false;
+	}
+
+	if (CreateRenderTarget(context) == false)
+	{
+		std::cerr << "Failed to create render target" << std::endl;
+		return false;
+	}
+
+	if (CreateDrawResources(context) == false)
+	{
+		std::cerr << "Failed to create draw resources" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+void DestroyBenchmarkContext(BenchmarkContext* context)
+{
+	if (context->device != VK_NULL_HANDLE)
+	{
+		vkDeviceWaitIdle(context->device);
+
+		DestroyTrackedBuffer(context, context->instanceBuffer, context->instanceMemory);
+		DestroyTrackedBuffer(context, context->indexBuffer, context->indexMemory);
+		DestroyTrackedBuffer(context, context->vertexBuffer, context->vertexMemory);
+		DestroyTrackedBuffer(context, context->uniformBuffer, context->uniformMemory);
+		vkDestroyPipeline(context->device, context->pipeline, NULL);
+		vkDestroyPipelineCache(context->device, context->pipelineCache, NULL);
+		vkDestroySampler(context->device, context->textureSampler, NULL);
+		vkDestroyImageView(context->device, context->textureView, NULL);
+		vkDestroyImage(context->device, context->textureImage, NULL);
+		vkFreeMemory(context->device, context->textureMemory, NULL);
+		vkDestroyShaderModule(context->device, context->fragModule, NULL);
+		vkDestroyShaderModule(context->device, context->vertModule, NULL);
+		vkDestroyDescriptorPool(context->device, context->descriptorPool, NULL);
+		vkDestroyPipelineLayout(context->device, context->pipelineLayout, NULL);
+		vkDestroyDescriptorSetLayout(context->device, context->descriptorSetLayout, NULL);
+		vkDestroyFramebuffer(context->device, context->framebuffer, NULL);
+		vkDestroyRenderPass(context->device, context->renderPass, NULL);
+		vkDestroyImageView(context->device, context->colorView, NULL);
+		vkDestroyImage(context->device, context->colorImage, NULL);
+		vkFreeMemory(context->device, context->colorMemory, NULL);
+		vkDestroyFence(context->device, context->frameFence, NULL);
+		vkDestroyCommandPool(context->device, context->commandPool, NULL);
+		vkDestroyDevice(context->device, NULL);
+	}
+
+	if (context->debugCallback != VK_NULL_HANDLE)
+	{
+		PFN_vkDestroyDebugReportCallbackEXT vkDestroyDebugReportCallbackEXT = (PFN_vkDestroyDebugReportCallbackEXT)vkGetInstanceProcAddr(context->instance, "vkDestroyDebugReportCallbackEXT");
+		vkDestroyDebugReportCallbackEXT(context->instance, context->debugCallback, NULL);
+	}
+
+	if (context->instance != VK_NULL_HANDLE)
+	{
+		vkDestroyInstance(context->instance, NULL);
+	}
+
+	memset(context, 0, sizeof(*context));
+}
+
+bool CreateTrackedBuffer(BenchmarkContext* context, VkBufferUsageFlags usage, const void* data, size_t dataSize, VkBuffer* buffer, VkDeviceMemory* memory)
+{
+	if (CreateBuffer(context->device, usage, context->memoryProperties.memoryTypes, data, dataSize, buffer, memory) == false)
+	{
+		return false;
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(context->device, *buffer, &memoryRequirements);
+	AddDeviceMemory(context, memoryRequirements.size);
+	context->objectsCreated += 2;
+
+	return true;
+}
+
+bool CreateTrackedDeviceBuffer(BenchmarkContext* context, VkBufferUsageFlags usage, VkDeviceSize size, VkBuffer* buffer, VkDeviceMemory* memory)
+{
+	VkBufferCreateInfo bufferCreateInfo;
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.pNext = NULL;
+	bufferCreateInfo.flags = 0;
+	bufferCreateInfo.size = size;
+	bufferCreateInfo.usage = usage;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	bufferCreateInfo.queueFamilyIndexCount = 0;
+	bufferCreateInfo.pQueueFamilyIndices = NULL;
+
+	if (vkCreateBuffer(context->device, &bufferCreateInfo, NULL, buffer) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(context->device, *buffer, &memoryRequirements);
+
+	if (CreateDeviceMemory(context->device, context->memoryProperties.memoryTypes, &memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, (size_t)memoryRequirements.size, memory) == false
+		|| vkBindBufferMemory(context->device, *buffer, *memory, 0) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	AddDeviceMemory(context, memoryRequirements.size);
+	context->objectsCreated += 2;
+
+	return true;
+}
+
+void DestroyTrackedBuffer(BenchmarkContext* context, VkBuffer buffer, VkDeviceMemory memory)
+{
+	if (buffer == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(context->device, buffer, &memoryRequirements);
+	context->deviceMemoryBytes -= memoryRequirements.size;
+
+	vkDestroyBuffer(context->device, buffer, NULL);
+	vkFreeMemory(context->device, memory, NULL);
+}
+
+bool WriteUniforms(BenchmarkContext* context, float scale)
+{
+	const float uniformData[24] = { scale, 0.0f, 0.0f, 0.0f,
+									0.0f, scale, 0.0f, 0.0f,
+									0.0f, 0.0f, 1.0f, 0.0f,
+									0.0f, 0.0f, 0.0f, 1.0f,
+									context->vertexFormat.positionScale[0], context->vertexFormat.positionScale[1], context->vertexFormat.positionScale[2], 0.0f,
+									context->vertexFormat.positionOffset[0], context->vertexFormat.positionOffset[1], context->vertexFormat.positionOffset[2], 0.0f };
+
+	return SetDeviceMemory(context->device, context->uniformMemory, uniformData, sizeof(uniformData));
+}
+
+void WriteTextureDescriptor(BenchmarkContext* context, VkDescriptorSet descriptorSet)
+{
+	VkDescriptorImageInfo textureImageInfo;
+	textureImageInfo.sampler = context->textureSampler;
+	textureImageInfo.imageView = context->textureView;
+	textureImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet textureWrite;
+	textureWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	textureWrite.pNext = NULL;
+	textureWrite.dstSet = descriptorSet;
+	textureWrite.dstBinding = 1;
+	textureWrite.dstArrayElement = 0;
+	textureWrite.descriptorCount = 1;
+	textureWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	textureWrite.pImageInfo = &textureImageInfo;
+	textureWrite.pBufferInfo = NULL;
+	textureWrite.pTexelBufferView = NULL;
+	vkUpdateDescriptorSets(context->device, 1, &textureWrite, 0, NULL);
+}
+
+void BeginBenchmarkRenderPass(BenchmarkContext* context)
+{
+	VkClearValue clearValue;
+	clearValue.color.float32[0] = 0.0f;
+	clearValue.color.float32[1] = 0.0f;
+	clearValue.color.float32[2] = 0.0f;
+	clearValue.color.float32[3] = 1.0f;
+
+	VkRenderPassBeginInfo renderPassBeginInfo;
+	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassBeginInfo.pNext = NULL;
+	renderPassBeginInfo.renderPass = context->renderPass;
+	renderPassBeginInfo.framebuffer = context->framebuffer;
+	renderPassBeginInfo.renderArea.offset.x = 0;
+	renderPassBeginInfo.renderArea.offset.y = 0;
+	renderPassBeginInfo.renderArea.extent.width = context->width;
+	renderPassBeginInfo.renderArea.extent.height = context->height;
+	renderPassBeginInfo.clearValueCount = 1;
+	renderPassBeginInfo.pClearValues = &clearValue;
+	vkCmdBeginRenderPass(context->commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	VkViewport viewport;
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float)context->width;
+	viewport.height = (float)context->height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(context->commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor;
+	scissor.offset.x = 0;
+	scissor.offset.y = 0;
+	scissor.extent.width = context->width;
+	scissor.extent.height = context->height;
+	vkCmdSetScissor(context->commandBuffer, 0, 1, &scissor);
+
+	// Draws only rebind the mesh's own binding, this one stays for the pass
+	VkDeviceSize instanceOffset = 0;
+	vkCmdBindVertexBuffers(context->commandBuffer, MeshInstanceBinding, 1, &context->instanceBuffer, &instanceOffset);
+}
+
+void EndBenchmarkRenderPass(BenchmarkContext* context)
+{
+	vkCmdEndRenderPass(context->commandBuffer);
+}
+
+void DrawTriangle(BenchmarkContext* context, VkPipeline pipeline, uint32_t instanceCount, BenchmarkStats* stats)
+{
+	VkDeviceSize offset = 0;
+
+	vkCmdBindPipeline(context->commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	vkCmdBindDescriptorSets(context->commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context->pipelineLayout, 0, 1, &context->descriptorSet, 0, NULL);
+	vkCmdBindVertexBuffers(context->commandBuffer, 0, 1, &context->vertexBuffer, &offset);
+	vkCmdBindIndexBuffer(context->commandBuffer, context->indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+	vkCmdDrawIndexed(context->commandBuffer, 3, instanceCount, 0, 0, 0);
+
+	++stats->drawCalls;
+	stats->stateChanges += 4;
+}
+
+static bool RunFrame(BenchmarkContext* context, BenchmarkScenario* scenario, BenchmarkStats* stats, double* cpuMilliseconds, double* frameMilliseconds)
+{
+	std::chrono::high_resolution_clock::time_point frameStart = std::chrono::high_resolution_clock::now();
+
+	VkCommandBufferBeginInfo commandBufferBeginInfo;
+	commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	commandBufferBeginInfo.pNext = NULL;
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	commandBufferBeginInfo.pInheritanceInfo = NULL;
+
+	if (vkBeginCommandBuffer(context->commandBuffer, &commandBufferBeginInfo) != VK_SUCCESS
+		|| scenario->RecordFrame(context, stats) == false
+		|| vkEndCommandBuffer(context->commandBuffer) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkSubmitInfo submitInfo;
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = NULL;
+	submitInfo.waitSemaphoreCount = 0;
+	submitInfo.pWaitSemaphores = NULL;
+	submitInfo.pWaitDstStageMask = NULL;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &context->commandBuffer;
+	submitInfo.signalSemaphoreCount = 0;
+	submitInfo.pSignalSemaphores = NULL;
+
+	if (vkQueueSubmit(context->queue, 1, &submitInfo, context->frameFence) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	++context->submitCount;
+
+	std::chrono::high_resolution_clock::time_point submitted = std::chrono::high_resolution_clock::now();
+
+	if (vkWaitForFences(context->device, 1, &context->frameFence, VK_TRUE, UINT64_MAX) != VK_SUCCESS
+		|| vkResetFences(context->device, 1, &context->frameFence) != VK_SUCCESS
+		|| vkResetCommandBuffer(context->commandBuffer, 0) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	scenario->EndFrame(context);
+
+	std::chrono::high_resolution_clock::time_point frameEnd = std::chrono::high_resolution_clock::now();
+	*cpuMilliseconds = std::chrono::duration<double, std::milli>(submitted - frameStart).count();
+	*frameMilliseconds = std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
+
+	return true;
+}
+
+bool RunBenchmarkScenario(BenchmarkContext* context, BenchmarkScenario* scenario, uint32_t warmupFrames, uint32_t frameCount, BenchmarkStats* stats)
+{
+	stats->scenario = scenario->GetName();
+	stats->cpuMilliseconds.clear();
+	stats->frameMilliseconds.clear();
+	stats->bytesUploaded = 0;
+	stats->drawCalls = 0;
+	stats->stateChanges = 0;
+	stats->culledObjects = 0;
+	stats->cullMilliseconds = 0.0;
+
+	uint32_t objectsBefore = context->objectsCreated;
+	context->peakDeviceMemoryBytes = context->deviceMemoryBytes;
+
+	if (scenario->Setup(context) == false)
+	{
+		std::cerr << "Setup of " << scenario->GetName() << " failed" << std::endl;
+		scenario->Teardown(context);
+		return false;
+	}
+
+	bool succeeded = true;
+	double cpuMilliseconds;
+	double frameMilliseconds;
+
+	for (uint32_t frame = 0; frame < warmupFrames && succeeded; ++frame)
+	{
+		succeeded = RunFrame(context, scenario, stats, &cpuMilliseconds, &frameMilliseconds);
+	}
+
+	// Counters cover the timed frames only, setup cost is in objectsCreated and memory
+	uint32_t submitsBefore = context->submitCount;
+	stats->bytesUploaded = 0;
+	stats->drawCalls = 0;
+	stats->stateChanges = 0;
+	stats->culledObjects = 0;
+	stats->cullMilliseconds = 0.0;
+
+	for (uint32_t frame = 0; frame < frameCount && succeeded; ++frame)
+	{
+		succeeded = RunFrame(context, scenario, stats, &cpuMilliseconds, &frameMilliseconds);
+
+		if (succeeded)
+		{
+			stats->cpuMilliseconds.push_back(cpuMilliseconds);
+			stats->frameMilliseconds.push_back(frameMilliseconds);
+		}
+	}
+
+	vkDeviceWaitIdle(context->device);
+	scenario->Teardown(context);
+
+	stats->submits = context->submitCount - submitsBefore;
+	stats->objectsCreated = context->objectsCreated - objectsBefore;
+	stats->peakDeviceMemoryBytes = context->peakDeviceMemoryBytes;
+
+	if (succeeded == false)
+	{
+		std::cerr << "Frame of " << scenario->GetName() << " failed" << std::endl;
+	}
+
+	return succeeded;
+}
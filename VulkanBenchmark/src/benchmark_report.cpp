@@ -0,0 +1,145 @@
+#include "benchmark_report.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "device_selection.h"
+
+struct TimingSummary
+{
+	double mean;
+	double minimum;
+	double median;
+	double p95;
+	double p99;
+	double maximum;
+};
+
+static double Percentile(const std::vector<double>& sorted, double fraction)
+{
+	size_t index = (size_t)(fraction * (double)(sorted.size() - 1) + 0.5);
+	return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static TimingSummary SummariseTimings(const std::vector<double>& timings)
+{
+	TimingSummary summary = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+
+	if (timings.empty())
+	{
+		return summary;
+	}
+
+	std::vector<double> sorted(timings);
+	std::sort(sorted.begin(), sorted.end());
+
+	double total = 0.0;
+
+	for (size_t i = 0; i < sorted.size(); ++i)
+	{
+		total += sorted[i];
+	}
+
+	summary.mean = total / (double)sorted.size();
+	summary.minimum = sorted.front();
+	summary.median = Percentile(sorted, 0.5);
+	summary.p95 = Percentile(sorted, 0.95);
+	summary.p99 = Percentile(sorted, 0.99);
+	summary.maximum = sorted.back();
+
+	return summary;
+}
+
+static void WriteJsonString(FILE* file, const char* text)
+{
+	fputc('"', file);
+
+	for (; *text != '\0'; ++text)
+	{
+		unsigned char c = (unsigned char)*text;
+
+		if (c == '"' || c == '\\')
+		{
+			fprintf(file, "\\%c", c);
+		}
+		else if (c < 0x20)
+		{
+			fprintf(file, "\\u%04x", c);
+		}
+		else
+		{
+			fputc(c, file);
+		}
+	}
+
+	fputc('"', file);
+}
+
+static void WriteTimings(FILE* file, const char* name, const std::vector<double>& timings)
+{
+	TimingSummary summary = SummariseTimings(timings);
+
+	fprintf(file, "\t\t\t\"%s\": { \"mean\": %.4f, \"min\": %.4f, \"median\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n",
+		name, summary.mean, summary.minimum, summary.median, summary.p95, summary.p99, summary.maximum);
+}
+
+bool WriteBenchmarkReport(FILE* file, const BenchmarkContext& context, uint32_t frameCount, const std::vector<BenchmarkStats>& results)
+{
+	const VkPhysicalDeviceProperties& properties = context.properties;
+
+	fprintf(file, "{\n");
+	fprintf(file, "\t\"device\": {\n");
+	fprintf(file, "\t\t\"name\": ");
+	WriteJsonString(file, properties.deviceName);
+	fprintf(file, ",\n");
+	fprintf(file, "\t\t\"type\": \"%s\",\n", GetPhysicalDeviceTypeName(properties.deviceType));
+	fprintf(file, "\t\t\"vendorId\": %u,\n", properties.vendorID);
+	fprintf(file, "\t\t\"deviceId\": %u,\n", properties.deviceID);
+	fprintf(file, "\t\t\"driverVersion\": %u,\n", properties.driverVersion);
+	fprintf(file, "\t\t\"apiVersion\": \"%u.%u.%u\"\n", VK_VERSION_MAJOR(properties.apiVersion), VK_VERSION_MINOR(properties.apiVersion), VK_VERSION_PATCH(properties.apiVersion));
+	fprintf(file, "\t},\n");
+	fprintf(file, "\t\"width\": %u,\n", context.width);
+	fprintf(file, "\t\"height\": %u,\n", context.height);
+	fprintf(file, "\t\"frames\": %u,\n", frameCount);
+	fprintf(file, "\t\"scenarios\": [\n");
+
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchmarkStats& stats = results[i];
+
+		fprintf(file, "\t\t{\n");
+		fprintf(file, "\t\t\t\"name\": ");
+		WriteJsonString(file, stats.scenario);
+		fprintf(file, ",\n");
+		fprintf(file, "\t\t\t\"frames\": %u,\n", (uint32_t)stats.frameMilliseconds.size());
+		WriteTimings(file, "cpuMs", stats.cpuMilliseconds);
+		WriteTimings(file, "frameMs", stats.frameMilliseconds);
+		fprintf(file, "\t\t\t\"submits\": %u,\n", stats.submits);
+		fprintf(file, "\t\t\t\"drawCalls\": %llu,\n", (unsigned long long)stats.drawCalls);
+		fprintf(file, "\t\t\t\"stateChanges\": %llu,\n", (unsigned long long)stats.stateChanges);
+		fprintf(file, "\t\t\t\"culledObjectsPerMs\": %.1f,\n", stats.cullMilliseconds > 0.0 ? stats.culledObjects / stats.cullMilliseconds : 0.0);
+		fprintf(file, "\t\t\t\"objectsCreated\": %u,\n", stats.objectsCreated);
+		fprintf(file, "\t\t\t\"bytesUploaded\": %llu,\n", (unsigned long long)stats.bytesUploaded);
+		fprintf(file, "\t\t\t\"peakDeviceMemoryBytes\": %llu\n", (unsigned long long)stats.peakDeviceMemoryBytes);
+		fprintf(file, "\t\t}%s\n", i + 1 < results.size() ? "," : "");
+	}
+
+	fprintf(file, "\t]\n");
+	fprintf(file, "}\n");
+
+	return ferror(file) == 0;
+}
+
+void PrintBenchmarkSummary(const BenchmarkStats& stats)
+{
+	TimingSummary cpu = SummariseTimings(stats.cpuMilliseconds);
+	TimingSummary frame = SummariseTimings(stats.frameMilliseconds);
+
+	std::cerr << stats.scenario << ": " << stats.frameMilliseconds.size() << " frames, cpu " << cpu.mean << " ms, frame " << frame.mean
+		<< " ms (p95 " << frame.p95 << " ms), " << stats.submits << " submits, " << stats.stateChanges << " state changes, " << stats.objectsCreated << " objects created" << std::endl;
+
+	if (stats.cullMilliseconds > 0.0)
+	{
+		std::cerr << stats.scenario << ": " << stats.culledObjects / stats.cullMilliseconds << " objects culled per ms" << std::endl;
+	}
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+#include "benchmark.h"
+
+// JSON document with the device, the run settings and per scenario timing percentiles and
+// counters, for regression tracking
+bool WriteBenchmarkReport(FILE* file, const BenchmarkContext& context, uint32_t frameCount, const std::vector<BenchmarkStats>& results);
+
+void PrintBenchmarkSummary(const BenchmarkStats& stats);
@@ -0,0 +1,499 @@
+#include "benchmark.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "frustum_culling.h"
+#include "mesh_pipeline.h"
+#include "particle_system.h"
+#include "render_queue.h"
+
+// Baseline: one draw per frame, measures the fixed cost of a submission
+class TriangleScenario : public BenchmarkScenario
+{
+public:
+	const char* GetName() const { return "triangle"; }
+	const char* GetDescription() const { return "Single triangle"; }
+
+	bool Setup(BenchmarkContext* context)
+	{
+		return WriteUniforms(context, 1.0f);
+	}
+
+	bool RecordFrame(BenchmarkContext* context, BenchmarkStats* stats)
+	{
+		BeginBenchmarkRenderPass(context);
+		DrawTriangle(context, context->pipeline, 1, stats);
+		EndBenchmarkRenderPass(context);
+		return true;
+	}
+
+	void Teardown(BenchmarkContext* context) {}
+};
+
+// Vertex throughput: the triangle is shrunk so fill rate doesn't dominate
+class InstancesScenario : public BenchmarkScenario
+{
+public:
+	const char* GetName() const { return "instances"; }
+	const char* GetDescription() const { return "100k instances of a small triangle in one draw"; }
+
+	bool Setup(BenchmarkContext* context)
+	{
+		return WriteUniforms(context, 0.01f);
+	}
+
+	bool RecordFrame(BenchmarkContext* context, BenchmarkStats* stats)
+	{
+		BeginBenchmarkRenderPass(context);
+		DrawTriangle(context, context->pipeline, 100000, stats);
+		EndBenchmarkRenderPass(context);
+		return true;
+	}
+
+	void Teardown(BenchmarkContext* context)
+	{
+		WriteUniforms(context, 1.0f);
+	}
+};
+
+// Host to device bandwidth: a staging buffer rewritten and copied into device local memory every frame
+class UploadsScenario : public BenchmarkScenario
+{
+public:
+	UploadsScenario() : stagingBuffer(VK_NULL_HANDLE), stagingMemory(VK_NULL_HANDLE), deviceBuffer(VK_NULL_HANDLE), deviceMemory(VK_NULL_HANDLE), mappedStaging(NULL), frame(0) {}
+
+	const char* GetName() const { return "uploads"; }
+	const char* GetDescription() const { return "16 MB staged upload per frame"; }
+
+	bool Setup(BenchmarkContext* context)
+	{
+		frame = 0;
+
+		if (CreateTrackedBuffer(context, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, NULL, UploadSize, &stagingBuffer, &stagingMemory) == false
+			|| CreateTrackedDeviceBuffer(context, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, UploadSize, &deviceBuffer, &deviceMemory) == false)
+		{
+			return false;
+		}
+
+		return vkMapMemory(context->device, stagingMemory, 0, UploadSize, 0, &mappedStaging) == VK_SUCCESS;
+	}
+
+	bool RecordFrame(BenchmarkContext* context, BenchmarkStats* stats)
+	{
+		// Touch every byte so the write is part of the CPU cost
+		memset(mappedStaging, (int)(frame++ & 0xff), UploadSize);
+
+		VkMappedMemoryRange range;
+		range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range.pNext = NULL;
+		range.memory = stagingMemory;
+		range.offset = 0;
+		range.size = VK_WHOLE_SIZE;
+		vkFlushMappedMemoryRanges(context->device, 1, &range);
+
+		VkBufferCopy copy;
+		copy.srcOffset = 0;
+		copy.dstOffset = 0;
+		copy.size = UploadSize;
+		vkCmdCopyBuffer(context->commandBuffer, stagingBuffer, deviceBuffer, 1, &copy);
+
+		VkBufferMemoryBarrier barrier;
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.pNext = NULL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = deviceBuffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(context->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, NULL, 1, &barrier, 0, NULL);
+
+		stats->bytesUploaded += UploadSize;
+
+		BeginBenchmarkRenderPass(context);
+		DrawTriangle(context, context->pipeline, 1, stats);
+		EndBenchmarkRenderPass(context);
+		return true;
+	}
+
+	void Teardown(BenchmarkContext* context)
+	{
+		if (mappedStaging != NULL)
+		{
+			vkUnmapMemory(context->device, stagingMemory);
+			mappedStaging = NULL;
+		}
+
+		DestroyTrackedBuffer(context, deviceBuffer, deviceMemory);
+		DestroyTrackedBuffer(context, stagingBuffer, stagingMemory);
+		stagingBuffer = VK_NULL_HANDLE;
+		deviceBuffer = VK_NULL_HANDLE;
+	}
+
+private:
+	static const VkDeviceSize UploadSize = 16 * 1024 * 1024;
+
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingMemory;
+	VkBuffer deviceBuffer;
+	VkDeviceMemory deviceMemory;
+	void* mappedStaging;
+	uint32_t frame;
+};
+
+// Pipeline creation cost: a new pipeline every frame, alternating specialisation constants so
+// the driver can't hand back the previous one, destroyed once the frame has finished with it
+class PipelineChurnScenario : public BenchmarkScenario
+{
+public:
+	PipelineChurnScenario() : pipeline(VK_NULL_HANDLE), frame(0) {}
+
+	const char* GetName() const { return "pipeline_churn"; }
+	const char* GetDescription() const { return "Pipeline created and destroyed every frame"; }
+
+	bool Setup(BenchmarkContext* context)
+	{
+		frame = 0;
+		return true;
+	}
+
+	bool RecordFrame(BenchmarkContext* context, BenchmarkStats* stats)
+	{
+		MeshShaderVariant variant = GetMeshShaderVariant(context->vertexFormat);
+		variant.quantizedPositions = (frame++ & 1) ? VK_TRUE : VK_FALSE;
+
+		if (CreateMeshPipeline(context->device, context->pipelineCache, context->pipelineLayout, context->renderPass, context->vertModule, context->fragModule, context->vertexFormat, variant, MeshDepthMode_None, false, &pipeline) == false)
+		{
+			return false;
+		}
+
+		++context->objectsCreated;
+
+		BeginBenchmarkRenderPass(context);
+		DrawTriangle(context, pipeline, 1, stats);
+		EndBenchmarkRenderPass(context);
+		return true;
+	}
+
+	void EndFrame(BenchmarkContext* context)
+	{
+		vkDestroyPipeline(context->device, pipeline, NULL);
+		pipeline = VK_NULL_HANDLE;
+	}
+
+	void Teardown(BenchmarkContext* context)
+	{
+		if (pipeline != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(context->device, pipeline, NULL);
+			pipeline = VK_NULL_HANDLE;
+		}
+	}
+
+private:
+	VkPipeline pipeline;
+	uint32_t frame;
+};
+
+// Draw recording cost: 10k small draws across two pipelines and sixteen materials submitted in
+// scrambled order. Sorted, the render queue groups them and skips redundant binds, unsorted every
+// key is zero so they record in submission order for comparison.
+class RenderQueueScenario : public BenchmarkScenario
+{
+public:
+	static const uint32_t DrawCount = 10000;
+	static const uint32_t MaterialCount = 16;
+
+	RenderQueueScenario(bool sorted) : sorted(sorted), variantPipeline(VK_NULL_HANDLE) {}
+
+	const char* GetName() const { return sorted ? "render_queue" : "render_queue_unsorted"; }
+	const char* GetDescription() const { return sorted ? "10k draws sorted by state" : "10k draws in submission order"; }
+
+	bool Setup(BenchmarkContext* context)
+	{
+		MeshShaderVariant variant = GetMeshShaderVariant(context->vertexFormat);
+		variant.quantizedPositions = variant.quantizedPositions ? VK_FALSE : VK_TRUE;
+
+		if (CreateMeshPipeline(context->device, context->pipelineCache, context->pipelineLayout, context->renderPass, context->vertModule, context->fragModule, context->vertexFormat, variant, MeshDepthMode_None, false, &variantPipeline) == false)
+		{
+			return false;
+		}
+
+		++context->objectsCreated;
+
+		// The context has a single descriptor set, materials differ in id only
+		renderQueue = RenderQueue();
+		pipelineIds[0] = renderQueue.AddPipeline(context->pipeline, context->pipelineLayout);
+		pipelineIds[1] = renderQueue.AddPipeline(variantPipeline, context->pipelineLayout);
+
+		for (uint32_t i = 0; i < MaterialCount; ++i)
+		{
+			materialIds[i] = renderQueue.AddMaterial(context->descriptorSet);
+		}
+
+		meshId = renderQueue.AddMesh(context->vertexBuffer, context->indexBuffer, VK_INDEX_TYPE_UINT16);
+
+		return WriteUniforms(context, 0.01f);
+	}
+
+	bool RecordFrame(BenchmarkContext* context, BenchmarkStats* stats)
+	{
+		renderQueue.Clear();
+
+		uint32_t random = 1;
+
+		for (uint32_t i = 0; i < DrawCount; ++i)
+		{
+			random = random * 1664525 + 1013904223;
+
+			DrawPacket packet;
+			packet.pipeline = pipelineIds[(random >> 16) & 1];
+			packet.material = materialIds[(random >> 20) % MaterialCount];
+			packet.mesh = meshId;
+			packet.key = sorted ? MakeSortKey(0, packet.pipeline, packet.material, (float)(random >> 8) / (1 << 24), false, 0) : 0;
+			packet.indexCount = 3;
+			packet.firstIndex = 0;
+			packet.vertexOffset = 0;
+			packet.instanceCount = 1;
+			packet.firstInstance = 0;
+			renderQueue.Submit(packet);
+		}
+
+		renderQueue.Sort();
+
+		BeginBenchmarkRenderPass(context);
+		renderQueue.Record(context->commandBuffer, NULL);
+		EndBenchmarkRenderPass(context);
+
+		const RenderQueueStats& queueStats = renderQueue.GetStats();
+		stats->drawCalls += queueStats.draws;
+		stats->stateChanges += queueStats.pipelineBinds + queueStats.descriptorSetBinds + queueStats.vertexBufferBinds + queueStats.indexBufferBinds;
+		return true;
+	}
+
+	void Teardown(BenchmarkContext* context)
+	{
+		if (variantPipeline != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(context->device, variantPipeline, NULL);
+			variantPipeline = VK_NULL_HANDLE;
+		}
+
+		WriteUniforms(context, 1.0f);
+	}
+
+private:
+	bool sorted;
+	VkPipeline variantPipeline;
+	RenderQueue renderQueue;
+	uint32_t pipelineIds[2];
+	uint32_t materialIds[MaterialCount];
+	uint32_t meshId;
+};
+
+// CPU culling throughput: 1M spheres and boxes scattered around a camera turning a little each
+// frame, culled against its frustum. The visible count is drawn as instances so the result is used.
+class FrustumCullingScenario : public BenchmarkScenario
+{
+public:
+	static const uint32_t ObjectCount = 1000000;
+
+	FrustumCullingScenario(bool simd) : simd(simd), frame(0) {}
+
+	const char* GetName() const { return simd ? "frustum_culling" : "frustum_culling_scalar"; }
+	const char* GetDescription() const { return simd ? "1M objects culled with SIMD on every thread" : "1M objects culled one at a time on one thread"; }
+
+	bool Setup(BenchmarkContext* context)
+	{
+		frame = 0;
+		volumes.Clear();
+		srand(1);
+
+		for (uint32_t i = 0; i < ObjectCount; ++i)
+		{
+			float center[3] = { RandomRange(-500.0f, 500.0f), RandomRange(-500.0f, 500.0f), RandomRange(-500.0f, 500.0f) };
+
+			if (i & 1)
+			{
+				float extent[3] = { RandomRange(0.5f, 4.0f), RandomRange(0.5f, 4.0f), RandomRange(0.5f, 4.0f) };
+				volumes.AddBox(center, extent);
+			}
+			else
+			{
+				volumes.AddSphere(center, RandomRange(0.5f, 4.0f));
+			}
+		}
+
+		culler.Start(simd ? 0 : 1, simd);
+		return WriteUniforms(context, 0.01f);
+	}
+
+	bool RecordFrame(BenchmarkContext* context, BenchmarkStats* stats)
+	{
+		float viewProjection[16];
+		GetViewProjection(frame++ * 0.01f, (float)context->width / (float)context->height, viewProjection);
+		FrustumPlanes planes = ExtractFrustumPlanes(viewProjection);
+
+		std::chrono::high_resolution_clock::time_point cullStart = std::chrono::high_resolution_clock::now();
+		culler.Cull(volumes, planes, &visible);
+		stats->cullMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - cullStart).count();
+		stats->culledObjects += ObjectCount;
+
+		BeginBenchmarkRenderPass(context);
+		DrawTriangle(context, context->pipeline, (uint32_t)visible.size(), stats);
+		EndBenchmarkRenderPass(context);
+		return true;
+	}
+
+	void Teardown(BenchmarkContext* context)
+	{
+		culler.Stop();
+		volumes.Clear();
+		visible.clear();
+		WriteUniforms(context, 1.0f);
+	}
+
+private:
+	static float RandomRange(float minimum, float maximum)
+	{
+		return minimum + (maximum - minimum) * (float)rand() / (float)RAND_MAX;
+	}
+
+	// Column major perspective with [0, 1] depth, looking down -z after turning angle radians about y
+	static void GetViewProjection(float angle, float aspect, float* viewProjection)
+	{
+		const float nearPlane = 0.1f;
+		const float farPlane = 1000.0f;
+		float focal = 1.0f / tanf(0.5f);
+
+		float projection[16] = {
+			focal / aspect, 0.0f, 0.0f, 0.0f,
+			0.0f, focal, 0.0f, 0.0f,
+			0.0f, 0.0f, farPlane / (nearPlane - farPlane), -1.0f,
+			0.0f, 0.0f, nearPlane * farPlane / (nearPlane - farPlane), 0.0f };
+
+		float view[16] = {
+			cosf(angle), 0.0f, sinf(angle), 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			-sinf(angle), 0.0f, cosf(angle), 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f };
+
+		for (int column = 0; column < 4; ++column)
+		{
+			for (int row = 0; row < 4; ++row)
+			{
+				float sum = 0.0f;
+
+				for (int k = 0; k < 4; ++k)
+				{
+					sum += projection[k * 4 + row] * view[column * 4 + k];
+				}
+
+				viewProjection[column * 4 + row] = sum;
+			}
+		}
+	}
+
+	bool simd;
+	uint32_t frame;
+	CullingVolumes volumes;
+	FrustumCuller culler;
+	std::vector<uint32_t> visible;
+};
+
+// GPU particles: 1M particles emitted, simulated and compacted in compute and drawn with an
+// indirect instanced draw. The CPU records the same few commands whatever the live count.
+class GpuParticlesScenario : public BenchmarkScenario
+{
+public:
+	static const uint32_t ParticleCount = 1000000;
+
+	const char* GetName() const { return "gpu_particles"; }
+	const char* GetDescription() const { return "1M particles simulated in compute, one indirect draw"; }
+
+	bool Setup(BenchmarkContext* context)
+	{
+		if (particleSystem.Create(context->device, context->queue, context->commandPool, context->memoryProperties.memoryTypes, context->pipelineCache, context->renderPass, 0, ParticleCount,
+			context->queueFamily, context->queueFamily) == false)
+		{
+			return false;
+		}
+
+		// Four pipelines and three buffers
+		context->objectsCreated += 7;
+		context->deviceMemoryBytes += particleSystem.GetMemoryBytes();
+
+		if (context->deviceMemoryBytes > context->peakDeviceMemoryBytes)
+		{
+			context->peakDeviceMemoryBytes = context->deviceMemoryBytes;
+		}
+
+		// Runs two lifetimes untimed so the pool is full, the live count settles close to capacity
+		VkCommandBuffer commandBuffer;
+
+		if (BeginOneTimeCommands(context->device, context->commandPool, &commandBuffer) == false)
+		{
+			return false;
+		}
+
+		uint32_t fillSteps = (uint32_t)(2.0f * ParticleSystem::DefaultLifetime / FrameTime);
+
+		for (uint32_t i = 0; i < fillSteps; ++i)
+		{
+			particleSystem.Record(commandBuffer, FrameTime);
+		}
+
+		return EndOneTimeCommands(context->device, context->queue, context->commandPool, commandBuffer);
+	}
+
+	bool RecordFrame(BenchmarkContext* context, BenchmarkStats* stats)
+	{
+		static const float identity[16] = {
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f };
+
+		particleSystem.Record(context->commandBuffer, FrameTime);
+
+		BeginBenchmarkRenderPass(context);
+		particleSystem.Draw(context->commandBuffer, identity);
+		EndBenchmarkRenderPass(context);
+
+		// Three compute pipelines and the draw's, one descriptor set bind for compute and one for the draw
+		stats->drawCalls++;
+		stats->stateChanges += 6;
+		return true;
+	}
+
+	void Teardown(BenchmarkContext* context)
+	{
+		context->deviceMemoryBytes -= particleSystem.GetMemoryBytes();
+		particleSystem.Destroy();
+	}
+
+private:
+	// Simulated at a fixed 60 Hz whatever the measured frame time, so runs are comparable
+	static const float FrameTime;
+
+	ParticleSystem particleSystem;
+};
+
+const float GpuParticlesScenario::FrameTime = 1.0f / 60.0f;
+
+void GetBenchmarkScenarios(std::vector<BenchmarkScenario*>* scenarios)
+{
+	scenarios->push_back(new TriangleScenario());
+	scenarios->push_back(new InstancesScenario());
+	scenarios->push_back(new UploadsScenario());
+	scenarios->push_back(new PipelineChurnScenario());
+	scenarios->push_back(new RenderQueueScenario(true));
+	scenarios->push_back(new RenderQueueScenario(false));
+	scenarios->push_back(new FrustumCullingScenario(true));
+	scenarios->push_back(new FrustumCullingScenario(false));
+	scenarios->push_back(new GpuParticlesScenario());
+}
@@ -0,0 +1,869 @@
+#include "benchmark.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "frame_capture_format.h"
+#include "mesh_pipeline.h"
+
+static const VkFormat replayColorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+// Replays a capture written by the test application's --capture. Every object is created in Setup at
+// the captured framebuffer size, with its own colour and depth targets since the capture may depend
+// on depth. Each frame then records the captured render pass unchanged, so every run does the same
+// work on any device.
+class CaptureReplayScenario : public BenchmarkScenario
+{
+public:
+	CaptureReplayScenario(const char* path)
+		: path(path)
+		, colorImage(VK_NULL_HANDLE)
+		, colorMemory(VK_NULL_HANDLE)
+		, colorView(VK_NULL_HANDLE)
+		, depthImage(VK_NULL_HANDLE)
+		, depthMemory(VK_NULL_HANDLE)
+		, depthView(VK_NULL_HANDLE)
+		, renderPass(VK_NULL_HANDLE)
+		, framebuffer(VK_NULL_HANDLE)
+		, descriptorPool(VK_NULL_HANDLE)
+	{
+		// Named after the file without its directory or extension, so results stay comparable
+		// wherever the capture is kept
+		size_t nameStart = this->path.find_last_of("/\\");
+		nameStart = nameStart == std::string::npos ? 0 : nameStart + 1;
+		size_t nameEnd = this->path.find('.', nameStart);
+		name = "replay_" + this->path.substr(nameStart, nameEnd == std::string::npos ? std::string::npos : nameEnd - nameStart);
+	}
+
+	const char* GetName() const { return name.c_str(); }
+	const char* GetDescription() const { return path.c_str(); }
+
+	bool Setup(BenchmarkContext* context)
+	{
+		std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+
+		if (file.is_open() == false)
+		{
+			std::cerr << "Couldn't open " << path << std::endl;
+			return false;
+		}
+
+		data.resize((size_t)file.tellg());
+		file.seekg(0);
+		file.read((char*)data.data(), data.size());
+
+		if (file.good() == false || data.size() < sizeof(FrameCaptureHeader))
+		{
+			std::cerr << "Couldn't read " << path << std::endl;
+			return false;
+		}
+
+		memcpy(&header, data.data(), sizeof(header));
+
+		if (header.magic != FrameCaptureMagic || header.version != FrameCaptureVersion || header.width == 0 || header.height == 0)
+		{
+			std::cerr << path << " isn't a version " << FrameCaptureVersion << " frame capture" << std::endl;
+			return false;
+		}
+
+		if (CreateTargets(context) == false)
+		{
+			std::cerr << "Couldn't create replay render targets" << std::endl;
+			return false;
+		}
+
+		// Staged uploads are recorded while the capture is read and submitted once at the end
+		VkCommandBufferBeginInfo commandBufferBeginInfo;
+		commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		commandBufferBeginInfo.pNext = NULL;
+		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		commandBufferBeginInfo.pInheritanceInfo = NULL;
+
+		if (vkBeginCommandBuffer(context->commandBuffer, &commandBufferBeginInfo) != VK_SUCCESS)
+		{
+			return false;
+		}
+
+		bool parsed = ParseCommands(context);
+
+		if (vkEndCommandBuffer(context->commandBuffer) != VK_SUCCESS || parsed == false)
+		{
+			vkResetCommandBuffer(context->commandBuffer, 0);
+			return false;
+		}
+
+		VkSubmitInfo submitInfo;
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = NULL;
+		submitInfo.waitSemaphoreCount = 0;
+		submitInfo.pWaitSemaphores = NULL;
+		submitInfo.pWaitDstStageMask = NULL;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &context->commandBuffer;
+		submitInfo.signalSemaphoreCount = 0;
+		submitInfo.pSignalSemaphores = NULL;
+
+		bool uploaded = vkQueueSubmit(context->queue, 1, &submitInfo, context->frameFence) == VK_SUCCESS
+			&& vkWaitForFences(context->device, 1, &context->frameFence, VK_TRUE, UINT64_MAX) == VK_SUCCESS
+			&& vkResetFences(context->device, 1, &context->frameFence) == VK_SUCCESS
+			&& vkResetCommandBuffer(context->commandBuffer, 0) == VK_SUCCESS;
+
+		for (size_t i = 0; i < stagingBuffers.size(); ++i)
+		{
+			DestroyTrackedBuffer(context, stagingBuffers[i].buffer, stagingBuffers[i].memory);
+		}
+
+		stagingBuffers.clear();
+		return uploaded;
+	}
+
+	bool RecordFrame(BenchmarkContext* context, BenchmarkStats* stats)
+	{
+		VkCommandBuffer commandBuffer = context->commandBuffer;
+
+		// Ids were checked against the objects when the capture was read
+		for (size_t i = 0; i < frameCommands.size(); ++i)
+		{
+			const unsigned char* payload = &data[frameCommands[i].offset];
+
+			switch (frameCommands[i].command)
+			{
+			case FrameCaptureCommand_BeginRenderPass:
+			{
+				FrameCaptureRenderPass pass;
+				memcpy(&pass, payload, sizeof(pass));
+
+				VkClearValue clearValues[2];
+				memcpy(clearValues[0].color.float32, pass.clearColor, sizeof(pass.clearColor));
+				clearValues[1].depthStencil.depth = pass.clearDepth;
+				clearValues[1].depthStencil.stencil = 0;
+
+				VkRenderPassBeginInfo renderPassBeginInfo;
+				renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+				renderPassBeginInfo.pNext = NULL;
+				renderPassBeginInfo.renderPass = renderPass;
+				renderPassBeginInfo.framebuffer = framebuffer;
+				renderPassBeginInfo.renderArea.offset.x = 0;
+				renderPassBeginInfo.renderArea.offset.y = 0;
+				renderPassBeginInfo.renderArea.extent.width = pass.width;
+				renderPassBeginInfo.renderArea.extent.height = pass.height;
+				renderPassBeginInfo.clearValueCount = 2;
+				renderPassBeginInfo.pClearValues = clearValues;
+				vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+				VkViewport viewport;
+				viewport.x = 0.0f;
+				viewport.y = 0.0f;
+				viewport.width = (float)pass.width;
+				viewport.height = (float)pass.height;
+				viewport.minDepth = 0.0f;
+				viewport.maxDepth = 1.0f;
+				vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+				vkCmdSetScissor(commandBuffer, 0, 1, &renderPassBeginInfo.renderArea);
+				break;
+			}
+			case FrameCaptureCommand_ClearRect:
+			{
+				FrameCaptureClearRect rect;
+				memcpy(&rect, payload, sizeof(rect));
+
+				VkClearAttachment clearAttachment;
+				clearAttachment.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				clearAttachment.colorAttachment = 0;
+				memcpy(clearAttachment.clearValue.color.float32, rect.color, sizeof(rect.color));
+
+				VkClearRect clearRect;
+				clearRect.baseArrayLayer = 0;
+				clearRect.layerCount = 1;
+				clearRect.rect.offset.x = rect.x;
+				clearRect.rect.offset.y = rect.y;
+				clearRect.rect.extent.width = rect.width;
+				clearRect.rect.extent.height = rect.height;
+				vkCmdClearAttachments(commandBuffer, 1, &clearAttachment, 1, &clearRect);
+				break;
+			}
+			case FrameCaptureCommand_BindPipeline:
+			{
+				uint32_t id;
+				memcpy(&id, payload, sizeof(id));
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[id]);
+				++stats->stateChanges;
+				break;
+			}
+			case FrameCaptureCommand_BindUniformSet:
+			{
+				uint32_t id;
+				memcpy(&id, payload, sizeof(id));
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context->pipelineLayout, 0, 1, &uniformSets[id], 0, NULL);
+				++stats->stateChanges;
+				break;
+			}
+			case FrameCaptureCommand_BindVertexBuffer:
+			{
+				FrameCaptureVertexBuffer binding;
+				memcpy(&binding, payload, sizeof(binding));
+				VkDeviceSize offset = binding.offset;
+				vkCmdBindVertexBuffers(commandBuffer, binding.binding, 1, &buffers[binding.buffer].buffer, &offset);
+				++stats->stateChanges;
+				break;
+			}
+			case FrameCaptureCommand_BindIndexBuffer:
+			{
+				FrameCaptureIndexBuffer binding;
+				memcpy(&binding, payload, sizeof(binding));
+				vkCmdBindIndexBuffer(commandBuffer, buffers[binding.buffer].buffer, binding.offset, (VkIndexType)binding.indexType);
+				++stats->stateChanges;
+				break;
+			}
+			case FrameCaptureCommand_DrawIndexed:
+			{
+				FrameCaptureDraw draw;
+				memcpy(&draw, payload, sizeof(draw));
+				vkCmdDrawIndexed(commandBuffer, draw.indexCount, draw.instanceCount, draw.firstIndex, draw.vertexOffset, draw.firstInstance);
+				++stats->drawCalls;
+				break;
+			}
+			case FrameCaptureCommand_EndRenderPass:
+				vkCmdEndRenderPass(commandBuffer);
+				break;
+			}
+		}
+
+		return true;
+	}
+
+	void Teardown(BenchmarkContext* context)
+	{
+		for (size_t i = 0; i < pipelines.size(); ++i)
+		{
+			vkDestroyPipeline(context->device, pipelines[i], NULL);
+		}
+
+		for (size_t i = 0; i < modules.size(); ++i)
+		{
+			vkDestroyShaderModule(context->device, modules[i], NULL);
+		}
+
+		for (size_t i = 0; i < buffers.size(); ++i)
+		{
+			DestroyTrackedBuffer(context, buffers[i].buffer, buffers[i].memory);
+		}
+
+		for (size_t i = 0; i < stagingBuffers.size(); ++i)
+		{
+			DestroyTrackedBuffer(context, stagingBuffers[i].buffer, stagingBuffers[i].memory);
+		}
+
+		// Destroying the pool frees the sets
+		if (descriptorPool != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorPool(context->device, descriptorPool, NULL);
+		}
+
+		vkDestroyFramebuffer(context->device, framebuffer, NULL);
+		vkDestroyRenderPass(context->device, renderPass, NULL);
+		vkDestroyImageView(context->device, depthView, NULL);
+		vkDestroyImage(context->device, depthImage, NULL);
+		vkFreeMemory(context->device, depthMemory, NULL);
+		vkDestroyImageView(context->device, colorView, NULL);
+		vkDestroyImage(context->device, colorImage, NULL);
+		vkFreeMemory(context->device, colorMemory, NULL);
+
+		pipelines.clear();
+		modules.clear();
+		buffers.clear();
+		stagingBuffers.clear();
+		uniformSets.clear();
+		frameCommands.clear();
+		data.clear();
+		descriptorPool = VK_NULL_HANDLE;
+		framebuffer = VK_NULL_HANDLE;
+		renderPass = VK_NULL_HANDLE;
+		depthView = VK_NULL_HANDLE;
+		depthImage = VK_NULL_HANDLE;
+		depthMemory = VK_NULL_HANDLE;
+		colorView = VK_NULL_HANDLE;
+		colorImage = VK_NULL_HANDLE;
+		colorMemory = VK_NULL_HANDLE;
+	}
+
+private:
+	struct ReplayBuffer
+	{
+		VkBuffer buffer;
+		VkDeviceMemory memory;
+		VkDeviceSize size;
+		bool hostVisible;
+	};
+
+	struct FrameCommand
+	{
+		uint32_t command;
+		size_t offset;		// Of the payload in data
+	};
+
+	bool CreateTargets(BenchmarkContext* context)
+	{
+		VkFormat depthFormat;
+
+		if (FindDepthFormat(context->physicalDevice, 0, &depthFormat) == false
+			|| CreateRenderTarget(context->device, context->memoryProperties.memoryTypes, header.width, header.height, replayColorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+				VK_IMAGE_ASPECT_COLOR_BIT, &colorImage, &colorMemory, &colorView) == false
+			|| CreateRenderTarget(context->device, context->memoryProperties.memoryTypes, header.width, header.height, depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+				VK_IMAGE_ASPECT_DEPTH_BIT, &depthImage, &depthMemory, &depthView) == false)
+		{
+			return false;
+		}
+
+		context->objectsCreated += 6;
+
+		// Neither target is read back, only the work of drawing into them matters
+		VkAttachmentDescription attachmentDescriptions[2];
+		attachmentDescriptions[0].flags = 0;
+		attachmentDescriptions[0].format = replayColorFormat;
+		attachmentDescriptions[0].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachmentDescriptions[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachmentDescriptions[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachmentDescriptions[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachmentDescriptions[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachmentDescriptions[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachmentDescriptions[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		attachmentDescriptions[1].flags = 0;
+		attachmentDescriptions[1].format = depthFormat;
+		attachmentDescriptions[1].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachmentDescriptions[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachmentDescriptions[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachmentDescriptions[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachmentDescriptions[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachmentDescriptions[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachmentDescriptions[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkAttachmentReference colorAttachmentReference;
+		colorAttachmentReference.attachment = 0;
+		colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		VkAttachmentReference depthAttachmentReference;
+		depthAttachmentReference.attachment = 1;
+		depthAttachmentReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkSubpassDescription subpassDescription;
+		subpassDescription.flags = 0;
+		subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpassDescription.inputAttachmentCount = 0;
+		subpassDescription.pInputAttachments = NULL;
+		subpassDescription.colorAttachmentCount = 1;
+		subpassDescription.pColorAttachments = &colorAttachmentReference;
+		subpassDescription.pResolveAttachments = NULL;
+		subpassDescription.pDepthStencilAttachment = &depthAttachmentReference;
+		subpassDescription.preserveAttachmentCount = 0;
+		subpassDescription.pPreserveAttachments = NULL;
+
+		VkRenderPassCreateInfo renderPassCreateInfo;
+		renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassCreateInfo.pNext = NULL;
+		renderPassCreateInfo.flags = 0;
+		renderPassCreateInfo.attachmentCount = 2;
+		renderPassCreateInfo.pAttachments = attachmentDescriptions;
+		renderPassCreateInfo.subpassCount = 1;
+		renderPassCreateInfo.pSubpasses = &subpassDescription;
+		renderPassCreateInfo.dependencyCount = 0;
+		renderPassCreateInfo.pDependencies = NULL;
+
+		if (vkCreateRenderPass(context->device, &renderPassCreateInfo, NULL, &renderPass) != VK_SUCCESS)
+		{
+			renderPass = VK_NULL_HANDLE;
+			return false;
+		}
+
+		VkImageView attachments[2] = { colorView, depthView };
+
+		VkFramebufferCreateInfo framebufferCreateInfo;
+		framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferCreateInfo.pNext = NULL;
+		framebufferCreateInfo.flags = 0;
+		framebufferCreateInfo.renderPass = renderPass;
+		framebufferCreateInfo.attachmentCount = 2;
+		framebufferCreateInfo.pAttachments = attachments;
+		framebufferCreateInfo.width = header.width;
+		framebufferCreateInfo.height = header.height;
+		framebufferCreateInfo.layers = 1;
+
+		if (vkCreateFramebuffer(context->device, &framebufferCreateInfo, NULL, &framebuffer) != VK_SUCCESS)
+		{
+			framebuffer = VK_NULL_HANDLE;
+			return false;
+		}
+
+		context->objectsCreated += 2;
+		return true;
+	}
+
+	// Creates the objects and keeps the render pass commands for RecordFrame. Anything malformed fails
+	// the whole capture, so RecordFrame can trust every id.
+	bool ParseCommands(BenchmarkContext* context)
+	{
+		size_t offset = sizeof(FrameCaptureHeader);
+		bool inRenderPass = false;
+
+		for (;;)
+		{
+			FrameCaptureCommandHeader command;
+
+			if (data.size() - offset < sizeof(command))
+			{
+				std::cerr << path << " is truncated" << std::endl;
+				return false;
+			}
+
+			memcpy(&command, &data[offset], sizeof(command));
+			offset += sizeof(command);
+			size_t paddedSize = ((size_t)command.size + 3) & ~(size_t)3;
+
+			if (data.size() - offset < paddedSize)
+			{
+				std::cerr << path << " is truncated" << std::endl;
+				return false;
+			}
+
+			if (command.command == FrameCaptureCommand_End)
+			{
+				return inRenderPass == false;
+			}
+
+			if (ParseCommand(context, command, offset, &inRenderPass) == false)
+			{
+				std::cerr << path << " has an invalid command " << command.command << " at offset " << offset - sizeof(command) << std::endl;
+				return false;
+			}
+
+			offset += paddedSize;
+		}
+	}
+
+	bool ParseCommand(BenchmarkContext* context, const FrameCaptureCommandHeader& command, size_t offset, bool* inRenderPass)
+	{
+		const unsigned char* payload = &data[offset];
+		uint32_t id;
+
+		switch (command.command)
+		{
+		case FrameCaptureCommand_CreateBuffer:
+		{
+			FrameCaptureBuffer description;
+
+			if (command.size != sizeof(description))
+			{
+				return false;
+			}
+
+			memcpy(&description, payload, sizeof(description));
+
+			if (description.id != buffers.size() || description.size == 0)
+			{
+				return false;
+			}
+
+			ReplayBuffer buffer;
+			buffer.size = description.size;
+			buffer.hostVisible = description.hostVisible != 0;
+
+			bool created = buffer.hostVisible
+				? CreateTrackedBuffer(context, description.usage, NULL, (size_t)description.size, &buffer.buffer, &buffer.memory)
+				: CreateTrackedDeviceBuffer(context, description.usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, description.size, &buffer.buffer, &buffer.memory);
+
+			if (created == false)
+			{
+				return false;
+			}
+
+			buffers.push_back(buffer);
+			return true;
+		}
+		case FrameCaptureCommand_UploadBuffer:
+		{
+			FrameCaptureUpload upload;
+
+			if (command.size < sizeof(upload))
+			{
+				return false;
+			}
+
+			memcpy(&upload, payload, sizeof(upload));
+			size_t size = command.size - sizeof(upload);
+
+			if (upload.buffer >= buffers.size() || upload.offset > buffers[upload.buffer].size || size > buffers[upload.buffer].size - upload.offset)
+			{
+				return false;
+			}
+
+			return Upload(context, buffers[upload.buffer], upload.offset, payload + sizeof(upload), size);
+		}
+		case FrameCaptureCommand_CreateShaderModule:
+		{
+			if (command.size <= sizeof(id) || (command.size - sizeof(id)) % sizeof(uint32_t) != 0)
+			{
+				return false;
+			}
+
+			memcpy(&id, payload, sizeof(id));
+
+			// Payloads are padded to 4 bytes, so the words that follow the id are aligned
+			VkShaderModule module;
+
+			if (id != modules.size() || CreateShaderModule(context->device, (const uint32_t*)(payload + sizeof(id)), command.size - sizeof(id), &module) == false)
+			{
+				return false;
+			}
+
+			modules.push_back(module);
+			++context->objectsCreated;
+			return true;
+		}
+		case FrameCaptureCommand_CreatePipeline:
+		{
+			FrameCapturePipeline description;
+
+			if (command.size != sizeof(description))
+			{
+				return false;
+			}
+
+			memcpy(&description, payload, sizeof(description));
+
+			if (description.id != pipelines.size() || description.vertModule >= modules.size()
+				|| (description.fragModule != FrameCaptureNoId && description.fragModule >= modules.size())
+				|| description.positionFormat > VertexPositionFormat_Half || description.attributeFormat > VertexAttributeFormat_Unorm10
+				|| description.depthMode > MeshDepthMode_TestEqual)
+			{
+				return false;
+			}
+
+			VertexFormat vertexFormat;
+			vertexFormat.position = (VertexPositionFormat)description.positionFormat;
+			vertexFormat.attribute = (VertexAttributeFormat)description.attributeFormat;
+			memcpy(vertexFormat.positionScale, description.positionScale, sizeof(vertexFormat.positionScale));
+			memcpy(vertexFormat.positionOffset, description.positionOffset, sizeof(vertexFormat.positionOffset));
+
+			MeshShaderVariant variant;
+			variant.quantizedPositions = description.quantizedPositions;
+
+			VkShaderModule fragModule = description.fragModule != FrameCaptureNoId ? modules[description.fragModule] : VK_NULL_HANDLE;
+			VkPipeline pipeline;
+
+			if (CreateMeshPipeline(context->device, context->pipelineCache, context->pipelineLayout, renderPass, modules[description.vertModule], fragModule, vertexFormat, variant,
+				(MeshDepthMode)description.depthMode, description.perInstanceTransforms != 0, &pipeline) == false)
+			{
+				return false;
+			}
+
+			pipelines.push_back(pipeline);
+			++context->objectsCreated;
+			return true;
+		}
+		case FrameCaptureCommand_CreateUniformSet:
+		{
+			FrameCaptureUniformSet description;
+
+			if (command.size != sizeof(description))
+			{
+				return false;
+			}
+
+			memcpy(&description, payload, sizeof(description));
+
+			if (description.id != uniformSets.size() || description.buffer >= buffers.size() || description.range > buffers[description.buffer].size)
+			{
+				return false;
+			}
+
+			VkDescriptorSet descriptorSet;
+
+			if (AllocateUniformSet(context, buffers[description.buffer].buffer, description.range, &descriptorSet) == false)
+			{
+				return false;
+			}
+
+			uniformSets.push_back(descriptorSet);
+			return true;
+		}
+		case FrameCaptureCommand_BeginRenderPass:
+		{
+			FrameCaptureRenderPass pass;
+
+			if (command.size != sizeof(pass) || *inRenderPass)
+			{
+				return false;
+			}
+
+			memcpy(&pass, payload, sizeof(pass));
+
+			if (pass.width == 0 || pass.width > header.width || pass.height == 0 || pass.height > header.height)
+			{
+				return false;
+			}
+
+			*inRenderPass = true;
+			break;
+		}
+		case FrameCaptureCommand_ClearRect:
+		{
+			FrameCaptureClearRect rect;
+
+			if (command.size != sizeof(rect))
+			{
+				return false;
+			}
+
+			memcpy(&rect, payload, sizeof(rect));
+
+			if (rect.x < 0 || rect.y < 0 || (uint64_t)rect.x + rect.width > header.width || (uint64_t)rect.y + rect.height > header.height)
+			{
+				return false;
+			}
+
+			break;
+		}
+		case FrameCaptureCommand_BindPipeline:
+		case FrameCaptureCommand_BindUniformSet:
+		{
+			if (command.size != sizeof(id))
+			{
+				return false;
+			}
+
+			memcpy(&id, payload, sizeof(id));
+
+			if (id >= (command.command == FrameCaptureCommand_BindPipeline ? pipelines.size() : uniformSets.size()))
+			{
+				return false;
+			}
+
+			break;
+		}
+		case FrameCaptureCommand_BindVertexBuffer:
+		{
+			FrameCaptureVertexBuffer binding;
+
+			if (command.size != sizeof(binding))
+			{
+				return false;
+			}
+
+			memcpy(&binding, payload, sizeof(binding));
+
+			if (binding.binding > MeshInstanceBinding || binding.buffer >= buffers.size() || binding.offset >= buffers[binding.buffer].size)
+			{
+				return false;
+			}
+
+			break;
+		}
+		case FrameCaptureCommand_BindIndexBuffer:
+		{
+			FrameCaptureIndexBuffer binding;
+
+			if (command.size != sizeof(binding))
+			{
+				return false;
+			}
+
+			memcpy(&binding, payload, sizeof(binding));
+
+			if (binding.buffer >= buffers.size() || binding.offset >= buffers[binding.buffer].size
+				|| (binding.indexType != VK_INDEX_TYPE_UINT16 && binding.indexType != VK_INDEX_TYPE_UINT32))
+			{
+				return false;
+			}
+
+			break;
+		}
+		case FrameCaptureCommand_DrawIndexed:
+		{
+			if (command.size != sizeof(FrameCaptureDraw))
+			{
+				return false;
+			}
+
+			break;
+		}
+		case FrameCaptureCommand_EndRenderPass:
+		{
+			if (command.size != 0 || *inRenderPass == false)
+			{
+				return false;
+			}
+
+			*inRenderPass = false;
+			break;
+		}
+		default:
+			return false;
+		}
+
+		// Only the render pass and what happens inside it is replayed every frame
+		if (*inRenderPass == false && command.command != FrameCaptureCommand_EndRenderPass)
+		{
+			return false;
+		}
+
+		FrameCommand frameCommand;
+		frameCommand.command = command.command;
+		frameCommand.offset = offset;
+		frameCommands.push_back(frameCommand);
+		return true;
+	}
+
+	bool Upload(BenchmarkContext* context, const ReplayBuffer& buffer, VkDeviceSize offset, const void* source, size_t size)
+	{
+		if (size == 0)
+		{
+			return true;
+		}
+
+		if (buffer.hostVisible)
+		{
+			void* mapped;
+
+			if (vkMapMemory(context->device, buffer.memory, offset, size, 0, &mapped) != VK_SUCCESS)
+			{
+				return false;
+			}
+
+			memcpy(mapped, source, size);
+			vkUnmapMemory(context->device, buffer.memory);
+			return true;
+		}
+
+		ReplayBuffer staging;
+		staging.size = size;
+		staging.hostVisible = true;
+
+		if (CreateTrackedBuffer(context, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, source, size, &staging.buffer, &staging.memory) == false)
+		{
+			return false;
+		}
+
+		stagingBuffers.push_back(staging);
+
+		VkBufferCopy copy;
+		copy.srcOffset = 0;
+		copy.dstOffset = offset;
+		copy.size = size;
+		vkCmdCopyBuffer(context->commandBuffer, staging.buffer, buffer.buffer, 1, &copy);
+
+		// Every frame's reads come after this submit has been waited for, the barrier only makes the
+		// copy visible to them
+		VkBufferMemoryBarrier barrier;
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.pNext = NULL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = buffer.buffer;
+		barrier.offset = offset;
+		barrier.size = size;
+		vkCmdPipelineBarrier(context->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 0, NULL, 1, &barrier, 0, NULL);
+		return true;
+	}
+
+	bool AllocateUniformSet(BenchmarkContext* context, VkBuffer buffer, VkDeviceSize range, VkDescriptorSet* descriptorSet)
+	{
+		// Captures hold a handful of sets, a pool per scenario run is sized generously once
+		if (descriptorPool == VK_NULL_HANDLE)
+		{
+			VkDescriptorPoolSize descriptorPoolSizes[2];
+			descriptorPoolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			descriptorPoolSizes[0].descriptorCount = MaxUniformSets;
+			descriptorPoolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			descriptorPoolSizes[1].descriptorCount = MaxUniformSets;
+
+			VkDescriptorPoolCreateInfo descriptorPoolCreateInfo;
+			descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+			descriptorPoolCreateInfo.pNext = NULL;
+			descriptorPoolCreateInfo.flags = 0;
+			descriptorPoolCreateInfo.maxSets = MaxUniformSets;
+			descriptorPoolCreateInfo.poolSizeCount = 2;
+			descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes;
+
+			if (vkCreateDescriptorPool(context->device, &descriptorPoolCreateInfo, NULL, &descriptorPool) != VK_SUCCESS)
+			{
+				descriptorPool = VK_NULL_HANDLE;
+				return false;
+			}
+
+			++context->objectsCreated;
+		}
+
+		if (uniformSets.size() >= MaxUniformSets)
+		{
+			return false;
+		}
+
+		VkDescriptorSetAllocateInfo descriptorSetAllocateInfo;
+		descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		descriptorSetAllocateInfo.pNext = NULL;
+		descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+		descriptorSetAllocateInfo.descriptorSetCount = 1;
+		descriptorSetAllocateInfo.pSetLayouts = &context->descriptorSetLayout;
+
+		if (vkAllocateDescriptorSets(context->device, &descriptorSetAllocateInfo, descriptorSet) != VK_SUCCESS)
+		{
+			return false;
+		}
+
+		VkDescriptorBufferInfo uniformBufferInfo;
+		uniformBufferInfo.buffer = buffer;
+		uniformBufferInfo.offset = 0;
+		uniformBufferInfo.range = range;
+
+		VkWriteDescriptorSet uniformWrite;
+		uniformWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		uniformWrite.pNext = NULL;
+		uniformWrite.dstSet = *descriptorSet;
+		uniformWrite.dstBinding = 0;
+		uniformWrite.dstArrayElement = 0;
+		uniformWrite.descriptorCount = 1;
+		uniformWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		uniformWrite.pImageInfo = NULL;
+		uniformWrite.pBufferInfo = &uniformBufferInfo;
+		uniformWrite.pTexelBufferView = NULL;
+		vkUpdateDescriptorSets(context->device, 1, &uniformWrite, 0, NULL);
+
+		// Textures aren't captured, the mesh shaders sample the context's white texture instead
+		WriteTextureDescriptor(context, *descriptorSet);
+		return true;
+	}
+
+	static const uint32_t MaxUniformSets = 64;
+
+	std::string path;
+	std::string name;
+	std::vector<unsigned char> data;
+	FrameCaptureHeader header;
+
+	VkImage colorImage;
+	VkDeviceMemory colorMemory;
+	VkImageView colorView;
+	VkImage depthImage;
+	VkDeviceMemory depthMemory;
+	VkImageView depthView;
+	VkRenderPass renderPass;
+	VkFramebuffer framebuffer;
+	VkDescriptorPool descriptorPool;
+
+	std::vector<ReplayBuffer> buffers;
+	std::vector<ReplayBuffer> stagingBuffers;
+	std::vector<VkShaderModule> modules;
+	std::vector<VkPipeline> pipelines;
+	std::vector<VkDescriptorSet> uniformSets;
+	std::vector<FrameCommand> frameCommands;
+};
+
+BenchmarkScenario* CreateCaptureReplayScenario(const char* path)
+{
+	return new CaptureReplayScenario(path);
+}
@@ -0,0 +1,206 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "benchmark.h"
+#include "benchmark_report.h"
+#include "logger.h"
+
+// Headless renderer benchmark for regression tracking. Runs named scenarios for a fixed number of
+// frames against an offscreen target and writes the results as JSON. Software implementations are
+// allowed by default so it runs on CI machines without a GPU or display. Frames captured by the
+// test application are replayed as extra scenarios with --replay.
+
+static void PrintUsage(const std::vector<BenchmarkScenario*>& scenarios)
+{
+	std::cerr << "Usage: VulkanBenchmark [--scenario <name>]... [--frames <count>] [--warmup <count>] [--resolution <width>x<height>]" << std::endl;
+	std::cerr << "                       [--device <index|name>] [--no-software-device] [--validation] [--output <file.json>] [--replay <capture>]..." << std::endl;
+	std::cerr << "Scenarios:" << std::endl;
+
+	for (size_t i = 0; i < scenarios.size(); ++i)
+	{
+		std::cerr << "  " << scenarios[i]->GetName() << ": " << scenarios[i]->GetDescription() << std::endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<BenchmarkScenario*> scenarios;
+	GetBenchmarkScenarios(&scenarios);
+
+	BenchmarkOptions options;
+	options.deviceName = NULL;
+	options.deviceIndex = -1;
+	options.allowSoftware = true;
+	options.validation = false;
+	options.width = 1280;
+	options.height = 720;
+
+	std::vector<const char*> scenarioNames;
+	uint32_t frameCount = 300;
+	uint32_t warmupFrames = 10;
+	const char* outputPath = NULL;
+	std::vector<BenchmarkScenario*> replayScenarios;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--scenario") == 0 && i + 1 < argc)
+		{
+			scenarioNames.push_back(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+		{
+			frameCount = (uint32_t)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+		{
+			warmupFrames = (uint32_t)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--resolution") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%ux%u", &options.width, &options.height) == 2)
+		{
+			++i;
+		}
+		else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc)
+		{
+			const char* device = argv[++i];
+			char* end;
+			long index = strtol(device, &end, 10);
+
+			if (*end == '\0' && index >= 0)
+			{
+				options.deviceIndex = (int)index;
+			}
+			else
+			{
+				options.deviceName = device;
+			}
+		}
+		else if (strcmp(argv[i], "--no-software-device") == 0)
+		{
+			options.allowSoftware = false;
+		}
+		else if (strcmp(argv[i], "--validation") == 0)
+		{
+			options.validation = true;
+		}
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+		{
+			outputPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+		{
+			replayScenarios.push_back(CreateCaptureReplayScenario(argv[++i]));
+		}
+		else
+		{
+			PrintUsage(scenarios);
+			return 1;
+		}
+	}
+
+	if (frameCount == 0 || options.width == 0 || options.height == 0)
+	{
+		PrintUsage(scenarios);
+		return 1;
+	}
+
+	std::vector<BenchmarkScenario*> selectedScenarios;
+
+	// Replays on their own run without the built in scenarios
+	if (scenarioNames.empty() && replayScenarios.empty())
+	{
+		selectedScenarios = scenarios;
+	}
+
+	for (size_t i = 0; i < scenarioNames.size(); ++i)
+	{
+		BenchmarkScenario* found = NULL;
+
+		for (size_t j = 0; j < scenarios.size() && found == NULL; ++j)
+		{
+			if (strcmp(scenarios[j]->GetName(), scenarioNames[i]) == 0)
+			{
+				found = scenarios[j];
+			}
+		}
+
+		if (found == NULL)
+		{
+			std::cerr << "Unknown scenario " << scenarioNames[i] << std::endl;
+			PrintUsage(scenarios);
+			return 1;
+		}
+
+		selectedScenarios.push_back(found);
+	}
+
+	selectedScenarios.insert(selectedScenarios.end(), replayScenarios.begin(), replayScenarios.end());
+	scenarios.insert(scenarios.end(), replayScenarios.begin(), replayScenarios.end());
+
+	StartLogging(LogSeverity_Warning);
+
+	BenchmarkContext context;
+
+	if (CreateBenchmarkContext(options, &context) == false)
+	{
+		DestroyBenchmarkContext(&context);
+		return 1;
+	}
+
+	std::cerr << "Running on " << context.properties.deviceName << std::endl;
+
+	std::vector<BenchmarkStats> results;
+	bool succeeded = true;
+
+	for (size_t i = 0; i < selectedScenarios.size(); ++i)
+	{
+		BenchmarkStats stats;
+
+		if (RunBenchmarkScenario(&context, selectedScenarios[i], warmupFrames, frameCount, &stats) == false)
+		{
+			succeeded = false;
+			continue;
+		}
+
+		PrintBenchmarkSummary(stats);
+		results.push_back(stats);
+	}
+
+	// Results go to stdout unless a file is given, progress is on stderr so the two can be separated
+	FILE* output = stdout;
+
+	if (outputPath != NULL)
+	{
+		output = fopen(outputPath, "w");
+
+		if (output == NULL)
+		{
+			std::cerr << "Couldn't open " << outputPath << std::endl;
+			DestroyBenchmarkContext(&context);
+			return 1;
+		}
+	}
+
+	if (WriteBenchmarkReport(output, context, frameCount, results) == false)
+	{
+		std::cerr << "Failed to write the benchmark report" << std::endl;
+		succeeded = false;
+	}
+
+	if (output != stdout)
+	{
+		fclose(output);
+	}
+
+	DestroyBenchmarkContext(&context);
+	StopLogging();
+
+	for (size_t i = 0; i < scenarios.size(); ++i)
+	{
+		delete scenarios[i];
+	}
+
+	return succeeded ? 0 : 1;
+}
@@ -0,0 +1,15 @@
+#version 450
+
+layout (set = 0, binding = 0) uniform sampler2D atlas;
+
+layout (location = 0) in vec2 atlasCoord;
+layout (location = 1) in vec4 color;
+
+layout (location = 0) out vec4 outColor;
+
+void main()
+{
+	// Glyphs are drawn at their baked size, so each pixel maps to one texel
+	float coverage = texelFetch(atlas, ivec2(atlasCoord), 0).r;
+	outColor = vec4(color.rgb, color.a * coverage);
+}
@@ -0,0 +1,35 @@
+#version 450
+
+// One quad per instance as a four vertex triangle strip, matches PerformanceHud::Quad
+layout (location = 0) in ivec2 position;	// Top left in pixels
+layout (location = 1) in uvec2 size;
+layout (location = 2) in uint glyph;
+layout (location = 3) in vec4 color;
+
+layout (push_constant) uniform Constants
+{
+	vec2 pixelToClip;	// 2 / the size the overlay is shown at
+} constants;
+
+// Glyph cells in hud_font.h and the atlas PerformanceHud builds from it
+const uint ATLAS_COLUMNS = 16;
+const vec2 GLYPH_SIZE = vec2(8.0, 12.0);
+
+layout (location = 0) out vec2 atlasCoord;	// In texels
+layout (location = 1) out vec4 outColor;
+
+out gl_PerVertex {
+	vec4 gl_Position;
+};
+
+void main()
+{
+	vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+	vec2 pixel = vec2(position) + corner * vec2(size);
+
+	vec2 cell = vec2(glyph % ATLAS_COLUMNS, glyph / ATLAS_COLUMNS);
+	atlasCoord = (cell + corner) * GLYPH_SIZE;
+	outColor = color;
+
+	gl_Position = vec4(pixel * constants.pixelToClip - 1.0, 0.0, 1.0);
+}
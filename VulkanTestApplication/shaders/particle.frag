@@ -0,0 +1,13 @@
+#version 450
+
+layout (location = 0) in vec4 color;
+layout (location = 1) in vec2 corner;
+
+layout (location = 0) out vec4 outColor;
+
+void main()
+{
+	// Round falloff inside the quad, blended additively
+	float falloff = clamp(1.0 - dot(corner, corner), 0.0, 1.0);
+	outColor = vec4(color.rgb, color.a * falloff);
+}
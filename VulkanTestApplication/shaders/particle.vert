@@ -0,0 +1,42 @@
+#version 450
+
+// One camera facing quad per particle as a four vertex triangle strip, read straight from the
+// buffer simulation compacted the survivors into
+struct Particle
+{
+	vec4 position;	// w is the remaining life in seconds
+	vec4 velocity;	// w is the life it was emitted with
+};
+
+layout (std430, binding = 1) readonly buffer Particles
+{
+	Particle particles[];
+};
+
+layout (push_constant) uniform Constants
+{
+	mat4 viewProjection;
+	vec2 size;		// Half size of a particle in clip space at w = 1
+} constants;
+
+layout (location = 0) out vec4 color;
+layout (location = 1) out vec2 corner;
+
+out gl_PerVertex {
+	vec4 gl_Position;
+};
+
+void main()
+{
+	Particle particle = particles[gl_InstanceIndex];
+
+	corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1) * 2.0 - 1.0;
+
+	vec4 position = constants.viewProjection * vec4(particle.position.xyz, 1.0);
+	position.xy += corner * constants.size * position.w;
+	gl_Position = position;
+
+	// Hot and opaque when emitted, fading to red as the particle ages
+	float age = 1.0 - particle.position.w / particle.velocity.w;
+	color = mix(vec4(1.0, 0.9, 0.5, 1.0), vec4(1.0, 0.25, 0.05, 0.0), age);
+}
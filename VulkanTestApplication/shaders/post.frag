@@ -0,0 +1,40 @@
+#version 450
+
+// One per-pixel post effect, reading the previous subpass's output at this pixel
+layout (input_attachment_index = 0, set = 0, binding = 0) uniform subpassInput previous;
+
+// Matches PostEffect in scene_pass.h
+layout (constant_id = 0) const int EFFECT = 0;
+
+layout (push_constant) uniform Constants
+{
+	vec2 sceneSize;		// Render area in pixels
+} constants;
+
+layout (location = 0) out vec4 outColor;
+
+void main()
+{
+	vec4 color = subpassLoad(previous);
+
+	if (EFFECT == 0)
+	{
+		// Tonemap: exposure then the Reinhard curve
+		vec3 exposed = color.rgb * 1.5;
+		color.rgb = exposed / (1.0 + exposed);
+	}
+	else if (EFFECT == 1)
+	{
+		// Vignette: darken towards the corners of the render area
+		vec2 offset = gl_FragCoord.xy / constants.sceneSize - 0.5;
+		color.rgb *= 1.0 - smoothstep(0.3, 0.75, length(offset));
+	}
+	else if (EFFECT == 2)
+	{
+		// Desaturate: halfway to Rec. 709 luminance
+		float luminance = dot(color.rgb, vec3(0.2126, 0.7152, 0.0722));
+		color.rgb = mix(color.rgb, vec3(luminance), 0.5);
+	}
+
+	outColor = color;
+}
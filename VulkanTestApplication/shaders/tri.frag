@@ -2,10 +2,13 @@
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_ARB_shading_language_420pack : enable
 
+// Streamed texture, the sampler picks whichever levels are resident
+layout (binding = 1) uniform sampler2D tex;
+
 layout (location = 0) in vec4 color;
+layout (location = 1) in vec2 texcoord;
 layout (location = 0) out vec4 uFragColor;
 
-
 void main() {
-   uFragColor = color;
+   uFragColor = color * texture(tex, texcoord);
 }
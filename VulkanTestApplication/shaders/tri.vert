@@ -5,15 +5,22 @@
 // Uniform
 layout (std140, binding = 0) uniform buf
 {
-	mat4 MVP;
+	mat4 viewProjection;
+	vec4 positionScale;
+	vec4 positionOffset;
 } ubuf;
 
+// Specialisation
+layout (constant_id = 0) const bool QUANTIZED_POSITIONS = false;
+
 // In
 layout (location = 0) in vec3 pos;
 layout (location = 1) in vec3 attr;
+layout (location = 2) in mat4 model;	// Per instance, locations 2 to 5
 
 // Out
 layout (location = 0) out vec4 color;
+layout (location = 1) out vec2 texcoord;	// Planar projection of the model space position
 
 out gl_PerVertex {
 	vec4 gl_Position;
@@ -21,5 +28,14 @@ out gl_PerVertex {
 
 void main() {
    color = vec4(attr.xyz, 1.0);
-   gl_Position = ubuf.MVP * vec4(pos.xyz, 1.0);
+   vec3 position = pos;
+
+   // Undo snorm quantisation, folded away for float and half positions
+   if (QUANTIZED_POSITIONS)
+   {
+      position = position * ubuf.positionScale.xyz + ubuf.positionOffset.xyz;
+   }
+
+   texcoord = position.xy * 0.5 + 0.5;
+   gl_Position = ubuf.viewProjection * model * vec4(position, 1.0);
 }
@@ -0,0 +1,236 @@
+#include "asset_pack.h"
+
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+AssetPack::AssetPack() :
+#ifdef _WIN32
+	fileHandle(INVALID_HANDLE_VALUE),
+	mappingHandle(NULL),
+#else
+	fileDescriptor(-1),
+#endif
+	mappedData(NULL),
+	mappedSize(0),
+	entries(NULL),
+	entryCount(0)
+{
+}
+
+AssetPack::~AssetPack()
+{
+	Close();
+}
+
+bool AssetPack::Open(const char* path)
+{
+	Close();
+
+#ifdef _WIN32
+	fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+
+	if (GetFileSizeEx(fileHandle, &fileSize) == FALSE || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (mappingHandle == NULL)
+	{
+		Close();
+		return false;
+	}
+
+	mappedData = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	mappedSize = (size_t)fileSize.QuadPart;
+#else
+	fileDescriptor = open(path, O_RDONLY);
+
+	if (fileDescriptor < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+
+	if (fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+
+	void* mapping = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	mappedData = mapping != MAP_FAILED ? (const unsigned char*)mapping : NULL;
+	mappedSize = (size_t)fileStat.st_size;
+#endif
+
+	if (mappedData == NULL)
+	{
+		Close();
+		return false;
+	}
+
+	if (Validate() == false)
+	{
+		std::cout << "Asset pack " << path << " is invalid" << std::endl;
+		Close();
+		return false;
+	}
+
+	entries = (const AssetPackEntry*)(mappedData + sizeof(AssetPackHeader));
+	entryCount = ((const AssetPackHeader*)mappedData)->entryCount;
+
+	return true;
+}
+
+void AssetPack::Close()
+{
+#ifdef _WIN32
+	if (mappedData != NULL)
+	{
+		UnmapViewOfFile(mappedData);
+	}
+
+	if (mappingHandle != NULL)
+	{
+		CloseHandle(mappingHandle);
+		mappingHandle = NULL;
+	}
+
+	if (fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(fileHandle);
+		fileHandle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (mappedData != NULL)
+	{
+		munmap((void*)mappedData, mappedSize);
+	}
+
+	if (fileDescriptor >= 0)
+	{
+		close(fileDescriptor);
+		fileDescriptor = -1;
+	}
+#endif
+
+	mappedData = NULL;
+	mappedSize = 0;
+	entries = NULL;
+	entryCount = 0;
+}
+
+bool AssetPack::IsOpen() const
+{
+	return mappedData != NULL;
+}
+
+bool AssetPack::Validate() const
+{
+	if (mappedSize < sizeof(AssetPackHeader))
+	{
+		return false;
+	}
+
+	const AssetPackHeader* header = (const AssetPackHeader*)mappedData;
+
+	if (header->magic != AssetPackMagic || header->version != AssetPackVersion || header->fileSize != mappedSize)
+	{
+		return false;
+	}
+
+	if (header->entryCount > (mappedSize - sizeof(AssetPackHeader)) / sizeof(AssetPackEntry))
+	{
+		return false;
+	}
+
+	// Only bounds are checked here, blob contents are validated by whoever consumes them
+	const AssetPackEntry* tableOfContents = (const AssetPackEntry*)(mappedData + sizeof(AssetPackHeader));
+
+	for (uint32_t i = 0; i < header->entryCount; ++i)
+	{
+		const AssetPackEntry& entry = tableOfContents[i];
+
+		if (entry.offset % AssetPackAlignment != 0 || entry.offset > mappedSize || entry.size > mappedSize - entry.offset)
+		{
+			return false;
+		}
+
+		if (i > 0 && strncmp(tableOfContents[i - 1].name, entry.name, AssetPackMaxNameLength) >= 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool AssetPack::Find(const char* name, AssetType type, const void** data, size_t* dataSize) const
+{
+	if (strlen(name) > AssetPackMaxNameLength)
+	{
+		return false;
+	}
+
+	// Binary search the sorted table of contents
+	uint32_t first = 0;
+	uint32_t last = entryCount;
+
+	while (first < last)
+	{
+		uint32_t middle = first + (last - first) / 2;
+		int compare = strncmp(name, entries[middle].name, AssetPackMaxNameLength);
+
+		if (compare == 0)
+		{
+			if (entries[middle].type != (uint32_t)type)
+			{
+				return false;
+			}
+
+			*data = mappedData + entries[middle].offset;
+			*dataSize = (size_t)entries[middle].size;
+			return true;
+		}
+
+		if (compare < 0)
+		{
+			last = middle;
+		}
+		else
+		{
+			first = middle + 1;
+		}
+	}
+
+	return false;
+}
+
+uint32_t AssetPack::GetEntryCount() const
+{
+	return entryCount;
+}
+
+const AssetPackEntry& AssetPack::GetEntry(uint32_t index) const
+{
+	return entries[index];
+}
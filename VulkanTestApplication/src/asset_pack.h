@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+#include "asset_pack_format.h"
+
+// Read only view of an asset pack. The file is memory mapped once and assets are returned as
+// pointers into the mapping, valid until Close.
+class AssetPack
+{
+public:
+	AssetPack();
+	~AssetPack();
+
+	bool Open(const char* path);
+	void Close();
+	bool IsOpen() const;
+
+	// Looks up an asset by name, returns false if it is missing or has a different type
+	bool Find(const char* name, AssetType type, const void** data, size_t* dataSize) const;
+
+	uint32_t GetEntryCount() const;
+	const AssetPackEntry& GetEntry(uint32_t index) const;
+
+private:
+	AssetPack(const AssetPack&);
+	AssetPack& operator=(const AssetPack&);
+
+	bool Validate() const;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+
+	const unsigned char* mappedData;
+	size_t mappedSize;
+	const AssetPackEntry* entries;
+	uint32_t entryCount;
+};
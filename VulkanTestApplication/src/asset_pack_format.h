@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+// On disk layout of an asset pack, shared by the runtime and the AssetPacker tool.
+//
+// AssetPackHeader
+// AssetPackEntry[entryCount], sorted by name
+// Blobs, each starting on an AssetPackAlignment boundary
+//
+// All values are little endian. Blobs are stored in the form the runtime consumes them so
+// they can be used straight from the mapped file.
+
+const uint32_t AssetPackMagic = 0x4b504b56; // "VKPK"
+const uint32_t AssetPackVersion = 3;
+const uint32_t AssetPackAlignment = 16;
+const uint32_t AssetPackMaxNameLength = 48;
+
+enum AssetType
+{
+	AssetType_Raw = 0,
+	// 1 held SPIR-V, shaders are compiled into the application now
+	AssetType_Texture = 2,	// KTX2 or DDS container
+	AssetType_Mesh = 3,		// AssetPackMeshHeader followed by vertex and index data
+};
+
+struct AssetPackHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t reserved;
+	uint64_t fileSize;
+};
+
+struct AssetPackEntry
+{
+	char name[AssetPackMaxNameLength];	// Zero padded, not terminated when all 48 characters are used
+	uint32_t type;
+	uint32_t reserved;
+	uint64_t offset;
+	uint64_t size;
+};
+
+// Vertex data follows the header, index data starts at the next AssetPackAlignment boundary after it
+struct AssetPackMeshHeader
+{
+	uint32_t vertexCount;
+	uint32_t vertexStride;
+	uint32_t indexCount;
+	uint32_t indexSize;		// 2 or 4 bytes
+	uint32_t positionFormat;	// VertexPositionFormat
+	uint32_t attributeFormat;	// VertexAttributeFormat
+	float positionScale[3];
+	float positionOffset[3];
+};
+
+inline uint64_t GetMeshIndexDataOffset(const AssetPackMeshHeader& header)
+{
+	uint64_t vertexEnd = sizeof(AssetPackMeshHeader) + (uint64_t)header.vertexCount * header.vertexStride;
+	return (vertexEnd + AssetPackAlignment - 1) & ~(uint64_t)(AssetPackAlignment - 1);
+}
+
+inline uint64_t GetMeshDataSize(const AssetPackMeshHeader& header)
+{
+	return GetMeshIndexDataOffset(header) + (uint64_t)header.indexCount * header.indexSize;
+}
+
+static_assert(sizeof(AssetPackHeader) == 24, "AssetPackHeader layout changed");
+static_assert(sizeof(AssetPackEntry) == 72, "AssetPackEntry layout changed");
+static_assert(sizeof(AssetPackMeshHeader) == 48, "AssetPackMeshHeader layout changed");
@@ -0,0 +1,216 @@
+#include "deletion_queue.h"
+
+#include <cstdint>
+
+DeletionQueue::DeletionQueue()
+	: device(VK_NULL_HANDLE)
+{
+}
+
+DeletionQueue::~DeletionQueue()
+{
+}
+
+void DeletionQueue::Create(VkDevice device)
+{
+	this->device = device;
+}
+
+void DeletionQueue::Destroy()
+{
+	Flush();
+	device = VK_NULL_HANDLE;
+}
+
+void DeletionQueue::RetireBuffer(VkBuffer buffer, uint64_t frameIndex)
+{
+	Retire(ObjectType_Buffer, (uint64_t)buffer, VK_NULL_HANDLE, frameIndex);
+}
+
+void DeletionQueue::RetireImage(VkImage image, uint64_t frameIndex)
+{
+	Retire(ObjectType_Image, (uint64_t)image, VK_NULL_HANDLE, frameIndex);
+}
+
+void DeletionQueue::RetireImageView(VkImageView imageView, uint64_t frameIndex)
+{
+	Retire(ObjectType_ImageView, (uint64_t)imageView, VK_NULL_HANDLE, frameIndex);
+}
+
+void DeletionQueue::RetireSampler(VkSampler sampler, uint64_t frameIndex)
+{
+	Retire(ObjectType_Sampler, (uint64_t)sampler, VK_NULL_HANDLE, frameIndex);
+}
+
+void DeletionQueue::RetireMemory(VkDeviceMemory memory, uint64_t frameIndex)
+{
+	Retire(ObjectType_Memory, (uint64_t)memory, VK_NULL_HANDLE, frameIndex);
+}
+
+void DeletionQueue::RetireFramebuffer(VkFramebuffer framebuffer, uint64_t frameIndex)
+{
+	Retire(ObjectType_Framebuffer, (uint64_t)framebuffer, VK_NULL_HANDLE, frameIndex);
+}
+
+void DeletionQueue::RetireRenderPass(VkRenderPass renderPass, uint64_t frameIndex)
+{
+	Retire(ObjectType_RenderPass, (uint64_t)renderPass, VK_NULL_HANDLE, frameIndex);
+}
+
+void DeletionQueue::RetirePipeline(VkPipeline pipeline, uint64_t frameIndex)
+{
+	Retire(ObjectType_Pipeline, (uint64_t)pipeline, VK_NULL_HANDLE, frameIndex);
+}
+
+void DeletionQueue::RetirePipelineLayout(VkPipelineLayout pipelineLayout, uint64_t frameIndex)
+{
+	Retire(ObjectType_PipelineLayout, (uint64_t)pipelineLayout, VK_NULL_HANDLE, frameIndex);
+}
+
+void DeletionQueue::RetirePipelineCache(VkPipelineCache pipelineCache, uint64_t frameIndex)
+{
+	Retire(ObjectType_PipelineCache, (uint64_t)pipelineCache, VK_NULL_HANDLE, frameIndex);
+}
+
+void DeletionQueue::RetireShaderModule(VkShaderModule shaderModule, uint64_t frameIndex)
+{
+	Retire(ObjectType_ShaderModule, (uint64_t)shaderModule, VK_NULL_HANDLE, frameIndex);
+}
+
+void DeletionQueue::RetireDescriptorSetLayout(VkDescriptorSetLayout descriptorSetLayout, uint64_t frameIndex)
+{
+	Retire(ObjectType_DescriptorSetLayout, (uint64_t)descriptorSetLayout, VK_NULL_HANDLE, frameIndex);
+}
+
+void DeletionQueue::RetireDescriptorPool(VkDescriptorPool descriptorPool, uint64_t frameIndex)
+{
+	Retire(ObjectType_DescriptorPool, (uint64_t)descriptorPool, VK_NULL_HANDLE, frameIndex);
+}
+
+void DeletionQueue::RetireCommandBuffer(VkCommandPool commandPool, VkCommandBuffer commandBuffer, uint64_t frameIndex)
+{
+	Retire(ObjectType_CommandBuffer, (uint64_t)(uintptr_t)commandBuffer, commandPool, frameIndex);
+}
+
+void DeletionQueue::RetireCommandPool(VkCommandPool commandPool, uint64_t frameIndex)
+{
+	Retire(ObjectType_CommandPool, (uint64_t)commandPool, VK_NULL_HANDLE, frameIndex);
+}
+
+void DeletionQueue::RetireSemaphore(VkSemaphore semaphore, uint64_t frameIndex)
+{
+	Retire(ObjectType_Semaphore, (uint64_t)semaphore, VK_NULL_HANDLE, frameIndex);
+}
+
+void DeletionQueue::RetireFence(VkFence fence, uint64_t frameIndex)
+{
+	Retire(ObjectType_Fence, (uint64_t)fence, VK_NULL_HANDLE, frameIndex);
+}
+
+void DeletionQueue::RetireSwapchain(VkSwapchainKHR swapchain, uint64_t frameIndex)
+{
+	Retire(ObjectType_Swapchain, (uint64_t)swapchain, VK_NULL_HANDLE, frameIndex);
+}
+
+void DeletionQueue::Collect(uint64_t completedFrameIndex)
+{
+	while (retired.empty() == false && retired.front().frameIndex <= completedFrameIndex)
+	{
+		DestroyObject(retired.front());
+		retired.pop_front();
+	}
+}
+
+void DeletionQueue::Flush()
+{
+	Collect(UINT64_MAX);
+}
+
+size_t DeletionQueue::GetPendingCount() const
+{
+	return retired.size();
+}
+
+void DeletionQueue::Retire(ObjectType type, uint64_t handle, VkCommandPool commandPool, uint64_t frameIndex)
+{
+	if (handle == 0)
+	{
+		return;
+	}
+
+	if (retired.empty() == false && frameIndex < retired.back().frameIndex)
+	{
+		frameIndex = retired.back().frameIndex;
+	}
+
+	RetiredObject object;
+	object.type = type;
+	object.handle = handle;
+	object.commandPool = commandPool;
+	object.frameIndex = frameIndex;
+	retired.push_back(object);
+}
+
+void DeletionQueue::DestroyObject(const RetiredObject& object)
+{
+	switch (object.type)
+	{
+	case ObjectType_Buffer:
+		vkDestroyBuffer(device, (VkBuffer)object.handle, NULL);
+		break;
+	case ObjectType_Image:
+		vkDestroyImage(device, (VkImage)object.handle, NULL);
+		break;
+	case ObjectType_ImageView:
+		vkDestroyImageView(device, (VkImageView)object.handle, NULL);
+		break;
+	case ObjectType_Sampler:
+		vkDestroySampler(device, (VkSampler)object.handle, NULL);
+		break;
+	case ObjectType_Memory:
+		vkFreeMemory(device, (VkDeviceMemory)object.handle, NULL);
+		break;
+	case ObjectType_Framebuffer:
+		vkDestroyFramebuffer(device, (VkFramebuffer)object.handle, NULL);
+		break;
+	case ObjectType_RenderPass:
+		vkDestroyRenderPass(device, (VkRenderPass)object.handle, NULL);
+		break;
+	case ObjectType_Pipeline:
+		vkDestroyPipeline(device, (VkPipeline)object.handle, NULL);
+		break;
+	case ObjectType_PipelineLayout:
+		vkDestroyPipelineLayout(device, (VkPipelineLayout)object.handle, NULL);
+		break;
+	case ObjectType_PipelineCache:
+		vkDestroyPipelineCache(device, (VkPipelineCache)object.handle, NULL);
+		break;
+	case ObjectType_ShaderModule:
+		vkDestroyShaderModule(device, (VkShaderModule)object.handle, NULL);
+		break;
+	case ObjectType_DescriptorSetLayout:
+		vkDestroyDescriptorSetLayout(device, (VkDescriptorSetLayout)object.handle, NULL);
+		break;
+	case ObjectType_DescriptorPool:
+		vkDestroyDescriptorPool(device, (VkDescriptorPool)object.handle, NULL);
+		break;
+	case ObjectType_CommandBuffer:
+	{
+		VkCommandBuffer commandBuffer = (VkCommandBuffer)(uintptr_t)object.handle;
+		vkFreeCommandBuffers(device, object.commandPool, 1, &commandBuffer);
+		break;
+	}
+	case ObjectType_CommandPool:
+		vkDestroyCommandPool(device, (VkCommandPool)object.handle, NULL);
+		break;
+	case ObjectType_Semaphore:
+		vkDestroySemaphore(device, (VkSemaphore)object.handle, NULL);
+		break;
+	case ObjectType_Fence:
+		vkDestroyFence(device, (VkFence)object.handle, NULL);
+		break;
+	case ObjectType_Swapchain:
+		vkDestroySwapchainKHR(device, (VkSwapchainKHR)object.handle, NULL);
+		break;
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+#include "vulkan_helpers.h"
+
+// Defers destroying Vulkan objects until the GPU can no longer be using them.
+//
+// Objects are retired with the index of the last frame that may reference them and destroyed by
+// Collect once that frame's fence has signalled, so resources can be released at runtime without
+// waiting for the queue to go idle. Objects retired for the same frame are destroyed in the order
+// they were retired, which lets shutdown retire everything in dependency order and Flush once the
+// device is idle.
+class DeletionQueue
+{
+public:
+	DeletionQueue();
+	~DeletionQueue();
+
+	void Create(VkDevice device);
+
+	// Flushes the queue, the device must be idle
+	void Destroy();
+
+	void RetireBuffer(VkBuffer buffer, uint64_t frameIndex);
+	void RetireImage(VkImage image, uint64_t frameIndex);
+	void RetireImageView(VkImageView imageView, uint64_t frameIndex);
+	void RetireSampler(VkSampler sampler, uint64_t frameIndex);
+	void RetireMemory(VkDeviceMemory memory, uint64_t frameIndex);
+	void RetireFramebuffer(VkFramebuffer framebuffer, uint64_t frameIndex);
+	void RetireRenderPass(VkRenderPass renderPass, uint64_t frameIndex);
+	void RetirePipeline(VkPipeline pipeline, uint64_t frameIndex);
+	void RetirePipelineLayout(VkPipelineLayout pipelineLayout, uint64_t frameIndex);
+	void RetirePipelineCache(VkPipelineCache pipelineCache, uint64_t frameIndex);
+	void RetireShaderModule(VkShaderModule shaderModule, uint64_t frameIndex);
+	void RetireDescriptorSetLayout(VkDescriptorSetLayout descriptorSetLayout, uint64_t frameIndex);
+	void RetireDescriptorPool(VkDescriptorPool descriptorPool, uint64_t frameIndex);
+	void RetireCommandBuffer(VkCommandPool commandPool, VkCommandBuffer commandBuffer, uint64_t frameIndex);
+	void RetireCommandPool(VkCommandPool commandPool, uint64_t frameIndex);
+	void RetireSemaphore(VkSemaphore semaphore, uint64_t frameIndex);
+	void RetireFence(VkFence fence, uint64_t frameIndex);
+	void RetireSwapchain(VkSwapchainKHR swapchain, uint64_t frameIndex);
+
+	// Destroys objects retired for frames up to and including completedFrameIndex
+	void Collect(uint64_t completedFrameIndex);
+
+	// Destroys everything queued, the device must be idle
+	void Flush();
+
+	size_t GetPendingCount() const;
+
+private:
+	enum ObjectType
+	{
+		ObjectType_Buffer,
+		ObjectType_Image,
+		ObjectType_ImageView,
+		ObjectType_Sampler,
+		ObjectType_Memory,
+		ObjectType_Framebuffer,
+		ObjectType_RenderPass,
+		ObjectType_Pipeline,
+		ObjectType_PipelineLayout,
+		ObjectType_PipelineCache,
+		ObjectType_ShaderModule,
+		ObjectType_DescriptorSetLayout,
+		ObjectType_DescriptorPool,
+		ObjectType_CommandBuffer,
+		ObjectType_CommandPool,
+		ObjectType_Semaphore,
+		ObjectType_Fence,
+		ObjectType_Swapchain,
+	};
+
+	// Non-dispatchable handles are 64 bit integers on 32 bit platforms and pointers elsewhere,
+	// so they are stored widened and cast back when destroyed
+	struct RetiredObject
+	{
+		ObjectType type;
+		uint64_t handle;
+		VkCommandPool commandPool;	// Owner of a retired command buffer
+		uint64_t frameIndex;
+	};
+
+	void Retire(ObjectType type, uint64_t handle, VkCommandPool commandPool, uint64_t frameIndex);
+	void DestroyObject(const RetiredObject& object);
+
+	VkDevice device;
+
+	// Kept in retirement order. Retire never lets a frame index go below the previous one, so
+	// Collect can stop at the first object whose frame hasn't completed.
+	std::deque<RetiredObject> retired;
+};
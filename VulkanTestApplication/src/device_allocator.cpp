@@ -0,0 +1,805 @@
+#include "device_allocator.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "logger.h"
+
+const float DeviceAllocator::DefragmentOccupancy = 0.5f;
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+DeviceAllocator::DeviceAllocator()
+	: device(VK_NULL_HANDLE)
+	, bufferImageGranularity(1)
+	, blockSize(DefaultBlockSize)
+	, budget(NULL)
+	, currentFrame(0)
+	, movedBytes(0)
+{
+	memset(&memoryProperties, 0, sizeof(memoryProperties));
+}
+
+DeviceAllocator::~DeviceAllocator()
+{
+	Destroy();
+}
+
+bool DeviceAllocator::Create(VkDevice device, VkPhysicalDevice physicalDevice, MemoryBudget* budget, VkDeviceSize blockSize)
+{
+	this->device = device;
+	this->budget = budget;
+	this->blockSize = blockSize;
+
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	// Linear and optimal resources sharing a block must not share a granularity page, aligning
+	// everything to it is simpler than tracking neighbours and the waste is small
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	bufferImageGranularity = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+
+	return true;
+}
+
+void DeviceAllocator::Destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < resources.size(); ++i)
+	{
+		if (resources[i].live)
+		{
+			vkDestroyBuffer(device, resources[i].buffer, NULL);
+			vkDestroyImage(device, resources[i].image, NULL);
+		}
+	}
+
+	for (size_t i = 0; i < pendingMoves.size(); ++i)
+	{
+		vkDestroyBuffer(device, pendingMoves[i].buffer, NULL);
+		vkDestroyImage(device, pendingMoves[i].image, NULL);
+	}
+
+	for (size_t i = 0; i < retiredResources.size(); ++i)
+	{
+		vkDestroyBuffer(device, retiredResources[i].buffer, NULL);
+		vkDestroyImage(device, retiredResources[i].image, NULL);
+	}
+
+	for (uint32_t i = 0; i < blocks.size(); ++i)
+	{
+		ReleaseBlock(i);
+	}
+
+	blocks.clear();
+	resources.clear();
+	freeResources.clear();
+	pendingMoves.clear();
+	retiredResources.clear();
+	device = VK_NULL_HANDLE;
+}
+
+bool DeviceAllocator::CreateBlock(uint32_t memoryType, VkDeviceSize size, bool dedicated, uint32_t* blockIndex)
+{
+	if (budget != NULL && budget->WouldExceedBudget(memoryType, size))
+	{
+		Log(LogSeverity_Warning, "Allocating a %llu MB block past the budget of memory type %u", (unsigned long long)(size >> 20), memoryType);
+	}
+
+	VkMemoryAllocateInfo allocateInfo;
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.pNext = NULL;
+	allocateInfo.allocationSize = size;
+	allocateInfo.memoryTypeIndex = memoryType;
+
+	MemoryBlock block;
+
+	if (vkAllocateMemory(device, &allocateInfo, NULL, &block.memory) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	block.memoryType = memoryType;
+	block.size = size;
+	block.used = 0;
+	block.allocationCount = 0;
+	block.mapped = NULL;
+	block.dedicated = dedicated;
+	block.evacuating = false;
+
+	FreeRange range = { 0, size };
+	block.freeRanges.push_back(range);
+
+	if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		if (vkMapMemory(device, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mapped) != VK_SUCCESS)
+		{
+			vkFreeMemory(device, block.memory, NULL);
+			return false;
+		}
+	}
+
+	if (budget != NULL)
+	{
+		budget->Allocated(memoryType, size);
+	}
+
+	// Reuse the slot of a released block so allocation block indices stay small
+	for (uint32_t i = 0; i < blocks.size(); ++i)
+	{
+		if (blocks[i].memory == VK_NULL_HANDLE)
+		{
+			blocks[i] = block;
+			*blockIndex = i;
+			return true;
+		}
+	}
+
+	*blockIndex = (uint32_t)blocks.size();
+	blocks.push_back(block);
+	return true;
+}
+
+void DeviceAllocator::ReleaseBlock(uint32_t blockIndex)
+{
+	MemoryBlock& block = blocks[blockIndex];
+
+	if (block.memory == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkFreeMemory(device, block.memory, NULL);
+
+	if (budget != NULL)
+	{
+		budget->Freed(block.memoryType, block.size);
+	}
+
+	block.memory = VK_NULL_HANDLE;
+	block.size = 0;
+	block.used = 0;
+	block.mapped = NULL;
+	block.freeRanges.clear();
+}
+
+bool DeviceAllocator::AllocateFromBlock(uint32_t blockIndex, VkDeviceSize size, VkDeviceSize alignment, Allocation* allocation)
+{
+	MemoryBlock& block = blocks[blockIndex];
+
+	// First fit, the padding in front of an aligned allocation stays a free range of its own
+	for (size_t i = 0; i < block.freeRanges.size(); ++i)
+	{
+		FreeRange range = block.freeRanges[i];
+		VkDeviceSize offset = AlignUp(range.offset, alignment);
+
+		if (offset + size > range.offset + range.size)
+		{
+			continue;
+		}
+
+		block.freeRanges.erase(block.freeRanges.begin() + i);
+
+		if (offset + size < range.offset + range.size)
+		{
+			FreeRange after = { offset + size, range.offset + range.size - (offset + size) };
+			block.freeRanges.insert(block.freeRanges.begin() + i, after);
+		}
+
+		if (offset > range.offset)
+		{
+			FreeRange before = { range.offset, offset - range.offset };
+			block.freeRanges.insert(block.freeRanges.begin() + i, before);
+		}
+
+		block.used += size;
+		++block.allocationCount;
+
+		allocation->block = blockIndex;
+		allocation->offset = offset;
+		allocation->size = size;
+		return true;
+	}
+
+	return false;
+}
+
+bool DeviceAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool allowNewBlock, uint32_t excludeBlock, Allocation* allocation)
+{
+	uint32_t memoryType;
+
+	if (memory_type_from_properties(memoryProperties.memoryTypes, requirements.memoryTypeBits, properties, &memoryType) == false)
+	{
+		return false;
+	}
+
+	VkDeviceSize alignment = std::max(requirements.alignment, bufferImageGranularity);
+	VkDeviceSize size = AlignUp(requirements.size, bufferImageGranularity);
+
+	// Large resources get a block to themselves rather than wasting most of a shared one
+	if (size > blockSize / 2)
+	{
+		uint32_t blockIndex;
+
+		if (allowNewBlock == false || CreateBlock(memoryType, size, true, &blockIndex) == false)
+		{
+			return false;
+		}
+
+		return AllocateFromBlock(blockIndex, size, alignment, allocation);
+	}
+
+	for (uint32_t i = 0; i < blocks.size(); ++i)
+	{
+		const MemoryBlock& block = blocks[i];
+
+		if (block.memory == VK_NULL_HANDLE || block.memoryType != memoryType || block.dedicated || block.evacuating || i == excludeBlock)
+		{
+			continue;
+		}
+
+		if (AllocateFromBlock(i, size, alignment, allocation))
+		{
+			return true;
+		}
+	}
+
+	uint32_t blockIndex;
+
+	if (allowNewBlock == false || CreateBlock(memoryType, blockSize, false, &blockIndex) == false)
+	{
+		return false;
+	}
+
+	return AllocateFromBlock(blockIndex, size, alignment, allocation);
+}
+
+void DeviceAllocator::Free(const Allocation& allocation)
+{
+	MemoryBlock& block = blocks[allocation.block];
+	FreeRange range = { allocation.offset, allocation.size };
+
+	std::vector<FreeRange>::iterator next = block.freeRanges.begin();
+
+	while (next != block.freeRanges.end() && next->offset < range.offset)
+	{
+		++next;
+	}
+
+	next = block.freeRanges.insert(next, range);
+
+	// Merge with the following and preceding ranges
+	if (next + 1 != block.freeRanges.end() && next->offset + next->size == (next + 1)->offset)
+	{
+		next->size += (next + 1)->size;
+		block.freeRanges.erase(next + 1);
+	}
+
+	if (next != block.freeRanges.begin() && (next - 1)->offset + (next - 1)->size == next->offset)
+	{
+		(next - 1)->size += next->size;
+		block.freeRanges.erase(next);
+	}
+
+	block.used -= allocation.size;
+	--block.allocationCount;
+
+	if (block.allocationCount == 0 && (block.dedicated || block.evacuating))
+	{
+		ReleaseBlock(allocation.block);
+	}
+}
+
+bool DeviceAllocator::CreateBufferAt(const VkBufferCreateInfo& createInfo, VkMemoryPropertyFlags properties, bool allowNewBlock, uint32_t excludeBlock, VkBuffer* buffer, Allocation* allocation)
+{
+	if (vkCreateBuffer(device, &createInfo, NULL, buffer) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(device, *buffer, &requirements);
+
+	if (Allocate(requirements, properties, allowNewBlock, excludeBlock, allocation) == false)
+	{
+		vkDestroyBuffer(device, *buffer, NULL);
+		return false;
+	}
+
+	if (vkBindBufferMemory(device, *buffer, blocks[allocation->block].memory, allocation->offset) != VK_SUCCESS)
+	{
+		Free(*allocation);
+		vkDestroyBuffer(device, *buffer, NULL);
+		return false;
+	}
+
+	return true;
+}
+
+bool DeviceAllocator::CreateImageAt(const VkImageCreateInfo& createInfo, VkMemoryPropertyFlags properties, bool allowNewBlock, uint32_t excludeBlock, VkImage* image, Allocation* allocation)
+{
+	if (vkCreateImage(device, &createInfo, NULL, image) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(device, *image, &requirements);
+
+	if (Allocate(requirements, properties, allowNewBlock, excludeBlock, allocation) == false)
+	{
+		vkDestroyImage(device, *image, NULL);
+		return false;
+	}
+
+	if (vkBindImageMemory(device, *image, blocks[allocation->block].memory, allocation->offset) != VK_SUCCESS)
+	{
+		Free(*allocation);
+		vkDestroyImage(device, *image, NULL);
+		return false;
+	}
+
+	return true;
+}
+
+ManagedResource DeviceAllocator::AddRecord(const ResourceRecord& record)
+{
+	if (freeResources.empty() == false)
+	{
+		ManagedResource resource = freeResources.back();
+		freeResources.pop_back();
+		resources[resource] = record;
+		return resource;
+	}
+
+	resources.push_back(record);
+	return (ManagedResource)(resources.size() - 1);
+}
+
+// Moves recreate the resource, so concurrent sharing needs its queue families to outlive the caller's array
+bool DeviceAllocator::KeepQueueFamilies(VkSharingMode sharingMode, uint32_t queueFamilyIndexCount, const uint32_t* queueFamilyIndices, ResourceRecord* record)
+{
+	if (sharingMode != VK_SHARING_MODE_CONCURRENT)
+	{
+		return true;
+	}
+
+	if (queueFamilyIndexCount > MaxSharedQueueFamilies)
+	{
+		Log(LogSeverity_Error, "Concurrent sharing across %u queue families, the allocator supports up to %u", queueFamilyIndexCount, MaxSharedQueueFamilies);
+		return false;
+	}
+
+	memcpy(record->queueFamilyIndices, queueFamilyIndices, sizeof(uint32_t) * queueFamilyIndexCount);
+	return true;
+}
+
+bool DeviceAllocator::CreateBuffer(const VkBufferCreateInfo& createInfo, VkMemoryPropertyFlags properties, ManagedResource* resource)
+{
+	ResourceRecord record;
+	memset(&record, 0, sizeof(record));
+	record.live = true;
+	record.isImage = false;
+	record.bufferCreateInfo = createInfo;
+	record.bufferCreateInfo.pNext = NULL;
+	record.properties = properties;
+
+	if ((properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0)
+	{
+		record.bufferCreateInfo.usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	}
+
+	if (KeepQueueFamilies(createInfo.sharingMode, createInfo.queueFamilyIndexCount, createInfo.pQueueFamilyIndices, &record) == false)
+	{
+		return false;
+	}
+
+	record.bufferCreateInfo.queueFamilyIndexCount = createInfo.sharingMode == VK_SHARING_MODE_CONCURRENT ? createInfo.queueFamilyIndexCount : 0;
+
+	if (CreateBufferAt(record.bufferCreateInfo, properties, true, UINT32_MAX, &record.buffer, &record.allocation) == false)
+	{
+		return false;
+	}
+
+	// Moves point it back at the record's copy, the record itself moves when resources grows
+	record.bufferCreateInfo.pQueueFamilyIndices = NULL;
+
+	*resource = AddRecord(record);
+	return true;
+}
+
+bool DeviceAllocator::CreateImage(const VkImageCreateInfo& createInfo, VkMemoryPropertyFlags properties, ManagedResource* resource)
+{
+	ResourceRecord record;
+	memset(&record, 0, sizeof(record));
+	record.live = true;
+	record.isImage = true;
+	record.imageCreateInfo = createInfo;
+	record.imageCreateInfo.pNext = NULL;
+	record.properties = properties;
+
+	if ((properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0)
+	{
+		record.imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	}
+
+	if (KeepQueueFamilies(createInfo.sharingMode, createInfo.queueFamilyIndexCount, createInfo.pQueueFamilyIndices, &record) == false)
+	{
+		return false;
+	}
+
+	record.imageCreateInfo.queueFamilyIndexCount = createInfo.sharingMode == VK_SHARING_MODE_CONCURRENT ? createInfo.queueFamilyIndexCount : 0;
+
+	if (CreateImageAt(record.imageCreateInfo, properties, true, UINT32_MAX, &record.image, &record.allocation) == false)
+	{
+		return false;
+	}
+
+	record.imageCreateInfo.pQueueFamilyIndices = NULL;
+	record.imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	*resource = AddRecord(record);
+	return true;
+}
+
+bool DeviceAllocator::CreateBufferWithData(VkQueue queue, VkCommandPool commandPool, VkBufferUsageFlags usage, const void* data, VkDeviceSize size, ManagedResource* resource)
+{
+	VkBufferCreateInfo createInfo;
+	createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	createInfo.pNext = NULL;
+	createInfo.flags = 0;
+	createInfo.size = size;
+	createInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	createInfo.queueFamilyIndexCount = 0;
+	createInfo.pQueueFamilyIndices = NULL;
+
+	if (CreateBuffer(createInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, resource) == false)
+	{
+		return false;
+	}
+
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingMemory;
+
+	if (::CreateBuffer(device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, memoryProperties.memoryTypes, data, (size_t)size, &stagingBuffer, &stagingMemory) == false)
+	{
+		DestroyResource(*resource, 0);
+		return false;
+	}
+
+	VkCommandBuffer commandBuffer;
+	bool uploaded = BeginOneTimeCommands(device, commandPool, &commandBuffer);
+
+	if (uploaded)
+	{
+		VkBufferCopy copy;
+		copy.srcOffset = 0;
+		copy.dstOffset = 0;
+		copy.size = size;
+		vkCmdCopyBuffer(commandBuffer, stagingBuffer, GetBuffer(*resource), 1, &copy);
+
+		uploaded = EndOneTimeCommands(device, queue, commandPool, commandBuffer);
+	}
+
+	vkDestroyBuffer(device, stagingBuffer, NULL);
+	vkFreeMemory(device, stagingMemory, NULL);
+
+	if (uploaded == false)
+	{
+		DestroyResource(*resource, 0);
+	}
+
+	return uploaded;
+}
+
+void DeviceAllocator::DestroyResource(ManagedResource resource, uint64_t frameIndex)
+{
+	ResourceRecord& record = resources[resource];
+
+	RetiredResource retired = { record.buffer, record.image, record.allocation, frameIndex };
+	retiredResources.push_back(retired);
+
+	// A move still in flight has its destination retired along with it
+	for (size_t i = 0; i < pendingMoves.size(); ++i)
+	{
+		if (pendingMoves[i].resource == resource)
+		{
+			RetiredResource destination = { pendingMoves[i].buffer, pendingMoves[i].image, pendingMoves[i].allocation, frameIndex };
+			retiredResources.push_back(destination);
+			pendingMoves.erase(pendingMoves.begin() + i);
+			break;
+		}
+	}
+
+	record.live = false;
+	record.buffer = VK_NULL_HANDLE;
+	record.image = VK_NULL_HANDLE;
+	freeResources.push_back(resource);
+}
+
+VkBuffer DeviceAllocator::GetBuffer(ManagedResource resource) const
+{
+	return resources[resource].buffer;
+}
+
+VkImage DeviceAllocator::GetImage(ManagedResource resource) const
+{
+	return resources[resource].image;
+}
+
+void* DeviceAllocator::GetMappedData(ManagedResource resource) const
+{
+	const Allocation& allocation = resources[resource].allocation;
+	const MemoryBlock& block = blocks[allocation.block];
+
+	if (block.mapped == NULL)
+	{
+		return NULL;
+	}
+
+	return (char*)block.mapped + allocation.offset;
+}
+
+void DeviceAllocator::BeginFrame(uint64_t frameIndex, uint64_t completedFrameIndex, std::vector<ManagedResource>* relocated)
+{
+	currentFrame = frameIndex;
+
+	// Frames recorded since the move was submitted may still reference the old handle
+	uint64_t lastUseOfOldHandle = frameIndex > 0 ? frameIndex - 1 : 0;
+
+	for (size_t i = 0; i < pendingMoves.size();)
+	{
+		PendingMove& move = pendingMoves[i];
+
+		if (move.frameIndex > completedFrameIndex)
+		{
+			++i;
+			continue;
+		}
+
+		ResourceRecord& record = resources[move.resource];
+		RetiredResource retired = { record.buffer, record.image, record.allocation, lastUseOfOldHandle };
+		retiredResources.push_back(retired);
+
+		record.buffer = move.buffer;
+		record.image = move.image;
+		record.allocation = move.allocation;
+		record.moving = false;
+		relocated->push_back(move.resource);
+
+		pendingMoves.erase(pendingMoves.begin() + i);
+	}
+
+	for (size_t i = 0; i < retiredResources.size();)
+	{
+		RetiredResource& retired = retiredResources[i];
+
+		if (retired.frameIndex > completedFrameIndex)
+		{
+			++i;
+			continue;
+		}
+
+		vkDestroyBuffer(device, retired.buffer, NULL);
+		vkDestroyImage(device, retired.image, NULL);
+		Free(retired.allocation);
+
+		retiredResources.erase(retiredResources.begin() + i);
+	}
+}
+
+void DeviceAllocator::RecordCopy(VkCommandBuffer commandBuffer, const ResourceRecord& record, VkBuffer buffer, VkImage image)
+{
+	if (record.isImage == false)
+	{
+		VkBufferCopy copy;
+		copy.srcOffset = 0;
+		copy.dstOffset = 0;
+		copy.size = record.bufferCreateInfo.size;
+		vkCmdCopyBuffer(commandBuffer, record.buffer, buffer, 1, &copy);
+
+		VkBufferMemoryBarrier barrier;
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.pNext = NULL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, NULL, 1, &barrier, 0, NULL);
+		return;
+	}
+
+	const VkImageCreateInfo& createInfo = record.imageCreateInfo;
+
+	VkImageMemoryBarrier barriers[2];
+
+	for (int i = 0; i < 2; ++i)
+	{
+		barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barriers[i].pNext = NULL;
+		barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[i].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barriers[i].subresourceRange.baseMipLevel = 0;
+		barriers[i].subresourceRange.levelCount = createInfo.mipLevels;
+		barriers[i].subresourceRange.baseArrayLayer = 0;
+		barriers[i].subresourceRange.layerCount = createInfo.arrayLayers;
+	}
+
+	barriers[0].image = record.image;
+	barriers[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+	barriers[1].image = image;
+	barriers[1].srcAccessMask = 0;
+	barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 2, barriers);
+
+	std::vector<VkImageCopy> copies(createInfo.mipLevels);
+
+	for (uint32_t level = 0; level < createInfo.mipLevels; ++level)
+	{
+		VkImageCopy& copy = copies[level];
+		copy.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copy.srcSubresource.mipLevel = level;
+		copy.srcSubresource.baseArrayLayer = 0;
+		copy.srcSubresource.layerCount = createInfo.arrayLayers;
+		copy.dstSubresource = copy.srcSubresource;
+		copy.srcOffset.x = 0;
+		copy.srcOffset.y = 0;
+		copy.srcOffset.z = 0;
+		copy.dstOffset = copy.srcOffset;
+		copy.extent.width = std::max(createInfo.extent.width >> level, 1u);
+		copy.extent.height = std::max(createInfo.extent.height >> level, 1u);
+		copy.extent.depth = std::max(createInfo.extent.depth >> level, 1u);
+	}
+
+	vkCmdCopyImage(commandBuffer, record.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)copies.size(), copies.data());
+
+	barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, NULL, 0, NULL, 2, barriers);
+}
+
+VkDeviceSize DeviceAllocator::Defragment(VkCommandBuffer commandBuffer, VkDeviceSize maxBytes)
+{
+	// Carry on with a block already being emptied, otherwise pick the emptiest device local
+	// block that has somewhere else of its type to go
+	uint32_t source = UINT32_MAX;
+
+	for (uint32_t i = 0; i < blocks.size(); ++i)
+	{
+		if (blocks[i].memory != VK_NULL_HANDLE && blocks[i].evacuating)
+		{
+			source = i;
+			break;
+		}
+	}
+
+	if (source == UINT32_MAX)
+	{
+		for (uint32_t i = 0; i < blocks.size(); ++i)
+		{
+			const MemoryBlock& block = blocks[i];
+
+			if (block.memory == VK_NULL_HANDLE || block.dedicated || block.allocationCount == 0
+				|| (memoryProperties.memoryTypes[block.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+				|| (float)block.used >= (float)block.size * DefragmentOccupancy)
+			{
+				continue;
+			}
+
+			bool hasDestination = false;
+
+			for (uint32_t j = 0; j < blocks.size() && hasDestination == false; ++j)
+			{
+				hasDestination = j != i && blocks[j].memory != VK_NULL_HANDLE && blocks[j].dedicated == false && blocks[j].memoryType == block.memoryType
+					&& blocks[j].size - blocks[j].used >= block.used;
+			}
+
+			if (hasDestination && (source == UINT32_MAX || block.used < blocks[source].used))
+			{
+				source = i;
+			}
+		}
+
+		if (source == UINT32_MAX)
+		{
+			return 0;
+		}
+
+		blocks[source].evacuating = true;
+	}
+
+	VkDeviceSize moved = 0;
+
+	for (ManagedResource resource = 0; resource < resources.size(); ++resource)
+	{
+		ResourceRecord& record = resources[resource];
+
+		if (record.live == false || record.moving || record.allocation.block != source)
+		{
+			continue;
+		}
+
+		if (moved > 0 && moved + record.allocation.size > maxBytes)
+		{
+			break;
+		}
+
+		PendingMove move;
+		move.resource = resource;
+		move.buffer = VK_NULL_HANDLE;
+		move.image = VK_NULL_HANDLE;
+		move.frameIndex = currentFrame;
+
+		VkBufferCreateInfo bufferCreateInfo = record.bufferCreateInfo;
+		bufferCreateInfo.pQueueFamilyIndices = record.queueFamilyIndices;
+		VkImageCreateInfo imageCreateInfo = record.imageCreateInfo;
+		imageCreateInfo.pQueueFamilyIndices = record.queueFamilyIndices;
+
+		bool created = record.isImage
+			? CreateImageAt(imageCreateInfo, record.properties, false, source, &move.image, &move.allocation)
+			: CreateBufferAt(bufferCreateInfo, record.properties, false, source, &move.buffer, &move.allocation);
+
+		if (created == false)
+		{
+			// The rest no longer fits, leave the block as it is
+			blocks[source].evacuating = false;
+			break;
+		}
+
+		RecordCopy(commandBuffer, record, move.buffer, move.image);
+		record.moving = true;
+		pendingMoves.push_back(move);
+		moved += record.allocation.size;
+	}
+
+	movedBytes += moved;
+	return moved;
+}
+
+DeviceAllocatorStats DeviceAllocator::GetStats() const
+{
+	DeviceAllocatorStats stats;
+	memset(&stats, 0, sizeof(stats));
+
+	for (size_t i = 0; i < blocks.size(); ++i)
+	{
+		if (blocks[i].memory != VK_NULL_HANDLE)
+		{
+			++stats.blockCount;
+			stats.reservedBytes += blocks[i].size;
+			stats.usedBytes += blocks[i].used;
+		}
+	}
+
+	stats.resourceCount = (uint32_t)(resources.size() - freeResources.size());
+	stats.movedBytes = movedBytes;
+
+	return stats;
+}
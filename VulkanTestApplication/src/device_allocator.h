@@ -0,0 +1,160 @@
+#pragma once
+
+#include <vector>
+
+#include "vulkan_helpers.h"
+#include "memory_budget.h"
+
+// Handle to a buffer or image owned by a DeviceAllocator. The Vulkan handle behind it changes
+// when the defragmenter moves it, so look it up each time it is bound.
+typedef uint32_t ManagedResource;
+const ManagedResource InvalidManagedResource = 0xffffffff;
+
+struct DeviceAllocatorStats
+{
+	uint32_t blockCount;
+	uint32_t resourceCount;
+	VkDeviceSize reservedBytes;	// Device memory held in blocks
+	VkDeviceSize usedBytes;		// Of which bound to resources
+	VkDeviceSize movedBytes;	// Total copied by the defragmenter
+};
+
+// Sub-allocates buffers and images from large per memory type blocks, instead of one
+// vkAllocateMemory per resource, and compacts the blocks over time.
+//
+// Defragment picks the emptiest block of a device local type and moves a bounded number of bytes
+// of its resources into the other blocks each frame: a new resource is created at the new place,
+// the contents copied on the GPU, and once that frame has completed the handle is swapped and the
+// owner told to rebind it. The old resource is destroyed once no frame can still reference it, and
+// the block is released when empty.
+//
+// Moves assume the GPU doesn't write to the resource after creation, and that images are in
+// VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL with a single colour aspect.
+class DeviceAllocator
+{
+public:
+	static const VkDeviceSize DefaultBlockSize = 64 * 1024 * 1024;
+
+	// Blocks below this occupancy are evacuated by Defragment
+	static const float DefragmentOccupancy;
+
+	DeviceAllocator();
+	~DeviceAllocator();
+
+	bool Create(VkDevice device, VkPhysicalDevice physicalDevice, MemoryBudget* budget, VkDeviceSize blockSize);
+	void Destroy();
+
+	// Device local resources also get transfer usage so the defragmenter can copy them
+	bool CreateBuffer(const VkBufferCreateInfo& createInfo, VkMemoryPropertyFlags properties, ManagedResource* resource);
+	bool CreateImage(const VkImageCreateInfo& createInfo, VkMemoryPropertyFlags properties, ManagedResource* resource);
+
+	// Device local buffer filled through a staging buffer and a blocking one-off submission
+	bool CreateBufferWithData(VkQueue queue, VkCommandPool commandPool, VkBufferUsageFlags usage, const void* data, VkDeviceSize size, ManagedResource* resource);
+
+	// Released once frameIndex has completed
+	void DestroyResource(ManagedResource resource, uint64_t frameIndex);
+
+	VkBuffer GetBuffer(ManagedResource resource) const;
+	VkImage GetImage(ManagedResource resource) const;
+
+	// Host visible resources only, blocks stay mapped for their lifetime
+	void* GetMappedData(ManagedResource resource) const;
+
+	// Finishes moves and releases memory for frames up to completedFrameIndex. Resources whose
+	// handle changed are appended to relocated, bindings to them must be updated before they are
+	// next recorded.
+	void BeginFrame(uint64_t frameIndex, uint64_t completedFrameIndex, std::vector<ManagedResource>* relocated);
+
+	// Records copies moving up to maxBytes out of the emptiest block into commandBuffer, which
+	// must be submitted as part of the current frame. Returns the number of bytes moved.
+	VkDeviceSize Defragment(VkCommandBuffer commandBuffer, VkDeviceSize maxBytes);
+
+	DeviceAllocatorStats GetStats() const;
+
+private:
+	struct FreeRange
+	{
+		VkDeviceSize offset;
+		VkDeviceSize size;
+	};
+
+	struct MemoryBlock
+	{
+		VkDeviceMemory memory;
+		uint32_t memoryType;
+		VkDeviceSize size;
+		VkDeviceSize used;
+		uint32_t allocationCount;
+		std::vector<FreeRange> freeRanges;	// Sorted by offset, adjacent ranges merged
+		void* mapped;
+		bool dedicated;		// Holds one resource too large to share a block
+		bool evacuating;	// Being emptied by the defragmenter, no new allocations
+	};
+
+	struct Allocation
+	{
+		uint32_t block;
+		VkDeviceSize offset;
+		VkDeviceSize size;
+	};
+
+	// Concurrent sharing across more families than this isn't supported
+	static const uint32_t MaxSharedQueueFamilies = 16;
+
+	struct ResourceRecord
+	{
+		bool live;
+		bool isImage;
+		VkBufferCreateInfo bufferCreateInfo;	// pQueueFamilyIndices is left NULL, the indices are kept below
+		VkImageCreateInfo imageCreateInfo;
+		uint32_t queueFamilyIndices[MaxSharedQueueFamilies];
+		VkMemoryPropertyFlags properties;
+		VkBuffer buffer;
+		VkImage image;
+		Allocation allocation;
+		bool moving;
+	};
+
+	struct PendingMove
+	{
+		ManagedResource resource;
+		VkBuffer buffer;
+		VkImage image;
+		Allocation allocation;
+		uint64_t frameIndex;
+	};
+
+	struct RetiredResource
+	{
+		VkBuffer buffer;
+		VkImage image;
+		Allocation allocation;
+		uint64_t frameIndex;
+	};
+
+	bool Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool allowNewBlock, uint32_t excludeBlock, Allocation* allocation);
+	bool AllocateFromBlock(uint32_t blockIndex, VkDeviceSize size, VkDeviceSize alignment, Allocation* allocation);
+	bool CreateBlock(uint32_t memoryType, VkDeviceSize size, bool dedicated, uint32_t* blockIndex);
+	void Free(const Allocation& allocation);
+	void ReleaseBlock(uint32_t blockIndex);
+
+	bool CreateBufferAt(const VkBufferCreateInfo& createInfo, VkMemoryPropertyFlags properties, bool allowNewBlock, uint32_t excludeBlock, VkBuffer* buffer, Allocation* allocation);
+	bool CreateImageAt(const VkImageCreateInfo& createInfo, VkMemoryPropertyFlags properties, bool allowNewBlock, uint32_t excludeBlock, VkImage* image, Allocation* allocation);
+	ManagedResource AddRecord(const ResourceRecord& record);
+	bool KeepQueueFamilies(VkSharingMode sharingMode, uint32_t queueFamilyIndexCount, const uint32_t* queueFamilyIndices, ResourceRecord* record);
+	void RecordCopy(VkCommandBuffer commandBuffer, const ResourceRecord& record, VkBuffer buffer, VkImage image);
+
+	VkDevice device;
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	VkDeviceSize bufferImageGranularity;
+	VkDeviceSize blockSize;
+	MemoryBudget* budget;
+	uint64_t currentFrame;
+	VkDeviceSize movedBytes;
+
+	std::vector<MemoryBlock> blocks;
+	std::vector<ResourceRecord> resources;
+	std::vector<ManagedResource> freeResources;
+	std::vector<PendingMove> pendingMoves;
+	std::vector<RetiredResource> retiredResources;
+};
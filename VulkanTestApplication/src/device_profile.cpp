@@ -0,0 +1,194 @@
+#include "device_profile.h"
+
+#include <cstring>
+#include <iostream>
+
+static VkBool32 GetFeature(const VkPhysicalDeviceFeatures& features, size_t offset)
+{
+	return *(const VkBool32*)((const char*)&features + offset);
+}
+
+static void SetFeature(VkPhysicalDeviceFeatures* features, size_t offset, VkBool32 value)
+{
+	*(VkBool32*)((char*)features + offset) = value;
+}
+
+static bool ContainsExtension(const std::vector<VkExtensionProperties>& extensions, const char* name)
+{
+	for (size_t i = 0; i < extensions.size(); ++i)
+	{
+		if (strcmp(extensions[i].extensionName, name) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void GetDeviceExtensions(VkPhysicalDevice physicalDevice, std::vector<VkExtensionProperties>* extensions)
+{
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &extensionCount, NULL);
+	extensions->resize(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &extensionCount, extensions->data());
+}
+
+DeviceProfile GetApplicationDeviceProfile(bool robustBufferAccess, bool physicalDeviceProperties2)
+{
+	DeviceProfile profile;
+
+	// Compressed textures are decoded on the CPU when their family isn't available
+	profile.features.push_back(DEVICE_FEATURE(textureCompressionBC, false));
+	profile.features.push_back(DEVICE_FEATURE(textureCompressionETC2, false));
+	profile.features.push_back(DEVICE_FEATURE(textureCompressionASTC_LDR, false));
+
+	if (robustBufferAccess)
+	{
+		profile.features.push_back(DEVICE_FEATURE(robustBufferAccess, true));
+	}
+
+	profile.extensions.push_back({ VK_KHR_SWAPCHAIN_EXTENSION_NAME, true });
+
+#ifdef VK_EXT_memory_budget
+	// Heap usage is tracked by the application alone without it
+	if (physicalDeviceProperties2)
+	{
+		profile.extensions.push_back({ VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, false });
+	}
+#endif
+
+#ifdef VK_KHR_timeline_semaphore
+	// Cross queue dependencies fall back to pooled binary semaphores without it
+	if (physicalDeviceProperties2)
+	{
+		profile.extensions.push_back({ VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME, false });
+	}
+#endif
+
+	return profile;
+}
+
+void GetRequiredFeatures(const DeviceProfile& profile, VkPhysicalDeviceFeatures* features)
+{
+	memset(features, 0, sizeof(*features));
+
+	for (size_t i = 0; i < profile.features.size(); ++i)
+	{
+		if (profile.features[i].required)
+		{
+			SetFeature(features, profile.features[i].offset, VK_TRUE);
+		}
+	}
+}
+
+void GetRequiredExtensions(const DeviceProfile& profile, std::vector<const char*>* extensions)
+{
+	for (size_t i = 0; i < profile.extensions.size(); ++i)
+	{
+		if (profile.extensions[i].required)
+		{
+			extensions->push_back(profile.extensions[i].name);
+		}
+	}
+}
+
+bool NegotiateDeviceProfile(VkPhysicalDevice physicalDevice, const DeviceProfile& profile, DeviceCapabilities* capabilities)
+{
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+	std::vector<VkExtensionProperties> supportedExtensions;
+	GetDeviceExtensions(physicalDevice, &supportedExtensions);
+
+	memset(&capabilities->enabledFeatures, 0, sizeof(capabilities->enabledFeatures));
+	capabilities->enabledExtensions.clear();
+
+	bool complete = true;
+
+	for (size_t i = 0; i < profile.features.size(); ++i)
+	{
+		const DeviceFeatureRequest& request = profile.features[i];
+
+		if (GetFeature(supportedFeatures, request.offset))
+		{
+			SetFeature(&capabilities->enabledFeatures, request.offset, VK_TRUE);
+		}
+		else if (request.required)
+		{
+			complete = false;
+		}
+	}
+
+	for (size_t i = 0; i < profile.extensions.size(); ++i)
+	{
+		const DeviceExtensionRequest& request = profile.extensions[i];
+
+		if (ContainsExtension(supportedExtensions, request.name))
+		{
+			capabilities->enabledExtensions.push_back(request.name);
+		}
+		else if (request.required)
+		{
+			complete = false;
+		}
+	}
+
+	return complete;
+}
+
+bool IsExtensionEnabled(const DeviceCapabilities& capabilities, const char* name)
+{
+	for (size_t i = 0; i < capabilities.enabledExtensions.size(); ++i)
+	{
+		if (strcmp(capabilities.enabledExtensions[i], name) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void PrintDeviceCapabilities(const DeviceProfile& profile, const DeviceCapabilities& capabilities)
+{
+	std::cout << "Device features:" << std::endl;
+
+	for (size_t i = 0; i < profile.features.size(); ++i)
+	{
+		const DeviceFeatureRequest& request = profile.features[i];
+		bool enabled = GetFeature(capabilities.enabledFeatures, request.offset) != VK_FALSE;
+
+		std::cout << "  " << request.name << (request.required ? " (required): " : " (optional): ") << (enabled ? "enabled" : "not supported") << std::endl;
+	}
+
+	std::cout << "Device extensions:" << std::endl;
+
+	for (size_t i = 0; i < profile.extensions.size(); ++i)
+	{
+		const DeviceExtensionRequest& request = profile.extensions[i];
+		bool enabled = IsExtensionEnabled(capabilities, request.name);
+
+		std::cout << "  " << request.name << (request.required ? " (required): " : " (optional): ") << (enabled ? "enabled" : "not supported") << std::endl;
+	}
+}
+
+bool IsTextureFormatEnabled(const VkPhysicalDeviceFeatures& enabledFeatures, VkFormat format)
+{
+	if (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK)
+	{
+		return enabledFeatures.textureCompressionBC != VK_FALSE;
+	}
+
+	if (format >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK && format <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK)
+	{
+		return enabledFeatures.textureCompressionETC2 != VK_FALSE;
+	}
+
+	if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK)
+	{
+		return enabledFeatures.textureCompressionASTC_LDR != VK_FALSE;
+	}
+
+	return true;
+}
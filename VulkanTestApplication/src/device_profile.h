@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "vulkan_helpers.h"
+
+// Capability profile: the features and extensions the application uses, negotiated against a
+// device so only those are enabled. Required entries make a device unsuitable when missing,
+// optional ones are enabled when present and the code checks the granted set before using them.
+
+struct DeviceFeatureRequest
+{
+	const char* name;
+	size_t offset;		// Of the VkBool32 in VkPhysicalDeviceFeatures
+	bool required;
+};
+
+struct DeviceExtensionRequest
+{
+	const char* name;
+	bool required;
+};
+
+struct DeviceProfile
+{
+	std::vector<DeviceFeatureRequest> features;
+	std::vector<DeviceExtensionRequest> extensions;
+};
+
+struct DeviceCapabilities
+{
+	VkPhysicalDeviceFeatures enabledFeatures;
+	std::vector<const char*> enabledExtensions;
+};
+
+#define DEVICE_FEATURE(member, required) { #member, offsetof(VkPhysicalDeviceFeatures, member), required }
+
+// What this application uses. robustBufferAccess is off unless asked for, it costs shader
+// performance on some drivers and is only wanted to measure that cost. physicalDeviceProperties2
+// says the instance has VK_KHR_get_physical_device_properties2, which VK_EXT_memory_budget and
+// VK_KHR_timeline_semaphore depend on.
+DeviceProfile GetApplicationDeviceProfile(bool robustBufferAccess, bool physicalDeviceProperties2);
+
+// Required subset of the profile, for device selection
+void GetRequiredFeatures(const DeviceProfile& profile, VkPhysicalDeviceFeatures* features);
+void GetRequiredExtensions(const DeviceProfile& profile, std::vector<const char*>* extensions);
+
+// Enables everything required and whatever optional entries the device supports.
+// Returns false if something required is missing.
+bool NegotiateDeviceProfile(VkPhysicalDevice physicalDevice, const DeviceProfile& profile, DeviceCapabilities* capabilities);
+
+bool IsExtensionEnabled(const DeviceCapabilities& capabilities, const char* name);
+
+void PrintDeviceCapabilities(const DeviceProfile& profile, const DeviceCapabilities& capabilities);
+
+// False for compressed formats whose texture compression feature wasn't enabled
+bool IsTextureFormatEnabled(const VkPhysicalDeviceFeatures& enabledFeatures, VkFormat format);
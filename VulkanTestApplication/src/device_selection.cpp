@@ -0,0 +1,261 @@
+#include "device_selection.h"
+
+#include <cstring>
+
+// Some software implementations report themselves as integrated or other
+static bool IsSoftwareDevice(const VkPhysicalDeviceProperties& properties)
+{
+	static const char* softwareNames[] = { "llvmpipe", "lavapipe", "SwiftShader" };
+
+	if (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU)
+	{
+		return true;
+	}
+
+	for (size_t i = 0; i < sizeof(softwareNames) / sizeof(softwareNames[0]); ++i)
+	{
+		if (strstr(properties.deviceName, softwareNames[i]) != NULL)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool HasDeviceExtensions(VkPhysicalDevice physicalDevice, const std::vector<const char*>& extensions)
+{
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &extensionCount, NULL);
+	std::vector<VkExtensionProperties> available(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &extensionCount, available.data());
+
+	for (size_t i = 0; i < extensions.size(); ++i)
+	{
+		bool found = false;
+
+		for (uint32_t j = 0; j < extensionCount && found == false; ++j)
+		{
+			found = strcmp(available[j].extensionName, extensions[i]) == 0;
+		}
+
+		if (found == false)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool HasDeviceFeatures(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceFeatures& required)
+{
+	VkPhysicalDeviceFeatures supported;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supported);
+
+	// VkPhysicalDeviceFeatures is nothing but VkBool32s
+	const VkBool32* requiredFlags = (const VkBool32*)&required;
+	const VkBool32* supportedFlags = (const VkBool32*)&supported;
+
+	for (size_t i = 0; i < sizeof(VkPhysicalDeviceFeatures) / sizeof(VkBool32); ++i)
+	{
+		if (requiredFlags[i] && supportedFlags[i] == VK_FALSE)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void FindQueueFamilies(VkPhysicalDevice physicalDevice, const std::vector<VkSurfaceKHR>& surfaces, PhysicalDeviceCandidate* candidate)
+{
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, NULL);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	candidate->graphicsQueueFamily = UINT32_MAX;
+	candidate->computeQueueFamily = UINT32_MAX;
+	candidate->transferQueueFamily = UINT32_MAX;
+
+	for (uint32_t i = 0; i < queueFamilyCount; ++i)
+	{
+		VkQueueFlags flags = queueFamilies[i].queueFlags;
+
+		if (queueFamilies[i].queueCount == 0)
+		{
+			continue;
+		}
+
+		if (flags & VK_QUEUE_GRAPHICS_BIT)
+		{
+			VkBool32 surfaceSupport = VK_TRUE;
+
+			for (size_t surface = 0; surface < surfaces.size() && surfaceSupport; ++surface)
+			{
+				vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surfaces[surface], &surfaceSupport);
+			}
+
+			if (surfaceSupport && candidate->graphicsQueueFamily == UINT32_MAX)
+			{
+				candidate->graphicsQueueFamily = i;
+			}
+		}
+		else if (flags & VK_QUEUE_COMPUTE_BIT)
+		{
+			if (candidate->computeQueueFamily == UINT32_MAX)
+			{
+				candidate->computeQueueFamily = i;
+			}
+		}
+		else if (flags & VK_QUEUE_TRANSFER_BIT)
+		{
+			if (candidate->transferQueueFamily == UINT32_MAX)
+			{
+				candidate->transferQueueFamily = i;
+			}
+		}
+	}
+}
+
+static int64_t ScoreCandidate(const PhysicalDeviceCandidate& candidate)
+{
+	// Device type dominates, then memory, then asynchronous queues as a tie breaker
+	int64_t typeScore = 0;
+
+	switch (candidate.properties.deviceType)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: typeScore = 4; break;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: typeScore = 3; break;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: typeScore = 2; break;
+	default: typeScore = 1; break;
+	}
+
+	if (candidate.software)
+	{
+		typeScore = 0;
+	}
+
+	int64_t memoryMegabytes = (int64_t)(candidate.deviceLocalMemory >> 20);
+
+	if (memoryMegabytes > 999999)
+	{
+		memoryMegabytes = 999999;
+	}
+
+	int64_t queueScore = (candidate.computeQueueFamily != UINT32_MAX ? 2 : 0) + (candidate.transferQueueFamily != UINT32_MAX ? 1 : 0);
+
+	return typeScore * 100000000ll + memoryMegabytes * 10 + queueScore;
+}
+
+bool EnumeratePhysicalDeviceCandidates(VkInstance instance, const DeviceSelectionOptions& options, std::vector<PhysicalDeviceCandidate>* candidates)
+{
+	uint32_t deviceCount = 0;
+
+	if (vkEnumeratePhysicalDevices(instance, &deviceCount, NULL) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	std::vector<VkPhysicalDevice> physicalDevices(deviceCount);
+
+	if (vkEnumeratePhysicalDevices(instance, &deviceCount, physicalDevices.data()) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	candidates->resize(deviceCount);
+
+	for (uint32_t i = 0; i < deviceCount; ++i)
+	{
+		PhysicalDeviceCandidate& candidate = (*candidates)[i];
+		candidate.physicalDevice = physicalDevices[i];
+		vkGetPhysicalDeviceProperties(physicalDevices[i], &candidate.properties);
+		candidate.software = IsSoftwareDevice(candidate.properties);
+		candidate.rejectReason = NULL;
+
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevices[i], &memoryProperties);
+		candidate.deviceLocalMemory = 0;
+
+		for (uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; ++heap)
+		{
+			if ((memoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && memoryProperties.memoryHeaps[heap].size > candidate.deviceLocalMemory)
+			{
+				candidate.deviceLocalMemory = memoryProperties.memoryHeaps[heap].size;
+			}
+		}
+
+		FindQueueFamilies(physicalDevices[i], options.surfaces, &candidate);
+
+		if (candidate.graphicsQueueFamily == UINT32_MAX)
+		{
+			candidate.rejectReason = "no graphics queue that can present";
+		}
+		else if (HasDeviceExtensions(physicalDevices[i], options.requiredExtensions) == false)
+		{
+			candidate.rejectReason = "missing required extensions";
+		}
+		else if (options.requiredFeatures != NULL && HasDeviceFeatures(physicalDevices[i], *options.requiredFeatures) == false)
+		{
+			candidate.rejectReason = "missing required features";
+		}
+
+		candidate.score = ScoreCandidate(candidate);
+	}
+
+	return true;
+}
+
+bool SelectPhysicalDevice(const std::vector<PhysicalDeviceCandidate>& candidates, const DeviceSelectionOptions& options, uint32_t* selected)
+{
+	// An explicit request wins over scoring, including a software device, as long as it can run at all
+	if (options.deviceIndex >= 0 || options.deviceName != NULL)
+	{
+		for (uint32_t i = 0; i < candidates.size(); ++i)
+		{
+			bool matches = options.deviceIndex >= 0 ? (int)i == options.deviceIndex : strstr(candidates[i].properties.deviceName, options.deviceName) != NULL;
+
+			if (matches)
+			{
+				*selected = i;
+				return candidates[i].rejectReason == NULL;
+			}
+		}
+
+		return false;
+	}
+
+	bool found = false;
+
+	for (uint32_t i = 0; i < candidates.size(); ++i)
+	{
+		const PhysicalDeviceCandidate& candidate = candidates[i];
+
+		if (candidate.rejectReason != NULL || (candidate.software && options.allowSoftware == false))
+		{
+			continue;
+		}
+
+		if (found == false || candidate.score > candidates[*selected].score)
+		{
+			*selected = i;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+const char* GetPhysicalDeviceTypeName(VkPhysicalDeviceType deviceType)
+{
+	switch (deviceType)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated";
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "discrete";
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "virtual";
+	case VK_PHYSICAL_DEVICE_TYPE_CPU: return "cpu";
+	default: return "other";
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include "vulkan_helpers.h"
+
+struct DeviceSelectionOptions
+{
+	const char* deviceName;		// Pick the device whose name contains this, NULL for any
+	int deviceIndex;		// Pick this enumeration index, -1 for any
+	bool allowSoftware;		// CPU implementations are only considered when asked for
+	std::vector<VkSurfaceKHR> surfaces;	// The graphics queue must be able to present to all of these
+	std::vector<const char*> requiredExtensions;
+	const VkPhysicalDeviceFeatures* requiredFeatures;	// NULL for none
+};
+
+struct PhysicalDeviceCandidate
+{
+	VkPhysicalDevice physicalDevice;
+	VkPhysicalDeviceProperties properties;
+	uint32_t graphicsQueueFamily;	// Graphics and present
+	uint32_t computeQueueFamily;	// Compute without graphics, UINT32_MAX if there is none
+	uint32_t transferQueueFamily;	// Transfer only, UINT32_MAX if there is none
+	VkDeviceSize deviceLocalMemory;	// Largest device local heap
+	bool software;
+	const char* rejectReason;	// NULL if the device can run the application
+	int64_t score;
+};
+
+// Gathers properties of every physical device and checks it against the options
+bool EnumeratePhysicalDeviceCandidates(VkInstance instance, const DeviceSelectionOptions& options, std::vector<PhysicalDeviceCandidate>* candidates);
+
+// Index of the explicitly requested device or otherwise the highest scoring suitable one.
+// Returns false, with the reason in rejectReason of the requested device if there was one, when nothing fits.
+bool SelectPhysicalDevice(const std::vector<PhysicalDeviceCandidate>& candidates, const DeviceSelectionOptions& options, uint32_t* selected);
+
+const char* GetPhysicalDeviceTypeName(VkPhysicalDeviceType deviceType);
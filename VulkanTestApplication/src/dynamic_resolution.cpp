@@ -0,0 +1,148 @@
+#include "dynamic_resolution.h"
+
+#include <cmath>
+
+const float DynamicResolution::DefaultMinScale = 0.5f;
+const float DynamicResolution::ScaleStep = 0.05f;
+const float DynamicResolution::Headroom = 0.85f;
+
+// Weight of the newest sample in the smoothed time
+static const float SmoothingFactor = 0.2f;
+
+// Largest rise in one step, drops aren't limited
+static const float MaxScaleIncrease = 0.1f;
+
+DynamicResolution::DynamicResolution()
+	: target(0.0f)
+	, minScale(DefaultMinScale)
+	, maxScale(1.0f)
+	, scale(1.0f)
+	, smoothedTime(0.0f)
+	, hasSample(false)
+	, framesWithHeadroom(0)
+	, settleFrames(0)
+{
+}
+
+void DynamicResolution::Initialize(float targetMilliseconds, float minScale, float maxScale)
+{
+	target = targetMilliseconds;
+	this->minScale = minScale;
+	this->maxScale = maxScale;
+	scale = maxScale;
+	smoothedTime = 0.0f;
+	hasSample = false;
+	framesWithHeadroom = 0;
+	settleFrames = 0;
+}
+
+float DynamicResolution::Update(float gpuMilliseconds)
+{
+	if (target <= 0.0f || gpuMilliseconds <= 0.0f)
+	{
+		return scale;
+	}
+
+	if (settleFrames > 0)
+	{
+		--settleFrames;
+		return scale;
+	}
+
+	smoothedTime = hasSample ? smoothedTime + (gpuMilliseconds - smoothedTime) * SmoothingFactor : gpuMilliseconds;
+	hasSample = true;
+
+	float desired = scale;
+
+	if (smoothedTime > target)
+	{
+		desired = scale * sqrtf(target / smoothedTime);
+		framesWithHeadroom = 0;
+	}
+	else if (smoothedTime < target * Headroom)
+	{
+		if (++framesWithHeadroom >= IncreaseDelay)
+		{
+			desired = scale * sqrtf(target * Headroom / smoothedTime);
+
+			if (desired > scale + MaxScaleIncrease)
+			{
+				desired = scale + MaxScaleIncrease;
+			}
+
+			framesWithHeadroom = 0;
+		}
+	}
+	else
+	{
+		framesWithHeadroom = 0;
+	}
+
+	// Drops round down and rises round up to the next step, so any change moves at least one
+	if (desired < scale)
+	{
+		desired = floorf(desired / ScaleStep + 0.001f) * ScaleStep;
+	}
+	else if (desired > scale)
+	{
+		desired = ceilf(desired / ScaleStep - 0.001f) * ScaleStep;
+	}
+
+	if (desired < minScale)
+	{
+		desired = minScale;
+	}
+
+	if (desired > maxScale)
+	{
+		desired = maxScale;
+	}
+
+	if (fabsf(desired - scale) > 0.001f)
+	{
+		scale = desired;
+		hasSample = false;
+		settleFrames = SettleFrames;
+	}
+
+	return scale;
+}
+
+float DynamicResolution::GetScale() const
+{
+	return scale;
+}
+
+float DynamicResolution::GetSmoothedTime() const
+{
+	return smoothedTime;
+}
+
+VkExtent2D DynamicResolution::GetScaledExtent(VkExtent2D fullExtent) const
+{
+	VkExtent2D extent;
+	extent.width = (uint32_t)(fullExtent.width * scale + 0.5f);
+	extent.height = (uint32_t)(fullExtent.height * scale + 0.5f);
+
+	if (extent.width == 0)
+	{
+		extent.width = 1;
+	}
+
+	if (extent.height == 0)
+	{
+		extent.height = 1;
+	}
+
+	if (extent.width > fullExtent.width)
+	{
+		extent.width = fullExtent.width;
+	}
+
+	if (extent.height > fullExtent.height)
+	{
+		extent.height = fullExtent.height;
+	}
+
+	return extent;
+}
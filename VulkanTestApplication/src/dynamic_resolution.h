@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+#include "vulkan_helpers.h"
+
+// Picks the scene's render scale from measured GPU frame time to hold a frame time target.
+//
+// GPU time is taken to be proportional to the pixels shaded, so the scale moves by the square root
+// of target over measured time. Measurements are smoothed, the scale drops as soon as the target is
+// exceeded but only rises after a run of frames with headroom, and it moves in fixed steps so small
+// fluctuations don't change the resolution. After a change a few samples are skipped, as results
+// for frames still in flight were rendered at the old scale.
+class DynamicResolution
+{
+public:
+	static const float DefaultMinScale;
+	static const float ScaleStep;
+
+	// Share of the target below which the scale may rise
+	static const float Headroom;
+
+	// Consecutive frames with headroom before the scale rises
+	static const uint32_t IncreaseDelay = 30;
+
+	// Samples ignored after a change
+	static const uint32_t SettleFrames = 4;
+
+	DynamicResolution();
+
+	void Initialize(float targetMilliseconds, float minScale, float maxScale);
+
+	// Feeds one GPU frame time and returns the scale to render the next frame at
+	float Update(float gpuMilliseconds);
+
+	float GetScale() const;
+	float GetSmoothedTime() const;
+
+	// Scaled extent of a full resolution one, at least 1x1
+	VkExtent2D GetScaledExtent(VkExtent2D fullExtent) const;
+
+private:
+	float target;
+	float minScale;
+	float maxScale;
+	float scale;
+	float smoothedTime;
+	bool hasSample;
+	uint32_t framesWithHeadroom;
+	uint32_t settleFrames;
+};
@@ -0,0 +1,229 @@
+#include "frame_capture.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "logger.h"
+
+FrameCapture::FrameCapture()
+	: capturing(false)
+	, valid(false)
+	, width(0)
+	, height(0)
+	, commandCount(0)
+{
+}
+
+void FrameCapture::Begin(uint32_t width, uint32_t height)
+{
+	capturing = true;
+	valid = true;
+	this->width = width;
+	this->height = height;
+	commandCount = 0;
+	stream.clear();
+	bufferIds.clear();
+	moduleIds.clear();
+	pipelineIds.clear();
+	uniformSetIds.clear();
+}
+
+bool FrameCapture::IsCapturing() const
+{
+	return capturing;
+}
+
+void FrameCapture::CreateBuffer(VkBuffer buffer, VkBufferUsageFlags usage, bool hostVisible, const void* data, VkDeviceSize size)
+{
+	FrameCaptureBuffer payload;
+	payload.id = AddId(bufferIds, buffer);
+	payload.usage = usage;
+	payload.hostVisible = hostVisible ? 1 : 0;
+	payload.reserved = 0;
+	payload.size = size;
+	WriteCommand(FrameCaptureCommand_CreateBuffer, &payload, sizeof(payload), NULL, 0);
+
+	FrameCaptureUpload upload;
+	upload.buffer = payload.id;
+	upload.reserved = 0;
+	upload.offset = 0;
+	WriteCommand(FrameCaptureCommand_UploadBuffer, &upload, sizeof(upload), data, (size_t)size);
+}
+
+void FrameCapture::CreateShaderModule(VkShaderModule module, const uint32_t* code, size_t codeSize)
+{
+	uint32_t id = AddId(moduleIds, module);
+	WriteCommand(FrameCaptureCommand_CreateShaderModule, &id, sizeof(id), code, codeSize);
+}
+
+void FrameCapture::CreateMeshPipeline(VkPipeline pipeline, VkShaderModule vertModule, VkShaderModule fragModule, const VertexFormat& vertexFormat, const MeshShaderVariant& variant, MeshDepthMode depthMode, bool perInstanceTransforms)
+{
+	FrameCapturePipeline payload;
+	payload.vertModule = FindId(moduleIds, vertModule);
+	payload.fragModule = fragModule != VK_NULL_HANDLE ? FindId(moduleIds, fragModule) : FrameCaptureNoId;
+	payload.positionFormat = vertexFormat.position;
+	payload.attributeFormat = vertexFormat.attribute;
+	memcpy(payload.positionScale, vertexFormat.positionScale, sizeof(payload.positionScale));
+	memcpy(payload.positionOffset, vertexFormat.positionOffset, sizeof(payload.positionOffset));
+	payload.quantizedPositions = variant.quantizedPositions;
+	payload.depthMode = depthMode;
+	payload.perInstanceTransforms = perInstanceTransforms ? 1 : 0;
+	payload.id = AddId(pipelineIds, pipeline);
+	WriteCommand(FrameCaptureCommand_CreatePipeline, &payload, sizeof(payload), NULL, 0);
+}
+
+void FrameCapture::CreateUniformSet(VkDescriptorSet descriptorSet, VkBuffer uniformBuffer, VkDeviceSize range)
+{
+	FrameCaptureUniformSet payload;
+	payload.buffer = FindId(bufferIds, uniformBuffer);
+	payload.range = range;
+	payload.id = AddId(uniformSetIds, descriptorSet);
+	WriteCommand(FrameCaptureCommand_CreateUniformSet, &payload, sizeof(payload), NULL, 0);
+}
+
+void FrameCapture::BeginRenderPass(VkExtent2D renderArea, const float clearColor[4], float clearDepth)
+{
+	FrameCaptureRenderPass payload;
+	payload.width = renderArea.width;
+	payload.height = renderArea.height;
+	memcpy(payload.clearColor, clearColor, sizeof(payload.clearColor));
+	payload.clearDepth = clearDepth;
+	payload.reserved = 0;
+	WriteCommand(FrameCaptureCommand_BeginRenderPass, &payload, sizeof(payload), NULL, 0);
+}
+
+void FrameCapture::ClearRect(const VkClearRect& rect, const float color[4])
+{
+	FrameCaptureClearRect payload;
+	payload.x = rect.rect.offset.x;
+	payload.y = rect.rect.offset.y;
+	payload.width = rect.rect.extent.width;
+	payload.height = rect.rect.extent.height;
+	memcpy(payload.color, color, sizeof(payload.color));
+	WriteCommand(FrameCaptureCommand_ClearRect, &payload, sizeof(payload), NULL, 0);
+}
+
+void FrameCapture::BindPipeline(VkPipeline pipeline)
+{
+	uint32_t id = FindId(pipelineIds, pipeline);
+	WriteCommand(FrameCaptureCommand_BindPipeline, &id, sizeof(id), NULL, 0);
+}
+
+void FrameCapture::BindDescriptorSet(VkDescriptorSet descriptorSet)
+{
+	uint32_t id = FindId(uniformSetIds, descriptorSet);
+	WriteCommand(FrameCaptureCommand_BindUniformSet, &id, sizeof(id), NULL, 0);
+}
+
+void FrameCapture::BindVertexBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset)
+{
+	FrameCaptureVertexBuffer payload;
+	payload.binding = binding;
+	payload.buffer = FindId(bufferIds, buffer);
+	payload.offset = offset;
+	WriteCommand(FrameCaptureCommand_BindVertexBuffer, &payload, sizeof(payload), NULL, 0);
+}
+
+void FrameCapture::BindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType)
+{
+	FrameCaptureIndexBuffer payload;
+	payload.buffer = FindId(bufferIds, buffer);
+	payload.indexType = indexType;
+	payload.offset = offset;
+	WriteCommand(FrameCaptureCommand_BindIndexBuffer, &payload, sizeof(payload), NULL, 0);
+}
+
+void FrameCapture::DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
+{
+	FrameCaptureDraw payload;
+	payload.indexCount = indexCount;
+	payload.instanceCount = instanceCount;
+	payload.firstIndex = firstIndex;
+	payload.vertexOffset = vertexOffset;
+	payload.firstInstance = firstInstance;
+	WriteCommand(FrameCaptureCommand_DrawIndexed, &payload, sizeof(payload), NULL, 0);
+}
+
+void FrameCapture::EndRenderPass()
+{
+	WriteCommand(FrameCaptureCommand_EndRenderPass, NULL, 0, NULL, 0);
+}
+
+bool FrameCapture::End(const char* path)
+{
+	if (capturing == false)
+	{
+		return false;
+	}
+
+	WriteCommand(FrameCaptureCommand_End, NULL, 0, NULL, 0);
+	capturing = false;
+
+	if (valid == false)
+	{
+		Log(LogSeverity_Warning, "The captured frame used objects created before the capture, %s wasn't written", path);
+		return false;
+	}
+
+	FrameCaptureHeader header;
+	header.magic = FrameCaptureMagic;
+	header.version = FrameCaptureVersion;
+	header.width = width;
+	header.height = height;
+	header.commandCount = commandCount;
+	header.reserved = 0;
+
+	FILE* file = fopen(path, "wb");
+
+	if (file == NULL)
+	{
+		Log(LogSeverity_Warning, "Couldn't open %s to write the capture", path);
+		return false;
+	}
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(stream.data(), 1, stream.size(), file) == stream.size();
+
+	if (fclose(file) != 0 || written == false)
+	{
+		Log(LogSeverity_Warning, "Couldn't write the capture to %s", path);
+		return false;
+	}
+
+	return true;
+}
+
+size_t FrameCapture::GetSize() const
+{
+	return sizeof(FrameCaptureHeader) + stream.size();
+}
+
+void FrameCapture::WriteCommand(FrameCaptureCommand command, const void* payload, size_t size, const void* data, size_t dataSize)
+{
+	if (capturing == false)
+	{
+		return;
+	}
+
+	FrameCaptureCommandHeader header;
+	header.command = command;
+	header.size = (uint32_t)(size + dataSize);
+
+	// Zero fills the padding
+	size_t offset = stream.size();
+	size_t paddedSize = (size + dataSize + 3) & ~(size_t)3;
+	stream.resize(offset + sizeof(header) + paddedSize, 0);
+
+	memcpy(&stream[offset], &header, sizeof(header));
+
+	if (size > 0)
+	{
+		memcpy(&stream[offset + sizeof(header)], payload, size);
+	}
+
+	if (dataSize > 0)
+	{
+		memcpy(&stream[offset + sizeof(header) + size], data, dataSize);
+	}
+
+	++commandCount;
+}
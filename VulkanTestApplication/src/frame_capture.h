@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "frame_capture_format.h"
+#include "mesh_pipeline.h"
+#include "vertex_format.h"
+
+// Records one frame of the renderer as a self contained command stream that VulkanBenchmark
+// replays with --replay, on any device.
+//
+// Between Begin and End, every object a frame uses is described with a Create call, buffers along
+// with their contents at that point, followed by the frame's render pass commands. Handles are mapped
+// to ids as they are created, so the file holds nothing device specific and replays the same
+// commands on every run. The calls mirror what was recorded into the command buffer and don't
+// record anything themselves.
+//
+// A command that refers to an object that wasn't created in the capture fails it, End then writes
+// nothing.
+class FrameCapture
+{
+public:
+	FrameCapture();
+
+	void Begin(uint32_t width, uint32_t height);
+	bool IsCapturing() const;
+
+	void CreateBuffer(VkBuffer buffer, VkBufferUsageFlags usage, bool hostVisible, const void* data, VkDeviceSize size);
+	void CreateShaderModule(VkShaderModule module, const uint32_t* code, size_t codeSize);
+
+	// fragModule is VK_NULL_HANDLE for a depth only pipeline
+	void CreateMeshPipeline(VkPipeline pipeline, VkShaderModule vertModule, VkShaderModule fragModule, const VertexFormat& vertexFormat, const MeshShaderVariant& variant, MeshDepthMode depthMode, bool perInstanceTransforms);
+	void CreateUniformSet(VkDescriptorSet descriptorSet, VkBuffer uniformBuffer, VkDeviceSize range);
+
+	void BeginRenderPass(VkExtent2D renderArea, const float clearColor[4], float clearDepth);
+	void ClearRect(const VkClearRect& rect, const float color[4]);
+	void BindPipeline(VkPipeline pipeline);
+	void BindDescriptorSet(VkDescriptorSet descriptorSet);
+	void BindVertexBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset);
+	void BindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+	void DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance);
+	void EndRenderPass();
+
+	// Writes the capture to path and stops capturing
+	bool End(const char* path);
+
+	// Size of the capture so far
+	size_t GetSize() const;
+
+private:
+	void WriteCommand(FrameCaptureCommand command, const void* payload, size_t size, const void* data, size_t dataSize);
+
+	template <typename Handle>
+	uint32_t AddId(std::map<Handle, uint32_t>& ids, Handle handle)
+	{
+		uint32_t id = (uint32_t)ids.size();
+		ids[handle] = id;
+		return id;
+	}
+
+	template <typename Handle>
+	uint32_t FindId(const std::map<Handle, uint32_t>& ids, Handle handle)
+	{
+		typename std::map<Handle, uint32_t>::const_iterator found = ids.find(handle);
+
+		if (found == ids.end())
+		{
+			valid = false;
+			return FrameCaptureNoId;
+		}
+
+		return found->second;
+	}
+
+	bool capturing;
+	bool valid;
+	uint32_t width;
+	uint32_t height;
+	uint32_t commandCount;
+	std::vector<unsigned char> stream;
+
+	std::map<VkBuffer, uint32_t> bufferIds;
+	std::map<VkShaderModule, uint32_t> moduleIds;
+	std::map<VkPipeline, uint32_t> pipelineIds;
+	std::map<VkDescriptorSet, uint32_t> uniformSetIds;
+};
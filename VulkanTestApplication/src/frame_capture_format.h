@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+
+// On disk layout of a frame capture, written by FrameCapture and replayed by VulkanBenchmark.
+//
+// FrameCaptureHeader
+// Commands, each a FrameCaptureCommandHeader followed by its payload, up to FrameCaptureCommand_End
+//
+// Objects are referred to by ids, numbered from 0 in creation order separately for each kind.
+// Creations and uploads come first, then the commands of one render pass. All values are little
+// endian and payloads are padded to 4 bytes.
+
+const uint32_t FrameCaptureMagic = 0x50414356; // "VCAP"
+const uint32_t FrameCaptureVersion = 1;
+
+// Stands in for an id where there is no object, such as the fragment shader of a depth only pipeline
+const uint32_t FrameCaptureNoId = 0xffffffff;
+
+enum FrameCaptureCommand
+{
+	FrameCaptureCommand_End = 0,
+	FrameCaptureCommand_CreateBuffer = 1,		// FrameCaptureBuffer
+	FrameCaptureCommand_UploadBuffer = 2,		// FrameCaptureUpload followed by the data
+	FrameCaptureCommand_CreateShaderModule = 3,	// uint32_t id followed by SPIR-V words
+	FrameCaptureCommand_CreatePipeline = 4,		// FrameCapturePipeline
+	FrameCaptureCommand_CreateUniformSet = 5,	// FrameCaptureUniformSet
+	FrameCaptureCommand_BeginRenderPass = 6,	// FrameCaptureRenderPass
+	FrameCaptureCommand_ClearRect = 7,			// FrameCaptureClearRect
+	FrameCaptureCommand_BindPipeline = 8,		// uint32_t id
+	FrameCaptureCommand_BindUniformSet = 9,		// uint32_t id
+	FrameCaptureCommand_BindVertexBuffer = 10,	// FrameCaptureVertexBuffer
+	FrameCaptureCommand_BindIndexBuffer = 11,	// FrameCaptureIndexBuffer
+	FrameCaptureCommand_DrawIndexed = 12,		// FrameCaptureDraw
+	FrameCaptureCommand_EndRenderPass = 13,
+};
+
+struct FrameCaptureHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;			// Framebuffer size, the render area may be smaller
+	uint32_t height;
+	uint32_t commandCount;
+	uint32_t reserved;
+};
+
+struct FrameCaptureCommandHeader
+{
+	uint32_t command;
+	uint32_t size;			// Of the payload, before padding
+};
+
+struct FrameCaptureBuffer
+{
+	uint32_t id;
+	uint32_t usage;			// VkBufferUsageFlags
+	uint32_t hostVisible;	// Otherwise device local, uploads are staged
+	uint32_t reserved;
+	uint64_t size;
+};
+
+struct FrameCaptureUpload
+{
+	uint32_t buffer;
+	uint32_t reserved;
+	uint64_t offset;
+};
+
+// A mesh pipeline, rebuilt with CreateMeshPipeline on replay
+struct FrameCapturePipeline
+{
+	uint32_t id;
+	uint32_t vertModule;
+	uint32_t fragModule;
+	uint32_t positionFormat;	// VertexPositionFormat
+	uint32_t attributeFormat;	// VertexAttributeFormat
+	float positionScale[3];
+	float positionOffset[3];
+	uint32_t quantizedPositions;
+	uint32_t depthMode;			// MeshDepthMode
+	uint32_t perInstanceTransforms;
+};
+
+// A descriptor set in the mesh pipelines' layout, binding 0 being the uniform buffer
+struct FrameCaptureUniformSet
+{
+	uint32_t id;
+	uint32_t buffer;
+	uint64_t range;
+};
+
+// Sets the viewport and scissor to the render area as well
+struct FrameCaptureRenderPass
+{
+	uint32_t width;
+	uint32_t height;
+	float clearColor[4];
+	float clearDepth;
+	uint32_t reserved;
+};
+
+struct FrameCaptureClearRect
+{
+	int32_t x;
+	int32_t y;
+	uint32_t width;
+	uint32_t height;
+	float color[4];
+};
+
+struct FrameCaptureVertexBuffer
+{
+	uint32_t binding;
+	uint32_t buffer;
+	uint64_t offset;
+};
+
+struct FrameCaptureIndexBuffer
+{
+	uint32_t buffer;
+	uint32_t indexType;		// VkIndexType
+	uint64_t offset;
+};
+
+struct FrameCaptureDraw
+{
+	uint32_t indexCount;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t firstInstance;
+};
+
+static_assert(sizeof(FrameCaptureHeader) == 24, "FrameCaptureHeader layout changed");
+static_assert(sizeof(FrameCaptureBuffer) == 24, "FrameCaptureBuffer layout changed");
+static_assert(sizeof(FrameCapturePipeline) == 56, "FrameCapturePipeline layout changed");
+static_assert(sizeof(FrameCaptureRenderPass) == 32, "FrameCaptureRenderPass layout changed");
+static_assert(sizeof(FrameCaptureDraw) == 20, "FrameCaptureDraw layout changed");
@@ -0,0 +1,459 @@
+#include "frame_readback.h"
+
+#include <cstring>
+
+#include "logger.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static const char* readbackFormatNames[] = { "raw", "y4m" };
+
+bool ParseReadbackFormat(const char* name, ReadbackFormat* format)
+{
+	for (int i = 0; i < (int)(sizeof(readbackFormatNames) / sizeof(readbackFormatNames[0])); ++i)
+	{
+		if (strcmp(name, readbackFormatNames[i]) == 0)
+		{
+			*format = (ReadbackFormat)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+FrameReadback::FrameReadback()
+	: device(VK_NULL_HANDLE)
+	, output(NULL)
+	, width(0)
+	, height(0)
+	, format(ReadbackFormat_Raw)
+	, swapRedBlue(false)
+	, stallCount(0)
+	, stopping(false)
+	, failed(false)
+	, framesWritten(0)
+	, bytesWritten(0)
+{
+}
+
+FrameReadback::~FrameReadback()
+{
+	Destroy();
+}
+
+bool FrameReadback::Open(const char* path)
+{
+	if (strcmp(path, "-") != 0)
+	{
+		output = fopen(path, "wb");
+		return output != NULL;
+	}
+
+	// Frames go to a duplicate of stdout and stdout itself is pointed at stderr, which keeps both
+	// std::cout and the logger out of the stream
+	fflush(stdout);
+
+#ifdef _WIN32
+	int frameDescriptor = _dup(_fileno(stdout));
+
+	if (frameDescriptor < 0 || _dup2(_fileno(stderr), _fileno(stdout)) != 0)
+	{
+		return false;
+	}
+
+	_setmode(frameDescriptor, _O_BINARY);
+	output = _fdopen(frameDescriptor, "wb");
+#else
+	int frameDescriptor = dup(STDOUT_FILENO);
+
+	if (frameDescriptor < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+	{
+		return false;
+	}
+
+	output = fdopen(frameDescriptor, "wb");
+#endif
+
+	return output != NULL;
+}
+
+bool FrameReadback::Create(VkDevice device, const VkMemoryType* memoryTypes, VkFormat imageFormat, uint32_t width, uint32_t height, uint32_t slotCount, ReadbackFormat format, uint32_t framesPerSecond)
+{
+	if (output == NULL || IsFormatSupported(imageFormat) == false || slotCount == 0)
+	{
+		return false;
+	}
+
+	this->device = device;
+	this->width = width;
+	this->height = height;
+	this->format = format;
+	swapRedBlue = imageFormat == VK_FORMAT_B8G8R8A8_UNORM || imageFormat == VK_FORMAT_B8G8R8A8_SRGB;
+
+	VkDeviceSize frameSize = (VkDeviceSize)width * height * 4;
+
+	slots.resize(slotCount);
+
+	for (uint32_t i = 0; i < slotCount; ++i)
+	{
+		Slot& slot = slots[i];
+		memset(&slot, 0, sizeof(slot));
+
+		VkBufferCreateInfo bufferCreateInfo;
+		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferCreateInfo.pNext = NULL;
+		bufferCreateInfo.flags = 0;
+		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferCreateInfo.size = frameSize;
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		bufferCreateInfo.queueFamilyIndexCount = 0;
+		bufferCreateInfo.pQueueFamilyIndices = NULL;
+
+		if (vkCreateBuffer(device, &bufferCreateInfo, NULL, &slot.buffer) != VK_SUCCESS)
+		{
+			slot.buffer = VK_NULL_HANDLE;
+			return false;
+		}
+
+		VkMemoryRequirements memoryRequirements;
+		vkGetBufferMemoryRequirements(device, slot.buffer, &memoryRequirements);
+
+		// The writer reads every byte, which is slow from uncached memory
+		if (CreateDeviceMemory(device, memoryTypes, &memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, (size_t)memoryRequirements.size, &slot.memory) == false
+			&& CreateDeviceMemory(device, memoryTypes, &memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, (size_t)memoryRequirements.size, &slot.memory) == false)
+		{
+			slot.memory = VK_NULL_HANDLE;
+			return false;
+		}
+
+		void* mapped;
+
+		if (vkBindBufferMemory(device, slot.buffer, slot.memory, 0) != VK_SUCCESS
+			|| vkMapMemory(device, slot.memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+		{
+			return false;
+		}
+
+		slot.mapped = (const unsigned char*)mapped;
+		freeSlots.push_back(i);
+	}
+
+	if (format == ReadbackFormat_Y4m && fprintf(output, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", width, height, framesPerSecond) < 0)
+	{
+		return false;
+	}
+
+	stopping = false;
+	failed = false;
+	writerThread = std::thread(&FrameReadback::WriterThread, this);
+
+	return true;
+}
+
+void FrameReadback::Destroy()
+{
+	if (writerThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			// The device is idle, so every copy has landed
+			writeQueue.insert(writeQueue.end(), copyingSlots.begin(), copyingSlots.end());
+			stopping = true;
+		}
+
+		copyingSlots.clear();
+		frameReady.notify_one();
+		writerThread.join();
+	}
+
+	if (output != NULL)
+	{
+		if (fclose(output) != 0 && failed == false)
+		{
+			Log(LogSeverity_Warning, "Couldn't finish writing read back frames");
+		}
+
+		output = NULL;
+	}
+
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	// Mappings go with the memory
+	for (size_t i = 0; i < slots.size(); ++i)
+	{
+		vkDestroyBuffer(device, slots[i].buffer, NULL);
+		vkFreeMemory(device, slots[i].memory, NULL);
+	}
+
+	slots.clear();
+	copyingSlots.clear();
+	freeSlots.clear();
+	writeQueue.clear();
+	device = VK_NULL_HANDLE;
+}
+
+bool FrameReadback::IsFormatSupported(VkFormat format)
+{
+	return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB
+		|| format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+}
+
+void FrameReadback::Poll(uint64_t completedFrameIndex)
+{
+	if (copyingSlots.empty() || slots[copyingSlots.front()].frameIndex > completedFrameIndex)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// Frames complete in order, so the oldest copies are the ones that have landed
+		while (copyingSlots.empty() == false && slots[copyingSlots.front()].frameIndex <= completedFrameIndex)
+		{
+			writeQueue.push_back(copyingSlots.front());
+			copyingSlots.pop_front();
+		}
+	}
+
+	frameReady.notify_one();
+}
+
+bool FrameReadback::Record(VkCommandBuffer commandBuffer, VkImage image, uint64_t frameIndex)
+{
+	uint32_t slotIndex;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		if (freeSlots.empty())
+		{
+			// Waiting only helps if the writer holds a buffer, ones still being copied into are freed by Poll
+			if (copyingSlots.size() == slots.size())
+			{
+				return false;
+			}
+
+			++stallCount;
+			slotFreed.wait(lock, [this] { return freeSlots.empty() == false; });
+		}
+
+		slotIndex = freeSlots.back();
+		freeSlots.pop_back();
+	}
+
+	Slot& slot = slots[slotIndex];
+	slot.frameIndex = frameIndex;
+	copyingSlots.push_back(slotIndex);
+
+	VkImageMemoryBarrier imageBarrier;
+	imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imageBarrier.pNext = NULL;
+	imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.image = image;
+	imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &imageBarrier);
+
+	VkBufferImageCopy copy;
+	copy.bufferOffset = 0;
+	copy.bufferRowLength = 0;
+	copy.bufferImageHeight = 0;
+	copy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	copy.imageOffset = { 0, 0, 0 };
+	copy.imageExtent = { width, height, 1 };
+	vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &copy);
+
+	VkBufferMemoryBarrier bufferBarrier;
+	bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	bufferBarrier.pNext = NULL;
+	bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferBarrier.buffer = slot.buffer;
+	bufferBarrier.offset = 0;
+	bufferBarrier.size = VK_WHOLE_SIZE;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, NULL, 1, &bufferBarrier, 0, NULL);
+
+	return true;
+}
+
+uint64_t FrameReadback::GetFramesWritten() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return framesWritten;
+}
+
+uint64_t FrameReadback::GetBytesWritten() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return bytesWritten;
+}
+
+uint32_t FrameReadback::GetStallCount() const
+{
+	return stallCount;
+}
+
+void FrameReadback::WriterThread()
+{
+	for (;;)
+	{
+		uint32_t slotIndex;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			frameReady.wait(lock, [this] { return writeQueue.empty() == false || stopping; });
+
+			// Stopping only once the queue has drained
+			if (writeQueue.empty())
+			{
+				return;
+			}
+
+			slotIndex = writeQueue.front();
+			writeQueue.pop_front();
+		}
+
+		const Slot& slot = slots[slotIndex];
+
+		VkMappedMemoryRange range;
+		range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range.pNext = NULL;
+		range.memory = slot.memory;
+		range.offset = 0;
+		range.size = VK_WHOLE_SIZE;
+		vkInvalidateMappedMemoryRanges(device, 1, &range);
+
+		// After a failed write the stream is broken, later frames are dropped
+		bool written = failed == false && WriteFrame(slot.mapped);
+
+		if (failed == false && written == false)
+		{
+			Log(LogSeverity_Warning, "Couldn't write a read back frame, the rest are dropped");
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			failed = failed || written == false;
+			framesWritten += written ? 1 : 0;
+			freeSlots.push_back(slotIndex);
+		}
+
+		slotFreed.notify_one();
+	}
+}
+
+bool FrameReadback::WriteFrame(const unsigned char* pixels)
+{
+	return format == ReadbackFormat_Y4m ? WriteY4m(pixels) : WriteRaw(pixels);
+}
+
+bool FrameReadback::WriteRaw(const unsigned char* pixels)
+{
+	size_t frameSize = (size_t)width * height * 4;
+
+	if (swapRedBlue)
+	{
+		converted.resize(frameSize);
+
+		for (size_t i = 0; i < frameSize; i += 4)
+		{
+			converted[i] = pixels[i + 2];
+			converted[i + 1] = pixels[i + 1];
+			converted[i + 2] = pixels[i];
+			converted[i + 3] = pixels[i + 3];
+		}
+
+		pixels = converted.data();
+	}
+
+	if (fwrite(pixels, 1, frameSize, output) != frameSize)
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	bytesWritten += frameSize;
+	return true;
+}
+
+bool FrameReadback::WriteY4m(const unsigned char* pixels)
+{
+	uint32_t chromaWidth = (width + 1) / 2;
+	uint32_t chromaHeight = (height + 1) / 2;
+	size_t lumaSize = (size_t)width * height;
+	size_t chromaSize = (size_t)chromaWidth * chromaHeight;
+
+	converted.resize(lumaSize + chromaSize * 2);
+	unsigned char* luma = converted.data();
+	unsigned char* blueDifference = luma + lumaSize;
+	unsigned char* redDifference = blueDifference + chromaSize;
+
+	uint32_t red = swapRedBlue ? 2 : 0;
+	uint32_t blue = swapRedBlue ? 0 : 2;
+
+	// BT.601 limited range in 8 bit fixed point, offsets folded in so the shifts stay unsigned
+	for (size_t i = 0; i < lumaSize; ++i)
+	{
+		const unsigned char* pixel = pixels + i * 4;
+		luma[i] = (unsigned char)((66 * pixel[red] + 129 * pixel[1] + 25 * pixel[blue] + 4224) >> 8);
+	}
+
+	// Chroma from the average of each 2x2 block, clamped at odd edges
+	for (uint32_t y = 0; y < chromaHeight; ++y)
+	{
+		uint32_t rows[2] = { y * 2, y * 2 + 1 < height ? y * 2 + 1 : y * 2 };
+
+		for (uint32_t x = 0; x < chromaWidth; ++x)
+		{
+			uint32_t columns[2] = { x * 2, x * 2 + 1 < width ? x * 2 + 1 : x * 2 };
+			int32_t sums[3] = { 0, 0, 0 };
+
+			for (uint32_t row = 0; row < 2; ++row)
+			{
+				for (uint32_t column = 0; column < 2; ++column)
+				{
+					const unsigned char* pixel = pixels + ((size_t)rows[row] * width + columns[column]) * 4;
+					sums[0] += pixel[red];
+					sums[1] += pixel[1];
+					sums[2] += pixel[blue];
+				}
+			}
+
+			int32_t r = (sums[0] + 2) >> 2;
+			int32_t g = (sums[1] + 2) >> 2;
+			int32_t b = (sums[2] + 2) >> 2;
+
+			blueDifference[(size_t)y * chromaWidth + x] = (unsigned char)((112 * b - 38 * r - 74 * g + 32896) >> 8);
+			redDifference[(size_t)y * chromaWidth + x] = (unsigned char)((112 * r - 94 * g - 18 * b + 32896) >> 8);
+		}
+	}
+
+	static const char frameHeader[] = "FRAME\n";
+	size_t headerSize = sizeof(frameHeader) - 1;
+
+	if (fwrite(frameHeader, 1, headerSize, output) != headerSize || fwrite(converted.data(), 1, converted.size(), output) != converted.size())
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	bytesWritten += headerSize + converted.size();
+	return true;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "vulkan_helpers.h"
+
+// Layout of the frames FrameReadback writes
+enum ReadbackFormat
+{
+	ReadbackFormat_Raw = 0,		// Tightly packed RGBA8 frames back to back, no header
+	ReadbackFormat_Y4m = 1,		// YUV4MPEG2 stream of 4:2:0 frames, BT.601 limited range
+};
+
+// Parses raw or y4m
+bool ParseReadbackFormat(const char* name, ReadbackFormat* format);
+
+// Streams finished frames out of the process without stalling the frame loop.
+//
+// Record copies an image into one of a ring of host visible buffers. Once the frame that copied it
+// has completed, which the caller learns from fences it polls without waiting, Poll hands the buffer
+// to a writer thread that converts it and writes it to a file or stdout, then returns it to the ring.
+// Frames are written in the order they were recorded. Record only waits when every buffer is still
+// queued for the writer, that is when writing can't keep up with rendering.
+class FrameReadback
+{
+public:
+	FrameReadback();
+	~FrameReadback();
+
+	// Opens path for writing, "-" being stdout. Console output then moves to stderr so stdout carries
+	// nothing but frames, so call this before anything is printed.
+	bool Open(const char* path);
+
+	// width and height are those of the images recorded, in an 8 bit RGBA or BGRA format.
+	// slotCount must be at least the number of frames in flight.
+	bool Create(VkDevice device, const VkMemoryType* memoryTypes, VkFormat imageFormat, uint32_t width, uint32_t height, uint32_t slotCount, ReadbackFormat format, uint32_t framesPerSecond);
+
+	// The device must be idle. Frames recorded so far are written before the writer stops.
+	void Destroy();
+
+	static bool IsFormatSupported(VkFormat format);
+
+	// Hands copies made by frames up to completedFrameIndex to the writer
+	void Poll(uint64_t completedFrameIndex);
+
+	// Copies image into a free buffer. Recorded after the image's last transfer write, with the image
+	// in TRANSFER_DST_OPTIMAL, and leaves it in TRANSFER_SRC_OPTIMAL.
+	bool Record(VkCommandBuffer commandBuffer, VkImage image, uint64_t frameIndex);
+
+	uint64_t GetFramesWritten() const;
+	uint64_t GetBytesWritten() const;
+
+	// Records that had to wait for the writer to free a buffer
+	uint32_t GetStallCount() const;
+
+private:
+	struct Slot
+	{
+		VkBuffer buffer;
+		VkDeviceMemory memory;
+		const unsigned char* mapped;
+		uint64_t frameIndex;
+	};
+
+	void WriterThread();
+	bool WriteFrame(const unsigned char* pixels);
+	bool WriteRaw(const unsigned char* pixels);
+	bool WriteY4m(const unsigned char* pixels);
+
+	VkDevice device;
+	FILE* output;
+	uint32_t width;
+	uint32_t height;
+	ReadbackFormat format;
+	bool swapRedBlue;
+
+	std::vector<Slot> slots;
+	std::deque<uint32_t> copyingSlots;		// Recorded, waiting for their frame to complete
+	uint32_t stallCount;
+
+	std::thread writerThread;
+	mutable std::mutex mutex;
+	std::condition_variable frameReady;
+	std::condition_variable slotFreed;
+	std::vector<uint32_t> freeSlots;
+	std::deque<uint32_t> writeQueue;
+	bool stopping;
+	bool failed;
+	uint64_t framesWritten;
+	uint64_t bytesWritten;
+
+	// Only touched by the writer thread
+	std::vector<unsigned char> converted;
+};
@@ -0,0 +1,460 @@
+#include "frustum_culling.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FRUSTUM_CULLING_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define FRUSTUM_CULLING_AVX2 0
+#endif
+
+// MSVC compiles AVX2 intrinsics anywhere, GCC and Clang only in functions targeting it
+#if FRUSTUM_CULLING_AVX2 && !defined(_MSC_VER)
+#define AVX2_FUNCTION __attribute__((target("avx2,fma")))
+#else
+#define AVX2_FUNCTION
+#endif
+
+static const uint32_t GroupSize = 8;
+
+FrustumPlanes ExtractFrustumPlanes(const float viewProjection[16])
+{
+	// Rows of the matrix, clip = M * position
+	float rows[4][4];
+
+	for (int row = 0; row < 4; ++row)
+	{
+		for (int column = 0; column < 4; ++column)
+		{
+			rows[row][column] = viewProjection[column * 4 + row];
+		}
+	}
+
+	// -w <= x <= w, -w <= y <= w, 0 <= z <= w
+	float planes[6][4];
+
+	for (int i = 0; i < 4; ++i)
+	{
+		planes[0][i] = rows[3][i] + rows[0][i];
+		planes[1][i] = rows[3][i] - rows[0][i];
+		planes[2][i] = rows[3][i] + rows[1][i];
+		planes[3][i] = rows[3][i] - rows[1][i];
+		planes[4][i] = rows[2][i];
+		planes[5][i] = rows[3][i] - rows[2][i];
+	}
+
+	FrustumPlanes result;
+
+	for (int plane = 0; plane < 6; ++plane)
+	{
+		float length = sqrtf(planes[plane][0] * planes[plane][0] + planes[plane][1] * planes[plane][1] + planes[plane][2] * planes[plane][2]);
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+
+		result.normalX[plane] = planes[plane][0] * scale;
+		result.normalY[plane] = planes[plane][1] * scale;
+		result.normalZ[plane] = planes[plane][2] * scale;
+		result.distance[plane] = planes[plane][3] * scale;
+	}
+
+	return result;
+}
+
+CullingVolumes::CullingVolumes()
+	: count(0)
+{
+}
+
+uint32_t CullingVolumes::Add()
+{
+	if (count % GroupSize == 0)
+	{
+		size_t size = count + GroupSize;
+		centerX.resize(size, 0.0f);
+		centerY.resize(size, 0.0f);
+		centerZ.resize(size, 0.0f);
+		radius.resize(size, 0.0f);
+		extentX.resize(size, 0.0f);
+		extentY.resize(size, 0.0f);
+		extentZ.resize(size, 0.0f);
+	}
+
+	return count++;
+}
+
+uint32_t CullingVolumes::AddSphere(const float center[3], float radius)
+{
+	uint32_t index = Add();
+	SetSphere(index, center, radius);
+	return index;
+}
+
+uint32_t CullingVolumes::AddBox(const float center[3], const float extent[3])
+{
+	uint32_t index = Add();
+	SetBox(index, center, extent);
+	return index;
+}
+
+void CullingVolumes::SetSphere(uint32_t index, const float center[3], float sphereRadius)
+{
+	centerX[index] = center[0];
+	centerY[index] = center[1];
+	centerZ[index] = center[2];
+	radius[index] = sphereRadius;
+	extentX[index] = sphereRadius;
+	extentY[index] = sphereRadius;
+	extentZ[index] = sphereRadius;
+}
+
+void CullingVolumes::SetBox(uint32_t index, const float center[3], const float extent[3])
+{
+	centerX[index] = center[0];
+	centerY[index] = center[1];
+	centerZ[index] = center[2];
+	radius[index] = sqrtf(extent[0] * extent[0] + extent[1] * extent[1] + extent[2] * extent[2]);
+	extentX[index] = extent[0];
+	extentY[index] = extent[1];
+	extentZ[index] = extent[2];
+}
+
+void CullingVolumes::Clear()
+{
+	count = 0;
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	radius.clear();
+	extentX.clear();
+	extentY.clear();
+	extentZ.clear();
+}
+
+uint32_t CullingVolumes::GetCount() const
+{
+	return count;
+}
+
+struct VolumeArrays
+{
+	const float* centerX;
+	const float* centerY;
+	const float* centerZ;
+	const float* radius;
+	const float* extentX;
+	const float* extentY;
+	const float* extentZ;
+};
+
+// An object is outside when its center is further behind any plane than the smaller of its
+// sphere radius and the box's projected half width on the plane normal
+static uint32_t CullRangeScalar(const VolumeArrays& volumes, const FrustumPlanes& planes, uint32_t begin, uint32_t end, uint32_t* output)
+{
+	uint32_t visibleCount = 0;
+
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		bool outside = false;
+
+		for (int plane = 0; plane < 6 && outside == false; ++plane)
+		{
+			float distance = planes.normalX[plane] * volumes.centerX[i] + planes.normalY[plane] * volumes.centerY[i] + planes.normalZ[plane] * volumes.centerZ[i] + planes.distance[plane];
+			float boxRadius = fabsf(planes.normalX[plane]) * volumes.extentX[i] + fabsf(planes.normalY[plane]) * volumes.extentY[i] + fabsf(planes.normalZ[plane]) * volumes.extentZ[i];
+			float radius = boxRadius < volumes.radius[i] ? boxRadius : volumes.radius[i];
+			outside = distance + radius < 0.0f;
+		}
+
+		output[visibleCount] = i;
+		visibleCount += outside ? 0 : 1;
+	}
+
+	return visibleCount;
+}
+
+#if FRUSTUM_CULLING_AVX2
+
+static bool CpuSupportsAvx2()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+
+	if (info[0] < 7)
+	{
+		return false;
+	}
+
+	__cpuid(info, 1);
+	bool fma = (info[2] & (1 << 12)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+
+	// The OS must save the upper halves of the YMM registers
+	if (fma == false || osxsave == false || avx == false || (_xgetbv(0) & 6) != 6)
+	{
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+AVX2_FUNCTION static uint32_t CullRangeAvx2(const VolumeArrays& volumes, const FrustumPlanes& planes, uint32_t begin, uint32_t end, uint32_t* output)
+{
+	__m256 normalX[6];
+	__m256 normalY[6];
+	__m256 normalZ[6];
+	__m256 absNormalX[6];
+	__m256 absNormalY[6];
+	__m256 absNormalZ[6];
+	__m256 distance[6];
+
+	for (int plane = 0; plane < 6; ++plane)
+	{
+		normalX[plane] = _mm256_set1_ps(planes.normalX[plane]);
+		normalY[plane] = _mm256_set1_ps(planes.normalY[plane]);
+		normalZ[plane] = _mm256_set1_ps(planes.normalZ[plane]);
+		absNormalX[plane] = _mm256_set1_ps(fabsf(planes.normalX[plane]));
+		absNormalY[plane] = _mm256_set1_ps(fabsf(planes.normalY[plane]));
+		absNormalZ[plane] = _mm256_set1_ps(fabsf(planes.normalZ[plane]));
+		distance[plane] = _mm256_set1_ps(planes.distance[plane]);
+	}
+
+	__m256 zero = _mm256_setzero_ps();
+	uint32_t visibleCount = 0;
+
+	// begin is a multiple of eight and the arrays are padded, so every group can be loaded whole
+	for (uint32_t i = begin; i < end; i += GroupSize)
+	{
+		__m256 centerX = _mm256_loadu_ps(volumes.centerX + i);
+		__m256 centerY = _mm256_loadu_ps(volumes.centerY + i);
+		__m256 centerZ = _mm256_loadu_ps(volumes.centerZ + i);
+		__m256 radius = _mm256_loadu_ps(volumes.radius + i);
+		__m256 extentX = _mm256_loadu_ps(volumes.extentX + i);
+		__m256 extentY = _mm256_loadu_ps(volumes.extentY + i);
+		__m256 extentZ = _mm256_loadu_ps(volumes.extentZ + i);
+
+		__m256 outside = zero;
+
+		for (int plane = 0; plane < 6; ++plane)
+		{
+			__m256 centerDistance = _mm256_fmadd_ps(normalX[plane], centerX, _mm256_fmadd_ps(normalY[plane], centerY, _mm256_fmadd_ps(normalZ[plane], centerZ, distance[plane])));
+			__m256 boxRadius = _mm256_fmadd_ps(absNormalX[plane], extentX, _mm256_fmadd_ps(absNormalY[plane], extentY, _mm256_mul_ps(absNormalZ[plane], extentZ)));
+			__m256 nearest = _mm256_add_ps(centerDistance, _mm256_min_ps(boxRadius, radius));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(nearest, zero, _CMP_LT_OQ));
+		}
+
+		uint32_t visibleMask = ~(uint32_t)_mm256_movemask_ps(outside) & 0xff;
+
+		if (end - i < GroupSize)
+		{
+			visibleMask &= (1u << (end - i)) - 1;
+		}
+
+		// Branch free compaction, every lane is written and only visible ones advance
+		for (uint32_t lane = 0; lane < GroupSize; ++lane)
+		{
+			output[visibleCount] = i + lane;
+			visibleCount += (visibleMask >> lane) & 1;
+		}
+	}
+
+	return visibleCount;
+}
+
+#endif
+
+FrustumCuller::FrustumCuller()
+	: useSimd(false)
+	, volumes(NULL)
+	, planes(NULL)
+	, output(NULL)
+	, jobGeneration(0)
+	, workersBusy(0)
+	, stopping(false)
+{
+}
+
+FrustumCuller::~FrustumCuller()
+{
+	Stop();
+}
+
+void FrustumCuller::Start(uint32_t threadCount, bool allowSimd)
+{
+	Stop();
+
+#if FRUSTUM_CULLING_AVX2
+	useSimd = allowSimd && CpuSupportsAvx2();
+#else
+	useSimd = false;
+#endif
+
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+	}
+
+	stopping = false;
+
+	for (uint32_t i = 1; i < threadCount; ++i)
+	{
+		workers.push_back(std::thread(&FrustumCuller::WorkerThread, this, i, jobGeneration));
+	}
+}
+
+void FrustumCuller::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	jobAvailable.notify_all();
+
+	for (size_t i = 0; i < workers.size(); ++i)
+	{
+		workers[i].join();
+	}
+
+	workers.clear();
+}
+
+void FrustumCuller::Cull(const CullingVolumes& volumes, const FrustumPlanes& planes, std::vector<uint32_t>* visible)
+{
+	uint32_t count = volumes.GetCount();
+
+	// Room for the last group's lanes, compaction writes all eight before counting
+	visible->resize(((count + GroupSize - 1) / GroupSize) * GroupSize);
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	uint32_t threadCount = count / MinObjectsPerThread;
+	threadCount = threadCount < 1 ? 1 : threadCount > GetThreadCount() ? GetThreadCount() : threadCount;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		this->volumes = &volumes;
+		this->planes = &planes;
+		output = visible->data();
+
+		// Whole groups per thread, so no two threads touch the same eight entries
+		uint32_t groupCount = (count + GroupSize - 1) / GroupSize;
+		ranges.resize(threadCount);
+
+		for (uint32_t i = 0; i < threadCount; ++i)
+		{
+			ranges[i].begin = (uint32_t)((uint64_t)groupCount * i / threadCount) * GroupSize;
+			ranges[i].end = (uint32_t)((uint64_t)groupCount * (i + 1) / threadCount) * GroupSize;
+			ranges[i].end = ranges[i].end < count ? ranges[i].end : count;
+			ranges[i].visibleCount = 0;
+		}
+
+		workersBusy = threadCount - 1;
+		++jobGeneration;
+	}
+
+	if (threadCount > 1)
+	{
+		jobAvailable.notify_all();
+	}
+
+	CullRange(ranges[0]);
+
+	if (threadCount > 1)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		jobDone.wait(lock, [this] { return workersBusy == 0; });
+	}
+
+	uint32_t visibleCount = ranges[0].visibleCount;
+
+	for (uint32_t i = 1; i < threadCount; ++i)
+	{
+		memmove(output + visibleCount, output + ranges[i].begin, ranges[i].visibleCount * sizeof(uint32_t));
+		visibleCount += ranges[i].visibleCount;
+	}
+
+	visible->resize(visibleCount);
+}
+
+bool FrustumCuller::UsesSimd() const
+{
+	return useSimd;
+}
+
+uint32_t FrustumCuller::GetThreadCount() const
+{
+	return (uint32_t)workers.size() + 1;
+}
+
+void FrustumCuller::CullRange(Range& range)
+{
+	VolumeArrays arrays;
+	arrays.centerX = volumes->centerX.data();
+	arrays.centerY = volumes->centerY.data();
+	arrays.centerZ = volumes->centerZ.data();
+	arrays.radius = volumes->radius.data();
+	arrays.extentX = volumes->extentX.data();
+	arrays.extentY = volumes->extentY.data();
+	arrays.extentZ = volumes->extentZ.data();
+
+#if FRUSTUM_CULLING_AVX2
+	if (useSimd)
+	{
+		range.visibleCount = CullRangeAvx2(arrays, *planes, range.begin, range.end, output + range.begin);
+		return;
+	}
+#endif
+
+	range.visibleCount = CullRangeScalar(arrays, *planes, range.begin, range.end, output + range.begin);
+}
+
+void FrustumCuller::WorkerThread(uint32_t rangeIndex, uint64_t generation)
+{
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [this, generation] { return stopping || jobGeneration != generation; });
+
+			if (stopping)
+			{
+				return;
+			}
+
+			generation = jobGeneration;
+
+			// Small jobs don't use every thread
+			if (rangeIndex >= ranges.size())
+			{
+				continue;
+			}
+		}
+
+		CullRange(ranges[rangeIndex]);
+
+		bool last;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			last = --workersBusy == 0;
+		}
+
+		if (last)
+		{
+			jobDone.notify_one();
+		}
+	}
+}
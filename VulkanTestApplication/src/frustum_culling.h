@@ -0,0 +1,108 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Six planes facing into the frustum, normalised so distances are in world units.
+// Order is left, right, bottom, top, near, far.
+struct FrustumPlanes
+{
+	float normalX[6];
+	float normalY[6];
+	float normalZ[6];
+	float distance[6];
+};
+
+// Planes of a column major view projection with Vulkan's [0, 1] depth range
+FrustumPlanes ExtractFrustumPlanes(const float viewProjection[16]);
+
+// Bounding volumes stored as structure of arrays, so eight objects load with one vector read
+// per component. Every object has a sphere and a box sharing its center, and is tested against
+// whichever is tighter for each plane. Spheres added alone get the box enclosing them, boxes
+// the sphere enclosing them.
+class CullingVolumes
+{
+public:
+	CullingVolumes();
+
+	// Index of the new object
+	uint32_t AddSphere(const float center[3], float radius);
+	uint32_t AddBox(const float center[3], const float extent[3]);
+
+	void SetSphere(uint32_t index, const float center[3], float radius);
+	void SetBox(uint32_t index, const float center[3], const float extent[3]);
+
+	void Clear();
+	uint32_t GetCount() const;
+
+private:
+	friend class FrustumCuller;
+
+	uint32_t Add();
+
+	uint32_t count;
+
+	// Padded to a multiple of eight with volumes that are never reported
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radius;
+	std::vector<float> extentX;
+	std::vector<float> extentY;
+	std::vector<float> extentZ;
+};
+
+// Tests volumes against a frustum, eight at a time with AVX2 and FMA when the CPU has them,
+// split across a pool of worker threads. Each thread compacts its visible indices in place and
+// the ranges are joined afterwards, so the result is in ascending order.
+class FrustumCuller
+{
+public:
+	// Fewer objects than this are culled on the calling thread alone
+	static const uint32_t MinObjectsPerThread = 16384;
+
+	FrustumCuller();
+	~FrustumCuller();
+
+	// threadCount 0 uses every hardware thread. allowSimd false forces the scalar path, for comparison.
+	void Start(uint32_t threadCount, bool allowSimd);
+	void Stop();
+
+	// Replaces visible with the indices of volumes at least partly inside planes
+	void Cull(const CullingVolumes& volumes, const FrustumPlanes& planes, std::vector<uint32_t>* visible);
+
+	bool UsesSimd() const;
+
+	// Including the calling thread
+	uint32_t GetThreadCount() const;
+
+private:
+	struct Range
+	{
+		uint32_t begin;
+		uint32_t end;
+		uint32_t visibleCount;
+	};
+
+	void CullRange(Range& range);
+	void WorkerThread(uint32_t rangeIndex, uint64_t generation);
+
+	bool useSimd;
+	std::vector<std::thread> workers;
+
+	// Current job, written by Cull before waking the workers
+	const CullingVolumes* volumes;
+	const FrustumPlanes* planes;
+	uint32_t* output;
+	std::vector<Range> ranges;
+
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::condition_variable jobDone;
+	uint64_t jobGeneration;
+	uint32_t workersBusy;
+	bool stopping;
+};
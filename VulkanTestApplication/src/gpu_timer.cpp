@@ -0,0 +1,112 @@
+#include "gpu_timer.h"
+
+GpuTimer::GpuTimer()
+	: device(VK_NULL_HANDLE)
+	, queryPool(VK_NULL_HANDLE)
+	, timestampPeriod(1.0f)
+	, timestampMask(0)
+{
+}
+
+GpuTimer::~GpuTimer()
+{
+}
+
+bool GpuTimer::Create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t frameCount)
+{
+	this->device = device;
+	queryPool = VK_NULL_HANDLE;
+	recorded.assign(frameCount, false);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, NULL);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	uint32_t validBits = queueFamilyIndex < queueFamilyCount ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+
+	if (validBits == 0 || properties.limits.timestampPeriod == 0.0f)
+	{
+		return true;
+	}
+
+	timestampPeriod = properties.limits.timestampPeriod;
+	timestampMask = validBits >= 64 ? ~(uint64_t)0 : (((uint64_t)1 << validBits) - 1);
+
+	VkQueryPoolCreateInfo queryPoolCreateInfo;
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.pNext = NULL;
+	queryPoolCreateInfo.flags = 0;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = frameCount * 2;
+	queryPoolCreateInfo.pipelineStatistics = 0;
+
+	if (vkCreateQueryPool(device, &queryPoolCreateInfo, NULL, &queryPool) != VK_SUCCESS)
+	{
+		queryPool = VK_NULL_HANDLE;
+		return false;
+	}
+
+	return true;
+}
+
+void GpuTimer::Destroy()
+{
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(device, queryPool, NULL);
+		queryPool = VK_NULL_HANDLE;
+	}
+
+	recorded.clear();
+	device = VK_NULL_HANDLE;
+}
+
+bool GpuTimer::IsSupported() const
+{
+	return queryPool != VK_NULL_HANDLE;
+}
+
+void GpuTimer::Begin(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+	if (queryPool == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkCmdResetQueryPool(commandBuffer, queryPool, frame * 2, 2);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, frame * 2);
+}
+
+void GpuTimer::End(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+	if (queryPool == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, frame * 2 + 1);
+	recorded[frame] = true;
+}
+
+bool GpuTimer::GetElapsed(uint32_t frame, float* milliseconds)
+{
+	if (queryPool == VK_NULL_HANDLE || recorded[frame] == false)
+	{
+		return false;
+	}
+
+	uint64_t timestamps[2];
+
+	if (vkGetQueryPoolResults(device, queryPool, frame * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	uint64_t ticks = (timestamps[1] - timestamps[0]) & timestampMask;
+	*milliseconds = (float)((double)ticks * timestampPeriod / 1000000.0);
+	return true;
+}
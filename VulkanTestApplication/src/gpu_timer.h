@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+#include "vulkan_helpers.h"
+
+// GPU time of a span of each frame, measured with a pair of timestamp queries per frame in
+// flight. Results are read without waiting once the frame's fence has signalled, so they lag
+// the CPU by the number of frames in flight.
+class GpuTimer
+{
+public:
+	GpuTimer();
+	~GpuTimer();
+
+	// Succeeds without timing when the queue family has no timestamp support, check IsSupported
+	bool Create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t frameCount);
+	void Destroy();
+
+	bool IsSupported() const;
+
+	// Begin resets the frame's queries and must be recorded outside a render pass
+	void Begin(VkCommandBuffer commandBuffer, uint32_t frame);
+	void End(VkCommandBuffer commandBuffer, uint32_t frame);
+
+	// Milliseconds between Begin and End the last time frame was recorded. False if it hasn't
+	// been recorded yet or the results aren't available.
+	bool GetElapsed(uint32_t frame, float* milliseconds);
+
+private:
+	VkDevice device;
+	VkQueryPool queryPool;
+	float timestampPeriod;		// Nanoseconds per tick
+	uint64_t timestampMask;
+	std::vector<bool> recorded;
+};
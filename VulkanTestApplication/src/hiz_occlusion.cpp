@@ -0,0 +1,699 @@
+#include "hiz_occlusion.h"
+
+#include <cstring>
+
+#include "hiz_reduce.comp.h"
+#include "hiz_cull.comp.h"
+
+// Workgroup sizes of hiz_reduce.comp and hiz_cull.comp
+static const uint32_t ReduceGroupSize = 8;
+static const uint32_t CullGroupSize = 64;
+
+struct ReduceConstants
+{
+	int32_t sourceSize[2];
+	int32_t destinationSize[2];
+};
+
+struct CullConstants
+{
+	float viewProjection[16];
+	float sceneSize[2];
+	uint32_t objectCount;
+	uint32_t levelCount;
+};
+
+static uint32_t HalfRoundedUp(uint32_t size)
+{
+	return (size + 1) / 2;
+}
+
+HiZOcclusion::HiZOcclusion()
+	: device(VK_NULL_HANDLE)
+	, width(0)
+	, height(0)
+	, levelCount(0)
+	, maxObjects(0)
+	, pyramidImage(VK_NULL_HANDLE)
+	, pyramidMemory(VK_NULL_HANDLE)
+	, pyramidView(VK_NULL_HANDLE)
+	, sampler(VK_NULL_HANDLE)
+	, reduceSetLayout(VK_NULL_HANDLE)
+	, cullSetLayout(VK_NULL_HANDLE)
+	, descriptorPool(VK_NULL_HANDLE)
+	, reduceModule(VK_NULL_HANDLE)
+	, cullModule(VK_NULL_HANDLE)
+	, reduceLayout(VK_NULL_HANDLE)
+	, cullLayout(VK_NULL_HANDLE)
+	, reducePipeline(VK_NULL_HANDLE)
+	, cullPipeline(VK_NULL_HANDLE)
+{
+}
+
+HiZOcclusion::~HiZOcclusion()
+{
+}
+
+bool HiZOcclusion::Create(VkDevice device, const VkMemoryType* memoryTypes, VkImageView depthView, uint32_t width, uint32_t height, uint32_t maxObjects, uint32_t frameCount)
+{
+	this->device = device;
+	this->width = width;
+	this->height = height;
+	this->maxObjects = maxObjects > 0 ? maxObjects : 1;
+
+	// Level 0 is half the depth buffer, down to 1x1
+	uint32_t levelWidth = HalfRoundedUp(width);
+	uint32_t levelHeight = HalfRoundedUp(height);
+	uint32_t largest = levelWidth > levelHeight ? levelWidth : levelHeight;
+	levelCount = 1;
+
+	while (largest > 1)
+	{
+		largest = HalfRoundedUp(largest);
+		++levelCount;
+	}
+
+	VkImageCreateInfo imageCreateInfo;
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.pNext = NULL;
+	imageCreateInfo.flags = 0;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format = VK_FORMAT_R32_SFLOAT;
+	imageCreateInfo.extent = { levelWidth, levelHeight, 1 };
+	imageCreateInfo.mipLevels = levelCount;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.queueFamilyIndexCount = 0;
+	imageCreateInfo.pQueueFamilyIndices = NULL;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(device, &imageCreateInfo, NULL, &pyramidImage) != VK_SUCCESS)
+	{
+		pyramidImage = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, pyramidImage, &memoryRequirements);
+
+	if (CreateDeviceMemory(device, memoryTypes, &memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, (size_t)memoryRequirements.size, &pyramidMemory) == false)
+	{
+		pyramidMemory = VK_NULL_HANDLE;
+		return false;
+	}
+
+	if (vkBindImageMemory(device, pyramidImage, pyramidMemory, 0) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkImageViewCreateInfo imageViewCreateInfo;
+	imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	imageViewCreateInfo.pNext = NULL;
+	imageViewCreateInfo.flags = 0;
+	imageViewCreateInfo.image = pyramidImage;
+	imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	imageViewCreateInfo.format = VK_FORMAT_R32_SFLOAT;
+	imageViewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+	imageViewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+
+	if (vkCreateImageView(device, &imageViewCreateInfo, NULL, &pyramidView) != VK_SUCCESS)
+	{
+		pyramidView = VK_NULL_HANDLE;
+		return false;
+	}
+
+	// Single level views for the reduction, storage images can't pick a level in the shader
+	levelViews.assign(levelCount, VK_NULL_HANDLE);
+
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		imageViewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+
+		if (vkCreateImageView(device, &imageViewCreateInfo, NULL, &levelViews[level]) != VK_SUCCESS)
+		{
+			levelViews[level] = VK_NULL_HANDLE;
+			return false;
+		}
+	}
+
+	// Only read with texelFetch, filtering doesn't apply
+	VkSamplerCreateInfo samplerCreateInfo;
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.pNext = NULL;
+	samplerCreateInfo.flags = 0;
+	samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.mipLodBias = 0.0f;
+	samplerCreateInfo.anisotropyEnable = VK_FALSE;
+	samplerCreateInfo.maxAnisotropy = 1.0f;
+	samplerCreateInfo.compareEnable = VK_FALSE;
+	samplerCreateInfo.compareOp = VK_COMPARE_OP_NEVER;
+	samplerCreateInfo.minLod = 0.0f;
+	samplerCreateInfo.maxLod = (float)levelCount;
+	samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+	samplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
+
+	if (vkCreateSampler(device, &samplerCreateInfo, NULL, &sampler) != VK_SUCCESS)
+	{
+		sampler = VK_NULL_HANDLE;
+		return false;
+	}
+
+	if (CreatePipelines() == false)
+	{
+		return false;
+	}
+
+	VkDescriptorPoolSize poolSizes[3];
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = levelCount + frameCount;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount = levelCount;
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[2].descriptorCount = frameCount * 2;
+
+	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo;
+	descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	descriptorPoolCreateInfo.pNext = NULL;
+	descriptorPoolCreateInfo.flags = 0;
+	descriptorPoolCreateInfo.maxSets = levelCount + frameCount;
+	descriptorPoolCreateInfo.poolSizeCount = 3;
+	descriptorPoolCreateInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, NULL, &descriptorPool) != VK_SUCCESS)
+	{
+		descriptorPool = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkDescriptorSetAllocateInfo descriptorSetAllocateInfo;
+	descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	descriptorSetAllocateInfo.pNext = NULL;
+	descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+	descriptorSetAllocateInfo.descriptorSetCount = 1;
+
+	// Level 0 reads the depth buffer, every other level the one below it
+	reduceSets.assign(levelCount, VK_NULL_HANDLE);
+
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		descriptorSetAllocateInfo.pSetLayouts = &reduceSetLayout;
+
+		if (vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, &reduceSets[level]) != VK_SUCCESS)
+		{
+			return false;
+		}
+
+		VkDescriptorImageInfo sourceInfo;
+		sourceInfo.sampler = sampler;
+		sourceInfo.imageView = level == 0 ? depthView : levelViews[level - 1];
+		sourceInfo.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+		VkDescriptorImageInfo destinationInfo;
+		destinationInfo.sampler = VK_NULL_HANDLE;
+		destinationInfo.imageView = levelViews[level];
+		destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		VkWriteDescriptorSet writes[2];
+		writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[0].pNext = NULL;
+		writes[0].dstSet = reduceSets[level];
+		writes[0].dstBinding = 0;
+		writes[0].dstArrayElement = 0;
+		writes[0].descriptorCount = 1;
+		writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writes[0].pImageInfo = &sourceInfo;
+		writes[0].pBufferInfo = NULL;
+		writes[0].pTexelBufferView = NULL;
+
+		writes[1] = writes[0];
+		writes[1].dstBinding = 1;
+		writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		writes[1].pImageInfo = &destinationInfo;
+
+		vkUpdateDescriptorSets(device, 2, writes, 0, NULL);
+	}
+
+	frames.resize(frameCount);
+
+	for (uint32_t i = 0; i < frameCount; ++i)
+	{
+		FrameData& frame = frames[i];
+		memset(&frame, 0, sizeof(frame));
+
+		VkDeviceSize objectSize = sizeof(OcclusionBounds) * this->maxObjects;
+		VkDeviceSize visibilitySize = sizeof(uint32_t) * this->maxObjects;
+
+		if (CreateBuffer(device, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, memoryTypes, NULL, (size_t)objectSize, &frame.objectBuffer, &frame.objectMemory) == false)
+		{
+			frame.objectBuffer = VK_NULL_HANDLE;
+			frame.objectMemory = VK_NULL_HANDLE;
+			return false;
+		}
+
+		if (CreateBuffer(device, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, memoryTypes, NULL, (size_t)visibilitySize, &frame.visibilityBuffer, &frame.visibilityMemory) == false)
+		{
+			frame.visibilityBuffer = VK_NULL_HANDLE;
+			frame.visibilityMemory = VK_NULL_HANDLE;
+			return false;
+		}
+
+		if (vkMapMemory(device, frame.objectMemory, 0, VK_WHOLE_SIZE, 0, (void**)&frame.mappedObjects) != VK_SUCCESS
+			|| vkMapMemory(device, frame.visibilityMemory, 0, VK_WHOLE_SIZE, 0, (void**)&frame.mappedVisibility) != VK_SUCCESS)
+		{
+			return false;
+		}
+
+		descriptorSetAllocateInfo.pSetLayouts = &cullSetLayout;
+
+		if (vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, &frame.cullSet) != VK_SUCCESS)
+		{
+			return false;
+		}
+
+		VkDescriptorImageInfo pyramidInfo;
+		pyramidInfo.sampler = sampler;
+		pyramidInfo.imageView = pyramidView;
+		pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		VkDescriptorBufferInfo bufferInfos[2];
+		bufferInfos[0].buffer = frame.objectBuffer;
+		bufferInfos[0].offset = 0;
+		bufferInfos[0].range = VK_WHOLE_SIZE;
+		bufferInfos[1].buffer = frame.visibilityBuffer;
+		bufferInfos[1].offset = 0;
+		bufferInfos[1].range = VK_WHOLE_SIZE;
+
+		VkWriteDescriptorSet writes[2];
+		writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[0].pNext = NULL;
+		writes[0].dstSet = frame.cullSet;
+		writes[0].dstBinding = 0;
+		writes[0].dstArrayElement = 0;
+		writes[0].descriptorCount = 1;
+		writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writes[0].pImageInfo = &pyramidInfo;
+		writes[0].pBufferInfo = NULL;
+		writes[0].pTexelBufferView = NULL;
+
+		writes[1] = writes[0];
+		writes[1].dstBinding = 1;
+		writes[1].descriptorCount = 2;
+		writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[1].pImageInfo = NULL;
+		writes[1].pBufferInfo = bufferInfos;
+
+		vkUpdateDescriptorSets(device, 2, writes, 0, NULL);
+	}
+
+	return true;
+}
+
+bool HiZOcclusion::CreatePipelines()
+{
+	if (CreateShaderModule(device, hiz_reduce_comp_spv, sizeof(hiz_reduce_comp_spv), &reduceModule) == false)
+	{
+		reduceModule = VK_NULL_HANDLE;
+		return false;
+	}
+
+	if (CreateShaderModule(device, hiz_cull_comp_spv, sizeof(hiz_cull_comp_spv), &cullModule) == false)
+	{
+		cullModule = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkDescriptorSetLayoutBinding bindings[3];
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[0].pImmutableSamplers = NULL;
+	bindings[1] = bindings[0];
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+
+	VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo;
+	setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutCreateInfo.pNext = NULL;
+	setLayoutCreateInfo.flags = 0;
+	setLayoutCreateInfo.bindingCount = 2;
+	setLayoutCreateInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, NULL, &reduceSetLayout) != VK_SUCCESS)
+	{
+		reduceSetLayout = VK_NULL_HANDLE;
+		return false;
+	}
+
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[2] = bindings[1];
+	bindings[2].binding = 2;
+	setLayoutCreateInfo.bindingCount = 3;
+
+	if (vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, NULL, &cullSetLayout) != VK_SUCCESS)
+	{
+		cullSetLayout = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkPushConstantRange pushConstantRange;
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(ReduceConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo;
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.pNext = NULL;
+	pipelineLayoutCreateInfo.flags = 0;
+	pipelineLayoutCreateInfo.setLayoutCount = 1;
+	pipelineLayoutCreateInfo.pSetLayouts = &reduceSetLayout;
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, NULL, &reduceLayout) != VK_SUCCESS)
+	{
+		reduceLayout = VK_NULL_HANDLE;
+		return false;
+	}
+
+	pushConstantRange.size = sizeof(CullConstants);
+	pipelineLayoutCreateInfo.pSetLayouts = &cullSetLayout;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, NULL, &cullLayout) != VK_SUCCESS)
+	{
+		cullLayout = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkComputePipelineCreateInfo pipelineCreateInfo;
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.pNext = NULL;
+	pipelineCreateInfo.flags = 0;
+	pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineCreateInfo.stage.pNext = NULL;
+	pipelineCreateInfo.stage.flags = 0;
+	pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineCreateInfo.stage.module = reduceModule;
+	pipelineCreateInfo.stage.pName = "main";
+	pipelineCreateInfo.stage.pSpecializationInfo = NULL;
+	pipelineCreateInfo.layout = reduceLayout;
+	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineCreateInfo.basePipelineIndex = 0;
+
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, NULL, &reducePipeline) != VK_SUCCESS)
+	{
+		reducePipeline = VK_NULL_HANDLE;
+		return false;
+	}
+
+	pipelineCreateInfo.stage.module = cullModule;
+	pipelineCreateInfo.layout = cullLayout;
+
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, NULL, &cullPipeline) != VK_SUCCESS)
+	{
+		cullPipeline = VK_NULL_HANDLE;
+		return false;
+	}
+
+	return true;
+}
+
+void HiZOcclusion::Destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < frames.size(); ++i)
+	{
+		FrameData& frame = frames[i];
+
+		if (frame.objectBuffer != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(device, frame.objectBuffer, NULL);
+		}
+
+		if (frame.objectMemory != VK_NULL_HANDLE)
+		{
+			vkFreeMemory(device, frame.objectMemory, NULL);
+		}
+
+		if (frame.visibilityBuffer != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(device, frame.visibilityBuffer, NULL);
+		}
+
+		if (frame.visibilityMemory != VK_NULL_HANDLE)
+		{
+			vkFreeMemory(device, frame.visibilityMemory, NULL);
+		}
+	}
+
+	frames.clear();
+
+	// Destroying the pool frees every set
+	if (descriptorPool != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(device, descriptorPool, NULL);
+		descriptorPool = VK_NULL_HANDLE;
+	}
+
+	reduceSets.clear();
+
+	if (reducePipeline != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline(device, reducePipeline, NULL);
+		reducePipeline = VK_NULL_HANDLE;
+	}
+
+	if (cullPipeline != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline(device, cullPipeline, NULL);
+		cullPipeline = VK_NULL_HANDLE;
+	}
+
+	if (reduceLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyPipelineLayout(device, reduceLayout, NULL);
+		reduceLayout = VK_NULL_HANDLE;
+	}
+
+	if (cullLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyPipelineLayout(device, cullLayout, NULL);
+		cullLayout = VK_NULL_HANDLE;
+	}
+
+	if (reduceSetLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorSetLayout(device, reduceSetLayout, NULL);
+		reduceSetLayout = VK_NULL_HANDLE;
+	}
+
+	if (cullSetLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorSetLayout(device, cullSetLayout, NULL);
+		cullSetLayout = VK_NULL_HANDLE;
+	}
+
+	if (reduceModule != VK_NULL_HANDLE)
+	{
+		vkDestroyShaderModule(device, reduceModule, NULL);
+		reduceModule = VK_NULL_HANDLE;
+	}
+
+	if (cullModule != VK_NULL_HANDLE)
+	{
+		vkDestroyShaderModule(device, cullModule, NULL);
+		cullModule = VK_NULL_HANDLE;
+	}
+
+	if (sampler != VK_NULL_HANDLE)
+	{
+		vkDestroySampler(device, sampler, NULL);
+		sampler = VK_NULL_HANDLE;
+	}
+
+	for (size_t i = 0; i < levelViews.size(); ++i)
+	{
+		if (levelViews[i] != VK_NULL_HANDLE)
+		{
+			vkDestroyImageView(device, levelViews[i], NULL);
+		}
+	}
+
+	levelViews.clear();
+
+	if (pyramidView != VK_NULL_HANDLE)
+	{
+		vkDestroyImageView(device, pyramidView, NULL);
+		pyramidView = VK_NULL_HANDLE;
+	}
+
+	if (pyramidImage != VK_NULL_HANDLE)
+	{
+		vkDestroyImage(device, pyramidImage, NULL);
+		pyramidImage = VK_NULL_HANDLE;
+	}
+
+	if (pyramidMemory != VK_NULL_HANDLE)
+	{
+		vkFreeMemory(device, pyramidMemory, NULL);
+		pyramidMemory = VK_NULL_HANDLE;
+	}
+
+	device = VK_NULL_HANDLE;
+}
+
+void HiZOcclusion::SetObjects(uint32_t frame, const OcclusionBounds* bounds, uint32_t count)
+{
+	FrameData& frameData = frames[frame];
+	frameData.objectCount = count < maxObjects ? count : maxObjects;
+
+	if (frameData.objectCount == 0)
+	{
+		return;
+	}
+
+	memcpy(frameData.mappedObjects, bounds, sizeof(OcclusionBounds) * frameData.objectCount);
+
+	VkMappedMemoryRange range;
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.pNext = NULL;
+	range.memory = frameData.objectMemory;
+	range.offset = 0;
+	range.size = VK_WHOLE_SIZE;
+	vkFlushMappedMemoryRanges(device, 1, &range);
+}
+
+void HiZOcclusion::Record(VkCommandBuffer commandBuffer, uint32_t frame, VkImage depthImage, VkExtent2D sceneExtent, const float viewProjection[16])
+{
+	FrameData& frameData = frames[frame];
+
+	// Depth becomes readable, the whole pyramid is rewritten after the previous frame's test read it
+	VkImageMemoryBarrier barriers[2];
+	barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barriers[0].pNext = NULL;
+	barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].image = depthImage;
+	barriers[0].subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+
+	barriers[1] = barriers[0];
+	barriers[1].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barriers[1].image = pyramidImage;
+	barriers[1].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, 2, barriers);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, reducePipeline);
+
+	// Only the region this frame rendered is reduced, the rest of the target holds stale depth
+	uint32_t sourceWidth = sceneExtent.width < width ? sceneExtent.width : width;
+	uint32_t sourceHeight = sceneExtent.height < height ? sceneExtent.height : height;
+
+	VkImageMemoryBarrier levelBarrier;
+	levelBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	levelBarrier.pNext = NULL;
+	levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	levelBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+	levelBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	levelBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	levelBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	levelBarrier.image = pyramidImage;
+
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		ReduceConstants constants;
+		constants.sourceSize[0] = (int32_t)sourceWidth;
+		constants.sourceSize[1] = (int32_t)sourceHeight;
+		constants.destinationSize[0] = (int32_t)HalfRoundedUp(sourceWidth);
+		constants.destinationSize[1] = (int32_t)HalfRoundedUp(sourceHeight);
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, reduceLayout, 0, 1, &reduceSets[level], 0, NULL);
+		vkCmdPushConstants(commandBuffer, reduceLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+		vkCmdDispatch(commandBuffer, (constants.destinationSize[0] + ReduceGroupSize - 1) / ReduceGroupSize, (constants.destinationSize[1] + ReduceGroupSize - 1) / ReduceGroupSize, 1);
+
+		levelBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &levelBarrier);
+
+		sourceWidth = (uint32_t)constants.destinationSize[0];
+		sourceHeight = (uint32_t)constants.destinationSize[1];
+	}
+
+	frameData.recordedCount = frameData.objectCount;
+
+	if (frameData.objectCount == 0)
+	{
+		return;
+	}
+
+	CullConstants constants;
+	memcpy(constants.viewProjection, viewProjection, sizeof(constants.viewProjection));
+	constants.sceneSize[0] = (float)(sceneExtent.width < width ? sceneExtent.width : width);
+	constants.sceneSize[1] = (float)(sceneExtent.height < height ? sceneExtent.height : height);
+	constants.objectCount = frameData.objectCount;
+	constants.levelCount = levelCount;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullLayout, 0, 1, &frameData.cullSet, 0, NULL);
+	vkCmdPushConstants(commandBuffer, cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+	vkCmdDispatch(commandBuffer, (frameData.objectCount + CullGroupSize - 1) / CullGroupSize, 1, 1);
+
+	VkBufferMemoryBarrier visibilityBarrier;
+	visibilityBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	visibilityBarrier.pNext = NULL;
+	visibilityBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	visibilityBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	visibilityBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	visibilityBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	visibilityBarrier.buffer = frameData.visibilityBuffer;
+	visibilityBarrier.offset = 0;
+	visibilityBarrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, NULL, 1, &visibilityBarrier, 0, NULL);
+}
+
+const uint32_t* HiZOcclusion::GetVisibility(uint32_t frame, uint32_t* count)
+{
+	FrameData& frameData = frames[frame];
+	*count = frameData.recordedCount;
+
+	if (frameData.recordedCount == 0)
+	{
+		return NULL;
+	}
+
+	VkMappedMemoryRange range;
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.pNext = NULL;
+	range.memory = frameData.visibilityMemory;
+	range.offset = 0;
+	range.size = VK_WHOLE_SIZE;
+	vkInvalidateMappedMemoryRanges(device, 1, &range);
+
+	return frameData.mappedVisibility;
+}
+
+uint32_t HiZOcclusion::GetLevelCount() const
+{
+	return levelCount;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+
+#include "vulkan_helpers.h"
+
+// Axis aligned box in the space the view projection transforms from, laid out as hiz_cull.comp reads it
+struct OcclusionBounds
+{
+	float center[4];
+	float extent[4];	// Half size on each axis
+};
+
+// Occlusion culling against a hierarchical depth pyramid.
+//
+// After the scene's depth is rendered a compute pass reduces it into a mip chain where each texel
+// holds the farthest depth under it, then tests each object's screen rectangle against the level
+// where it covers at most 2x2 texels. Results are per frame in flight and read back once the
+// frame's fence has signalled, so they describe the scene as it was that many frames ago. Objects
+// that become visible appear with the same delay.
+class HiZOcclusion
+{
+public:
+	HiZOcclusion();
+	~HiZOcclusion();
+
+	// depthView is the depth attachment's view, width and height its size
+	bool Create(VkDevice device, const VkMemoryType* memoryTypes, VkImageView depthView, uint32_t width, uint32_t height, uint32_t maxObjects, uint32_t frameCount);
+	void Destroy();
+
+	// Bounds tested when frame is next recorded, count is clamped to maxObjects
+	void SetObjects(uint32_t frame, const OcclusionBounds* bounds, uint32_t count);
+
+	// Builds the pyramid from the sceneExtent region of depthImage and tests the frame's objects.
+	// Recorded after the render pass, which must leave depth in DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+	// and leaves it in DEPTH_STENCIL_READ_ONLY_OPTIMAL. viewProjection is column major.
+	void Record(VkCommandBuffer commandBuffer, uint32_t frame, VkImage depthImage, VkExtent2D sceneExtent, const float viewProjection[16]);
+
+	// One entry per object last recorded for frame, non-zero if visible. NULL if frame hasn't
+	// been recorded, only valid once its fence has signalled.
+	const uint32_t* GetVisibility(uint32_t frame, uint32_t* count);
+
+	uint32_t GetLevelCount() const;
+
+private:
+	struct FrameData
+	{
+		VkBuffer objectBuffer;
+		VkDeviceMemory objectMemory;
+		OcclusionBounds* mappedObjects;
+		VkBuffer visibilityBuffer;
+		VkDeviceMemory visibilityMemory;
+		uint32_t* mappedVisibility;
+		VkDescriptorSet cullSet;
+		uint32_t objectCount;		// Set by SetObjects
+		uint32_t recordedCount;		// Tested by the last Record
+	};
+
+	bool CreatePipelines();
+
+	VkDevice device;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+	uint32_t maxObjects;
+
+	VkImage pyramidImage;
+	VkDeviceMemory pyramidMemory;
+	VkImageView pyramidView;
+	std::vector<VkImageView> levelViews;
+	VkSampler sampler;
+
+	VkDescriptorSetLayout reduceSetLayout;
+	VkDescriptorSetLayout cullSetLayout;
+	VkDescriptorPool descriptorPool;
+	std::vector<VkDescriptorSet> reduceSets;
+
+	VkShaderModule reduceModule;
+	VkShaderModule cullModule;
+	VkPipelineLayout reduceLayout;
+	VkPipelineLayout cullLayout;
+	VkPipeline reducePipeline;
+	VkPipeline cullPipeline;
+
+	std::vector<FrameData> frames;
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+
+// Glyphs of the performance HUD's atlas: printable ASCII from space to tilde, then a solid block
+// for panels and graph bars. Baked from DejaVu Sans Mono Bold at 11 pixels and thresholded to one
+// bit, one byte per row with the most significant bit leftmost.
+static const uint32_t HudGlyphWidth = 8;
+static const uint32_t HudGlyphHeight = 12;
+static const uint32_t HudFirstCharacter = 32;
+static const uint32_t HudGlyphCount = 96;
+static const uint32_t HudSolidGlyph = 95;
+
+static const uint8_t HudGlyphRows[HudGlyphCount][HudGlyphHeight] =
+{
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// ' '
+	{ 0x00, 0x00, 0x30, 0x30, 0x30, 0x10, 0x10, 0x00, 0x30, 0x30, 0x00, 0x00 },	// '!'
+	{ 0x00, 0x00, 0x68, 0x68, 0x68, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// '"'
+	{ 0x00, 0x00, 0x34, 0x3c, 0x7e, 0x28, 0x68, 0xfc, 0x58, 0x50, 0x00, 0x00 },	// '#'
+	{ 0x00, 0x00, 0x10, 0x78, 0x70, 0x78, 0x3c, 0x1c, 0x5c, 0x78, 0x10, 0x10 },	// '$'
+	{ 0x00, 0x00, 0x60, 0xb0, 0x64, 0x18, 0x20, 0x4c, 0x16, 0x0c, 0x00, 0x00 },	// '%'
+	{ 0x00, 0x00, 0x38, 0x68, 0x60, 0x70, 0xf6, 0xdc, 0xcc, 0x7c, 0x00, 0x00 },	// '&'
+	{ 0x00, 0x00, 0x30, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// '\''
+	{ 0x00, 0x18, 0x10, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x10, 0x18, 0x00 },	// '('
+	{ 0x00, 0x20, 0x30, 0x10, 0x18, 0x18, 0x18, 0x10, 0x10, 0x30, 0x20, 0x00 },	// ')'
+	{ 0x00, 0x00, 0x10, 0x54, 0x78, 0x78, 0x54, 0x10, 0x00, 0x00, 0x00, 0x00 },	// '*'
+	{ 0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0xfc, 0x10, 0x10, 0x00, 0x00, 0x00 },	// '+'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x30, 0x20 },	// ','
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x78, 0x78, 0x00, 0x00, 0x00, 0x00 },	// '-'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x00, 0x00 },	// '.'
+	{ 0x00, 0x00, 0x0c, 0x08, 0x08, 0x10, 0x10, 0x30, 0x20, 0x60, 0x40, 0x00 },	// '/'
+	{ 0x00, 0x00, 0x38, 0x6c, 0x4c, 0x4c, 0x7c, 0x4c, 0x6c, 0x38, 0x00, 0x00 },	// '0'
+	{ 0x00, 0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x7c, 0x00, 0x00 },	// '1'
+	{ 0x00, 0x00, 0x78, 0x0c, 0x0c, 0x18, 0x18, 0x30, 0x60, 0x7c, 0x00, 0x00 },	// '2'
+	{ 0x00, 0x00, 0x78, 0x0c, 0x0c, 0x38, 0x0c, 0x0c, 0x0c, 0x78, 0x00, 0x00 },	// '3'
+	{ 0x00, 0x00, 0x18, 0x38, 0x38, 0x68, 0x48, 0xfc, 0x08, 0x08, 0x00, 0x00 },	// '4'
+	{ 0x00, 0x00, 0x7c, 0x40, 0x40, 0x78, 0x0c, 0x0c, 0x0c, 0x78, 0x00, 0x00 },	// '5'
+	{ 0x00, 0x00, 0x3c, 0x60, 0x40, 0x78, 0x6c, 0x6c, 0x6c, 0x38, 0x00, 0x00 },	// '6'
+	{ 0x00, 0x00, 0x7c, 0x0c, 0x18, 0x18, 0x18, 0x30, 0x30, 0x20, 0x00, 0x00 },	// '7'
+	{ 0x00, 0x00, 0x38, 0x6c, 0x6c, 0x38, 0x6c, 0x4c, 0x6c, 0x38, 0x00, 0x00 },	// '8'
+	{ 0x00, 0x00, 0x78, 0x4c, 0x4c, 0x4c, 0x7c, 0x0c, 0x08, 0x78, 0x00, 0x00 },	// '9'
+	{ 0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x00, 0x00, 0x30, 0x30, 0x00, 0x00 },	// ':'
+	{ 0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x00, 0x00, 0x30, 0x30, 0x30, 0x20 },	// ';'
+	{ 0x00, 0x00, 0x00, 0x00, 0x04, 0x3c, 0xf0, 0xe0, 0x3c, 0x04, 0x00, 0x00 },	// '<'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0xfc, 0x00, 0xfc, 0x00, 0x00, 0x00, 0x00 },	// '='
+	{ 0x00, 0x00, 0x00, 0x00, 0xc0, 0x70, 0x1c, 0x1c, 0x70, 0xc0, 0x00, 0x00 },	// '>'
+	{ 0x00, 0x00, 0x38, 0x4c, 0x08, 0x10, 0x30, 0x00, 0x30, 0x30, 0x00, 0x00 },	// '?'
+	{ 0x00, 0x00, 0x38, 0x64, 0xdc, 0xb4, 0xa4, 0xb4, 0xdc, 0x64, 0x3c, 0x00 },	// '@'
+	{ 0x00, 0x00, 0x38, 0x38, 0x38, 0x68, 0x6c, 0x7c, 0xcc, 0xc4, 0x00, 0x00 },	// 'A'
+	{ 0x00, 0x00, 0x78, 0x4c, 0x4c, 0x78, 0x4c, 0x4c, 0x4c, 0x78, 0x00, 0x00 },	// 'B'
+	{ 0x00, 0x00, 0x38, 0x64, 0x60, 0x60, 0x60, 0x60, 0x64, 0x38, 0x00, 0x00 },	// 'C'
+	{ 0x00, 0x00, 0x78, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x4c, 0x78, 0x00, 0x00 },	// 'D'
+	{ 0x00, 0x00, 0x7c, 0x60, 0x60, 0x7c, 0x60, 0x60, 0x60, 0x7c, 0x00, 0x00 },	// 'E'
+	{ 0x00, 0x00, 0x7c, 0x60, 0x60, 0x7c, 0x60, 0x60, 0x60, 0x60, 0x00, 0x00 },	// 'F'
+	{ 0x00, 0x00, 0x38, 0x64, 0x60, 0x40, 0x5c, 0x64, 0x64, 0x3c, 0x00, 0x00 },	// 'G'
+	{ 0x00, 0x00, 0x4c, 0x4c, 0x4c, 0x7c, 0x4c, 0x4c, 0x4c, 0x4c, 0x00, 0x00 },	// 'H'
+	{ 0x00, 0x00, 0x7c, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x7c, 0x00, 0x00 },	// 'I'
+	{ 0x00, 0x00, 0x3c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x18, 0x78, 0x00, 0x00 },	// 'J'
+	{ 0x00, 0x00, 0x4c, 0x58, 0x78, 0x70, 0x78, 0x58, 0x4c, 0x4c, 0x00, 0x00 },	// 'K'
+	{ 0x00, 0x00, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x7c, 0x00, 0x00 },	// 'L'
+	{ 0x00, 0x00, 0xec, 0xec, 0xfc, 0xfc, 0xf4, 0xc4, 0xc4, 0xc4, 0x00, 0x00 },	// 'M'
+	{ 0x00, 0x00, 0x6c, 0x6c, 0x6c, 0x7c, 0x5c, 0x5c, 0x4c, 0x4c, 0x00, 0x00 },	// 'N'
+	{ 0x00, 0x00, 0x38, 0x6c, 0x4c, 0xcc, 0xcc, 0x4c, 0x6c, 0x38, 0x00, 0x00 },	// 'O'
+	{ 0x00, 0x00, 0x78, 0x6c, 0x6c, 0x6c, 0x78, 0x60, 0x60, 0x60, 0x00, 0x00 },	// 'P'
+	{ 0x00, 0x00, 0x38, 0x6c, 0x4c, 0xcc, 0xcc, 0x4c, 0x6c, 0x38, 0x0c, 0x00 },	// 'Q'
+	{ 0x00, 0x00, 0x78, 0x4c, 0x4c, 0x4c, 0x78, 0x58, 0x4c, 0x44, 0x00, 0x00 },	// 'R'
+	{ 0x00, 0x00, 0x78, 0x64, 0x60, 0x70, 0x3c, 0x0c, 0x4c, 0x78, 0x00, 0x00 },	// 'S'
+	{ 0x00, 0x00, 0xfc, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00 },	// 'T'
+	{ 0x00, 0x00, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0x6c, 0x78, 0x00, 0x00 },	// 'U'
+	{ 0x00, 0x00, 0xc4, 0x4c, 0x6c, 0x6c, 0x68, 0x38, 0x38, 0x38, 0x00, 0x00 },	// 'V'
+	{ 0x00, 0x00, 0xc6, 0xc6, 0xf4, 0xf4, 0xfc, 0x6c, 0x6c, 0x6c, 0x00, 0x00 },	// 'W'
+	{ 0x00, 0x00, 0xcc, 0x6c, 0x38, 0x38, 0x38, 0x78, 0x6c, 0xcc, 0x00, 0x00 },	// 'X'
+	{ 0x00, 0x00, 0xc4, 0x6c, 0x68, 0x38, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00 },	// 'Y'
+	{ 0x00, 0x00, 0x7c, 0x0c, 0x1c, 0x18, 0x30, 0x70, 0x60, 0x7c, 0x00, 0x00 },	// 'Z'
+	{ 0x00, 0x38, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x38, 0x00 },	// '['
+	{ 0x00, 0x00, 0x40, 0x60, 0x20, 0x30, 0x10, 0x10, 0x08, 0x08, 0x0c, 0x00 },	// '\\'
+	{ 0x00, 0x30, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x30, 0x00 },	// ']'
+	{ 0x00, 0x00, 0x30, 0x78, 0x4c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// '^'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// '_'
+	{ 0x00, 0x60, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// '`'
+	{ 0x00, 0x00, 0x00, 0x00, 0x78, 0x0c, 0x7c, 0xec, 0xec, 0x7c, 0x00, 0x00 },	// 'a'
+	{ 0x00, 0x40, 0x40, 0x40, 0x78, 0x6c, 0x6c, 0x6c, 0x6c, 0x78, 0x00, 0x00 },	// 'b'
+	{ 0x00, 0x00, 0x00, 0x00, 0x3c, 0x60, 0x60, 0x60, 0x60, 0x3c, 0x00, 0x00 },	// 'c'
+	{ 0x00, 0x0c, 0x0c, 0x0c, 0x7c, 0x6c, 0xcc, 0xcc, 0x6c, 0x7c, 0x00, 0x00 },	// 'd'
+	{ 0x00, 0x00, 0x00, 0x00, 0x38, 0x6c, 0xfc, 0xc0, 0x60, 0x3c, 0x00, 0x00 },	// 'e'
+	{ 0x00, 0x1c, 0x30, 0x30, 0x7c, 0x30, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00 },	// 'f'
+	{ 0x00, 0x00, 0x00, 0x00, 0x7c, 0x6c, 0xcc, 0xcc, 0x6c, 0x7c, 0x0c, 0x78 },	// 'g'
+	{ 0x00, 0x60, 0x60, 0x60, 0x78, 0x6c, 0x6c, 0x6c, 0x6c, 0x6c, 0x00, 0x00 },	// 'h'
+	{ 0x00, 0x10, 0x10, 0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x7c, 0x00, 0x00 },	// 'i'
+	{ 0x00, 0x18, 0x18, 0x00, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x70 },	// 'j'
+	{ 0x00, 0x60, 0x60, 0x60, 0x6c, 0x78, 0x70, 0x78, 0x6c, 0x6c, 0x00, 0x00 },	// 'k'
+	{ 0x00, 0xf0, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x1c, 0x00, 0x00 },	// 'l'
+	{ 0x00, 0x00, 0x00, 0x00, 0xfc, 0xf4, 0xd4, 0xd4, 0xd4, 0xd4, 0x00, 0x00 },	// 'm'
+	{ 0x00, 0x00, 0x00, 0x00, 0x78, 0x6c, 0x6c, 0x6c, 0x6c, 0x6c, 0x00, 0x00 },	// 'n'
+	{ 0x00, 0x00, 0x00, 0x00, 0x38, 0x6c, 0xcc, 0xcc, 0x6c, 0x38, 0x00, 0x00 },	// 'o'
+	{ 0x00, 0x00, 0x00, 0x00, 0x78, 0x6c, 0x6c, 0x6c, 0x6c, 0x78, 0x40, 0x40 },	// 'p'
+	{ 0x00, 0x00, 0x00, 0x00, 0x7c, 0x6c, 0xcc, 0xcc, 0x6c, 0x7c, 0x0c, 0x0c },	// 'q'
+	{ 0x00, 0x00, 0x00, 0x00, 0x7c, 0x70, 0x60, 0x60, 0x60, 0x60, 0x00, 0x00 },	// 'r'
+	{ 0x00, 0x00, 0x00, 0x00, 0x38, 0x60, 0x78, 0x3c, 0x0c, 0x78, 0x00, 0x00 },	// 's'
+	{ 0x00, 0x00, 0x30, 0x30, 0xfc, 0x30, 0x30, 0x30, 0x30, 0x1c, 0x00, 0x00 },	// 't'
+	{ 0x00, 0x00, 0x00, 0x00, 0x6c, 0x6c, 0x6c, 0x6c, 0x6c, 0x7c, 0x00, 0x00 },	// 'u'
+	{ 0x00, 0x00, 0x00, 0x00, 0xcc, 0x6c, 0x6c, 0x78, 0x38, 0x38, 0x00, 0x00 },	// 'v'
+	{ 0x00, 0x00, 0x00, 0x00, 0x86, 0xc4, 0xf4, 0x7c, 0x6c, 0x6c, 0x00, 0x00 },	// 'w'
+	{ 0x00, 0x00, 0x00, 0x00, 0x6c, 0x78, 0x38, 0x38, 0x78, 0x6c, 0x00, 0x00 },	// 'x'
+	{ 0x00, 0x00, 0x00, 0x00, 0xcc, 0x6c, 0x68, 0x38, 0x38, 0x30, 0x30, 0x60 },	// 'y'
+	{ 0x00, 0x00, 0x00, 0x00, 0x7c, 0x0c, 0x18, 0x30, 0x60, 0x7c, 0x00, 0x00 },	// 'z'
+	{ 0x00, 0x1c, 0x10, 0x10, 0x30, 0x30, 0x70, 0x30, 0x30, 0x10, 0x1c, 0x00 },	// '{'
+	{ 0x00, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 },	// '|'
+	{ 0x00, 0x70, 0x30, 0x30, 0x30, 0x10, 0x1c, 0x10, 0x30, 0x30, 0x70, 0x00 },	// '}'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x70, 0x1c, 0x00, 0x00, 0x00, 0x00 },	// '~'
+	{ 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff }	// solid
+};
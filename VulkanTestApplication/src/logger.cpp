@@ -0,0 +1,287 @@
+#include "logger.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace
+{
+	// Bounded multi-producer queue (Vyukov). Each slot's sequence says whether it is free for the
+	// producer at that position or holds a message for the consumer.
+	const uint32_t RingCapacity = 1024;
+
+	struct LogSlot
+	{
+		std::atomic<uint32_t> sequence;
+		LogSeverity severity;
+		char text[MaxLogMessageLength];
+	};
+
+	LogSlot ring[RingCapacity];
+	std::atomic<uint32_t> enqueuePosition(0);
+	uint32_t dequeuePosition = 0;
+
+	std::atomic<int> minimumSeverity(LogSeverity_Info);
+	std::atomic<bool> running(false);
+	std::atomic<uint32_t> droppedMessages(0);
+
+	// Producers between checking running and publishing their slot
+	std::atomic<uint32_t> activeProducers(0);
+	std::thread writerThread;
+
+	// Early returns from main skip StopLogging, a joinable thread would terminate the process on exit
+	struct LoggingShutdown
+	{
+		~LoggingShutdown() { StopLogging(); }
+	} loggingShutdown;
+
+	// The last message written and how many identical messages have followed it since
+	uint64_t lastMessageHash = 0;
+	bool hasLastMessage = false;
+	uint32_t repeatCount = 0;
+
+	const char* severityNames[] = { "debug", "info", "perf", "warning", "error" };
+}
+
+static uint64_t HashMessage(const char* text)
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+
+	for (; *text != '\0'; ++text)
+	{
+		hash = (hash ^ (unsigned char)*text) * 1099511628211ull;
+	}
+
+	return hash;
+}
+
+static void AppendMessage(std::string* batch, LogSeverity severity, const char* text)
+{
+	if (severity != LogSeverity_Info)
+	{
+		batch->append("[");
+		batch->append(severityNames[severity]);
+		batch->append("] ");
+	}
+
+	batch->append(text);
+	batch->append("\n");
+}
+
+// Ends a run of repeats of the last message, if there is one
+static void AppendRepeatCount(std::string* batch)
+{
+	if (repeatCount > 0)
+	{
+		char text[64];
+		snprintf(text, sizeof(text), "(repeated %u times)\n", repeatCount);
+		batch->append(text);
+		repeatCount = 0;
+	}
+}
+
+// Consumer side, only ever called from one thread at a time
+static bool DrainMessages(std::string* batch)
+{
+	bool drained = false;
+
+	for (;;)
+	{
+		LogSlot& slot = ring[dequeuePosition % RingCapacity];
+
+		if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition + 1)
+		{
+			break;
+		}
+
+		// Only consecutive repeats collapse, the same message after a different one is written again
+		uint64_t hash = HashMessage(slot.text) ^ (uint64_t)slot.severity;
+
+		if (hasLastMessage && hash == lastMessageHash)
+		{
+			++repeatCount;
+		}
+		else
+		{
+			AppendRepeatCount(batch);
+			AppendMessage(batch, slot.severity, slot.text);
+			lastMessageHash = hash;
+			hasLastMessage = true;
+		}
+
+		slot.sequence.store(dequeuePosition + RingCapacity, std::memory_order_release);
+		++dequeuePosition;
+		drained = true;
+	}
+
+	return drained;
+}
+
+static void WriterThread()
+{
+	std::string batch;
+
+	while (running.load(std::memory_order_acquire))
+	{
+		if (DrainMessages(&batch))
+		{
+			// One write per batch rather than a flush per message
+			fwrite(batch.data(), 1, batch.size(), stdout);
+			fflush(stdout);
+			batch.clear();
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+	}
+}
+
+bool StartLogging(LogSeverity severity)
+{
+	if (running.load())
+	{
+		return false;
+	}
+
+	// Positions carry on from the last run, so slot i isn't necessarily position start + i
+	uint32_t start = enqueuePosition.load();
+
+	for (uint32_t i = 0; i < RingCapacity; ++i)
+	{
+		ring[(start + i) % RingCapacity].sequence.store(start + i, std::memory_order_relaxed);
+	}
+
+	dequeuePosition = start;
+	minimumSeverity.store(severity);
+	running.store(true, std::memory_order_release);
+	writerThread = std::thread(WriterThread);
+
+	return true;
+}
+
+void StopLogging()
+{
+	if (running.exchange(false) == false)
+	{
+		return;
+	}
+
+	// A producer that saw running set may still be filling its slot, the final drain has to include it
+	while (activeProducers.load() != 0)
+	{
+		std::this_thread::yield();
+	}
+
+	writerThread.join();
+
+	std::string batch;
+	DrainMessages(&batch);
+	AppendRepeatCount(&batch);
+	fwrite(batch.data(), 1, batch.size(), stdout);
+
+	if (droppedMessages.load() > 0)
+	{
+		fprintf(stdout, "%u log messages were dropped because the log queue was full\n", droppedMessages.load());
+	}
+
+	fflush(stdout);
+
+	hasLastMessage = false;
+	droppedMessages.store(0);
+}
+
+void SetLogSeverity(LogSeverity severity)
+{
+	minimumSeverity.store(severity, std::memory_order_relaxed);
+}
+
+bool IsLogEnabled(LogSeverity severity)
+{
+	return severity >= minimumSeverity.load(std::memory_order_relaxed);
+}
+
+bool ParseLogSeverity(const char* name, LogSeverity* severity)
+{
+	for (int i = 0; i < (int)(sizeof(severityNames) / sizeof(severityNames[0])); ++i)
+	{
+		if (strcmp(name, severityNames[i]) == 0)
+		{
+			*severity = (LogSeverity)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void Log(LogSeverity severity, const char* format, ...)
+{
+	if (IsLogEnabled(severity) == false)
+	{
+		return;
+	}
+
+	va_list arguments;
+	va_start(arguments, format);
+
+	// Sequentially consistent with StopLogging's exchange: either this sees running cleared, or
+	// StopLogging sees this producer and waits for it
+	activeProducers.fetch_add(1);
+
+	if (running.load() == false)
+	{
+		activeProducers.fetch_sub(1);
+
+		char text[MaxLogMessageLength];
+		vsnprintf(text, sizeof(text), format, arguments);
+		va_end(arguments);
+
+		std::string line;
+		AppendMessage(&line, severity, text);
+		fputs(line.c_str(), stdout);
+		return;
+	}
+
+	// Claim a slot, giving up rather than waiting if the writer has fallen a full ring behind
+	uint32_t position = enqueuePosition.load(std::memory_order_relaxed);
+	LogSlot* slot;
+
+	for (;;)
+	{
+		slot = &ring[position % RingCapacity];
+		int32_t difference = (int32_t)(slot->sequence.load(std::memory_order_acquire) - position);
+
+		if (difference == 0)
+		{
+			if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			droppedMessages.fetch_add(1, std::memory_order_relaxed);
+			activeProducers.fetch_sub(1);
+			va_end(arguments);
+			return;
+		}
+		else
+		{
+			position = enqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	slot->severity = severity;
+	vsnprintf(slot->text, sizeof(slot->text), format, arguments);
+	va_end(arguments);
+
+	slot->sequence.store(position + 1, std::memory_order_release);
+	activeProducers.fetch_sub(1);
+}
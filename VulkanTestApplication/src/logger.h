@@ -0,0 +1,37 @@
+#pragma once
+
+// Asynchronous logging. Log formats into a slot of a fixed size lock-free ring and returns, a
+// background thread writes batches to stdout. Producers never block: when the ring is full the
+// message is dropped and counted. A message identical to the one before it isn't written again,
+// the run of repeats is counted and reported when a different message arrives or logging stops.
+
+enum LogSeverity
+{
+	LogSeverity_Debug = 0,
+	LogSeverity_Info = 1,
+	LogSeverity_Performance = 2,
+	LogSeverity_Warning = 3,
+	LogSeverity_Error = 4,
+};
+
+// Messages longer than this are truncated
+const unsigned int MaxLogMessageLength = 512;
+
+// Starts the writer thread. Until then, and after StopLogging, messages are written synchronously.
+bool StartLogging(LogSeverity minimumSeverity);
+
+// Writes everything still queued, reports drops and repeats, and joins the writer thread
+void StopLogging();
+
+void SetLogSeverity(LogSeverity minimumSeverity);
+
+// Cheap check so callers can skip building expensive messages
+bool IsLogEnabled(LogSeverity severity);
+
+bool ParseLogSeverity(const char* name, LogSeverity* severity);
+
+#if defined(__GNUC__)
+void Log(LogSeverity severity, const char* format, ...) __attribute__((format(printf, 2, 3)));
+#else
+void Log(LogSeverity severity, const char* format, ...);
+#endif
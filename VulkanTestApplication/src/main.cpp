@@ -1,171 +1,361 @@
 #include <iostream>
 #include <vector>
 #include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
 
 #include "render_window.h"
 
 #define VK_USE_PLATFORM_WIN32_KHR
 #include <vulkan\vulkan.h>
 
-VKAPI_ATTR VkBool32 VKAPI_CALL debug_callback(VkFlags msgFlags, VkDebugReportObjectTypeEXT objType, uint64_t srcObject, size_t location, int32_t msgCode, const char *pLayerPrefix, const char *pMsg, void *pUserData)
+#include "vulkan_helpers.h"
+#include "mip_generation.h"
+#include "texture_loader.h"
+#include "texture_streamer.h"
+#include "asset_pack.h"
+#include "mesh_pipeline.h"
+#include "logger.h"
+#include "device_selection.h"
+#include "device_profile.h"
+#include "memory_budget.h"
+#include "device_allocator.h"
+#include "deletion_queue.h"
+#include "submission_scheduler.h"
+#include "gpu_timer.h"
+#include "dynamic_resolution.h"
+#include "render_queue.h"
+#include "frustum_culling.h"
+#include "hiz_occlusion.h"
+#include "transform_hierarchy.h"
+#include "shader_reload.h"
+#include "scene_pass.h"
+#include "frame_capture.h"
+#include "frame_readback.h"
+#include "swapchain.h"
+#include "performance_hud.h"
+#include "particle_system.h"
+
+// Optimised SPIR-V generated from shaders/ by the build
+#include "tri.vert.h"
+#include "tri.frag.h"
+
+// Validation layers are on by default in debug builds, --validation and --no-validation override it
+#ifndef ENABLE_VALIDATION
+#ifdef _DEBUG
+#define ENABLE_VALIDATION 1
+#else
+#define ENABLE_VALIDATION 0
+#endif
+#endif
+
+static const char* validationLayerName = "VK_LAYER_LUNARG_standard_validation";
+
+// Frames the CPU may record ahead of the GPU
+static const uint32_t FramesInFlight = 2;
+
+// Texture levels are promoted while they fit in the first, uploading at most the second per frame
+static const VkDeviceSize TextureMemoryBudget = 64 << 20;
+static const VkDeviceSize TextureUploadBudgetPerFrame = 4 << 20;
+
+// Everything a frame in flight owns, reused once its fence has signalled
+struct FrameResources
 {
-	std::cout << pLayerPrefix << ": " << pMsg << std::endl;
-	return false;
-}
+	VkCommandBuffer commandBuffer;
+	VkCommandBuffer computeCommandBuffer;	// Particle simulation, only with a separate compute queue
+	VkFence fence;
+	VkSemaphore renderCompleteSemaphore;
+	VkBuffer uniformBuffer;
+	VkDeviceMemory uniformMemory;
+	VkBuffer instanceBuffer;		// World matrix of every scene node, at its instance index
+	VkDeviceMemory instanceMemory;
+	void* mappedInstances;
+	VkDescriptorSet descriptorSet;
+	bool textureStale;		// The set's texture binding refers to a view the streamer has replaced
+	uint64_t frameIndex;	// Last frame submitted with these resources, 0 if none
+};
 
-bool memory_type_from_properties(const VkMemoryType* memoryTypes, uint32_t typeBits, VkFlags requirementsMask, uint32_t* typeIndex)
+// A window's own scene and depth targets, sized to its swapchain, and the framebuffer over them
+struct WindowTargets
 {
-	for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++)
-	{
-		if (typeBits & 1 && (memoryTypes[i].propertyFlags & requirementsMask) == requirementsMask)
-		{
-			*typeIndex = i;
-			return true;
-		}
-		typeBits >>= 1;
-	}
-
-	return false;
-}
-
-bool CreateDeviceMemory(VkDevice device, const VkMemoryType* memoryTypes, const VkMemoryRequirements* memoryRequirements, VkFlags requirementsMask, size_t dataSize, VkDeviceMemory* memory)
+	VkImage sceneImage;
+	VkDeviceMemory sceneMemory;
+	VkImageView sceneView;
+	VkImage depthImage;
+	VkDeviceMemory depthMemory;
+	VkImageView depthView;
+	ScenePass scenePass;
+};
+
+// Called on whichever thread made the offending call, so only queue the message
+VKAPI_ATTR VkBool32 VKAPI_CALL debug_callback(VkFlags msgFlags, VkDebugReportObjectTypeEXT objType, uint64_t srcObject, size_t location, int32_t msgCode, const char *pLayerPrefix, const char *pMsg, void *pUserData)
 {
-	VkMemoryAllocateInfo bufferAllocateInfo;
-	bufferAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	bufferAllocateInfo.pNext = NULL;
-	bufferAllocateInfo.allocationSize = dataSize;
-	bufferAllocateInfo.memoryTypeIndex = 0;
-
-	bool validMemoryType = memory_type_from_properties(memoryTypes, memoryRequirements->memoryTypeBits, requirementsMask, &bufferAllocateInfo.memoryTypeIndex);
+	LogSeverity severity = LogSeverity_Debug;
 
-	if (validMemoryType == false)
+	if (msgFlags & VK_DEBUG_REPORT_ERROR_BIT_EXT)
 	{
-		return false;
+		severity = LogSeverity_Error;
 	}
-
-	VkResult result = vkAllocateMemory(device, &bufferAllocateInfo, NULL, memory);
-
-	if (result != VK_SUCCESS)
+	else if (msgFlags & VK_DEBUG_REPORT_WARNING_BIT_EXT)
+	{
+		severity = LogSeverity_Warning;
+	}
+	else if (msgFlags & VK_DEBUG_REPORT_PERFORMANCE_WARNING_BIT_EXT)
+	{
+		severity = LogSeverity_Performance;
+	}
+	else if (msgFlags & VK_DEBUG_REPORT_INFORMATION_BIT_EXT)
 	{
-		return false;
+		severity = LogSeverity_Info;
 	}
 
-	return true;
+	Log(severity, "%s: %s", pLayerPrefix, pMsg);
+	return false;
 }
 
-bool SetDeviceMemory(VkDevice device, VkDeviceMemory memory, void* data, size_t dataSize)
+// Closing any of the windows ends the app
+static bool AreWindowsOpen(const RenderWindow* windows, uint32_t windowCount)
 {
-	void* mappedMem;
-	VkResult result = vkMapMemory(device, memory, 0, dataSize, 0, &mappedMem);
-
-	if (result != VK_SUCCESS)
+	for (uint32_t i = 0; i < windowCount; ++i)
 	{
-		return false;
+		if (windows[i].IsOpen() == false)
+		{
+			return false;
+		}
 	}
 
-	memcpy(mappedMem, data, dataSize);
-
-	vkUnmapMemory(device, memory);
-
 	return true;
 }
 
-bool CreateBuffer(VkDevice device, VkBufferUsageFlags usageFlags, const VkMemoryType* memoryTypes, void* data, size_t dataSize, VkBuffer* buffer, VkDeviceMemory* memory)
+static bool IsInstanceLayerAvailable(const char* layerName)
 {
-	VkBufferCreateInfo bufferCreateInfo;
-	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferCreateInfo.pNext = NULL;
-	bufferCreateInfo.flags = 0;
-	bufferCreateInfo.usage = usageFlags;
-	bufferCreateInfo.size = dataSize;
-	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	bufferCreateInfo.queueFamilyIndexCount = 0;
-	bufferCreateInfo.pQueueFamilyIndices = NULL;
-
-	VkResult result = vkCreateBuffer(device, &bufferCreateInfo, NULL, buffer);
+	uint32_t layerCount = 0;
+	vkEnumerateInstanceLayerProperties(&layerCount, NULL);
+	std::vector<VkLayerProperties> layers(layerCount);
+	vkEnumerateInstanceLayerProperties(&layerCount, layers.data());
 
-	if (result != VK_SUCCESS)
+	for (uint32_t i = 0; i < layerCount; ++i)
 	{
-		return false;
+		if (strcmp(layers[i].layerName, layerName) == 0)
+		{
+			return true;
+		}
 	}
 
-	VkMemoryRequirements memoryRequirements;
-	vkGetBufferMemoryRequirements(device, *buffer, &memoryRequirements);
+	return false;
+}
 
-	if (CreateDeviceMemory(device, memoryTypes, &memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, dataSize, memory) == false)
-	{
-		return false;
-	}
+static bool IsInstanceExtensionAvailable(const char* extensionName)
+{
+	uint32_t extensionCount = 0;
+	vkEnumerateInstanceExtensionProperties(NULL, &extensionCount, NULL);
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateInstanceExtensionProperties(NULL, &extensionCount, extensions.data());
 
-	if (data != NULL)
+	for (uint32_t i = 0; i < extensionCount; ++i)
 	{
-		if (SetDeviceMemory(device, *memory, data, dataSize) == false)
+		if (strcmp(extensions[i].extensionName, extensionName) == 0)
 		{
-			return false;
+			return true;
 		}
 	}
 
-	result = vkBindBufferMemory(device, *buffer, *memory, 0);
+	return false;
+}
 
-	if (result != VK_SUCCESS)
+int main(int argc, char** argv)
+{
+	const char* texturePath = NULL;
+	const char* packPath = "assets.pack";
+	bool validation = ENABLE_VALIDATION != 0;
+	LogSeverity logSeverity = LogSeverity_Info;
+	const char* deviceName = NULL;
+	int deviceIndex = -1;
+	bool allowSoftwareDevice = false;
+	bool robustBufferAccess = false;
+	uint32_t frameLimit = 0;
+	VkDeviceSize defragmentBytesPerFrame = 4 * 1024 * 1024;
+	float targetFrameTime = 0.0f;
+	float minResolutionScale = DynamicResolution::DefaultMinScale;
+	uint32_t drawCount = 1;
+	bool depthPrepass = false;
+	bool occlusionCulling = false;
+	bool frustumCulling = false;
+	const char* shaderDirectory = NULL;
+	std::vector<PostEffect> postEffects;
+	const char* capturePath = NULL;
+	uint32_t captureFrame = 60;
+	const char* readbackPath = NULL;
+	ReadbackFormat readbackFormat = ReadbackFormat_Raw;
+	uint32_t readbackSlots = 4;
+	uint32_t windowCount = 1;
+	bool showHud = false;
+	uint32_t particleCount = 0;
+
+	for (int i = 1; i < argc; ++i)
 	{
-		return false;
-	}
+		if (strcmp(argv[i], "--texture") == 0 && i + 1 < argc)
+		{
+			texturePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--pack") == 0 && i + 1 < argc)
+		{
+			packPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--validation") == 0)
+		{
+			validation = true;
+		}
+		else if (strcmp(argv[i], "--no-validation") == 0)
+		{
+			validation = false;
+		}
+		else if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc && ParseLogSeverity(argv[i + 1], &logSeverity))
+		{
+			++i;
+		}
+		else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc)
+		{
+			// A plain number is an enumeration index, anything else part of the device name
+			const char* device = argv[++i];
+			char* end;
+			long index = strtol(device, &end, 10);
+
+			if (*end == '\0' && index >= 0)
+			{
+				deviceIndex = (int)index;
+			}
+			else
+			{
+				deviceName = device;
+			}
+		}
+		else if (strcmp(argv[i], "--allow-software-device") == 0)
+		{
+			allowSoftwareDevice = true;
+		}
+		else if (strcmp(argv[i], "--robust-buffer-access") == 0)
+		{
+			robustBufferAccess = true;
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+		{
+			frameLimit = (uint32_t)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--defragment-budget") == 0 && i + 1 < argc)
+		{
+			defragmentBytesPerFrame = (VkDeviceSize)strtoul(argv[++i], NULL, 10) * 1024 * 1024;
+		}
+		else if (strcmp(argv[i], "--dynamic-resolution") == 0 && i + 1 < argc)
+		{
+			targetFrameTime = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--min-resolution-scale") == 0 && i + 1 < argc)
+		{
+			minResolutionScale = (float)atof(argv[++i]);
 
-	return true;
-}
+			if (minResolutionScale < 0.1f || minResolutionScale > 1.0f)
+			{
+				std::cout << "--min-resolution-scale must be between 0.1 and 1" << std::endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--draw-count") == 0 && i + 1 < argc)
+		{
+			drawCount = (uint32_t)strtoul(argv[++i], NULL, 10);
 
-bool CreateImage2D(VkDevice device, uint32_t width, uint32_t height, VkFormat format, const VkMemoryType* memoryTypes, void* data, size_t dataSize, VkImage* image, VkDeviceMemory* memory)
-{
-	VkImageCreateInfo imageCreateInfo;
-	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-	imageCreateInfo.pNext = NULL;
-	imageCreateInfo.flags = 0;
-	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-	imageCreateInfo.format = format;
-	imageCreateInfo.extent = { width, height, 1 };
-	imageCreateInfo.mipLevels = 1;
-	imageCreateInfo.arrayLayers = 1;
-	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-	imageCreateInfo.tiling = VK_IMAGE_TILING_LINEAR; 	// TODO:  THIS MIGHT NOT BE SUPPORTED, may need to use staging texture!
-	imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
-	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	imageCreateInfo.queueFamilyIndexCount = 0;
-	imageCreateInfo.pQueueFamilyIndices = NULL;
-	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_GENERAL;
-
-	VkResult result = vkCreateImage(device, &imageCreateInfo, NULL, image);
+			if (drawCount == 0)
+			{
+				drawCount = 1;
+			}
+		}
+		else if (strcmp(argv[i], "--depth-prepass") == 0)
+		{
+			depthPrepass = true;
+		}
+		else if (strcmp(argv[i], "--occlusion-culling") == 0)
+		{
+			occlusionCulling = true;
+		}
+		else if (strcmp(argv[i], "--frustum-culling") == 0)
+		{
+			frustumCulling = true;
+		}
+		else if (strcmp(argv[i], "--shader-dir") == 0 && i + 1 < argc)
+		{
+			shaderDirectory = argv[++i];
+		}
+		else if (strcmp(argv[i], "--post-process") == 0 && i + 1 < argc && ParsePostEffects(argv[i + 1], &postEffects))
+		{
+			++i;
+		}
+		else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+		{
+			capturePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--capture-frame") == 0 && i + 1 < argc)
+		{
+			captureFrame = (uint32_t)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--readback") == 0 && i + 1 < argc)
+		{
+			readbackPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--readback-format") == 0 && i + 1 < argc && ParseReadbackFormat(argv[i + 1], &readbackFormat))
+		{
+			++i;
+		}
+		else if (strcmp(argv[i], "--readback-slots") == 0 && i + 1 < argc)
+		{
+			readbackSlots = (uint32_t)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--hud") == 0)
+		{
+			showHud = true;
+		}
+		else if (strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+		{
+			particleCount = (uint32_t)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--windows") == 0 && i + 1 < argc)
+		{
+			windowCount = (uint32_t)strtoul(argv[++i], NULL, 10);
 
-	if (result != VK_SUCCESS)
-	{
-		return false;
+			if (windowCount < 1 || windowCount > Swapchain::MaxSwapchains)
+			{
+				std::cout << "--windows must be between 1 and " << Swapchain::MaxSwapchains << std::endl;
+				return 1;
+			}
+		}
+		else
+		{
+			std::cout << "Usage: VulkanTestApplication [--texture <file.ktx2|file.dds>] [--pack <file>] [--validation|--no-validation] [--log-level debug|info|perf|warning|error] [--device <index|name>] [--allow-software-device] [--robust-buffer-access] [--frames <count>] [--defragment-budget <MB per frame>] [--dynamic-resolution <target GPU ms>] [--min-resolution-scale <fraction>] [--draw-count <count>] [--depth-prepass] [--occlusion-culling] [--frustum-culling] [--shader-dir <directory>] [--post-process <tonemap,vignette,desaturate>] [--capture <file> [--capture-frame <index>]] [--readback <file|-> [--readback-format raw|y4m] [--readback-slots <count>]] [--windows <count>] [--hud] [--particles <count>]" << std::endl;
+			return 1;
+		}
 	}
 
-	VkMemoryRequirements memoryRequirements;
-	vkGetImageMemoryRequirements(device, *image, &memoryRequirements);
+	// Opened before anything is printed, streaming to stdout moves console output to stderr
+	FrameReadback frameReadback;
 
-	if (CreateDeviceMemory(device, memoryTypes, &memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, dataSize, memory) == false)
+	if (readbackPath != NULL && frameReadback.Open(readbackPath) == false)
 	{
-		return false;
+		std::cout << "Couldn't open " << readbackPath << " for readback" << std::endl;
+		return 1;
 	}
 
-	if (SetDeviceMemory(device, *memory, data, dataSize) == false)
-	{
-		return false;
-	}
+	StartLogging(logSeverity);
 
-	result = vkBindImageMemory(device, *image, *memory, 0);
+	// Assets are used straight from the mapping, anything missing from the pack falls back to built in data
+	AssetPack assetPack;
 
-	if (result != VK_SUCCESS)
+	if (assetPack.Open(packPath) == false)
 	{
-		return false;
+		std::cout << "No asset pack at " << packPath << ", using built in assets" << std::endl;
 	}
 
-	return true;
-}
-
-int main(char** argv, int argc)
-{
 	VkApplicationInfo appInfo;
 	appInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
@@ -176,14 +366,34 @@ int main(char** argv, int argc)
 	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
 
 	std::vector<const char*> enabledExtensions = {
-		VK_EXT_DEBUG_REPORT_EXTENSION_NAME,
 		VK_KHR_WIN32_SURFACE_EXTENSION_NAME,
 		VK_KHR_SURFACE_EXTENSION_NAME
 	};
 
-	std::vector<const char*> enabledLayers = {
-		"VK_LAYER_LUNARG_standard_validation"
-	};
+	std::vector<const char*> enabledLayers;
+
+	if (validation && IsInstanceLayerAvailable(validationLayerName) == false)
+	{
+		Log(LogSeverity_Warning, "%s is not installed, running without validation", validationLayerName);
+		validation = false;
+	}
+
+	if (validation)
+	{
+		enabledExtensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+		enabledLayers.push_back(validationLayerName);
+	}
+
+	// Needed to query VK_EXT_memory_budget and to enable VK_KHR_timeline_semaphore
+	bool physicalDeviceProperties2 = false;
+
+#ifdef VK_KHR_get_physical_device_properties2
+	if (IsInstanceExtensionAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))
+	{
+		enabledExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+		physicalDeviceProperties2 = true;
+	}
+#endif
 
 	VkInstanceCreateInfo createInfo;
 	createInfo.flags = 0;
@@ -206,161 +416,232 @@ int main(char** argv, int argc)
 		return 1;
 	}
 
-	VkDebugReportCallbackCreateInfoEXT debugReportCallbackCreateInfo;
-	debugReportCallbackCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CREATE_INFO_EXT;
-	debugReportCallbackCreateInfo.pNext = NULL;
-	debugReportCallbackCreateInfo.flags = VK_DEBUG_REPORT_ERROR_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT | VK_DEBUG_REPORT_INFORMATION_BIT_EXT | VK_DEBUG_REPORT_PERFORMANCE_WARNING_BIT_EXT;
-	debugReportCallbackCreateInfo.pfnCallback = debug_callback;
-	debugReportCallbackCreateInfo.pUserData = NULL;
+	VkDebugReportCallbackEXT debugCallback = VK_NULL_HANDLE;
+
+	if (validation)
+	{
+		// Only ask the layers for the reports that would pass the log filter, building them is not free
+		VkDebugReportCallbackCreateInfoEXT debugReportCallbackCreateInfo;
+		debugReportCallbackCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CREATE_INFO_EXT;
+		debugReportCallbackCreateInfo.pNext = NULL;
+		debugReportCallbackCreateInfo.flags = VK_DEBUG_REPORT_ERROR_BIT_EXT;
+		debugReportCallbackCreateInfo.pfnCallback = debug_callback;
+		debugReportCallbackCreateInfo.pUserData = NULL;
+
+		if (IsLogEnabled(LogSeverity_Warning))
+		{
+			debugReportCallbackCreateInfo.flags |= VK_DEBUG_REPORT_WARNING_BIT_EXT;
+		}
 
-	PFN_vkCreateDebugReportCallbackEXT vkCreateDebugReportCallbackEXT = (PFN_vkCreateDebugReportCallbackEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugReportCallbackEXT");
+		if (IsLogEnabled(LogSeverity_Performance))
+		{
+			debugReportCallbackCreateInfo.flags |= VK_DEBUG_REPORT_PERFORMANCE_WARNING_BIT_EXT;
+		}
 
-	VkDebugReportCallbackEXT debugCallback;
-	result = vkCreateDebugReportCallbackEXT(instance, &debugReportCallbackCreateInfo, NULL, &debugCallback);
+		if (IsLogEnabled(LogSeverity_Info))
+		{
+			debugReportCallbackCreateInfo.flags |= VK_DEBUG_REPORT_INFORMATION_BIT_EXT;
+		}
 
-	if (result != VK_SUCCESS)
+		if (IsLogEnabled(LogSeverity_Debug))
+		{
+			debugReportCallbackCreateInfo.flags |= VK_DEBUG_REPORT_DEBUG_BIT_EXT;
+		}
+
+		PFN_vkCreateDebugReportCallbackEXT vkCreateDebugReportCallbackEXT = (PFN_vkCreateDebugReportCallbackEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugReportCallbackEXT");
+
+		result = vkCreateDebugReportCallbackEXT(instance, &debugReportCallbackCreateInfo, NULL, &debugCallback);
+
+		if (result != VK_SUCCESS)
+		{
+			std::cout << "Failed to install debug report callback" << std::endl;
+		}
+	}
+
+	// With several windows each goes on its own display while there are enough of them. All are
+	// driven by this device and show the same scene.
+	RenderWindow renderWindows[Swapchain::MaxSwapchains];
+	std::vector<VkSurfaceKHR> surfaces(windowCount, VK_NULL_HANDLE);
+
+	for (uint32_t i = 0; i < windowCount; ++i)
 	{
-		std::cout << "Failed to install debug report callback" << std::endl;
+		int windowX = CW_USEDEFAULT;
+		int windowY = CW_USEDEFAULT;
+
+		if (windowCount > 1)
+		{
+			RenderWindow::GetMonitorOrigin(i, &windowX, &windowY);
+		}
+
+		renderWindows[i].Create(windowX, windowY);
+		renderWindows[i].Show();
+
+		// Begin Windows specific
+		VkWin32SurfaceCreateInfoKHR surfaceCreateInfo;
+		surfaceCreateInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
+		surfaceCreateInfo.pNext = NULL;
+		surfaceCreateInfo.flags = 0;
+		surfaceCreateInfo.hinstance = (HINSTANCE)GetModuleHandle(NULL);
+		surfaceCreateInfo.hwnd = renderWindows[i].GetNativeHandle();
+		result = vkCreateWin32SurfaceKHR(instance, &surfaceCreateInfo, NULL, &surfaces[i]);
+
+		if (result != VK_SUCCESS)
+		{
+			std::cout << "Failed to create win32 surface" << std::endl;
+			return 1;
+		}
+		// End Windows Specific
 	}
 
-	// Get number of physical devices
-	uint32_t deviceCount = 0;
-	result = vkEnumeratePhysicalDevices(instance, &deviceCount, NULL);
+	DeviceProfile deviceProfile = GetApplicationDeviceProfile(robustBufferAccess, physicalDeviceProperties2);
+	VkPhysicalDeviceFeatures requiredFeatures;
+	GetRequiredFeatures(deviceProfile, &requiredFeatures);
 
-	if (result != VK_SUCCESS)
+	DeviceSelectionOptions deviceSelectionOptions;
+	deviceSelectionOptions.deviceName = deviceName;
+	deviceSelectionOptions.deviceIndex = deviceIndex;
+	deviceSelectionOptions.allowSoftware = allowSoftwareDevice;
+	deviceSelectionOptions.surfaces = surfaces;
+	GetRequiredExtensions(deviceProfile, &deviceSelectionOptions.requiredExtensions);
+	deviceSelectionOptions.requiredFeatures = &requiredFeatures;
+
+	std::vector<PhysicalDeviceCandidate> deviceCandidates;
+
+	if (EnumeratePhysicalDeviceCandidates(instance, deviceSelectionOptions, &deviceCandidates) == false)
 	{
 		std::cout << "Failed to enumerate devices" << std::endl;
 		return 1;
 	}
 
-	if (deviceCount == 0)
+	if (deviceCandidates.empty())
 	{
 		std::cout << "No devices found" << std::endl;
 		return 1;
 	}
 
-	std::vector<VkPhysicalDevice> physicalDevices(deviceCount);
+	std::cout << "Device Count:" << deviceCandidates.size() << std::endl;
 
-	result = vkEnumeratePhysicalDevices(instance, &deviceCount, physicalDevices.data());
-
-	if (result != VK_SUCCESS)
-	{
-		std::cout << "Failed to enumerate devices" << std::endl;
-	}
-
-	std::cout << "Device Count:" << deviceCount << std::endl;
-
-	for (uint32_t i = 0; i < deviceCount; ++i)
+	for (uint32_t i = 0; i < deviceCandidates.size(); ++i)
 	{
-		VkPhysicalDeviceProperties deviceProperties;
-		vkGetPhysicalDeviceProperties(physicalDevices[i], &deviceProperties);
+		const PhysicalDeviceCandidate& candidate = deviceCandidates[i];
+		const VkPhysicalDeviceProperties& deviceProperties = candidate.properties;
 
 		std::cout << "============================================================" << std::endl;
+		std::cout << "Device " << i << ": " << deviceProperties.deviceName << std::endl;
 		std::cout << "Api Version: " << VK_VERSION_MAJOR(deviceProperties.apiVersion)
 			<< "." << VK_VERSION_MINOR(deviceProperties.apiVersion)
 			<< "." << VK_VERSION_PATCH(deviceProperties.apiVersion)
 			<< std::endl;
-		std::cout << "Device ID: " << deviceProperties.deviceID << std::endl;
-		std::cout << "Device Name: " << deviceProperties.deviceName << std::endl;
-		std::cout << "Device Type: " << deviceProperties.deviceType << std::endl;
+		std::cout << "Device Type: " << GetPhysicalDeviceTypeName(deviceProperties.deviceType) << (candidate.software ? " (software)" : "") << std::endl;
 		std::cout << "Driver Version: " << VK_VERSION_MAJOR(deviceProperties.driverVersion)
 			<< "." << VK_VERSION_MINOR(deviceProperties.driverVersion)
 			<< "." << VK_VERSION_PATCH(deviceProperties.driverVersion)
 			<< std::endl;
 		std::cout << "Device ID: " << deviceProperties.deviceID << std::endl;
 		std::cout << "VendorID: " << deviceProperties.vendorID << std::endl;
-	}
-
-	// For now pick the first available physical device..
-	VkPhysicalDevice physicalDevice = physicalDevices[0];
-
-
-	RenderWindow renderWindow;
-	renderWindow.Create();
-	renderWindow.Show();
+		std::cout << "Device Local Memory: " << (candidate.deviceLocalMemory >> 20) << " MB" << std::endl;
 
-	VkSurfaceKHR surface;
-	// Begin Windows specific
-	VkWin32SurfaceCreateInfoKHR surfaceCreateInfo;
-	surfaceCreateInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
-	surfaceCreateInfo.pNext = NULL;
-	surfaceCreateInfo.flags = 0;
-	surfaceCreateInfo.hinstance = (HINSTANCE)GetModuleHandle(NULL);
-	surfaceCreateInfo.hwnd = renderWindow.GetNativeHandle();
-	result = vkCreateWin32SurfaceKHR(instance, &surfaceCreateInfo, NULL, &surface);
-
-	if (result != VK_SUCCESS)
-	{
-		std::cout << "Failed to create win32 surface" << std::endl;
-		return 1;
+		if (candidate.rejectReason != NULL)
+		{
+			std::cout << "Unsuitable: " << candidate.rejectReason << std::endl;
+		}
+		else
+		{
+			std::cout << "Score: " << candidate.score << std::endl;
+		}
 	}
-	// End Windows Specific
 
-	// Enumerate queue family properties
-	uint32_t queueFamilyPropertyCount = 0;
-	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyPropertyCount, NULL);
-	std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyPropertyCount);
-	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyPropertyCount, queueFamilyProperties.data());
+	uint32_t selectedDevice = 0;
 
-	uint32_t graphicsQueueIndex = UINT32_MAX;
-
-	for (uint32_t i = 0; i < queueFamilyPropertyCount; ++i)
+	if (SelectPhysicalDevice(deviceCandidates, deviceSelectionOptions, &selectedDevice) == false)
 	{
-		VkQueueFamilyProperties& props = queueFamilyProperties[i];
-		
-		VkBool32 surfaceSupport;
-		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &surfaceSupport);
-
-		if (props.queueFlags & VK_QUEUE_GRAPHICS_BIT && surfaceSupport)
+		if (deviceName != NULL || deviceIndex >= 0)
 		{
-			graphicsQueueIndex = i;
-			break;
+			std::cout << "Requested device is not available or unsuitable" << std::endl;
+		}
+		else
+		{
+			std::cout << "No suitable device found" << (allowSoftwareDevice ? "" : ", use --allow-software-device to consider CPU implementations") << std::endl;
 		}
-	}
 
-	if (graphicsQueueIndex == UINT32_MAX)
-	{
-		std::cout << "No compatible device queue found" << std::endl;
 		return 1;
 	}
 
+	const PhysicalDeviceCandidate& selectedCandidate = deviceCandidates[selectedDevice];
+	VkPhysicalDevice physicalDevice = selectedCandidate.physicalDevice;
+	uint32_t graphicsQueueIndex = selectedCandidate.graphicsQueueFamily;
+
+	std::cout << "Using device " << selectedDevice << ": " << selectedCandidate.properties.deviceName << std::endl;
+
+	if (selectedCandidate.properties.deviceType != VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+	{
+		Log(LogSeverity_Warning, "%s is a %s device, performance will not be representative", selectedCandidate.properties.deviceName, GetPhysicalDeviceTypeName(selectedCandidate.properties.deviceType));
+	}
 
 	VkPhysicalDeviceMemoryProperties memoryProperties;
 	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
 
-	// For now use a single queue (first available)
+	// Particles are simulated on a compute only queue when the device has one, so the simulation
+	// can run alongside graphics work. Otherwise everything goes to the one graphics queue.
+	bool asyncCompute = particleCount > 0 && selectedCandidate.computeQueueFamily != UINT32_MAX;
+	uint32_t computeQueueIndex = asyncCompute ? selectedCandidate.computeQueueFamily : graphicsQueueIndex;
+
 	std::vector<VkDeviceQueueCreateInfo> deviceQueueCreateInfos;
 	VkDeviceQueueCreateInfo deviceQueueCreateInfo;
 	deviceQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 	deviceQueueCreateInfo.pNext = NULL;
 	deviceQueueCreateInfo.flags = 0;
-	// First queue from family list
 	deviceQueueCreateInfo.queueFamilyIndex = graphicsQueueIndex;
-	// Single queue
+	// Single queue per family
 	const float queuePriorities[] = { 1.0f }; // normalized floats, 1.0 is highest priority
 	deviceQueueCreateInfo.queueCount = 1;
 	deviceQueueCreateInfo.pQueuePriorities = queuePriorities;
 	deviceQueueCreateInfos.push_back(deviceQueueCreateInfo);
 
-	VkPhysicalDeviceFeatures deviceFeatures;
-	vkGetPhysicalDeviceFeatures(physicalDevice, &deviceFeatures);
+	if (asyncCompute)
+	{
+		deviceQueueCreateInfo.queueFamilyIndex = computeQueueIndex;
+		deviceQueueCreateInfos.push_back(deviceQueueCreateInfo);
+	}
 
-	std::vector<const char*> deviceExtensions =
+	// Only what the profile asks for, enabling every supported feature isn't free
+	DeviceCapabilities deviceCapabilities;
+
+	if (NegotiateDeviceProfile(physicalDevice, deviceProfile, &deviceCapabilities) == false)
 	{
-		VK_KHR_SWAPCHAIN_EXTENSION_NAME
-	};
+		std::cout << "Device is missing required features or extensions" << std::endl;
+		return 1;
+	}
+
+	PrintDeviceCapabilities(deviceProfile, deviceCapabilities);
 
 	VkDeviceCreateInfo deviceCreateInfo;
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	deviceCreateInfo.pNext = NULL;
 	deviceCreateInfo.flags = 0;
-	deviceCreateInfo.queueCreateInfoCount = 1;
+	deviceCreateInfo.queueCreateInfoCount = (uint32_t)deviceQueueCreateInfos.size();
 	deviceCreateInfo.pQueueCreateInfos = deviceQueueCreateInfos.data();
 	deviceCreateInfo.enabledLayerCount = enabledLayers.size();
 	deviceCreateInfo.ppEnabledLayerNames = enabledLayers.data();
-	deviceCreateInfo.enabledExtensionCount = deviceExtensions.size();
-	deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
-	deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
+	deviceCreateInfo.enabledExtensionCount = deviceCapabilities.enabledExtensions.size();
+	deviceCreateInfo.ppEnabledExtensionNames = deviceCapabilities.enabledExtensions.data();
+	deviceCreateInfo.pEnabledFeatures = &deviceCapabilities.enabledFeatures;
+
+	bool timelineSemaphores = false;
+
+#ifdef VK_KHR_timeline_semaphore
+	// Devices exposing the extension must support the feature, it still has to be enabled
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures;
+	timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	timelineSemaphoreFeatures.pNext = NULL;
+	timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+
+	if (IsExtensionEnabled(deviceCapabilities, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+	{
+		deviceCreateInfo.pNext = &timelineSemaphoreFeatures;
+		timelineSemaphores = true;
+	}
+#endif
 
 	VkDevice device;
 	result = vkCreateDevice(physicalDevice, &deviceCreateInfo, NULL, &device);
@@ -371,8 +652,40 @@ int main(char** argv, int argc)
 		return 1;
 	}
 
+	bool memoryBudgetExtension = false;
+
+#ifdef VK_EXT_memory_budget
+	memoryBudgetExtension = IsExtensionEnabled(deviceCapabilities, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+#endif
+
+	MemoryBudget memoryBudget;
+	memoryBudget.Initialize(instance, physicalDevice, memoryBudgetExtension);
+
+	DeviceAllocator deviceAllocator;
+
+	if (deviceAllocator.Create(device, physicalDevice, &memoryBudget, DeviceAllocator::DefaultBlockSize) == false)
+	{
+		std::cout << "Failed to create device allocator" << std::endl;
+		return 1;
+	}
+
+	DeletionQueue deletionQueue;
+	deletionQueue.Create(device);
+
+	// All queue submissions of a frame go through here and are flushed together
+	SubmissionScheduler submissionScheduler;
+	submissionScheduler.Create(device, timelineSemaphores);
+
+	GpuTimer gpuTimer;
+
+	if (gpuTimer.Create(device, physicalDevice, graphicsQueueIndex, FramesInFlight) == false)
+	{
+		std::cout << "Couldn't create GPU timer" << std::endl;
+		return 1;
+	}
+
 	uint32_t formatCount;
-	result = vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &formatCount, NULL);
+	result = vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surfaces[0], &formatCount, NULL);
 
 	if (result != VK_SUCCESS)
 	{
@@ -381,7 +694,7 @@ int main(char** argv, int argc)
 	}
 
 	std::vector<VkSurfaceFormatKHR> surfaceFormats(formatCount);
-	result = vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &formatCount, surfaceFormats.data());
+	result = vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surfaces[0], &formatCount, surfaceFormats.data());
 
 	if (result != VK_SUCCESS)
 	{
@@ -412,172 +725,146 @@ int main(char** argv, int argc)
 	std::cout << "colorFormat: " << colorFormat << std::endl;
 	std::cout << "colorSpace: " << colorSpace << std::endl;
 
+	// Every window's targets and scene pass share one set of pipelines, so all of them present in
+	// the first one's format
+	for (uint32_t i = 1; i < windowCount; ++i)
+	{
+		if (Swapchain::SupportsFormat(physicalDevice, surfaces[i], colorFormat) == false)
+		{
+			std::cout << "Window " << i << " can't present format " << colorFormat << std::endl;
+			return 1;
+		}
+	}
+
+	// Usage and present modes are checked on the first window, each swapchain takes its own size
 	VkSurfaceCapabilitiesKHR surfaceCapabilities;
-	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCapabilities);
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surfaces[0], &surfaceCapabilities);
 
 	uint32_t presentModeCount;
-	vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, NULL);
+	vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surfaces[0], &presentModeCount, NULL);
 	std::vector<VkPresentModeKHR> presentModes(presentModeCount);
-	vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, presentModes.data());
-
-	// Create swapchain
-	VkSwapchainCreateInfoKHR swapchainCreateInfo;
-	swapchainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-	swapchainCreateInfo.pNext = NULL;
-	swapchainCreateInfo.flags = 0;
-	swapchainCreateInfo.surface = surface;
-	swapchainCreateInfo.minImageCount = 2;
-	swapchainCreateInfo.imageFormat = colorFormat;
-	swapchainCreateInfo.imageColorSpace = colorSpace;
-	swapchainCreateInfo.imageExtent = surfaceCapabilities.currentExtent; 	// Window width / height
-	swapchainCreateInfo.imageArrayLayers = 1;
-	swapchainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-	swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	swapchainCreateInfo.queueFamilyIndexCount = 0;
-	swapchainCreateInfo.pQueueFamilyIndices = NULL;
-	swapchainCreateInfo.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
-	swapchainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-	swapchainCreateInfo.presentMode = VK_PRESENT_MODE_FIFO_KHR;
-	swapchainCreateInfo.clipped = true;
-	swapchainCreateInfo.oldSwapchain = NULL;
-
-	VkSwapchainKHR swapchain;
-	result = vkCreateSwapchainKHR(device, &swapchainCreateInfo, NULL, &swapchain);
+	vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surfaces[0], &presentModeCount, presentModes.data());
 
-	if (result != VK_SUCCESS)
+	// The scene is rendered offscreen and copied in
+	if ((surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) == 0)
 	{
-		std::cout << "Couldn't create swapchain" << std::endl;
+		std::cout << "Swapchain images can't be transfer destinations" << std::endl;
 		return 1;
 	}
 
-	// Get swapchain images
-	uint32_t swapchainImageCount;
-	result = vkGetSwapchainImagesKHR(device, swapchain, &swapchainImageCount, NULL);
-	if (result != VK_SUCCESS)
+	// Read back frames are copied out of the backbuffer once it's complete
+	if (readbackPath != NULL && (surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) == 0)
 	{
-		std::cout << "Couldn't get swapchain image count" << std::endl;
+		std::cout << "Swapchain images can't be transfer sources, frames can't be read back" << std::endl;
 		return 1;
 	}
 
-	std::vector<VkImage> swapchainImages(swapchainImageCount);
-	result = vkGetSwapchainImagesKHR(device, swapchain, &swapchainImageCount, swapchainImages.data());
-	if (result != VK_SUCCESS)
+	if (readbackPath != NULL && FrameReadback::IsFormatSupported(colorFormat) == false)
 	{
-		std::cout << "Couldn't get swapchain images" << std::endl;
+		std::cout << "Frames can't be read back from format " << colorFormat << std::endl;
 		return 1;
 	}
 
+	// Only the first window is read back
+	Swapchain swapchains[Swapchain::MaxSwapchains];
+
+	for (uint32_t i = 0; i < windowCount; ++i)
+	{
+		VkImageUsageFlags extraUsage = i == 0 && readbackPath != NULL ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0;
+
+		if (swapchains[i].Create(physicalDevice, device, surfaces[i], colorFormat, colorSpace, extraUsage, FramesInFlight) == false)
+		{
+			std::cout << "Couldn't create swapchain for window " << i << std::endl;
+			return 1;
+		}
+	}
+
 	VkQueue queue;
-	vkGetDeviceQueue(device, 0, 0, &queue);
-
-	VkAttachmentDescription attachmentDescription;
-	attachmentDescription.flags = 0;
-	attachmentDescription.format = colorFormat;
-	attachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
-	attachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	attachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	attachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	attachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	attachmentDescription.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	attachmentDescription.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference colorAttachmentReference;
-	colorAttachmentReference.attachment = 0;
-	colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpassDescription;
-	subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpassDescription.flags = 0;
-	subpassDescription.inputAttachmentCount = 0;
-	subpassDescription.pInputAttachments = NULL;
-	subpassDescription.colorAttachmentCount = 1;
-	subpassDescription.pColorAttachments = &colorAttachmentReference;
-	subpassDescription.pResolveAttachments = NULL;
-	subpassDescription.pDepthStencilAttachment = NULL;
-	subpassDescription.preserveAttachmentCount = 0;
-	subpassDescription.pPreserveAttachments = NULL;
-
-	VkRenderPassCreateInfo renderPassCreateInfo;
-	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassCreateInfo.pNext = NULL;
-	renderPassCreateInfo.flags = 0;
-	renderPassCreateInfo.attachmentCount = 1;
-	renderPassCreateInfo.pAttachments = &attachmentDescription;
-	renderPassCreateInfo.subpassCount = 1;
-	renderPassCreateInfo.pSubpasses = &subpassDescription;
-	renderPassCreateInfo.dependencyCount = 0;
-	renderPassCreateInfo.pDependencies = NULL;
-
-	VkRenderPass renderPass;
-	result = vkCreateRenderPass(device, &renderPassCreateInfo, NULL, &renderPass);
+	vkGetDeviceQueue(device, graphicsQueueIndex, 0, &queue);
 
-	if (result != VK_SUCCESS)
+	VkQueue computeQueue = queue;
+
+	if (asyncCompute)
 	{
-		std::cout << "Couldn't create vk renderpass" << std::endl;
-		return 1;
+		vkGetDeviceQueue(device, computeQueueIndex, 0, &computeQueue);
 	}
 
-	std::vector<VkImageView> backbufferViews(swapchainImageCount);
-	std::vector<VkFramebuffer> framebuffers(swapchainImageCount);
+	// Occlusion culling samples depth after the pass
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
 
-	for (uint32_t i = 0; i < swapchainImageCount; ++i)
+	if (occlusionCulling && FindDepthFormat(physicalDevice, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT, &depthFormat) == false)
 	{
-		VkImageViewCreateInfo backbufferViewCreateInfo;
-		backbufferViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-		backbufferViewCreateInfo.pNext = NULL;
-		backbufferViewCreateInfo.flags = 0;
-		backbufferViewCreateInfo.image = swapchainImages[i];
-		backbufferViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		backbufferViewCreateInfo.format = colorFormat;
-		backbufferViewCreateInfo.components =
-		{
-			VK_COMPONENT_SWIZZLE_R,
-			VK_COMPONENT_SWIZZLE_G,
-			VK_COMPONENT_SWIZZLE_B,
-			VK_COMPONENT_SWIZZLE_A
-		};
-		backbufferViewCreateInfo.subresourceRange =
-		{
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			0,
-			1,
-			0,
-			1
-		};
+		Log(LogSeverity_Warning, "No depth format can be sampled, occlusion culling is disabled");
+		occlusionCulling = false;
+	}
 
-		result = vkCreateImageView(device, &backbufferViewCreateInfo, NULL, &backbufferViews[i]);
+	if (occlusionCulling == false && FindDepthFormat(physicalDevice, 0, &depthFormat) == false)
+	{
+		std::cout << "No supported depth format" << std::endl;
+		return 1;
+	}
 
-		if (result != VK_SUCCESS)
+	// Each window's scene renders into the top left of a full size offscreen target, at a scale picked
+	// from GPU frame time, and is upscaled into its backbuffer. Scaling only changes the render area,
+	// so the targets are never reallocated. Occlusion culling only samples the first window's depth.
+	WindowTargets windowTargets[Swapchain::MaxSwapchains];
+
+	for (uint32_t i = 0; i < windowCount; ++i)
+	{
+		WindowTargets& targets = windowTargets[i];
+		VkExtent2D windowExtent = swapchains[i].GetExtent();
+		bool sampleDepth = occlusionCulling && i == 0;
+
+		if (CreateRenderTarget(device, memoryProperties.memoryTypes, windowExtent.width, windowExtent.height, colorFormat,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT, &targets.sceneImage, &targets.sceneMemory, &targets.sceneView) == false)
 		{
-			std::cout << "Couldn't create backbuffer image view " << i << std::endl;
+			std::cout << "Couldn't create scene render target for window " << i << std::endl;
 			return 1;
 		}
 
-		VkFramebufferCreateInfo framebufferCreateInfo;
-		framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferCreateInfo.pNext = NULL;
-		framebufferCreateInfo.flags = 0;
-		framebufferCreateInfo.renderPass = renderPass;
-		framebufferCreateInfo.attachmentCount = 1;
-		VkImageView backbufferView = backbufferViews[i];
-		framebufferCreateInfo.pAttachments = &backbufferView;
-		framebufferCreateInfo.width = surfaceCapabilities.currentExtent.width;
-		framebufferCreateInfo.height = surfaceCapabilities.currentExtent.height;
-		framebufferCreateInfo.layers = 1;
-
-		VkFramebuffer framebuffer = VK_NULL_HANDLE;
-		result = vkCreateFramebuffer(device, &framebufferCreateInfo, NULL, &framebuffer);
-
-		framebuffers[i] = framebuffer;
-
-		if (result != VK_SUCCESS)
+		if (CreateRenderTarget(device, memoryProperties.memoryTypes, windowExtent.width, windowExtent.height, depthFormat,
+			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | (sampleDepth ? VK_IMAGE_USAGE_SAMPLED_BIT : VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT), VK_IMAGE_ASPECT_DEPTH_BIT,
+			&targets.depthImage, &targets.depthMemory, &targets.depthView) == false)
 		{
-			std::cout << "Couldn't create framebuffer" << std::endl;
+			std::cout << "Couldn't create depth render target for window " << i << std::endl;
 			return 1;
 		}
 	}
 
-	VkCommandPoolCreateInfo commandPoolCreateInfo;
+	// One object per draw, tested against the depth of the frame that last used the same slot
+	HiZOcclusion hizOcclusion;
+
+	if (occlusionCulling && hizOcclusion.Create(device, memoryProperties.memoryTypes, windowTargets[0].depthView, swapchains[0].GetExtent().width, swapchains[0].GetExtent().height, drawCount, FramesInFlight) == false)
+	{
+		std::cout << "Couldn't create occlusion culling resources" << std::endl;
+		return 1;
+	}
+
+	// Enough buffers for every frame in flight plus some queued for the writer. Presentation is FIFO,
+	// so the stream is tagged with a typical 60 Hz refresh.
+	if (readbackPath != NULL && frameReadback.Create(device, memoryProperties.memoryTypes, colorFormat, swapchains[0].GetExtent().width, swapchains[0].GetExtent().height,
+		readbackSlots > FramesInFlight ? readbackSlots : FramesInFlight, readbackFormat, 60) == false)
+	{
+		std::cout << "Couldn't create readback buffers" << std::endl;
+		return 1;
+	}
+
+	// Scaling needs a blit, without one each window's scene is copied at full resolution
+	VkFormatProperties colorFormatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, colorFormat, &colorFormatProperties);
+	bool sceneBlit = (colorFormatProperties.optimalTilingFeatures & (VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT)) == (VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT);
+	VkFilter sceneFilter = (colorFormatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+	if (targetFrameTime > 0.0f && sceneBlit == false)
+	{
+		Log(LogSeverity_Warning, "Format %d can't be blitted, dynamic resolution is disabled", colorFormat);
+		targetFrameTime = 0.0f;
+	}
+
+	DynamicResolution dynamicResolution;
+	dynamicResolution.Initialize(targetFrameTime, minResolutionScale, 1.0f);
+
+	VkCommandPoolCreateInfo commandPoolCreateInfo;
 	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	commandPoolCreateInfo.pNext = NULL;
 	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
@@ -592,6 +879,19 @@ int main(char** argv, int argc)
 		return 1;
 	}
 
+	VkCommandPool computeCommandPool = VK_NULL_HANDLE;
+
+	if (asyncCompute)
+	{
+		commandPoolCreateInfo.queueFamilyIndex = computeQueueIndex;
+
+		if (vkCreateCommandPool(device, &commandPoolCreateInfo, NULL, &computeCommandPool) != VK_SUCCESS)
+		{
+			std::cout << "Couldn't create compute command pool" << std::endl;
+			return 1;
+		}
+	}
+
 	// Initialise framebuffers
 	{
 		VkCommandBufferAllocateInfo initCommandBufferAllocateInfo;
@@ -633,20 +933,25 @@ int main(char** argv, int argc)
 			return 1;
 		}
 
-		for (size_t i = 0; i < swapchainImages.size(); ++i)
+		for (uint32_t window = 0; window < windowCount; ++window)
 		{
-			VkImageMemoryBarrier initBackbufferBarrier;
-			initBackbufferBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-			initBackbufferBarrier.pNext = NULL;
-			initBackbufferBarrier.srcAccessMask = 0;
-			initBackbufferBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-			initBackbufferBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			initBackbufferBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-			initBackbufferBarrier.srcQueueFamilyIndex = 0;
-			initBackbufferBarrier.dstQueueFamilyIndex = 0;
-			initBackbufferBarrier.image = swapchainImages[i];
-			initBackbufferBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-			vkCmdPipelineBarrier(initCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, 0, NULL, 0, NULL, 1, &initBackbufferBarrier);
+			const std::vector<VkImage>& swapchainImages = swapchains[window].GetImages();
+
+			for (size_t i = 0; i < swapchainImages.size(); ++i)
+			{
+				VkImageMemoryBarrier initBackbufferBarrier;
+				initBackbufferBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				initBackbufferBarrier.pNext = NULL;
+				initBackbufferBarrier.srcAccessMask = 0;
+				initBackbufferBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+				initBackbufferBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+				initBackbufferBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+				initBackbufferBarrier.srcQueueFamilyIndex = 0;
+				initBackbufferBarrier.dstQueueFamilyIndex = 0;
+				initBackbufferBarrier.image = swapchainImages[i];
+				initBackbufferBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+				vkCmdPipelineBarrier(initCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, 0, NULL, 0, NULL, 1, &initBackbufferBarrier);
+			}
 		}
 
 		result = vkEndCommandBuffer(initCommandBuffer);
@@ -657,47 +962,31 @@ int main(char** argv, int argc)
 			return 1;
 		}
 
-		VkSubmitInfo initSubmitInfo;
-		initSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		initSubmitInfo.pNext = NULL;
-		initSubmitInfo.waitSemaphoreCount = 0;
-		initSubmitInfo.pWaitSemaphores = NULL;
-		initSubmitInfo.pWaitDstStageMask = NULL;
-		initSubmitInfo.commandBufferCount = 1;
-		initSubmitInfo.pCommandBuffers = &initCommandBuffer;
-		initSubmitInfo.signalSemaphoreCount = 0;
-		initSubmitInfo.pSignalSemaphores = NULL;
-		result = vkQueueSubmit(queue, 1, &initSubmitInfo, VK_NULL_HANDLE);
-		if (result != VK_SUCCESS)
-		{
-			std::cout << "Couldn't submit command buffer" << std::endl;
-			return 1;
-		}
-
-		result = vkQueueWaitIdle(queue);
-		if (result != VK_SUCCESS)
-		{
-			std::cout << "Wait idle failed" << std::endl;
-			return 1;
-		}
-
-		vkFreeCommandBuffers(device, commandPool, 1, &initCommandBuffer);
+		// Goes to the GPU with the first frame rather than in a submission of its own
+		submissionScheduler.AddCommandBuffer(queue, initCommandBuffer);
+		deletionQueue.RetireCommandBuffer(commandPool, initCommandBuffer, 1);
 	}
 
-	// Initialise drawable
-	VkDescriptorSetLayoutBinding descriptorSetLayoutBinding;
-	descriptorSetLayoutBinding.binding = 0;
-	descriptorSetLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	descriptorSetLayoutBinding.descriptorCount = 1;
-	descriptorSetLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	descriptorSetLayoutBinding.pImmutableSamplers = NULL;
+	// Initialise drawable. Binding 1 is the streamed texture, rewritten as its levels arrive.
+	VkDescriptorSetLayoutBinding descriptorSetLayoutBindings[2];
+	descriptorSetLayoutBindings[0].binding = 0;
+	descriptorSetLayoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	descriptorSetLayoutBindings[0].descriptorCount = 1;
+	descriptorSetLayoutBindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	descriptorSetLayoutBindings[0].pImmutableSamplers = NULL;
+
+	descriptorSetLayoutBindings[1].binding = 1;
+	descriptorSetLayoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorSetLayoutBindings[1].descriptorCount = 1;
+	descriptorSetLayoutBindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	descriptorSetLayoutBindings[1].pImmutableSamplers = NULL;
 
 	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo;
 	descriptorSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 	descriptorSetLayoutCreateInfo.pNext = NULL;
 	descriptorSetLayoutCreateInfo.flags = 0;
-	descriptorSetLayoutCreateInfo.bindingCount = 1;
-	descriptorSetLayoutCreateInfo.pBindings = &descriptorSetLayoutBinding;
+	descriptorSetLayoutCreateInfo.bindingCount = 2;
+	descriptorSetLayoutCreateInfo.pBindings = descriptorSetLayoutBindings;
 
 	VkDescriptorSetLayout descriptorSetLayout;
 	result = vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCreateInfo, NULL, &descriptorSetLayout);
@@ -725,59 +1014,12 @@ int main(char** argv, int argc)
 	}
 
 	VkShaderModule vertModule;
-	{
-		std::ifstream vertfile("tri.vert.spv", std::ios::binary);
-		if (vertfile.is_open() == false)
-		{
-			std::cout << "Couldn't read tri.vert.spv" << std::endl;
-			return 1;
-		}
-
-		std::vector<char> contents;
-		contents.reserve(10000);
-		contents.assign(std::istreambuf_iterator<char>(vertfile), std::istreambuf_iterator<char>());
-
-		VkShaderModuleCreateInfo vertModuleCreateInfo;
-		vertModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		vertModuleCreateInfo.pNext = NULL;
-		vertModuleCreateInfo.flags = 0;
-		vertModuleCreateInfo.codeSize = contents.size();
-		vertModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(contents.data());
-
-		result = vkCreateShaderModule(device, &vertModuleCreateInfo, NULL, &vertModule);
-		if (result != VK_SUCCESS)
-		{
-			std::cout << "Couldn't create vert shader module" << std::endl;
-			return 1;
-		}
-	}
-
 	VkShaderModule fragModule;
-	{
-		std::ifstream fragfile("tri.frag.spv", std::ios::binary);
-		if (fragfile.is_open() == false)
-		{
-			std::cout << "Couldn't read tri.frag.spv" << std::endl;
-			return 1;
-		}
-
-		std::vector<char> contents;
-		contents.reserve(10000);
-		contents.assign(std::istreambuf_iterator<char>(fragfile), std::istreambuf_iterator<char>());
-
-		VkShaderModuleCreateInfo vertModuleCreateInfo;
-		vertModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		vertModuleCreateInfo.pNext = NULL;
-		vertModuleCreateInfo.flags = 0;
-		vertModuleCreateInfo.codeSize = contents.size();
-		vertModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(contents.data());
 
-		result = vkCreateShaderModule(device, &vertModuleCreateInfo, NULL, &fragModule);
-		if (result != VK_SUCCESS)
-		{
-			std::cout << "Couldn't create vert shader module" << std::endl;
-			return 1;
-		}
+	if (CreateShaderModule(device, tri_vert_spv, sizeof(tri_vert_spv), &vertModule) == false || CreateShaderModule(device, tri_frag_spv, sizeof(tri_frag_spv), &fragModule) == false)
+	{
+		std::cout << "Couldn't create shader modules" << std::endl;
+		return 1;
 	}
 
 	VkPipelineCacheCreateInfo pipelineCacheCreateInfo;
@@ -795,197 +1037,239 @@ int main(char** argv, int argc)
 		return 1;
 	}
 
-	VkPipeline pipeline;
+	// Depth is only kept past the pass when occlusion culling samples it, otherwise it never leaves
+	// tile memory and, like the effect intermediates, may be lazily allocated. Every window's pass has
+	// the same formats, so pipelines built against the first are compatible with all of them.
+	for (uint32_t i = 0; i < windowCount; ++i)
 	{
-		VkPipelineShaderStageCreateInfo stages[2];
-		stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		stages[0].pNext = NULL;
-		stages[0].flags = 0;
-		stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-		stages[0].module = vertModule;
-		stages[0].pName = "main";
-		stages[0].pSpecializationInfo = NULL;
-
-		stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		stages[1].pNext = NULL;
-		stages[1].flags = 0;
-		stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		stages[1].module = fragModule;
-		stages[1].pName = "main";
-		stages[1].pSpecializationInfo = NULL;
-
-		VkVertexInputBindingDescription vertexBindingDescription;
-		vertexBindingDescription.binding = 0;
-		vertexBindingDescription.stride = sizeof(float) * 6;
-		vertexBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-		VkVertexInputAttributeDescription vertexAttributes[2];
-		vertexAttributes[0].binding = 0;
-		vertexAttributes[0].location = 0;
-		vertexAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertexAttributes[0].offset = 0;
-
-		vertexAttributes[1].binding = 0;
-		vertexAttributes[1].location = 1;
-		vertexAttributes[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertexAttributes[1].offset = sizeof(float) * 3;
-
-		VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo;
-		vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		vertexInputCreateInfo.pNext = NULL;
-		vertexInputCreateInfo.flags = 0;
-		vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
-		vertexInputCreateInfo.pVertexBindingDescriptions = &vertexBindingDescription;
-		vertexInputCreateInfo.vertexAttributeDescriptionCount = 2;
-		vertexInputCreateInfo.pVertexAttributeDescriptions = vertexAttributes;
-
-		VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo;
-		inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-		inputAssemblyCreateInfo.pNext = NULL;
-		inputAssemblyCreateInfo.flags = 0;
-		inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-		inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
-		
-		VkPipelineViewportStateCreateInfo viewportCreateInfo;
-		viewportCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-		viewportCreateInfo.pNext = NULL;
-		viewportCreateInfo.flags = 0;
-		viewportCreateInfo.viewportCount = 1;
-		viewportCreateInfo.pViewports = NULL;
-		viewportCreateInfo.scissorCount = 1;
-		viewportCreateInfo.pScissors = NULL;
-
-		VkPipelineRasterizationStateCreateInfo rasterizationCreateInfo;
-		rasterizationCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-		rasterizationCreateInfo.pNext = NULL;
-		rasterizationCreateInfo.flags = 0;
-		rasterizationCreateInfo.depthClampEnable = VK_FALSE;
-		rasterizationCreateInfo.rasterizerDiscardEnable = VK_FALSE;
-		rasterizationCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
-		rasterizationCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
-		rasterizationCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
-		rasterizationCreateInfo.depthBiasEnable = VK_FALSE;
-		rasterizationCreateInfo.depthBiasConstantFactor = 0.f;
-		rasterizationCreateInfo.depthBiasClamp = 0.f;
-		rasterizationCreateInfo.depthBiasSlopeFactor = 0.f;
-		rasterizationCreateInfo.lineWidth = 0.f;
-
-		VkPipelineMultisampleStateCreateInfo multisampleCreateInfo;
-		multisampleCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-		multisampleCreateInfo.pNext = NULL;
-		multisampleCreateInfo.flags = 0;
-		multisampleCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-		multisampleCreateInfo.sampleShadingEnable = VK_FALSE;
-		multisampleCreateInfo.minSampleShading = 0.f;
-		multisampleCreateInfo.pSampleMask = NULL;
-		multisampleCreateInfo.alphaToCoverageEnable = VK_FALSE;
-		multisampleCreateInfo.alphaToOneEnable = VK_FALSE;
-
-		VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo;
-		depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-		depthStencilCreateInfo.pNext = NULL;
-		depthStencilCreateInfo.flags = 0;
-		depthStencilCreateInfo.depthTestEnable = VK_FALSE;
-		depthStencilCreateInfo.depthWriteEnable = VK_FALSE;
-		depthStencilCreateInfo.depthCompareOp = VK_COMPARE_OP_ALWAYS;
-		depthStencilCreateInfo.depthBoundsTestEnable = VK_FALSE;
-		depthStencilCreateInfo.stencilTestEnable = VK_FALSE;
-		depthStencilCreateInfo.front = { VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_COMPARE_OP_ALWAYS, 0, 0, 0 };
-		depthStencilCreateInfo.back = { VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_COMPARE_OP_ALWAYS, 0, 0, 0 };
-		depthStencilCreateInfo.minDepthBounds = 0.f;
-		depthStencilCreateInfo.maxDepthBounds = 1.f;
-
-		VkPipelineColorBlendAttachmentState colorBlendAttachmentState;
-		colorBlendAttachmentState.blendEnable = VK_FALSE;
-		colorBlendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-		colorBlendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-		colorBlendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
-		colorBlendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-		colorBlendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-		colorBlendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
-		colorBlendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_A_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_R_BIT;
-
-		VkPipelineColorBlendStateCreateInfo colorBlendCreateInfo;
-		colorBlendCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-		colorBlendCreateInfo.pNext = NULL;
-		colorBlendCreateInfo.flags = 0;
-		colorBlendCreateInfo.logicOpEnable = VK_FALSE;
-		colorBlendCreateInfo.logicOp = VK_LOGIC_OP_CLEAR;
-		colorBlendCreateInfo.attachmentCount = 1;
-		colorBlendCreateInfo.pAttachments = &colorBlendAttachmentState;
-		colorBlendCreateInfo.blendConstants[0] = 1.f;
-		colorBlendCreateInfo.blendConstants[1] = 1.f;
-		colorBlendCreateInfo.blendConstants[2] = 1.f;
-		colorBlendCreateInfo.blendConstants[3] = 1.f;
-
-
-		VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
-
-		VkPipelineDynamicStateCreateInfo dynamicCreateInfo;
-		dynamicCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-		dynamicCreateInfo.pNext = NULL;
-		dynamicCreateInfo.flags = 0;
-		dynamicCreateInfo.dynamicStateCount = 2;
-		dynamicCreateInfo.pDynamicStates = dynamicStates;
-
-		VkGraphicsPipelineCreateInfo pipelineCreateInfo;
-		pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-		pipelineCreateInfo.pNext = NULL;
-		pipelineCreateInfo.flags = 0;
-		pipelineCreateInfo.stageCount = 2;
-		pipelineCreateInfo.pStages = stages;
-		pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
-		pipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
-		pipelineCreateInfo.pTessellationState = NULL;
-		pipelineCreateInfo.pViewportState = &viewportCreateInfo;
-		pipelineCreateInfo.pRasterizationState = &rasterizationCreateInfo;
-		pipelineCreateInfo.pMultisampleState = &multisampleCreateInfo;
-		pipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;
-		pipelineCreateInfo.pColorBlendState = &colorBlendCreateInfo;
-		pipelineCreateInfo.pDynamicState = &dynamicCreateInfo;
-		pipelineCreateInfo.renderPass = renderPass;
-		pipelineCreateInfo.layout = pipelineLayout;
-		pipelineCreateInfo.subpass = 0;
-		pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
-		pipelineCreateInfo.basePipelineIndex = 0;
-
-		result = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, NULL, &pipeline);
+		WindowTargets& targets = windowTargets[i];
+		VkExtent2D windowExtent = swapchains[i].GetExtent();
 
-		if (result != VK_SUCCESS)
+		if (targets.scenePass.Create(device, memoryProperties.memoryTypes, pipelineCache, postEffects, colorFormat, targets.sceneView, depthFormat, targets.depthView,
+			occlusionCulling && i == 0, windowExtent.width, windowExtent.height) == false)
 		{
-			std::cout << "Couldn't create graphics pipeline" << std::endl;
+			std::cout << "Couldn't create scene pass for window " << i << std::endl;
 			return 1;
 		}
 	}
 
-	VkBuffer vertBuffer;
-	VkDeviceMemory vertDeviceMemory;
+	VkRenderPass renderPass = windowTargets[0].scenePass.GetRenderPass();
+
+	// Drawn in the last subpass, over the scene and its effects
+	PerformanceHud performanceHud;
+
+	if (showHud && performanceHud.Create(device, queue, commandPool, memoryProperties.memoryTypes, pipelineCache, renderPass, windowTargets[0].scenePass.GetEffectCount(), FramesInFlight) == false)
+	{
+		std::cout << "Couldn't create performance HUD" << std::endl;
+		return 1;
+	}
+
+	// Drawn with the scene in subpass 0, so effects apply to it
+	ParticleSystem particleSystem;
+
+	if (particleCount > 0 && particleSystem.Create(device, queue, commandPool, memoryProperties.memoryTypes, pipelineCache, renderPass, 0, particleCount,
+		graphicsQueueIndex, computeQueueIndex) == false)
+	{
+		std::cout << "Couldn't create particle system" << std::endl;
+		return 1;
+	}
+
+	ManagedResource vertexResource;
+	ManagedResource indexResource;
 
 	const float buffer[3][6] = {
 		{ -1.0f, -1.0f,  0.25f,     1.0f, 0.0f, 0.0f },
 		{ 1.0f, -1.0f,  0.25f,      0.0f, 1.0f, 0.0f },
 		{ 0.0f,  1.0f,  1.0f,       0.0f, 0.0f, 1.0f },
 	};
+	const uint16_t indices[3] = { 0, 1, 2 };
+
+	const void* vertexData = buffer;
 	size_t bufferSize = sizeof(buffer);
+	const void* indexData = indices;
+	size_t indexDataSize = sizeof(indices);
+	uint32_t indexCount = 3;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+	VertexFormat vertexFormat = GetDefaultVertexFormat();
+
+	const void* meshData;
+	size_t meshSize;
+
+	if (assetPack.Find("tri", AssetType_Mesh, &meshData, &meshSize))
+	{
+		const AssetPackMeshHeader* meshHeader = (const AssetPackMeshHeader*)meshData;
+
+		if (meshSize < sizeof(AssetPackMeshHeader)
+			|| meshHeader->positionFormat > VertexPositionFormat_Half
+			|| meshHeader->attributeFormat > VertexAttributeFormat_Unorm10
+			|| (meshHeader->indexSize != 2 && meshHeader->indexSize != 4)
+			|| meshSize < GetMeshDataSize(*meshHeader))
+		{
+			std::cout << "Mesh tri in the asset pack is invalid" << std::endl;
+			return 1;
+		}
+
+		vertexFormat.position = (VertexPositionFormat)meshHeader->positionFormat;
+		vertexFormat.attribute = (VertexAttributeFormat)meshHeader->attributeFormat;
+		memcpy(vertexFormat.positionScale, meshHeader->positionScale, sizeof(vertexFormat.positionScale));
+		memcpy(vertexFormat.positionOffset, meshHeader->positionOffset, sizeof(vertexFormat.positionOffset));
+
+		if (meshHeader->vertexStride != GetVertexStride(vertexFormat))
+		{
+			std::cout << "Mesh tri in the asset pack has an unexpected vertex stride" << std::endl;
+			return 1;
+		}
+
+		vertexData = meshHeader + 1;
+		bufferSize = (size_t)meshHeader->vertexCount * meshHeader->vertexStride;
+		indexData = (const unsigned char*)meshData + GetMeshIndexDataOffset(*meshHeader);
+		indexDataSize = (size_t)meshHeader->indexCount * meshHeader->indexSize;
+		indexCount = meshHeader->indexCount;
+		indexType = meshHeader->indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	}
 
-	bool vertBufferCreated = CreateBuffer(device, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, memoryProperties.memoryTypes, (void*)buffer, bufferSize, &vertBuffer, &vertDeviceMemory);
-	
-	if (vertBufferCreated == false)
+	// Device local and sub-allocated, so the defragmenter may move them. The handles are
+	// refreshed whenever that happens.
+	if (deviceAllocator.CreateBufferWithData(queue, commandPool, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexData, bufferSize, &vertexResource) == false)
 	{
 		std::cout << "Couldn't create vertex buffer" << std::endl;
 		return 1;
 	}
 
-	VkImage texture;
-	VkDeviceMemory textureMemory;
+	if (deviceAllocator.CreateBufferWithData(queue, commandPool, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexData, indexDataSize, &indexResource) == false)
+	{
+		std::cout << "Couldn't create index buffer" << std::endl;
+		return 1;
+	}
+
+	VkBuffer vertBuffer = deviceAllocator.GetBuffer(vertexResource);
+	VkBuffer indexBuffer = deviceAllocator.GetBuffer(indexResource);
+
+	// With a prepass depth is laid down first, then each pixel is shaded once by the fragment that passes an equal test
+	VkPipeline pipeline;
+	VkPipeline prepassPipeline = VK_NULL_HANDLE;
+	MeshShaderVariant meshVariant = GetMeshShaderVariant(vertexFormat);
+
+	if (CreateMeshPipeline(device, pipelineCache, pipelineLayout, renderPass, vertModule, fragModule, vertexFormat, meshVariant, depthPrepass ? MeshDepthMode_TestEqual : MeshDepthMode_TestAndWrite, true, &pipeline) == false)
+	{
+		std::cout << "Couldn't create graphics pipeline" << std::endl;
+		return 1;
+	}
+
+	if (depthPrepass && CreateMeshPipeline(device, pipelineCache, pipelineLayout, renderPass, vertModule, VK_NULL_HANDLE, vertexFormat, meshVariant, MeshDepthMode_Prepass, true, &prepassPipeline) == false)
+	{
+		std::cout << "Couldn't create depth prepass pipeline" << std::endl;
+		return 1;
+	}
+
+	// With --shader-dir the embedded shaders are replaced whenever their sources there change.
+	// Pipelines are rebuilt on the watcher thread in the same order as above.
+	ShaderReloader shaderReloader;
+
+	if (shaderDirectory != NULL)
+	{
+		shaderReloader.AddShader("tri.vert");
+		shaderReloader.AddShader("tri.frag");
+
+		ShaderReloader::PipelineBuilder pipelineBuilder = [=](const std::vector<VkShaderModule>& modules, std::vector<VkPipeline>* pipelines)
+		{
+			VkPipeline reloadedPipeline;
+
+			if (CreateMeshPipeline(device, pipelineCache, pipelineLayout, renderPass, modules[0], modules[1], vertexFormat, meshVariant, depthPrepass ? MeshDepthMode_TestEqual : MeshDepthMode_TestAndWrite, true, &reloadedPipeline) == false)
+			{
+				return false;
+			}
+
+			pipelines->push_back(reloadedPipeline);
+
+			if (depthPrepass && CreateMeshPipeline(device, pipelineCache, pipelineLayout, renderPass, modules[0], VK_NULL_HANDLE, vertexFormat, meshVariant, MeshDepthMode_Prepass, true, &reloadedPipeline) == false)
+			{
+				vkDestroyPipeline(device, pipelines->back(), NULL);
+				pipelines->clear();
+				return false;
+			}
+
+			if (depthPrepass)
+			{
+				pipelines->push_back(reloadedPipeline);
+			}
+
+			return true;
+		};
+
+		if (shaderReloader.Start(device, shaderDirectory, pipelineBuilder) == false)
+		{
+			Log(LogSeverity_Warning, "Shader hot reload is disabled");
+		}
+	}
+
+	// Bounds of the mesh for occlusion tests
+	float meshMinimum[3];
+	float meshMaximum[3];
+	GetPositionBounds(vertexFormat, vertexData, (uint32_t)(bufferSize / GetVertexStride(vertexFormat)), meshMinimum, meshMaximum);
+
+	// A texture given on the command line overrides the one in the pack
+	TextureData textureData;
+	TextureData decodedData;
+	bool textureLoaded = false;
+	const void* packedTexture;
+	size_t packedTextureSize;
+
+	if (texturePath != NULL)
+	{
+		if (LoadTextureFile(texturePath, &textureData) == false)
+		{
+			std::cout << "Couldn't load texture " << texturePath << std::endl;
+			return 1;
+		}
+
+		textureLoaded = true;
+	}
+	else if (assetPack.Find("texture", AssetType_Texture, &packedTexture, &packedTextureSize))
+	{
+		if (LoadTextureFromMemory(packedTexture, packedTextureSize, &textureData) == false)
+		{
+			std::cout << "Couldn't load texture from the asset pack" << std::endl;
+			return 1;
+		}
+
+		textureLoaded = true;
+	}
+
+	// The streamer loads levels on demand, so the whole chain is kept on the CPU
+	uint32_t textureWidth;
+	uint32_t textureHeight;
+	VkFormat textureFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	std::vector<unsigned char> textureTexels;
+	std::vector<unsigned char> textureChain;
+	std::vector<ImageMipData> textureLevels;
 
-	// Init texture
+	if (textureLoaded)
 	{
-		const size_t width = 8;
-		const size_t height = 8;
-		const size_t numPixels = width * height;
-		const size_t textureSize = numPixels * 4;
-		unsigned char data[textureSize];
+		// Fall back to decoding on the CPU if the device can't sample the stored format
+		const TextureData* uploadData = &textureData;
+
+		if (IsTextureFormatEnabled(deviceCapabilities.enabledFeatures, textureData.format) == false || IsTextureFormatSupported(physicalDevice, textureData.format) == false)
+		{
+			if (DecompressTexture(textureData, &decodedData) == false)
+			{
+				std::cout << "Texture format " << textureData.format << " isn't supported by the device" << std::endl;
+				return 1;
+			}
+
+			uploadData = &decodedData;
+		}
+
+		textureWidth = uploadData->width;
+		textureHeight = uploadData->height;
+		textureFormat = uploadData->format;
+		textureLevels.assign(uploadData->levels.begin(), uploadData->levels.begin() + uploadData->mipLevels);
+	}
+	else
+	{
+		textureWidth = 8;
+		textureHeight = 8;
+		textureTexels.resize(textureWidth * textureHeight * 4);
 
 		const char* textureMap =
 			"........"
@@ -1001,26 +1285,55 @@ int main(char** argv, int argc)
 		unsigned char fgCol[4] = { 0,   0,   0,   255 };
 		int bufferIndex = 0;
 
-		for (int i = 0; i < numPixels; i++)
+		for (uint32_t i = 0; i < textureWidth * textureHeight; i++)
 		{
 			unsigned char* col = textureMap[i] == '#' ? fgCol : bgCol;
-			data[bufferIndex++] = col[0];
-			data[bufferIndex++] = col[1];
-			data[bufferIndex++] = col[2];
-			data[bufferIndex++] = col[3];
+			textureTexels[bufferIndex++] = col[0];
+			textureTexels[bufferIndex++] = col[1];
+			textureTexels[bufferIndex++] = col[2];
+			textureTexels[bufferIndex++] = col[3];
 		}
 
-		bool created = CreateImage2D(device, width, height, VK_FORMAT_R8G8B8A8_UNORM, memoryProperties.memoryTypes, (void*)data, textureSize, &texture, &textureMemory);
+		ImageMipData topLevel = { textureTexels.data(), textureTexels.size() };
+		textureLevels.push_back(topLevel);
+	}
 
-		if (created == false)
-		{
-			std::cout << "Couldn't create texture" << std::endl;
-			return 1;
-		}
+	// Levels can't be blitted on the GPU when they stream in one at a time, a lone RGBA8 level gets
+	// its chain generated here instead. Other formats without a chain stream as a single level.
+	if (textureLevels.size() == 1 && (textureFormat == VK_FORMAT_R8G8B8A8_UNORM || textureFormat == VK_FORMAT_R8G8B8A8_SRGB))
+	{
+		const unsigned char* topLevel = (const unsigned char*)textureLevels[0].data;
+		GenerateMipChainRGBA8(topLevel, textureWidth, textureHeight, GetMipLevelCount(textureWidth, textureHeight), &textureChain, &textureLevels);
 	}
 
+	uint32_t textureMipLevels = (uint32_t)textureLevels.size();
+
+	// Destroyed before the levels it reads from, which joins the streaming thread
+	TextureStreamer textureStreamer;
+	uint32_t streamedTexture;
+
+	if (textureStreamer.Create(device, memoryProperties.memoryTypes, &deletionQueue, FramesInFlight, TextureMemoryBudget, TextureUploadBudgetPerFrame) == false)
+	{
+		std::cout << "Couldn't create texture streamer" << std::endl;
+		return 1;
+	}
+
+	// Called on the streaming thread, the levels aren't modified once streaming starts
+	TextureStreamer::MipLoader textureLoader = [&textureLevels](uint32_t mipLevel, std::vector<unsigned char>* data)
+	{
+		const unsigned char* texels = (const unsigned char*)textureLevels[mipLevel].data;
+		data->assign(texels, texels + textureLevels[mipLevel].dataSize);
+		return true;
+	};
+
+	if (textureStreamer.AddTexture(textureWidth, textureHeight, textureMipLevels, textureFormat, textureLoader, &streamedTexture) == false)
+	{
+		std::cout << "Couldn't create texture" << std::endl;
+		return 1;
+	}
+
+	// LODs are relative to the largest resident level, the view covers only those
 	VkSampler textureSampler;
-	VkImageView textureImageView;
 
 	{
 		VkSamplerCreateInfo samplerCreateInfo;
@@ -1029,7 +1342,7 @@ int main(char** argv, int argc)
 		samplerCreateInfo.flags = 0;
 		samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
 		samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
-		samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 		samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
 		samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
 		samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
@@ -1039,7 +1352,7 @@ int main(char** argv, int argc)
 		samplerCreateInfo.compareEnable = VK_FALSE;
 		samplerCreateInfo.compareOp = VK_COMPARE_OP_NEVER;
 		samplerCreateInfo.minLod = 0.0f;
-		samplerCreateInfo.maxLod = 0.0f;
+		samplerCreateInfo.maxLod = (float)textureMipLevels;
 		samplerCreateInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_WHITE;
 		samplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
 
@@ -1050,48 +1363,69 @@ int main(char** argv, int argc)
 			std::cout << "Couldn't create texture sampler" << std::endl;
 			return 1;
 		}
+	}
 
-		VkImageViewCreateInfo imageViewCreateInfo;
-		imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-		imageViewCreateInfo.pNext = NULL;
-		imageViewCreateInfo.flags = 0;
-		imageViewCreateInfo.image = texture;
-		imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		imageViewCreateInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
-		imageViewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
-		imageViewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	// Scene: every draw is a leaf under one of the row nodes of a grid, all below a root. For one
+	// draw the grid is a single cell with identity transforms. Rows move one at a time, so most of
+	// the hierarchy is unchanged from frame to frame.
+	uint32_t rowCount = (uint32_t)ceil(sqrt((double)drawCount));
+	float cellSize = 2.0f / rowCount;
+
+	TransformHierarchy transforms;
+	transforms.Initialize(FramesInFlight);
+
+	float nodeMatrix[16] = { 1.0f, 0.0f, 0.0f, 0.0f,
+							 0.0f, 1.0f, 0.0f, 0.0f,
+							 0.0f, 0.0f, 1.0f, 0.0f,
+							 0.0f, 0.0f, 0.0f, 1.0f };
+	uint32_t rootNode = transforms.AddNode(TransformHierarchy::NoParent, nodeMatrix);
+	std::vector<uint32_t> rowNodes(rowCount);
+	std::vector<float> rowPositions(rowCount);
+	std::vector<uint32_t> drawNodes(drawCount);
+
+	for (uint32_t row = 0; row < rowCount; ++row)
+	{
+		rowPositions[row] = rowCount > 1 ? -1.0f + (row + 0.5f) * cellSize : 0.0f;
+		nodeMatrix[13] = rowPositions[row];
+		rowNodes[row] = transforms.AddNode(rootNode, nodeMatrix);
+	}
 
-		result = vkCreateImageView(device, &imageViewCreateInfo, NULL, &textureImageView);
+	nodeMatrix[0] = 1.0f / rowCount;
+	nodeMatrix[5] = 1.0f / rowCount;
+	nodeMatrix[13] = 0.0f;
 
-		if (result != VK_SUCCESS)
-		{
-			std::cout << "Couldn't create texture image view" << std::endl;
-			return 1;
-		}
+	for (uint32_t i = 0; i < drawCount; ++i)
+	{
+		nodeMatrix[12] = rowCount > 1 ? -1.0f + (i % rowCount + 0.5f) * cellSize : 0.0f;
+		drawNodes[i] = transforms.AddNode(rowNodes[i / rowCount], nodeMatrix);
 	}
 
-	VkBuffer uniformBuffer;
-	VkDeviceMemory uniformDeviceMemory;
-	size_t uniformSize = sizeof(float)*16;
-	bool uniformBufferCreated = CreateBuffer(device, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, memoryProperties.memoryTypes, NULL, uniformSize, &uniformBuffer, &uniformDeviceMemory);
+	transforms.Update();
+
+	// Draw owning each instance, for refreshing culling bounds when transforms change
+	const uint32_t NoDraw = 0xffffffff;
+	std::vector<uint32_t> drawOfInstance(transforms.GetNodeCount(), NoDraw);
 
-	if (uniformBufferCreated == false)
+	for (uint32_t i = 0; i < drawCount; ++i)
 	{
-		std::cout << "Couldn't create uniform buffer" << std::endl;
-		return 1;
+		drawOfInstance[transforms.GetInstanceIndex(drawNodes[i])] = i;
 	}
 
-	VkDescriptorPoolSize descriptorPoolSize;
-	descriptorPoolSize.descriptorCount = 1;
-	descriptorPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	size_t uniformSize = sizeof(float)*24;
+
+	VkDescriptorPoolSize descriptorPoolSizes[2];
+	descriptorPoolSizes[0].descriptorCount = FramesInFlight;
+	descriptorPoolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	descriptorPoolSizes[1].descriptorCount = FramesInFlight;
+	descriptorPoolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 
 	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo;
 	descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	descriptorPoolCreateInfo.pNext = NULL;
 	descriptorPoolCreateInfo.flags = 0;
-	descriptorPoolCreateInfo.maxSets = 1;
-	descriptorPoolCreateInfo.poolSizeCount = 1;
-	descriptorPoolCreateInfo.pPoolSizes = &descriptorPoolSize;
+	descriptorPoolCreateInfo.maxSets = FramesInFlight;
+	descriptorPoolCreateInfo.poolSizeCount = 2;
+	descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes;
 
 	VkDescriptorPool descriptorPool;
 	result = vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, NULL, &descriptorPool);
@@ -1099,105 +1433,365 @@ int main(char** argv, int argc)
 	if (result != VK_SUCCESS)
 	{
 		std::cout << "Couldn't create descriptor pool" << std::endl;
+		return 1;
 	}
 
-	VkDescriptorSet descriptorSet;
-	VkDescriptorSetAllocateInfo descriptorSetAllocateInfo;
-	descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	descriptorSetAllocateInfo.pNext = NULL;
-	descriptorSetAllocateInfo.descriptorPool = descriptorPool; 
-	descriptorSetAllocateInfo.descriptorSetCount = 1;
-	descriptorSetAllocateInfo.pSetLayouts = &descriptorSetLayout;
-	result = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, &descriptorSet);
+	// Each frame in flight gets its own command buffer, sync objects and uniforms, so recording
+	// the next frame never touches anything the GPU may still be reading
+	FrameResources frames[FramesInFlight];
 
-	if (result != VK_SUCCESS)
+	for (uint32_t i = 0; i < FramesInFlight; ++i)
 	{
-		std::cout << "Couldn't allocate descriptor set" << std::endl;
-		return 1;
-	}
+		FrameResources& frame = frames[i];
+		frame.frameIndex = 0;
+		frame.textureStale = true;
+
+		VkCommandBufferAllocateInfo commandBufferAllocateInfo;
+		commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		commandBufferAllocateInfo.pNext = NULL;
+		commandBufferAllocateInfo.commandPool = commandPool;
+		commandBufferAllocateInfo.commandBufferCount = 1;
+		commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		result = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &frame.commandBuffer);
+
+		if (result != VK_SUCCESS)
+		{
+			std::cout << "Couldn't allocate command buffer" << std::endl;
+			return 1;
+		}
+
+		frame.computeCommandBuffer = VK_NULL_HANDLE;
+		commandBufferAllocateInfo.commandPool = computeCommandPool;
+
+		if (asyncCompute && vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &frame.computeCommandBuffer) != VK_SUCCESS)
+		{
+			std::cout << "Couldn't allocate compute command buffer" << std::endl;
+			return 1;
+		}
 
-	VkDescriptorBufferInfo uniformBufferInfo;
-	uniformBufferInfo.buffer = uniformBuffer;
-	uniformBufferInfo.offset = 0;
-	uniformBufferInfo.range = uniformSize;
+		// Signalled so the first wait on it returns immediately
+		VkFenceCreateInfo fenceCreateInfo;
+		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceCreateInfo.pNext = NULL;
+		fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+		result = vkCreateFence(device, &fenceCreateInfo, NULL, &frame.fence);
 
-	VkWriteDescriptorSet uniformWrite;
-	uniformWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	uniformWrite.pNext = NULL;
-	uniformWrite.dstSet = descriptorSet;
-	uniformWrite.dstBinding = 0;
-	uniformWrite.dstArrayElement = 0;
-	uniformWrite.descriptorCount = 1;
-	uniformWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uniformWrite.pImageInfo = NULL;
-	uniformWrite.pBufferInfo = &uniformBufferInfo;
-	uniformWrite.pTexelBufferView = NULL;
-	vkUpdateDescriptorSets(device, 1, &uniformWrite, 0, NULL);
+		if (result != VK_SUCCESS)
+		{
+			std::cout << "Couldn't create frame fence" << std::endl;
+			return 1;
+		}
+
+		VkSemaphoreCreateInfo semaphoreCreateInfo;
+		semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreCreateInfo.pNext = NULL;
+		semaphoreCreateInfo.flags = 0;
+
+		if (vkCreateSemaphore(device, &semaphoreCreateInfo, NULL, &frame.renderCompleteSemaphore) != VK_SUCCESS)
+		{
+			std::cout << "Couldn't create frame semaphores" << std::endl;
+			return 1;
+		}
+
+		if (CreateBuffer(device, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, memoryProperties.memoryTypes, NULL, uniformSize, &frame.uniformBuffer, &frame.uniformMemory) == false)
+		{
+			std::cout << "Couldn't create uniform buffer" << std::endl;
+			return 1;
+		}
+
+		if (CreateBuffer(device, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, memoryProperties.memoryTypes, NULL, transforms.GetNodeCount() * MeshInstanceStride, &frame.instanceBuffer, &frame.instanceMemory) == false
+			|| vkMapMemory(device, frame.instanceMemory, 0, VK_WHOLE_SIZE, 0, &frame.mappedInstances) != VK_SUCCESS)
+		{
+			std::cout << "Couldn't create instance buffer" << std::endl;
+			return 1;
+		}
+
+		VkDescriptorSetAllocateInfo descriptorSetAllocateInfo;
+		descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		descriptorSetAllocateInfo.pNext = NULL;
+		descriptorSetAllocateInfo.descriptorPool = descriptorPool;
+		descriptorSetAllocateInfo.descriptorSetCount = 1;
+		descriptorSetAllocateInfo.pSetLayouts = &descriptorSetLayout;
+		result = vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, &frame.descriptorSet);
+
+		if (result != VK_SUCCESS)
+		{
+			std::cout << "Couldn't allocate descriptor set" << std::endl;
+			return 1;
+		}
 
+		VkDescriptorBufferInfo uniformBufferInfo;
+		uniformBufferInfo.buffer = frame.uniformBuffer;
+		uniformBufferInfo.offset = 0;
+		uniformBufferInfo.range = uniformSize;
+
+		VkWriteDescriptorSet uniformWrite;
+		uniformWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		uniformWrite.pNext = NULL;
+		uniformWrite.dstSet = frame.descriptorSet;
+		uniformWrite.dstBinding = 0;
+		uniformWrite.dstArrayElement = 0;
+		uniformWrite.descriptorCount = 1;
+		uniformWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		uniformWrite.pImageInfo = NULL;
+		uniformWrite.pBufferInfo = &uniformBufferInfo;
+		uniformWrite.pTexelBufferView = NULL;
+		vkUpdateDescriptorSets(device, 1, &uniformWrite, 0, NULL);
+	}
 
 	float t = 0.0f;
 
-	while (renderWindow.IsOpen())
+	// Average wall time per frame, for comparing --robust-buffer-access runs
+	uint32_t frameCount = 0;
+	uint64_t completedFrameIndex = 0;
+	double gpuTimeTotal = 0.0;
+	double resolutionScaleTotal = 0.0;
+	uint32_t gpuTimeSamples = 0;
+	std::chrono::high_resolution_clock::time_point frameStart = std::chrono::high_resolution_clock::now();
+	std::chrono::high_resolution_clock::time_point lastFrameStart = frameStart;
+
+	// The previous frame's particle draw. The buffers it reads are the ones the next simulation
+	// rewrites, so with a separate compute queue that simulation waits for it.
+	QueueSyncPoint particlesDrawn;
+	particlesDrawn.queue = VK_NULL_HANDLE;
+	particlesDrawn.semaphore = VK_NULL_HANDLE;
+	particlesDrawn.value = 0;
+	double hudUpdateTotal = 0.0;
+	uint64_t emittedTotal = 0;
+
+	std::vector<ManagedResource> relocatedResources;
+	std::vector<uint32_t> changedTextures;
+	uint32_t textureViewChanges = 0;
+
+	// Draws go through the render queue, --draw-count repeats the mesh to load the sort and recording
+	RenderQueue renderQueue;
+	uint32_t meshPipelineId = renderQueue.AddPipeline(pipeline, pipelineLayout);
+	uint32_t frameMaterialId = renderQueue.AddMaterial(frames[0].descriptorSet);
+	uint32_t meshId = renderQueue.AddMesh(vertBuffer, indexBuffer, indexType);
+	uint32_t prepassPipelineId = depthPrepass ? renderQueue.AddPipeline(prepassPipeline, pipelineLayout) : 0;
+
+	// Pipelines are captured as built from the embedded shaders
+	FrameCapture frameCapture;
+
+	if (capturePath != NULL && shaderDirectory != NULL)
+	{
+		Log(LogSeverity_Warning, "Captures record the built in shaders, reloaded ones aren't captured");
+	}
+
+	// Every draw repeats the mesh, so their bounds are its bounds in world space
+	float meshCenter[3];
+	float meshExtent[3];
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		meshCenter[axis] = (meshMinimum[axis] + meshMaximum[axis]) * 0.5f;
+		meshExtent[axis] = (meshMaximum[axis] - meshMinimum[axis]) * 0.5f;
+	}
+
+	std::vector<OcclusionBounds> objectBounds(drawCount);
+
+	for (uint32_t i = 0; i < drawCount; ++i)
+	{
+		TransformBounds(transforms.GetWorld(drawNodes[i]), meshCenter, meshExtent, objectBounds[i].center, objectBounds[i].extent);
+		objectBounds[i].center[3] = 0.0f;
+		objectBounds[i].extent[3] = 0.0f;
+	}
+
+	// CPU frustum culling runs before the queue is filled, so culled draws never reach the sort
+	CullingVolumes cullingVolumes;
+	FrustumCuller frustumCuller;
+	std::vector<uint32_t> frustumVisible;
+
+	if (frustumCulling)
+	{
+		for (uint32_t i = 0; i < drawCount; ++i)
+		{
+			cullingVolumes.AddBox(objectBounds[i].center, objectBounds[i].extent);
+		}
+
+		frustumCuller.Start(0, true);
+	}
+
+	uint64_t transformsRecomputedTotal = 0;
+	uint64_t instancesWrittenTotal = 0;
+	uint64_t frustumCulledTotal = 0;
+	uint64_t culledDrawTotal = 0;
+	uint64_t sortPassTotal = 0;
+	uint64_t bindTotal = 0;
+	uint64_t skippedBindTotal = 0;
+
+	while (AreWindowsOpen(renderWindows, windowCount) && (frameLimit == 0 || frameCount < frameLimit))
 	{
 		t += 0.0001f;
 
-		void* mappedUniform;
-		result = vkMapMemory(device, uniformDeviceMemory, 0, uniformSize, 0, &mappedUniform);
+		std::chrono::high_resolution_clock::time_point thisFrameStart = std::chrono::high_resolution_clock::now();
+		float cpuMilliseconds = std::chrono::duration<float, std::milli>(thisFrameStart - lastFrameStart).count();
+		lastFrameStart = thisFrameStart;
 
-		float uniformData[16] = { cos(t), sin(t), 0.0f, 0.0f,
-								  -sin(t), cos(t), 0.0f, 0.0f,
-								  0.0f, 0.0f, 1.0f, 0.0f,
-								  0.0f, 0.0f, 0.0f, 1.0f };
+		// Frames are numbered from 1. Waiting for the fence of the frame that last used this slot
+		// also means every frame before it has completed, the queue executes them in order.
+		uint64_t frameIndex = frameCount + 1;
+		uint32_t frameSlot = (uint32_t)(frameIndex % FramesInFlight);
+		FrameResources& frame = frames[frameSlot];
+
+		result = vkWaitForFences(device, 1, &frame.fence, VK_TRUE, UINT64_MAX);
 
 		if (result != VK_SUCCESS)
 		{
-			std::cout << "Unable to map uniform memory" << std::endl;
+			std::cout << "Wait for frame fence failed" << std::endl;
 			return 1;
 		}
 
-		memcpy(mappedUniform, uniformData, uniformSize);
-		vkUnmapMemory(device, uniformDeviceMemory);
+		if (frame.frameIndex > completedFrameIndex)
+		{
+			completedFrameIndex = frame.frameIndex;
+		}
 
-		VkSemaphoreCreateInfo presentCompleteSemaphoreCreateInfo;
-		presentCompleteSemaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-		presentCompleteSemaphoreCreateInfo.pNext = NULL;
-		presentCompleteSemaphoreCreateInfo.flags = 0;
+		// Later frames are checked without waiting, so read back frames reach the writer as soon as
+		// they land rather than a whole ring of frames in flight later
+		if (readbackPath != NULL)
+		{
+			for (uint32_t i = 0; i < FramesInFlight; ++i)
+			{
+				if (frames[i].frameIndex > completedFrameIndex && vkGetFenceStatus(device, frames[i].fence) == VK_SUCCESS)
+				{
+					completedFrameIndex = frames[i].frameIndex;
+				}
+			}
+
+			frameReadback.Poll(completedFrameIndex);
+		}
 
-		VkSemaphore presentCompleteSemaphore;
-		result = vkCreateSemaphore(device, &presentCompleteSemaphoreCreateInfo, NULL, &presentCompleteSemaphore);
+		deletionQueue.Collect(completedFrameIndex);
 
-		if (result != VK_SUCCESS)
+		// Rebuilt pipelines are swapped in between frames, the ones they replace were last used by
+		// the frame before this one
+		ShaderReloader::Reload shaderReload;
+
+		if (shaderReloader.TakeReload(&shaderReload))
 		{
-			std::cout << "Couldn't create present complete semaphore" << std::endl;
-			return 1;
+			deletionQueue.RetirePipeline(pipeline, frameCount);
+			deletionQueue.RetireShaderModule(vertModule, frameCount);
+			deletionQueue.RetireShaderModule(fragModule, frameCount);
+
+			vertModule = shaderReload.modules[0];
+			fragModule = shaderReload.modules[1];
+			pipeline = shaderReload.pipelines[0];
+			renderQueue.SetPipeline(meshPipelineId, pipeline, pipelineLayout);
+
+			if (depthPrepass)
+			{
+				deletionQueue.RetirePipeline(prepassPipeline, frameCount);
+				prepassPipeline = shaderReload.pipelines[1];
+				renderQueue.SetPipeline(prepassPipelineId, prepassPipeline, pipelineLayout);
+			}
 		}
+		submissionScheduler.BeginFrame(frameIndex, completedFrameIndex);
 
-		uint32_t currentSwapImage;
-		result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, presentCompleteSemaphore, VK_NULL_HANDLE, &currentSwapImage);
+		// Results of the occlusion test recorded the last time this slot was used
+		uint32_t visibilityCount = 0;
+		const uint32_t* visibility = occlusionCulling ? hizOcclusion.GetVisibility(frameSlot, &visibilityCount) : NULL;
 
-		if (result != VK_SUCCESS)
+		// GPU time of the frame that last used this slot picks the scale of this one
+		float gpuMilliseconds = -1.0f;
+
+		if (gpuTimer.GetElapsed(frameSlot, &gpuMilliseconds))
 		{
-			std::cout << "Couldn't aquire swapchain image" << std::endl;
+			gpuTimeTotal += gpuMilliseconds;
+			resolutionScaleTotal += dynamicResolution.GetScale();
+			++gpuTimeSamples;
+			dynamicResolution.Update(gpuMilliseconds);
+		}
 
-			// if out of date respond to window resize?
-			return 1;
+		relocatedResources.clear();
+		deviceAllocator.BeginFrame(frameIndex, completedFrameIndex, &relocatedResources);
+
+		for (size_t i = 0; i < relocatedResources.size(); ++i)
+		{
+			if (relocatedResources[i] == vertexResource)
+			{
+				vertBuffer = deviceAllocator.GetBuffer(vertexResource);
+			}
+			else if (relocatedResources[i] == indexResource)
+			{
+				indexBuffer = deviceAllocator.GetBuffer(indexResource);
+			}
 		}
-		
-		VkCommandBufferAllocateInfo commandBufferAllocateInfo;
-		commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		commandBufferAllocateInfo.pNext = NULL;
-		commandBufferAllocateInfo.commandPool = commandPool;
-		commandBufferAllocateInfo.commandBufferCount = 1;
-		commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		VkCommandBuffer commandBuffer;
-		result = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &commandBuffer);
+
+		if (frameIndex % 60 == 0)
+		{
+			memoryBudget.Update();
+		}
+
+		// One row moves each frame, only its subtree is recomputed and rewritten
+		if (rowCount > 1)
+		{
+			uint32_t movingRow = (uint32_t)(frameCount % rowCount);
+			float rowMatrix[16];
+			memcpy(rowMatrix, transforms.GetLocal(rowNodes[movingRow]), sizeof(rowMatrix));
+			rowMatrix[13] = rowPositions[movingRow] + sinf(t * 1000.0f + movingRow) * cellSize * 0.1f;
+			transforms.SetLocal(rowNodes[movingRow], rowMatrix);
+		}
+
+		transformsRecomputedTotal += transforms.Update();
+
+		const std::vector<TransformHierarchy::Range>& updatedRanges = transforms.GetUpdatedRanges();
+
+		for (size_t i = 0; i < updatedRanges.size(); ++i)
+		{
+			for (uint32_t instance = updatedRanges[i].begin; instance < updatedRanges[i].end; ++instance)
+			{
+				uint32_t draw = drawOfInstance[instance];
+
+				if (draw != NoDraw)
+				{
+					TransformBounds(transforms.GetWorld(drawNodes[draw]), meshCenter, meshExtent, objectBounds[draw].center, objectBounds[draw].extent);
+
+					if (frustumCulling)
+					{
+						cullingVolumes.SetBox(draw, objectBounds[draw].center, objectBounds[draw].extent);
+					}
+				}
+			}
+		}
+
+		// The fence has signalled, so the GPU is done with this slot's instances
+		instancesWrittenTotal += transforms.WriteInstances(frameSlot, frame.mappedInstances);
+
+		void* mappedUniform;
+		result = vkMapMemory(device, frame.uniformMemory, 0, uniformSize, 0, &mappedUniform);
+
+		// View projection followed by the position dequantisation scale and offset
+		float uniformData[24] = { cos(t), sin(t), 0.0f, 0.0f,
+								  -sin(t), cos(t), 0.0f, 0.0f,
+								  0.0f, 0.0f, 1.0f, 0.0f,
+								  0.0f, 0.0f, 0.0f, 1.0f,
+								  vertexFormat.positionScale[0], vertexFormat.positionScale[1], vertexFormat.positionScale[2], 0.0f,
+								  vertexFormat.positionOffset[0], vertexFormat.positionOffset[1], vertexFormat.positionOffset[2], 0.0f };
 
 		if (result != VK_SUCCESS)
 		{
-			std::cout << "Couldn't allocate command buffer" << std::endl;
+			std::cout << "Unable to map uniform memory" << std::endl;
 			return 1;
 		}
 
+		memcpy(mappedUniform, uniformData, uniformSize);
+		vkUnmapMemory(device, frame.uniformMemory);
+
+		for (uint32_t window = 0; window < windowCount; ++window)
+		{
+			if (swapchains[window].Acquire(frameSlot) == false)
+			{
+				std::cout << "Couldn't aquire swapchain image" << std::endl;
+
+				// if out of date respond to window resize?
+				return 1;
+			}
+		}
+		
+		// The pool allows individual resets, so beginning the buffer again resets it
+		VkCommandBuffer commandBuffer = frame.commandBuffer;
+
 		VkCommandBufferInheritanceInfo commandBufferInheritanceInfo;
 		commandBufferInheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
 		commandBufferInheritanceInfo.pNext = NULL;
@@ -1220,99 +1814,416 @@ int main(char** argv, int argc)
 			std::cout << "Couldn't begin command buffer" << std::endl;
 			return 1;
 		}
+
+		gpuTimer.Begin(commandBuffer, frameSlot);
+
+		if (defragmentBytesPerFrame > 0)
+		{
+			deviceAllocator.Defragment(commandBuffer, defragmentBytesPerFrame);
+		}
+
+		// A promotion replaces the texture's view, every frame's set is rewritten before its next use
+		changedTextures.clear();
+
+		if (textureStreamer.Update(commandBuffer, frameSlot, frameIndex, &changedTextures) == false)
+		{
+			std::cout << "Texture streaming failed" << std::endl;
+			return 1;
+		}
+
+		if (changedTextures.empty() == false)
+		{
+			textureViewChanges += (uint32_t)changedTextures.size();
+
+			for (uint32_t i = 0; i < FramesInFlight; ++i)
+			{
+				frames[i].textureStale = true;
+			}
+		}
+
+		if (frame.textureStale && textureStreamer.GetImageView(streamedTexture) != VK_NULL_HANDLE)
+		{
+			VkDescriptorImageInfo textureImageInfo;
+			textureImageInfo.sampler = textureSampler;
+			textureImageInfo.imageView = textureStreamer.GetImageView(streamedTexture);
+			textureImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+			VkWriteDescriptorSet textureWrite;
+			textureWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			textureWrite.pNext = NULL;
+			textureWrite.dstSet = frame.descriptorSet;
+			textureWrite.dstBinding = 1;
+			textureWrite.dstArrayElement = 0;
+			textureWrite.descriptorCount = 1;
+			textureWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			textureWrite.pImageInfo = &textureImageInfo;
+			textureWrite.pBufferInfo = NULL;
+			textureWrite.pTexelBufferView = NULL;
+			vkUpdateDescriptorSets(device, 1, &textureWrite, 0, NULL);
+			frame.textureStale = false;
+		}
+
+		// Simulated with the frame's real duration, clamped so a stall doesn't fling everything away
+		if (particleCount > 0)
+		{
+			VkCommandBuffer particleCommandBuffer = asyncCompute ? frame.computeCommandBuffer : commandBuffer;
+
+			VkCommandBufferBeginInfo computeBeginInfo;
+			computeBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			computeBeginInfo.pNext = NULL;
+			computeBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			computeBeginInfo.pInheritanceInfo = NULL;
+
+			if (asyncCompute && vkBeginCommandBuffer(particleCommandBuffer, &computeBeginInfo) != VK_SUCCESS)
+			{
+				std::cout << "Couldn't begin compute command buffer" << std::endl;
+				return 1;
+			}
+
+			particleSystem.Record(particleCommandBuffer, std::min(cpuMilliseconds / 1000.0f, 0.1f));
+			emittedTotal += particleSystem.GetEmitCount();
+
+			if (asyncCompute && vkEndCommandBuffer(particleCommandBuffer) != VK_SUCCESS)
+			{
+				std::cout << "Couldn't end compute command buffer" << std::endl;
+				return 1;
+			}
+		}
 		
-		VkImageMemoryBarrier beginFrameBarrier;
-		beginFrameBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		beginFrameBarrier.pNext = NULL;
-		beginFrameBarrier.srcAccessMask = 0;
-		beginFrameBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		beginFrameBarrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-		beginFrameBarrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		beginFrameBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		beginFrameBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		beginFrameBarrier.image = swapchainImages[currentSwapImage];
-		beginFrameBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, 0, NULL, 0, NULL, 1, &beginFrameBarrier);
-
-		VkClearValue clearValue;
-		clearValue.color.float32[0] = (float)rand() / (float)RAND_MAX;
-		clearValue.color.float32[1] = (float)rand() / (float)RAND_MAX;
-		clearValue.color.float32[2] = (float)rand() / (float)RAND_MAX;
-		clearValue.color.float32[3] = 1.0f;
-
-		VkRenderPassBeginInfo renderPassBeginInfo;
-		renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassBeginInfo.pNext = NULL;
-		renderPassBeginInfo.renderPass = renderPass;
-		renderPassBeginInfo.framebuffer = framebuffers[currentSwapImage];
-		renderPassBeginInfo.renderArea.offset = { 0, 0 };
-		renderPassBeginInfo.renderArea.extent.width = surfaceCapabilities.currentExtent.width;
-		renderPassBeginInfo.renderArea.extent.height = surfaceCapabilities.currentExtent.width;
-		renderPassBeginInfo.clearValueCount = 1;
-		renderPassBeginInfo.pClearValues = &clearValue;
-		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-		
-		for (int i = 1; i < 5; ++i)
+		// Every window clears to the same colours, whichever colour attachment subpass 0 writes
+		VkClearValue clearValues[ScenePass::MaxAttachments];
+		clearValues[ScenePass::OutputAttachment].color.float32[0] = (float)rand() / (float)RAND_MAX;
+		clearValues[ScenePass::OutputAttachment].color.float32[1] = (float)rand() / (float)RAND_MAX;
+		clearValues[ScenePass::OutputAttachment].color.float32[2] = (float)rand() / (float)RAND_MAX;
+		clearValues[ScenePass::OutputAttachment].color.float32[3] = 1.0f;
+		clearValues[ScenePass::DepthAttachment].depthStencil.depth = 1.0f;
+		clearValues[ScenePass::DepthAttachment].depthStencil.stencil = 0;
+		clearValues[ScenePass::FirstIntermediateAttachment] = clearValues[ScenePass::OutputAttachment];
+		clearValues[ScenePass::FirstIntermediateAttachment + 1] = clearValues[ScenePass::OutputAttachment];
+
+		VkClearValue insetClearValues[4];
+
+		for (int i = 0; i < 4; ++i)
 		{
-			clearValue.color.float32[0] = (float)rand() / (float)RAND_MAX;
-			clearValue.color.float32[1] = (float)rand() / (float)RAND_MAX;
-			clearValue.color.float32[2] = (float)rand() / (float)RAND_MAX;
-			clearValue.color.float32[3] = 1.0f;
+			insetClearValues[i].color.float32[0] = (float)rand() / (float)RAND_MAX;
+			insetClearValues[i].color.float32[1] = (float)rand() / (float)RAND_MAX;
+			insetClearValues[i].color.float32[2] = (float)rand() / (float)RAND_MAX;
+			insetClearValues[i].color.float32[3] = 1.0f;
+		}
 
-			VkClearAttachment clearAttachment;
-			clearAttachment.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			clearAttachment.clearValue = clearValue;
-			clearAttachment.colorAttachment = 0;
+		renderQueue.SetMaterial(frameMaterialId, frame.descriptorSet);
+		renderQueue.SetMesh(meshId, vertBuffer, indexBuffer, indexType);
+		renderQueue.Clear();
 
-			VkClearRect clearRect;
-			clearRect.baseArrayLayer = 0;
-			clearRect.layerCount = 1;
-			clearRect.rect.offset = { i * 20, i * 20 };
-			clearRect.rect.extent = { surfaceCapabilities.currentExtent.width - i * 40, surfaceCapabilities.currentExtent.height - i * 40 };
-			vkCmdClearAttachments(commandBuffer, 1, &clearAttachment, 1, &clearRect);
+		if (frustumCulling)
+		{
+			frustumCuller.Cull(cullingVolumes, ExtractFrustumPlanes(uniformData), &frustumVisible);
+			frustumCulledTotal += drawCount - (uint32_t)frustumVisible.size();
 		}
 
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		// Visible indices are ascending, so one cursor walks them alongside the draws
+		uint32_t frustumCursor = 0;
+		uint32_t drawnCount = 0;
 
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, NULL);
+		// The prepass is layer 0, so it sorts ahead of the shaded draws in layer 1
+		for (uint32_t i = 0; i < drawCount; ++i)
+		{
+			if (frustumCulling)
+			{
+				if (frustumCursor == frustumVisible.size() || frustumVisible[frustumCursor] != i)
+				{
+					continue;
+				}
+
+				++frustumCursor;
+			}
+
+			if (i < visibilityCount && visibility[i] == 0)
+			{
+				++culledDrawTotal;
+				continue;
+			}
+
+			float depth = (float)(drawCount - i) / drawCount;
+
+			DrawPacket packet;
+			packet.key = MakeSortKey(depthPrepass ? 1 : 0, meshPipelineId, frameMaterialId, depth, false, 0);
+			packet.pipeline = meshPipelineId;
+			packet.material = frameMaterialId;
+			packet.mesh = meshId;
+			packet.indexCount = indexCount;
+			packet.firstIndex = 0;
+			packet.vertexOffset = 0;
+			packet.instanceCount = 1;
+			packet.firstInstance = transforms.GetInstanceIndex(drawNodes[i]);
+			renderQueue.Submit(packet);
+			++drawnCount;
+
+			if (depthPrepass)
+			{
+				packet.key = MakeSortKey(0, prepassPipelineId, frameMaterialId, depth, false, 0);
+				packet.pipeline = prepassPipelineId;
+				renderQueue.Submit(packet);
+			}
+		}
 
-		VkViewport viewport;
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = (float)surfaceCapabilities.currentExtent.width;
-		viewport.height = (float)surfaceCapabilities.currentExtent.height;
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		// Sorted once and recorded into every window's pass
+		renderQueue.Sort();
+		sortPassTotal += renderQueue.GetStats().sortPasses;
 
-		VkRect2D scissor;
-		scissor.extent.width = surfaceCapabilities.currentExtent.width;
-		scissor.extent.height = surfaceCapabilities.currentExtent.height;
-		scissor.offset.x = 0;
-		scissor.offset.y = 0;
-		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		if (showHud)
+		{
+			std::chrono::high_resolution_clock::time_point hudStart = std::chrono::high_resolution_clock::now();
+
+			HudStats hudStats;
+			hudStats.cpuMilliseconds = cpuMilliseconds;
+			hudStats.gpuMilliseconds = gpuMilliseconds;
+			hudStats.resolutionScale = dynamicResolution.GetScale();
+			hudStats.drawCount = drawnCount;
+			hudStats.totalDrawCount = drawCount;
+			// Without the extension only the device allocator's blocks are tracked, too little to show as heap usage
+			hudStats.heapCount = memoryBudget.HasBudgetExtension() ? memoryBudget.GetHeapCount() : 0;
+
+			for (uint32_t heap = 0; heap < hudStats.heapCount; ++heap)
+			{
+				hudStats.heapUsage[heap] = memoryBudget.GetUsage(heap);
+				hudStats.heapBudget[heap] = memoryBudget.GetBudget(heap);
+			}
+
+			performanceHud.Update(frameSlot, hudStats);
+			hudUpdateTotal += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - hudStart).count();
+		}
 
-		VkDeviceSize offset = 0;
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertBuffer, &offset);
+		// Each window renders the scene into its own targets at its own size and upscales that into
+		// its backbuffer, all in this one command buffer
+		for (uint32_t window = 0; window < windowCount; ++window)
+		{
+			WindowTargets& targets = windowTargets[window];
+			VkExtent2D fullExtent = swapchains[window].GetExtent();
+			VkExtent2D sceneExtent = dynamicResolution.GetScaledExtent(fullExtent);
+
+			// The previous frame's upscale may still be reading the scene target and its depth test or
+			// occlusion pass using depth, the contents of both are discarded
+			VkImageMemoryBarrier beginFrameBarriers[2];
+			beginFrameBarriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			beginFrameBarriers[0].pNext = NULL;
+			beginFrameBarriers[0].srcAccessMask = 0;
+			beginFrameBarriers[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			beginFrameBarriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			beginFrameBarriers[0].newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			beginFrameBarriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			beginFrameBarriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			beginFrameBarriers[0].image = targets.sceneImage;
+			beginFrameBarriers[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+			beginFrameBarriers[1] = beginFrameBarriers[0];
+			beginFrameBarriers[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			beginFrameBarriers[1].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			beginFrameBarriers[1].image = targets.depthImage;
+			beginFrameBarriers[1].subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, 0, 0, NULL, 0, NULL, 2, beginFrameBarriers);
+
+			// Describes everything the first window's draws use as it is this frame, so the capture
+			// replays without anything from the frames before
+			if (window == 0 && capturePath != NULL && frameCount == captureFrame)
+			{
+				frameCapture.Begin(fullExtent.width, fullExtent.height);
+				frameCapture.CreateBuffer(vertBuffer, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, false, vertexData, bufferSize);
+				frameCapture.CreateBuffer(indexBuffer, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, false, indexData, indexDataSize);
+				frameCapture.CreateBuffer(frame.uniformBuffer, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, true, uniformData, uniformSize);
+				frameCapture.CreateBuffer(frame.instanceBuffer, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, true, frame.mappedInstances, transforms.GetNodeCount() * MeshInstanceStride);
+				frameCapture.CreateShaderModule(vertModule, tri_vert_spv, sizeof(tri_vert_spv));
+				frameCapture.CreateShaderModule(fragModule, tri_frag_spv, sizeof(tri_frag_spv));
+				frameCapture.CreateMeshPipeline(pipeline, vertModule, fragModule, vertexFormat, meshVariant, depthPrepass ? MeshDepthMode_TestEqual : MeshDepthMode_TestAndWrite, true);
+
+				if (depthPrepass)
+				{
+					frameCapture.CreateMeshPipeline(prepassPipeline, vertModule, VK_NULL_HANDLE, vertexFormat, meshVariant, MeshDepthMode_Prepass, true);
+				}
+
+				frameCapture.CreateUniformSet(frame.descriptorSet, frame.uniformBuffer, uniformSize);
+				frameCapture.BeginRenderPass(sceneExtent, clearValues[ScenePass::OutputAttachment].color.float32, clearValues[ScenePass::DepthAttachment].depthStencil.depth);
+			}
+
+			VkRenderPassBeginInfo renderPassBeginInfo;
+			renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			renderPassBeginInfo.pNext = NULL;
+			renderPassBeginInfo.renderPass = targets.scenePass.GetRenderPass();
+			renderPassBeginInfo.framebuffer = targets.scenePass.GetFramebuffer();
+			renderPassBeginInfo.renderArea.offset = { 0, 0 };
+			renderPassBeginInfo.renderArea.extent = sceneExtent;
+			renderPassBeginInfo.clearValueCount = targets.scenePass.GetAttachmentCount();
+			renderPassBeginInfo.pClearValues = clearValues;
+			vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+			for (int i = 1; i < 5; ++i)
+			{
+				VkClearAttachment clearAttachment;
+				clearAttachment.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				clearAttachment.clearValue = insetClearValues[i - 1];
+				clearAttachment.colorAttachment = 0;
+
+				// Insets scale with the scene so the upscaled result looks the same at any resolution
+				uint32_t inset = (uint32_t)(i * 20 * dynamicResolution.GetScale());
+
+				VkClearRect clearRect;
+				clearRect.baseArrayLayer = 0;
+				clearRect.layerCount = 1;
+				clearRect.rect.offset = { (int32_t)inset, (int32_t)inset };
+				clearRect.rect.extent = { sceneExtent.width - inset * 2, sceneExtent.height - inset * 2 };
+				vkCmdClearAttachments(commandBuffer, 1, &clearAttachment, 1, &clearRect);
+
+				if (frameCapture.IsCapturing())
+				{
+					frameCapture.ClearRect(clearRect, clearAttachment.clearValue.color.float32);
+				}
+			}
+
+			VkViewport viewport;
+			viewport.x = 0.0f;
+			viewport.y = 0.0f;
+			viewport.width = (float)sceneExtent.width;
+			viewport.height = (float)sceneExtent.height;
+			viewport.minDepth = 0.0f;
+			viewport.maxDepth = 1.0f;
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+			VkRect2D scissor;
+			scissor.extent = sceneExtent;
+			scissor.offset.x = 0;
+			scissor.offset.y = 0;
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+			// The queue binds meshes to binding 0 only, instances stay bound throughout
+			VkDeviceSize instanceOffset = 0;
+			vkCmdBindVertexBuffers(commandBuffer, MeshInstanceBinding, 1, &frame.instanceBuffer, &instanceOffset);
+
+			if (frameCapture.IsCapturing())
+			{
+				frameCapture.BindVertexBuffer(MeshInstanceBinding, frame.instanceBuffer, instanceOffset);
+			}
+
+			renderQueue.Record(commandBuffer, &frameCapture);
+
+			// Not part of the capture, replays show the scene's draws only
+			if (particleCount > 0)
+			{
+				particleSystem.Draw(commandBuffer, uniformData);
+			}
+
+			const RenderQueueStats& renderQueueStats = renderQueue.GetStats();
+			bindTotal += renderQueueStats.pipelineBinds + renderQueueStats.descriptorSetBinds + renderQueueStats.vertexBufferBinds + renderQueueStats.indexBufferBinds;
+			skippedBindTotal += renderQueueStats.skippedBinds;
+
+			targets.scenePass.RecordEffects(commandBuffer, sceneExtent);
+
+			// Laid out in window pixels, the upscale takes it back to its baked size
+			if (showHud)
+			{
+				performanceHud.Record(commandBuffer, frameSlot, fullExtent);
+			}
+
+			vkCmdEndRenderPass(commandBuffer);
+
+			// Post effects, occlusion culling and the other windows aren't part of the capture, only
+			// the first window's scene draws
+			if (frameCapture.IsCapturing())
+			{
+				frameCapture.EndRenderPass();
+
+				if (frameCapture.End(capturePath))
+				{
+					std::cout << "Captured frame " << frameCount << " to " << capturePath << ", " << (frameCapture.GetSize() >> 10) << " KB" << std::endl;
+				}
+			}
+
+			if (window == 0 && occlusionCulling)
+			{
+				hizOcclusion.SetObjects(frameSlot, objectBounds.data(), drawCount);
+				hizOcclusion.Record(commandBuffer, frameSlot, targets.depthImage, sceneExtent, uniformData);
+			}
+
+			// Upscale the rendered region into the whole of the window's backbuffer
+			VkImageMemoryBarrier upscaleBarriers[2];
+			upscaleBarriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			upscaleBarriers[0].pNext = NULL;
+			upscaleBarriers[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			upscaleBarriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			upscaleBarriers[0].oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			upscaleBarriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			upscaleBarriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			upscaleBarriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			upscaleBarriers[0].image = targets.sceneImage;
+			upscaleBarriers[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+			upscaleBarriers[1] = upscaleBarriers[0];
+			upscaleBarriers[1].srcAccessMask = 0;
+			upscaleBarriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			upscaleBarriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			upscaleBarriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			upscaleBarriers[1].image = swapchains[window].GetCurrentImage();
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 2, upscaleBarriers);
+
+			if (sceneBlit)
+			{
+				VkImageBlit blit;
+				blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+				blit.srcOffsets[0] = { 0, 0, 0 };
+				blit.srcOffsets[1] = { (int32_t)sceneExtent.width, (int32_t)sceneExtent.height, 1 };
+				blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+				blit.dstOffsets[0] = { 0, 0, 0 };
+				blit.dstOffsets[1] = { (int32_t)fullExtent.width, (int32_t)fullExtent.height, 1 };
+				vkCmdBlitImage(commandBuffer, targets.sceneImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, swapchains[window].GetCurrentImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, sceneFilter);
+			}
+			else
+			{
+				// Dynamic resolution is off without a blit, so the scene covers the whole target
+				VkImageCopy copy;
+				copy.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+				copy.srcOffset = { 0, 0, 0 };
+				copy.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+				copy.dstOffset = { 0, 0, 0 };
+				copy.extent = { fullExtent.width, fullExtent.height, 1 };
+				vkCmdCopyImage(commandBuffer, targets.sceneImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, swapchains[window].GetCurrentImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+			}
+		}
+
+		VkImageLayout backbufferLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+		if (readbackPath != NULL)
+		{
+			if (frameReadback.Record(commandBuffer, swapchains[0].GetCurrentImage(), frameIndex) == false)
+			{
+				std::cout << "No free readback buffer" << std::endl;
+				return 1;
+			}
 
-		vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+			backbufferLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		}
 
+		VkImageMemoryBarrier endOfFrameBarriers[Swapchain::MaxSwapchains];
 
+		for (uint32_t window = 0; window < windowCount; ++window)
+		{
+			VkImageMemoryBarrier& endOfFrameBarrier = endOfFrameBarriers[window];
+			endOfFrameBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			endOfFrameBarrier.pNext = NULL;
+			endOfFrameBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			endOfFrameBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+			endOfFrameBarrier.oldLayout = window == 0 ? backbufferLayout : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			endOfFrameBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+			endOfFrameBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			endOfFrameBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			endOfFrameBarrier.image = swapchains[window].GetCurrentImage();
+			endOfFrameBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		}
 
-		vkCmdEndRenderPass(commandBuffer);
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 0, NULL, windowCount, endOfFrameBarriers);
 
-		VkImageMemoryBarrier endOfFrameBarrier;
-		endOfFrameBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		endOfFrameBarrier.pNext = NULL;
-		endOfFrameBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		endOfFrameBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-		endOfFrameBarrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		endOfFrameBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-		endOfFrameBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		endOfFrameBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		endOfFrameBarrier.image = swapchainImages[currentSwapImage];
-		endOfFrameBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 0, NULL, 1, &endOfFrameBarrier);
+		gpuTimer.End(commandBuffer, frameSlot);
 
 		result = vkEndCommandBuffer(commandBuffer);
 
@@ -1322,66 +2233,281 @@ int main(char** argv, int argc)
 			return 1;
 		}
 
-		VkPipelineStageFlags waitDstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		// The simulation is added first so Flush submits it ahead of the graphics work waiting for it.
+		// Graphics only waits at the draw stages, so its uploads and copies overlap the simulation.
+		if (asyncCompute)
+		{
+			QueueSyncPoint particlesSimulated;
+
+			if (particlesDrawn.semaphore != VK_NULL_HANDLE)
+			{
+				submissionScheduler.WaitForQueue(computeQueue, particlesDrawn, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+			}
 
-		VkSubmitInfo submitInfo;
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.pNext = NULL;
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = &presentCompleteSemaphore;
-		submitInfo.pWaitDstStageMask = &waitDstStageMask;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &commandBuffer;
-		submitInfo.signalSemaphoreCount = 0;
-		submitInfo.pSignalSemaphores = NULL;
-		result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+			submissionScheduler.AddCommandBuffer(computeQueue, frame.computeCommandBuffer);
 
-		if (result != VK_SUCCESS)
+			if (submissionScheduler.SignalQueue(computeQueue, &particlesSimulated) == false)
+			{
+				std::cout << "Couldn't signal the compute queue" << std::endl;
+				return 1;
+			}
+
+			submissionScheduler.WaitForQueue(queue, particlesSimulated, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+		}
+
+		// Backbuffers are only written by the upscale
+		for (uint32_t window = 0; window < windowCount; ++window)
+		{
+			submissionScheduler.AddWait(queue, swapchains[window].GetAcquiredSemaphore(frameSlot), VK_PIPELINE_STAGE_TRANSFER_BIT);
+		}
+
+		submissionScheduler.AddCommandBuffer(queue, commandBuffer);
+		submissionScheduler.AddSignal(queue, frame.renderCompleteSemaphore);
+
+		if (asyncCompute && submissionScheduler.SignalQueue(queue, &particlesDrawn) == false)
+		{
+			std::cout << "Couldn't signal the graphics queue" << std::endl;
+			return 1;
+		}
+
+		vkResetFences(device, 1, &frame.fence);
+
+		if (submissionScheduler.Flush(queue, frame.fence) == false)
 		{
 			std::cout << "Couldn't submit command buffer" << std::endl;
+			return 1;
 		}
 
-		VkResult queuePresentResult = VK_SUCCESS;
+		frame.frameIndex = frameIndex;
 
-		VkPresentInfoKHR presentInfo;
-		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-		presentInfo.pNext = NULL;
-		presentInfo.waitSemaphoreCount = 0;
-		presentInfo.pWaitSemaphores = NULL;
-		presentInfo.swapchainCount = 1;
-		presentInfo.pSwapchains = &swapchain;
-		presentInfo.pImageIndices = &currentSwapImage;
-		presentInfo.pResults = &queuePresentResult;
-		
-		result = vkQueuePresentKHR(queue, &presentInfo);
+		SubmissionStats frameSubmissions = submissionScheduler.GetFrameStats();
+		Log(LogSeverity_Debug, "Frame %llu: %u submits, %u batches, %u command buffers", (unsigned long long)frameIndex, frameSubmissions.submitCalls, frameSubmissions.batches, frameSubmissions.commandBuffers);
 
-		if (result != VK_SUCCESS)
+		// Every window in one present call
+		Swapchain* presentedSwapchains[Swapchain::MaxSwapchains];
+
+		for (uint32_t window = 0; window < windowCount; ++window)
+		{
+			presentedSwapchains[window] = &swapchains[window];
+		}
+
+		if (Swapchain::Present(queue, presentedSwapchains, windowCount, frame.renderCompleteSemaphore) == false)
 		{
 			std::cout << "Couldn't present buffer" << std::endl;
 			return 1;
 		}
 
-		if (queuePresentResult != VK_SUCCESS)
+		// Handles the messages of every window on this thread
+		renderWindows[0].DispatchEvents();
+		++frameCount;
+	}
+
+	if (frameCount > 0)
+	{
+		double elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frameStart).count();
+		std::cout << frameCount << " frames, " << elapsed / frameCount << " ms average, robustBufferAccess " << (deviceCapabilities.enabledFeatures.robustBufferAccess ? "on" : "off") << std::endl;
+	}
+
+	if (gpuTimeSamples > 0)
+	{
+		std::cout << "GPU: " << gpuTimeTotal / gpuTimeSamples << " ms average, resolution scale " << resolutionScaleTotal / gpuTimeSamples << " average";
+
+		if (targetFrameTime > 0.0f)
 		{
-			std::cout << "Queue present failed" << std::endl;
-			return 1;
+			std::cout << " for a " << targetFrameTime << " ms target";
 		}
 
-		result = vkQueueWaitIdle(queue);
+		std::cout << std::endl;
+	}
 
-		if (result != VK_SUCCESS)
+	if (frameCount > 0)
+	{
+		std::cout << "Render queue: " << drawCount << " draws, " << (double)bindTotal / frameCount << " state binds and " << (double)skippedBindTotal / frameCount
+			<< " redundant binds skipped per frame, " << (double)sortPassTotal / frameCount << " radix passes per sort" << std::endl;
+	}
+
+	if (frameCount > 0)
+	{
+		std::cout << "Transforms: " << transforms.GetNodeCount() << " nodes, " << (double)transformsRecomputedTotal / frameCount << " world matrices recomputed and "
+			<< (double)instancesWrittenTotal / frameCount << " instances written per frame" << std::endl;
+	}
+
+	if (shaderDirectory != NULL)
+	{
+		std::cout << "Shader reload: " << shaderReloader.GetReloadCount() << " rebuilds, " << shaderReloader.GetFailureCount() << " failed" << std::endl;
+	}
+
+	if (showHud && frameCount > 0)
+	{
+		std::cout << "HUD: " << performanceHud.GetQuadCount(frameCount % FramesInFlight) << " quads in one draw, " << hudUpdateTotal / frameCount << " ms CPU per frame to lay out" << std::endl;
+	}
+
+	if (particleCount > 0 && frameCount > 0)
+	{
+		std::cout << "Particles: capacity " << particleSystem.GetCapacity() << ", " << emittedTotal / frameCount << " emitted per frame, " << (particleSystem.GetMemoryBytes() >> 10)
+			<< " KB of device memory, simulated on the " << (asyncCompute ? "compute" : "graphics") << " queue" << std::endl;
+	}
+
+	std::cout << "Texture streaming: largest resident mip " << textureStreamer.GetResidentMipLevel(streamedTexture) << " of " << textureMipLevels << " levels, "
+		<< (textureStreamer.GetResidentBytes() >> 10) << " KB resident, " << textureViewChanges << " view changes" << std::endl;
+
+	VkDeviceSize intermediateBytes = 0;
+	VkDeviceSize committedBytes = 0;
+
+	for (uint32_t i = 0; i < windowCount; ++i)
+	{
+		intermediateBytes += windowTargets[i].scenePass.GetIntermediateBytes();
+		committedBytes += windowTargets[i].scenePass.GetCommittedBytes();
+	}
+
+	std::cout << "Scene pass: " << windowTargets[0].scenePass.GetEffectCount() << " effects, " << windowCount << " windows, intermediates " << (intermediateBytes >> 10) << " KB, "
+		<< (committedBytes >> 10) << " KB committed, lazily allocated " << (windowTargets[0].scenePass.UsesLazyMemory() ? "yes" : "no") << std::endl;
+
+	if (frustumCulling && frameCount > 0)
+	{
+		std::cout << "Frustum culling: " << (double)frustumCulledTotal / frameCount << " of " << drawCount << " draws culled per frame on " << frustumCuller.GetThreadCount()
+			<< " threads, " << (frustumCuller.UsesSimd() ? "AVX2" : "scalar") << std::endl;
+	}
+
+	if (occlusionCulling && frameCount > 0)
+	{
+		std::cout << "Occlusion culling: " << (double)culledDrawTotal / frameCount << " of " << drawCount << " draws culled per frame, " << hizOcclusion.GetLevelCount() << " pyramid levels" << std::endl;
+	}
+
+	SubmissionStats submissionStats = submissionScheduler.GetTotalStats();
+
+	if (frameCount > 0)
+	{
+		std::cout << "Submission: " << (double)submissionStats.submitCalls / frameCount << " vkQueueSubmit calls and " << (double)submissionStats.batches / frameCount
+			<< " batches per frame, timeline semaphores " << (submissionScheduler.UsesTimelineSemaphores() ? "on" : "off") << std::endl;
+	}
+
+	DeviceAllocatorStats allocatorStats = deviceAllocator.GetStats();
+	std::cout << "Device allocator: " << allocatorStats.blockCount << " blocks, " << (allocatorStats.usedBytes >> 10) << " of " << (allocatorStats.reservedBytes >> 10)
+		<< " KB used, " << (allocatorStats.movedBytes >> 10) << " KB moved by defragmentation" << std::endl;
+
+	// The fallback only counts the device allocator's blocks, which the line above already covers
+	if (memoryBudget.HasBudgetExtension())
+	{
+		for (uint32_t heap = 0; heap < memoryBudget.GetHeapCount(); ++heap)
 		{
-			std::cout << "Wait Idle failed" << std::endl;
-			return 1;
+			std::cout << "Heap " << heap << ": " << (memoryBudget.GetUsage(heap) >> 20) << " of " << (memoryBudget.GetBudget(heap) >> 20) << " MB budget" << std::endl;
+		}
+	}
+
+	frustumCuller.Stop();
+	shaderReloader.Stop();
+
+	// Orderly shutdown: once the device is idle every frame has completed. Whatever is built on the
+	// scene targets and render passes goes first, then the rest is retired and destroyed in one
+	// flush, then the swapchains, allocator, device and surfaces.
+	result = vkDeviceWaitIdle(device);
+
+	if (result != VK_SUCCESS)
+	{
+		std::cout << "Wait idle failed" << std::endl;
+	}
+
+	// Frames still queued are written before the writer stops
+	if (readbackPath != NULL)
+	{
+		frameReadback.Destroy();
+		std::cout << "Readback: " << frameReadback.GetFramesWritten() << " frames, " << (frameReadback.GetBytesWritten() >> 20) << " MB written, " << frameReadback.GetStallCount()
+			<< " waits for the writer" << std::endl;
+	}
+
+	// The HUD and particles draw in the scene's render pass and Hi-Z samples the first window's
+	// depth, and each scene pass's framebuffer holds its window's views
+	performanceHud.Destroy();
+	particleSystem.Destroy();
+	hizOcclusion.Destroy();
+
+	for (uint32_t i = 0; i < windowCount; ++i)
+	{
+		windowTargets[i].scenePass.Destroy();
+	}
+
+	uint64_t lastFrameIndex = frameCount;
+
+	for (uint32_t i = 0; i < FramesInFlight; ++i)
+	{
+		deletionQueue.RetireCommandBuffer(commandPool, frames[i].commandBuffer, lastFrameIndex);
+
+		if (frames[i].computeCommandBuffer != VK_NULL_HANDLE)
+		{
+			deletionQueue.RetireCommandBuffer(computeCommandPool, frames[i].computeCommandBuffer, lastFrameIndex);
 		}
+		deletionQueue.RetireFence(frames[i].fence, lastFrameIndex);
+		deletionQueue.RetireSemaphore(frames[i].renderCompleteSemaphore, lastFrameIndex);
+		deletionQueue.RetireBuffer(frames[i].uniformBuffer, lastFrameIndex);
+		deletionQueue.RetireMemory(frames[i].uniformMemory, lastFrameIndex);
+		deletionQueue.RetireBuffer(frames[i].instanceBuffer, lastFrameIndex);
+		deletionQueue.RetireMemory(frames[i].instanceMemory, lastFrameIndex);
+	}
 
-		vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+	// Sets allocated from the pool go with it
+	deletionQueue.RetireDescriptorPool(descriptorPool, lastFrameIndex);
+	deletionQueue.RetireSampler(textureSampler, lastFrameIndex);
+	deletionQueue.RetirePipeline(pipeline, lastFrameIndex);
 
-		vkDestroySemaphore(device, presentCompleteSemaphore, NULL);
+	if (prepassPipeline != VK_NULL_HANDLE)
+	{
+		deletionQueue.RetirePipeline(prepassPipeline, lastFrameIndex);
+	}
 
-		renderWindow.DispatchEvents();
+	deletionQueue.RetirePipelineCache(pipelineCache, lastFrameIndex);
+	deletionQueue.RetireShaderModule(vertModule, lastFrameIndex);
+	deletionQueue.RetireShaderModule(fragModule, lastFrameIndex);
+	deletionQueue.RetirePipelineLayout(pipelineLayout, lastFrameIndex);
+	deletionQueue.RetireDescriptorSetLayout(descriptorSetLayout, lastFrameIndex);
+	deletionQueue.RetireCommandPool(commandPool, lastFrameIndex);
+
+	if (computeCommandPool != VK_NULL_HANDLE)
+	{
+		deletionQueue.RetireCommandPool(computeCommandPool, lastFrameIndex);
+	}
+
+	for (uint32_t i = 0; i < windowCount; ++i)
+	{
+		WindowTargets& targets = windowTargets[i];
+		deletionQueue.RetireImageView(targets.sceneView, lastFrameIndex);
+		deletionQueue.RetireImage(targets.sceneImage, lastFrameIndex);
+		deletionQueue.RetireMemory(targets.sceneMemory, lastFrameIndex);
+		deletionQueue.RetireImageView(targets.depthView, lastFrameIndex);
+		deletionQueue.RetireImage(targets.depthImage, lastFrameIndex);
+		deletionQueue.RetireMemory(targets.depthMemory, lastFrameIndex);
+	}
+
+	deletionQueue.Destroy();
+
+	// Images it replaced went through the deletion queue, the resident ones are destroyed here
+	textureStreamer.Destroy();
+
+	for (uint32_t i = 0; i < windowCount; ++i)
+	{
+		swapchains[i].Destroy();
+	}
+
+	submissionScheduler.Destroy();
+	gpuTimer.Destroy();
+
+	deviceAllocator.DestroyResource(vertexResource, lastFrameIndex);
+	deviceAllocator.DestroyResource(indexResource, lastFrameIndex);
+	deviceAllocator.Destroy();
+
+	vkDestroyDevice(device, NULL);
+	for (uint32_t i = 0; i < windowCount; ++i)
+	{
+		vkDestroySurfaceKHR(instance, surfaces[i], NULL);
+	}
+
+	if (debugCallback != VK_NULL_HANDLE)
+	{
+		PFN_vkDestroyDebugReportCallbackEXT vkDestroyDebugReportCallbackEXT = (PFN_vkDestroyDebugReportCallbackEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugReportCallbackEXT");
+		vkDestroyDebugReportCallbackEXT(instance, debugCallback, NULL);
 	}
 
 	vkDestroyInstance(instance, NULL);
+	StopLogging();
 	return 0;
 }
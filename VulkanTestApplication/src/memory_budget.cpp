@@ -0,0 +1,141 @@
+#include "memory_budget.h"
+
+#include <cstring>
+
+#include "logger.h"
+
+const float MemoryBudget::DefaultHeapBudget = 0.8f;
+const float MemoryBudget::DefaultWarningThreshold = 0.9f;
+
+MemoryBudget::MemoryBudget()
+	: physicalDevice(VK_NULL_HANDLE)
+	, getMemoryProperties2(NULL)
+	, warningThreshold(DefaultWarningThreshold)
+{
+	memset(&memoryProperties, 0, sizeof(memoryProperties));
+	memset(budget, 0, sizeof(budget));
+	memset(usage, 0, sizeof(usage));
+	memset(allocated, 0, sizeof(allocated));
+	memset(warned, 0, sizeof(warned));
+}
+
+void MemoryBudget::Initialize(VkInstance instance, VkPhysicalDevice physicalDevice, bool budgetExtension)
+{
+	this->physicalDevice = physicalDevice;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	getMemoryProperties2 = NULL;
+
+#ifdef VK_EXT_memory_budget
+	if (budgetExtension)
+	{
+		getMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+	}
+#endif
+
+	for (uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; ++heap)
+	{
+		budget[heap] = (VkDeviceSize)((double)memoryProperties.memoryHeaps[heap].size * DefaultHeapBudget);
+		usage[heap] = allocated[heap];
+	}
+
+	Update();
+}
+
+void MemoryBudget::Allocated(uint32_t memoryTypeIndex, VkDeviceSize size)
+{
+	uint32_t heap = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	allocated[heap] += size;
+
+	// The driver's figure is refreshed in Update, until then assume the allocation is all of it
+	usage[heap] += size;
+}
+
+void MemoryBudget::Freed(uint32_t memoryTypeIndex, VkDeviceSize size)
+{
+	uint32_t heap = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	allocated[heap] -= size;
+	usage[heap] = usage[heap] > size ? usage[heap] - size : 0;
+}
+
+void MemoryBudget::Update()
+{
+#ifdef VK_EXT_memory_budget
+	if (getMemoryProperties2 != NULL)
+	{
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties;
+		memset(&budgetProperties, 0, sizeof(budgetProperties));
+		budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+		budgetProperties.pNext = NULL;
+
+		VkPhysicalDeviceMemoryProperties2KHR properties2;
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+		properties2.pNext = &budgetProperties;
+		getMemoryProperties2(physicalDevice, &properties2);
+
+		for (uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; ++heap)
+		{
+			budget[heap] = budgetProperties.heapBudget[heap];
+			usage[heap] = budgetProperties.heapUsage[heap];
+		}
+	}
+#endif
+
+	for (uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; ++heap)
+	{
+		if (budget[heap] == 0)
+		{
+			continue;
+		}
+
+		double fraction = (double)usage[heap] / (double)budget[heap];
+
+		// Re-arm a little below the threshold so hovering around it doesn't spam
+		if (fraction >= warningThreshold && warned[heap] == false)
+		{
+			Log(LogSeverity_Warning, "Memory heap %u is at %.0f%% of its %llu MB budget (%llu MB used)", heap, fraction * 100.0,
+				(unsigned long long)(budget[heap] >> 20), (unsigned long long)(usage[heap] >> 20));
+			warned[heap] = true;
+		}
+		else if (fraction < warningThreshold - 0.05 && warned[heap])
+		{
+			warned[heap] = false;
+		}
+	}
+}
+
+void MemoryBudget::SetWarningThreshold(float fraction)
+{
+	warningThreshold = fraction;
+}
+
+uint32_t MemoryBudget::GetHeapCount() const
+{
+	return memoryProperties.memoryHeapCount;
+}
+
+VkDeviceSize MemoryBudget::GetBudget(uint32_t heap) const
+{
+	return budget[heap];
+}
+
+VkDeviceSize MemoryBudget::GetUsage(uint32_t heap) const
+{
+	return usage[heap];
+}
+
+VkDeviceSize MemoryBudget::GetAllocated(uint32_t heap) const
+{
+	return allocated[heap];
+}
+
+bool MemoryBudget::WouldExceedBudget(uint32_t memoryTypeIndex, VkDeviceSize size) const
+{
+	uint32_t heap = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	return usage[heap] + size > budget[heap];
+}
+
+bool MemoryBudget::HasBudgetExtension() const
+{
+	return getMemoryProperties2 != NULL;
+}
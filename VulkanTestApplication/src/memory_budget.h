@@ -0,0 +1,54 @@
+#pragma once
+
+#include "vulkan_helpers.h"
+
+// Per heap memory usage against a budget.
+//
+// With VK_EXT_memory_budget the driver reports both, including memory used by other processes.
+// Without it usage is what was recorded through Allocated and Freed, against a fixed fraction of
+// the heap size. Only the DeviceAllocator reports there, so that figure is a lower bound and only
+// good for the allocator's own budget checks. A warning is logged when a heap crosses the warning threshold.
+class MemoryBudget
+{
+public:
+	// Share of a heap treated as the budget when the driver can't say
+	static const float DefaultHeapBudget;
+	static const float DefaultWarningThreshold;
+
+	MemoryBudget();
+
+	// budgetExtension requires VK_KHR_get_physical_device_properties2 on the instance and
+	// VK_EXT_memory_budget on the device
+	void Initialize(VkInstance instance, VkPhysicalDevice physicalDevice, bool budgetExtension);
+
+	void Allocated(uint32_t memoryTypeIndex, VkDeviceSize size);
+	void Freed(uint32_t memoryTypeIndex, VkDeviceSize size);
+
+	// Refreshes the driver's numbers and checks the threshold. Cheap enough to call every few frames.
+	void Update();
+
+	void SetWarningThreshold(float fraction);
+
+	uint32_t GetHeapCount() const;
+	VkDeviceSize GetBudget(uint32_t heap) const;
+	VkDeviceSize GetUsage(uint32_t heap) const;
+
+	// Bytes allocated through this tracker, a subset of GetUsage when the extension is used
+	VkDeviceSize GetAllocated(uint32_t heap) const;
+
+	// True if an allocation of size on memoryTypeIndex would take its heap past the budget
+	bool WouldExceedBudget(uint32_t memoryTypeIndex, VkDeviceSize size) const;
+
+	bool HasBudgetExtension() const;
+
+private:
+	VkPhysicalDevice physicalDevice;
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2;
+	float warningThreshold;
+
+	VkDeviceSize budget[VK_MAX_MEMORY_HEAPS];
+	VkDeviceSize usage[VK_MAX_MEMORY_HEAPS];
+	VkDeviceSize allocated[VK_MAX_MEMORY_HEAPS];
+	bool warned[VK_MAX_MEMORY_HEAPS];
+};
@@ -0,0 +1,182 @@
+#include "mesh_pipeline.h"
+
+#include <cstddef>
+
+MeshShaderVariant GetMeshShaderVariant(const VertexFormat& vertexFormat)
+{
+	MeshShaderVariant variant;
+	variant.quantizedPositions = vertexFormat.position == VertexPositionFormat_Snorm16 ? VK_TRUE : VK_FALSE;
+	return variant;
+}
+
+bool CreateMeshPipeline(VkDevice device, VkPipelineCache pipelineCache, VkPipelineLayout pipelineLayout, VkRenderPass renderPass, VkShaderModule vertModule, VkShaderModule fragModule, const VertexFormat& vertexFormat, const MeshShaderVariant& variant, MeshDepthMode depthMode, bool perInstanceTransforms, VkPipeline* pipeline)
+{
+	// Both stages share one constant block, entries a stage doesn't declare are ignored
+	VkSpecializationMapEntry specializationEntries[1];
+	specializationEntries[0].constantID = 0;
+	specializationEntries[0].offset = offsetof(MeshShaderVariant, quantizedPositions);
+	specializationEntries[0].size = sizeof(VkBool32);
+
+	VkSpecializationInfo specializationInfo;
+	specializationInfo.mapEntryCount = 1;
+	specializationInfo.pMapEntries = specializationEntries;
+	specializationInfo.dataSize = sizeof(MeshShaderVariant);
+	specializationInfo.pData = &variant;
+
+	VkPipelineShaderStageCreateInfo stages[2];
+	stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[0].pNext = NULL;
+	stages[0].flags = 0;
+	stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	stages[0].module = vertModule;
+	stages[0].pName = "main";
+	stages[0].pSpecializationInfo = &specializationInfo;
+
+	stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[1].pNext = NULL;
+	stages[1].flags = 0;
+	stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	stages[1].module = fragModule;
+	stages[1].pName = "main";
+	stages[1].pSpecializationInfo = &specializationInfo;
+
+	VkVertexInputBindingDescription vertexBindingDescriptions[2];
+	VkVertexInputAttributeDescription vertexAttributes[6];
+	GetVertexInputDescriptions(vertexFormat, &vertexBindingDescriptions[0], vertexAttributes);
+
+	vertexBindingDescriptions[1].binding = MeshInstanceBinding;
+	vertexBindingDescriptions[1].stride = perInstanceTransforms ? MeshInstanceStride : 0;
+	vertexBindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+	// One attribute per matrix column
+	for (uint32_t column = 0; column < 4; ++column)
+	{
+		vertexAttributes[2 + column].location = 2 + column;
+		vertexAttributes[2 + column].binding = MeshInstanceBinding;
+		vertexAttributes[2 + column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		vertexAttributes[2 + column].offset = column * 4 * sizeof(float);
+	}
+
+	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo;
+	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputCreateInfo.pNext = NULL;
+	vertexInputCreateInfo.flags = 0;
+	vertexInputCreateInfo.vertexBindingDescriptionCount = 2;
+	vertexInputCreateInfo.pVertexBindingDescriptions = vertexBindingDescriptions;
+	vertexInputCreateInfo.vertexAttributeDescriptionCount = 6;
+	vertexInputCreateInfo.pVertexAttributeDescriptions = vertexAttributes;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo;
+	inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssemblyCreateInfo.pNext = NULL;
+	inputAssemblyCreateInfo.flags = 0;
+	inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
+	
+	VkPipelineViewportStateCreateInfo viewportCreateInfo;
+	viewportCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportCreateInfo.pNext = NULL;
+	viewportCreateInfo.flags = 0;
+	viewportCreateInfo.viewportCount = 1;
+	viewportCreateInfo.pViewports = NULL;
+	viewportCreateInfo.scissorCount = 1;
+	viewportCreateInfo.pScissors = NULL;
+
+	VkPipelineRasterizationStateCreateInfo rasterizationCreateInfo;
+	rasterizationCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizationCreateInfo.pNext = NULL;
+	rasterizationCreateInfo.flags = 0;
+	rasterizationCreateInfo.depthClampEnable = VK_FALSE;
+	rasterizationCreateInfo.rasterizerDiscardEnable = VK_FALSE;
+	rasterizationCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizationCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+	rasterizationCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterizationCreateInfo.depthBiasEnable = VK_FALSE;
+	rasterizationCreateInfo.depthBiasConstantFactor = 0.f;
+	rasterizationCreateInfo.depthBiasClamp = 0.f;
+	rasterizationCreateInfo.depthBiasSlopeFactor = 0.f;
+	rasterizationCreateInfo.lineWidth = 0.f;
+
+	VkPipelineMultisampleStateCreateInfo multisampleCreateInfo;
+	multisampleCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampleCreateInfo.pNext = NULL;
+	multisampleCreateInfo.flags = 0;
+	multisampleCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampleCreateInfo.sampleShadingEnable = VK_FALSE;
+	multisampleCreateInfo.minSampleShading = 0.f;
+	multisampleCreateInfo.pSampleMask = NULL;
+	multisampleCreateInfo.alphaToCoverageEnable = VK_FALSE;
+	multisampleCreateInfo.alphaToOneEnable = VK_FALSE;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo;
+	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilCreateInfo.pNext = NULL;
+	depthStencilCreateInfo.flags = 0;
+	depthStencilCreateInfo.depthTestEnable = depthMode != MeshDepthMode_None ? VK_TRUE : VK_FALSE;
+	depthStencilCreateInfo.depthWriteEnable = (depthMode == MeshDepthMode_TestAndWrite || depthMode == MeshDepthMode_Prepass) ? VK_TRUE : VK_FALSE;
+	depthStencilCreateInfo.depthCompareOp = depthMode == MeshDepthMode_TestEqual ? VK_COMPARE_OP_EQUAL : depthMode != MeshDepthMode_None ? VK_COMPARE_OP_LESS : VK_COMPARE_OP_ALWAYS;
+	depthStencilCreateInfo.depthBoundsTestEnable = VK_FALSE;
+	depthStencilCreateInfo.stencilTestEnable = VK_FALSE;
+	depthStencilCreateInfo.front = { VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_COMPARE_OP_ALWAYS, 0, 0, 0 };
+	depthStencilCreateInfo.back = { VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_COMPARE_OP_ALWAYS, 0, 0, 0 };
+	depthStencilCreateInfo.minDepthBounds = 0.f;
+	depthStencilCreateInfo.maxDepthBounds = 1.f;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachmentState;
+	colorBlendAttachmentState.blendEnable = VK_FALSE;
+	colorBlendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachmentState.colorWriteMask = depthMode == MeshDepthMode_Prepass ? 0 : VK_COLOR_COMPONENT_A_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_R_BIT;
+
+	VkPipelineColorBlendStateCreateInfo colorBlendCreateInfo;
+	colorBlendCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlendCreateInfo.pNext = NULL;
+	colorBlendCreateInfo.flags = 0;
+	colorBlendCreateInfo.logicOpEnable = VK_FALSE;
+	colorBlendCreateInfo.logicOp = VK_LOGIC_OP_CLEAR;
+	colorBlendCreateInfo.attachmentCount = 1;
+	colorBlendCreateInfo.pAttachments = &colorBlendAttachmentState;
+	colorBlendCreateInfo.blendConstants[0] = 1.f;
+	colorBlendCreateInfo.blendConstants[1] = 1.f;
+	colorBlendCreateInfo.blendConstants[2] = 1.f;
+	colorBlendCreateInfo.blendConstants[3] = 1.f;
+
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	VkPipelineDynamicStateCreateInfo dynamicCreateInfo;
+	dynamicCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicCreateInfo.pNext = NULL;
+	dynamicCreateInfo.flags = 0;
+	dynamicCreateInfo.dynamicStateCount = 2;
+	dynamicCreateInfo.pDynamicStates = dynamicStates;
+
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo;
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.pNext = NULL;
+	pipelineCreateInfo.flags = 0;
+	pipelineCreateInfo.stageCount = depthMode == MeshDepthMode_Prepass ? 1 : 2;
+	pipelineCreateInfo.pStages = stages;
+	pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
+	pipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
+	pipelineCreateInfo.pTessellationState = NULL;
+	pipelineCreateInfo.pViewportState = &viewportCreateInfo;
+	pipelineCreateInfo.pRasterizationState = &rasterizationCreateInfo;
+	pipelineCreateInfo.pMultisampleState = &multisampleCreateInfo;
+	pipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;
+	pipelineCreateInfo.pColorBlendState = &colorBlendCreateInfo;
+	pipelineCreateInfo.pDynamicState = &dynamicCreateInfo;
+	pipelineCreateInfo.renderPass = renderPass;
+	pipelineCreateInfo.layout = pipelineLayout;
+	pipelineCreateInfo.subpass = 0;
+	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineCreateInfo.basePipelineIndex = 0;
+
+	VkResult result = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, NULL, pipeline);
+
+	return result == VK_SUCCESS;
+}
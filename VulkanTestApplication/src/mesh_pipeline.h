@@ -0,0 +1,30 @@
+#pragma once
+
+#include "vulkan_helpers.h"
+
+// Specialisation constants of tri.vert and tri.frag, laid out as the constant data block.
+// Each combination is a separate pipeline built from the same shader modules, letting the
+// driver fold away the branches that don't apply.
+struct MeshShaderVariant
+{
+	VkBool32 quantizedPositions;	// constant_id 0, rescale positions by the uniform scale and offset
+};
+
+// Depth state of a mesh pipeline, the render pass must have a depth attachment for anything but None
+enum MeshDepthMode
+{
+	MeshDepthMode_None = 0,			// No depth testing
+	MeshDepthMode_TestAndWrite = 1,	// Closer fragments replace farther ones
+	MeshDepthMode_Prepass = 2,		// Depth only, no fragment shader or colour writes
+	MeshDepthMode_TestEqual = 3,	// After a prepass, shades only the visible fragment of each pixel
+};
+
+// Vertex binding 1 holds a column major model matrix per instance, read as four vec4 attributes at
+// locations 2 to 5. Without per instance transforms its stride is zero, so every instance reads the
+// first matrix and a buffer holding one identity matrix serves any instance count.
+static const uint32_t MeshInstanceBinding = 1;
+static const uint32_t MeshInstanceStride = 16 * sizeof(float);
+
+MeshShaderVariant GetMeshShaderVariant(const VertexFormat& vertexFormat);
+
+bool CreateMeshPipeline(VkDevice device, VkPipelineCache pipelineCache, VkPipelineLayout pipelineLayout, VkRenderPass renderPass, VkShaderModule vertModule, VkShaderModule fragModule, const VertexFormat& vertexFormat, const MeshShaderVariant& variant, MeshDepthMode depthMode, bool perInstanceTransforms, VkPipeline* pipeline);
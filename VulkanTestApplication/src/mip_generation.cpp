@@ -0,0 +1,133 @@
+#include "mip_generation.h"
+
+#include <cstring>
+
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t size = width > height ? width : height;
+	uint32_t levels = 1;
+
+	while (size > 1)
+	{
+		size >>= 1;
+		++levels;
+	}
+
+	return levels;
+}
+
+uint32_t GetMipDimension(uint32_t size, uint32_t level)
+{
+	uint32_t dimension = size >> level;
+	return dimension > 0 ? dimension : 1;
+}
+
+bool SupportsBlitMipGeneration(VkPhysicalDevice physicalDevice, VkFormat format)
+{
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+
+	VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+	return (formatProperties.optimalTilingFeatures & required) == required;
+}
+
+void GenerateMipChainRGBA8(const unsigned char* rgba, uint32_t width, uint32_t height, uint32_t mipLevels, std::vector<unsigned char>* chain, std::vector<ImageMipData>* levels)
+{
+	std::vector<size_t> offsets(mipLevels);
+	size_t totalSize = 0;
+
+	for (uint32_t level = 0; level < mipLevels; ++level)
+	{
+		offsets[level] = totalSize;
+		totalSize += (size_t)GetMipDimension(width, level) * GetMipDimension(height, level) * 4;
+	}
+
+	chain->resize(totalSize);
+	memcpy(chain->data(), rgba, (size_t)width * height * 4);
+
+	for (uint32_t level = 1; level < mipLevels; ++level)
+	{
+		uint32_t srcWidth = GetMipDimension(width, level - 1);
+		uint32_t srcHeight = GetMipDimension(height, level - 1);
+		uint32_t dstWidth = GetMipDimension(width, level);
+		uint32_t dstHeight = GetMipDimension(height, level);
+
+		const unsigned char* src = chain->data() + offsets[level - 1];
+		unsigned char* dst = chain->data() + offsets[level];
+
+		for (uint32_t y = 0; y < dstHeight; ++y)
+		{
+			uint32_t y0 = y * 2 < srcHeight ? y * 2 : srcHeight - 1;
+			uint32_t y1 = y * 2 + 1 < srcHeight ? y * 2 + 1 : srcHeight - 1;
+
+			for (uint32_t x = 0; x < dstWidth; ++x)
+			{
+				uint32_t x0 = x * 2 < srcWidth ? x * 2 : srcWidth - 1;
+				uint32_t x1 = x * 2 + 1 < srcWidth ? x * 2 + 1 : srcWidth - 1;
+
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					uint32_t sum = src[(y0 * srcWidth + x0) * 4 + c]
+						+ src[(y0 * srcWidth + x1) * 4 + c]
+						+ src[(y1 * srcWidth + x0) * 4 + c]
+						+ src[(y1 * srcWidth + x1) * 4 + c];
+
+					dst[(y * dstWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+	}
+
+	levels->resize(mipLevels);
+
+	for (uint32_t level = 0; level < mipLevels; ++level)
+	{
+		(*levels)[level].data = chain->data() + offsets[level];
+		(*levels)[level].dataSize = (size_t)GetMipDimension(width, level) * GetMipDimension(height, level) * 4;
+	}
+}
+
+void RecordBlitMipChain(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t firstLevel, uint32_t mipLevels)
+{
+	VkImageMemoryBarrier barrier;
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.pNext = NULL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+
+	for (uint32_t level = firstLevel; level < mipLevels; ++level)
+	{
+		// Previous level becomes the blit source
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 1, 0, 1 };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+		VkImageBlit blit;
+		blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 };
+		blit.srcOffsets[0] = { 0, 0, 0 };
+		blit.srcOffsets[1] = { (int32_t)GetMipDimension(width, level - 1), (int32_t)GetMipDimension(height, level - 1), 1 };
+		blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+		blit.dstOffsets[0] = { 0, 0, 0 };
+		blit.dstOffsets[1] = { (int32_t)GetMipDimension(width, level), (int32_t)GetMipDimension(height, level), 1 };
+		vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+	}
+
+	// The smallest level was only ever written
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, mipLevels - 1, 1, 0, 1 };
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
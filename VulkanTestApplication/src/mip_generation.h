@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+
+#include "vulkan_helpers.h"
+
+// Number of levels in a full mip chain down to 1x1
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+// Size of a single dimension at the given mip level
+uint32_t GetMipDimension(uint32_t size, uint32_t level);
+
+// True if the format can be downsampled with linear filtered vkCmdBlitImage on optimally tiled images
+bool SupportsBlitMipGeneration(VkPhysicalDevice physicalDevice, VkFormat format);
+
+// Box filters an RGBA8 image into mipLevels levels (level 0 is a copy of the source).
+// levels points into chain, so chain must outlive levels.
+void GenerateMipChainRGBA8(const unsigned char* rgba, uint32_t width, uint32_t height, uint32_t mipLevels, std::vector<unsigned char>* chain, std::vector<ImageMipData>* levels);
+
+// Records blits generating levels [firstLevel, mipLevels) from level firstLevel - 1.
+// Levels firstLevel - 1 onwards must be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL and are all
+// left in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+void RecordBlitMipChain(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t firstLevel, uint32_t mipLevels);
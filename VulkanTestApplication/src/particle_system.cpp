@@ -0,0 +1,734 @@
+#include "particle_system.h"
+
+#include <cstddef>
+#include <cstring>
+
+#include "particle_simulate.comp.h"
+#include "particle_emit.comp.h"
+#include "particle_prepare.comp.h"
+#include "particle.vert.h"
+#include "particle.frag.h"
+
+// Workgroup size of particle_simulate.comp and particle_emit.comp
+static const uint32_t GroupSize = 256;
+
+// Emitted lives average this fraction of the lifetime
+static const float MeanLifeFraction = 0.75f;
+
+// Half size of a particle in clip space
+static const float ParticleSize = 0.004f;
+
+const float ParticleSystem::DefaultLifetime = 2.0f;
+
+// Laid out as the shaders' Particle
+struct Particle
+{
+	float position[4];
+	float velocity[4];
+};
+
+// Laid out as the shaders' State, the indirect arguments are read from it in place
+struct ParticleState
+{
+	uint32_t aliveCount[2];
+	VkDispatchIndirectCommand simulateDispatch;
+	VkDrawIndirectCommand draw;
+};
+
+struct ParticleConstants
+{
+	float emitter[4];
+	float deltaTime;
+	float gravity;
+	float lifetime;
+	uint32_t seed;
+	uint32_t source;
+	uint32_t emitCount;
+	uint32_t capacity;
+};
+
+struct DrawConstants
+{
+	float viewProjection[16];
+	float size[2];
+};
+
+// Shared concurrently by queueFamilies[0] and [1] if they differ, rather than transferring ownership every step
+static bool CreateDeviceLocalBuffer(VkDevice device, const VkMemoryType* memoryTypes, VkBufferUsageFlags usage, VkDeviceSize size, const uint32_t queueFamilies[2], VkBuffer* buffer, VkDeviceMemory* memory, VkDeviceSize* allocatedBytes)
+{
+	bool concurrent = queueFamilies[0] != queueFamilies[1];
+
+	VkBufferCreateInfo bufferCreateInfo;
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.pNext = NULL;
+	bufferCreateInfo.flags = 0;
+	bufferCreateInfo.size = size;
+	bufferCreateInfo.usage = usage;
+	bufferCreateInfo.sharingMode = concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+	bufferCreateInfo.queueFamilyIndexCount = concurrent ? 2 : 0;
+	bufferCreateInfo.pQueueFamilyIndices = concurrent ? queueFamilies : NULL;
+
+	if (vkCreateBuffer(device, &bufferCreateInfo, NULL, buffer) != VK_SUCCESS)
+	{
+		*buffer = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(device, *buffer, &memoryRequirements);
+
+	if (CreateDeviceMemory(device, memoryTypes, &memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, (size_t)memoryRequirements.size, memory) == false)
+	{
+		*memory = VK_NULL_HANDLE;
+		return false;
+	}
+
+	*allocatedBytes += memoryRequirements.size;
+	return vkBindBufferMemory(device, *buffer, *memory, 0) == VK_SUCCESS;
+}
+
+ParticleSystem::ParticleSystem()
+	: device(VK_NULL_HANDLE)
+	, capacity(0)
+	, separateComputeQueue(false)
+	, stateBuffer(VK_NULL_HANDLE)
+	, stateMemory(VK_NULL_HANDLE)
+	, memoryBytes(0)
+	, setLayout(VK_NULL_HANDLE)
+	, descriptorPool(VK_NULL_HANDLE)
+	, simulateModule(VK_NULL_HANDLE)
+	, emitModule(VK_NULL_HANDLE)
+	, prepareModule(VK_NULL_HANDLE)
+	, vertModule(VK_NULL_HANDLE)
+	, fragModule(VK_NULL_HANDLE)
+	, computeLayout(VK_NULL_HANDLE)
+	, drawLayout(VK_NULL_HANDLE)
+	, simulatePipeline(VK_NULL_HANDLE)
+	, emitPipeline(VK_NULL_HANDLE)
+	, preparePipeline(VK_NULL_HANDLE)
+	, drawPipeline(VK_NULL_HANDLE)
+	, gravity(1.5f)
+	, lifetime(DefaultLifetime)
+	, source(0)
+	, step(0)
+	, emitRemainder(0.0f)
+	, emitCount(0)
+{
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		particleBuffers[i] = VK_NULL_HANDLE;
+		particleMemory[i] = VK_NULL_HANDLE;
+		descriptorSets[i] = VK_NULL_HANDLE;
+	}
+
+	// A fountain rising from near the bottom of the view
+	emitter[0] = 0.0f;
+	emitter[1] = -0.8f;
+	emitter[2] = 0.5f;
+	emitter[3] = 0.3f;
+}
+
+ParticleSystem::~ParticleSystem()
+{
+	Destroy();
+}
+
+bool ParticleSystem::Create(VkDevice device, VkQueue queue, VkCommandPool commandPool, const VkMemoryType* memoryTypes, VkPipelineCache pipelineCache, VkRenderPass renderPass, uint32_t subpass, uint32_t capacity,
+	uint32_t drawQueueFamily, uint32_t computeQueueFamily)
+{
+	this->device = device;
+	this->capacity = capacity;
+	separateComputeQueue = drawQueueFamily != computeQueueFamily;
+	source = 0;
+	step = 0;
+	emitRemainder = 0.0f;
+	emitCount = 0;
+
+	if (CreateBuffers(queue, commandPool, memoryTypes, drawQueueFamily, computeQueueFamily) == false)
+	{
+		return false;
+	}
+
+	if (CreateComputePipelines(pipelineCache) == false)
+	{
+		return false;
+	}
+
+	if (CreateDrawPipeline(pipelineCache, renderPass, subpass) == false)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool ParticleSystem::CreateBuffers(VkQueue queue, VkCommandPool commandPool, const VkMemoryType* memoryTypes, uint32_t drawQueueFamily, uint32_t computeQueueFamily)
+{
+	VkDeviceSize particleBytes = sizeof(Particle) * (VkDeviceSize)capacity;
+	const uint32_t queueFamilies[2] = { drawQueueFamily, computeQueueFamily };
+
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		if (CreateDeviceLocalBuffer(device, memoryTypes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, particleBytes, queueFamilies, &particleBuffers[i], &particleMemory[i], &memoryBytes) == false)
+		{
+			return false;
+		}
+	}
+
+	if (CreateDeviceLocalBuffer(device, memoryTypes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(ParticleState),
+		queueFamilies, &stateBuffer, &stateMemory, &memoryBytes) == false)
+	{
+		return false;
+	}
+
+	// Nothing alive, so the first simulation dispatch and draw are empty
+	ParticleState initialState;
+	memset(&initialState, 0, sizeof(initialState));
+	initialState.simulateDispatch.y = 1;
+	initialState.simulateDispatch.z = 1;
+	initialState.draw.vertexCount = 4;
+
+	VkCommandBuffer commandBuffer;
+
+	if (BeginOneTimeCommands(device, commandPool, &commandBuffer) == false)
+	{
+		return false;
+	}
+
+	vkCmdUpdateBuffer(commandBuffer, stateBuffer, 0, sizeof(initialState), &initialState);
+	return EndOneTimeCommands(device, queue, commandPool, commandBuffer);
+}
+
+bool ParticleSystem::CreateComputePipelines(VkPipelineCache pipelineCache)
+{
+	if (CreateShaderModule(device, particle_simulate_comp_spv, sizeof(particle_simulate_comp_spv), &simulateModule) == false)
+	{
+		simulateModule = VK_NULL_HANDLE;
+		return false;
+	}
+
+	if (CreateShaderModule(device, particle_emit_comp_spv, sizeof(particle_emit_comp_spv), &emitModule) == false)
+	{
+		emitModule = VK_NULL_HANDLE;
+		return false;
+	}
+
+	if (CreateShaderModule(device, particle_prepare_comp_spv, sizeof(particle_prepare_comp_spv), &prepareModule) == false)
+	{
+		prepareModule = VK_NULL_HANDLE;
+		return false;
+	}
+
+	// Source particles, destination particles and the state. The draw reads the destination.
+	VkDescriptorSetLayoutBinding bindings[3];
+
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT;
+		bindings[i].pImmutableSamplers = NULL;
+	}
+
+	VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo;
+	setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutCreateInfo.pNext = NULL;
+	setLayoutCreateInfo.flags = 0;
+	setLayoutCreateInfo.bindingCount = 3;
+	setLayoutCreateInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, NULL, &setLayout) != VK_SUCCESS)
+	{
+		setLayout = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkDescriptorPoolSize poolSize;
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = 6;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo;
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.pNext = NULL;
+	poolCreateInfo.flags = 0;
+	poolCreateInfo.maxSets = 2;
+	poolCreateInfo.poolSizeCount = 1;
+	poolCreateInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(device, &poolCreateInfo, NULL, &descriptorPool) != VK_SUCCESS)
+	{
+		descriptorPool = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkDescriptorSetLayout setLayouts[2] = { setLayout, setLayout };
+
+	VkDescriptorSetAllocateInfo setAllocateInfo;
+	setAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocateInfo.pNext = NULL;
+	setAllocateInfo.descriptorPool = descriptorPool;
+	setAllocateInfo.descriptorSetCount = 2;
+	setAllocateInfo.pSetLayouts = setLayouts;
+
+	if (vkAllocateDescriptorSets(device, &setAllocateInfo, descriptorSets) != VK_SUCCESS)
+	{
+		descriptorSets[0] = VK_NULL_HANDLE;
+		descriptorSets[1] = VK_NULL_HANDLE;
+		return false;
+	}
+
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		VkDescriptorBufferInfo bufferInfos[3];
+		bufferInfos[0].buffer = particleBuffers[i];
+		bufferInfos[0].offset = 0;
+		bufferInfos[0].range = VK_WHOLE_SIZE;
+		bufferInfos[1].buffer = particleBuffers[1 - i];
+		bufferInfos[1].offset = 0;
+		bufferInfos[1].range = VK_WHOLE_SIZE;
+		bufferInfos[2].buffer = stateBuffer;
+		bufferInfos[2].offset = 0;
+		bufferInfos[2].range = VK_WHOLE_SIZE;
+
+		VkWriteDescriptorSet write;
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.pNext = NULL;
+		write.dstSet = descriptorSets[i];
+		write.dstBinding = 0;
+		write.dstArrayElement = 0;
+		write.descriptorCount = 3;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		write.pImageInfo = NULL;
+		write.pBufferInfo = bufferInfos;
+		write.pTexelBufferView = NULL;
+		vkUpdateDescriptorSets(device, 1, &write, 0, NULL);
+	}
+
+	VkPushConstantRange pushConstantRange;
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(ParticleConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo;
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.pNext = NULL;
+	pipelineLayoutCreateInfo.flags = 0;
+	pipelineLayoutCreateInfo.setLayoutCount = 1;
+	pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, NULL, &computeLayout) != VK_SUCCESS)
+	{
+		computeLayout = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkShaderModule modules[3] = { simulateModule, emitModule, prepareModule };
+	VkComputePipelineCreateInfo pipelineCreateInfos[3];
+
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		pipelineCreateInfos[i].sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineCreateInfos[i].pNext = NULL;
+		pipelineCreateInfos[i].flags = 0;
+		pipelineCreateInfos[i].stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineCreateInfos[i].stage.pNext = NULL;
+		pipelineCreateInfos[i].stage.flags = 0;
+		pipelineCreateInfos[i].stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineCreateInfos[i].stage.module = modules[i];
+		pipelineCreateInfos[i].stage.pName = "main";
+		pipelineCreateInfos[i].stage.pSpecializationInfo = NULL;
+		pipelineCreateInfos[i].layout = computeLayout;
+		pipelineCreateInfos[i].basePipelineHandle = VK_NULL_HANDLE;
+		pipelineCreateInfos[i].basePipelineIndex = -1;
+	}
+
+	VkPipeline pipelines[3] = { VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE };
+	VkResult result = vkCreateComputePipelines(device, pipelineCache, 3, pipelineCreateInfos, NULL, pipelines);
+	simulatePipeline = pipelines[0];
+	emitPipeline = pipelines[1];
+	preparePipeline = pipelines[2];
+
+	return result == VK_SUCCESS;
+}
+
+bool ParticleSystem::CreateDrawPipeline(VkPipelineCache pipelineCache, VkRenderPass renderPass, uint32_t subpass)
+{
+	if (CreateShaderModule(device, particle_vert_spv, sizeof(particle_vert_spv), &vertModule) == false)
+	{
+		vertModule = VK_NULL_HANDLE;
+		return false;
+	}
+
+	if (CreateShaderModule(device, particle_frag_spv, sizeof(particle_frag_spv), &fragModule) == false)
+	{
+		fragModule = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkPushConstantRange pushConstantRange;
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(DrawConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo;
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.pNext = NULL;
+	pipelineLayoutCreateInfo.flags = 0;
+	pipelineLayoutCreateInfo.setLayoutCount = 1;
+	pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, NULL, &drawLayout) != VK_SUCCESS)
+	{
+		drawLayout = VK_NULL_HANDLE;
+		return false;
+	}
+
+	// Particles come from the storage buffer, not vertex input
+	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo;
+	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputCreateInfo.pNext = NULL;
+	vertexInputCreateInfo.flags = 0;
+	vertexInputCreateInfo.vertexBindingDescriptionCount = 0;
+	vertexInputCreateInfo.pVertexBindingDescriptions = NULL;
+	vertexInputCreateInfo.vertexAttributeDescriptionCount = 0;
+	vertexInputCreateInfo.pVertexAttributeDescriptions = NULL;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo;
+	inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssemblyCreateInfo.pNext = NULL;
+	inputAssemblyCreateInfo.flags = 0;
+	inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+	inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
+
+	VkPipelineViewportStateCreateInfo viewportCreateInfo;
+	viewportCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportCreateInfo.pNext = NULL;
+	viewportCreateInfo.flags = 0;
+	viewportCreateInfo.viewportCount = 1;
+	viewportCreateInfo.pViewports = NULL;
+	viewportCreateInfo.scissorCount = 1;
+	viewportCreateInfo.pScissors = NULL;
+
+	VkPipelineRasterizationStateCreateInfo rasterizationCreateInfo;
+	rasterizationCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizationCreateInfo.pNext = NULL;
+	rasterizationCreateInfo.flags = 0;
+	rasterizationCreateInfo.depthClampEnable = VK_FALSE;
+	rasterizationCreateInfo.rasterizerDiscardEnable = VK_FALSE;
+	rasterizationCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizationCreateInfo.cullMode = VK_CULL_MODE_NONE;
+	rasterizationCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterizationCreateInfo.depthBiasEnable = VK_FALSE;
+	rasterizationCreateInfo.depthBiasConstantFactor = 0.f;
+	rasterizationCreateInfo.depthBiasClamp = 0.f;
+	rasterizationCreateInfo.depthBiasSlopeFactor = 0.f;
+	rasterizationCreateInfo.lineWidth = 1.f;
+
+	VkPipelineMultisampleStateCreateInfo multisampleCreateInfo;
+	multisampleCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampleCreateInfo.pNext = NULL;
+	multisampleCreateInfo.flags = 0;
+	multisampleCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampleCreateInfo.sampleShadingEnable = VK_FALSE;
+	multisampleCreateInfo.minSampleShading = 0.f;
+	multisampleCreateInfo.pSampleMask = NULL;
+	multisampleCreateInfo.alphaToCoverageEnable = VK_FALSE;
+	multisampleCreateInfo.alphaToOneEnable = VK_FALSE;
+
+	// Occluded by the scene but never occluding each other, blending makes their order irrelevant
+	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo;
+	memset(&depthStencilCreateInfo, 0, sizeof(depthStencilCreateInfo));
+	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilCreateInfo.depthTestEnable = VK_TRUE;
+	depthStencilCreateInfo.depthWriteEnable = VK_FALSE;
+	depthStencilCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	depthStencilCreateInfo.maxDepthBounds = 1.0f;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachmentState;
+	memset(&colorBlendAttachmentState, 0, sizeof(colorBlendAttachmentState));
+	colorBlendAttachmentState.blendEnable = VK_TRUE;
+	colorBlendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorBlendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	VkPipelineColorBlendStateCreateInfo colorBlendCreateInfo;
+	colorBlendCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlendCreateInfo.pNext = NULL;
+	colorBlendCreateInfo.flags = 0;
+	colorBlendCreateInfo.logicOpEnable = VK_FALSE;
+	colorBlendCreateInfo.logicOp = VK_LOGIC_OP_CLEAR;
+	colorBlendCreateInfo.attachmentCount = 1;
+	colorBlendCreateInfo.pAttachments = &colorBlendAttachmentState;
+	colorBlendCreateInfo.blendConstants[0] = 0.f;
+	colorBlendCreateInfo.blendConstants[1] = 0.f;
+	colorBlendCreateInfo.blendConstants[2] = 0.f;
+	colorBlendCreateInfo.blendConstants[3] = 0.f;
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	VkPipelineDynamicStateCreateInfo dynamicCreateInfo;
+	dynamicCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicCreateInfo.pNext = NULL;
+	dynamicCreateInfo.flags = 0;
+	dynamicCreateInfo.dynamicStateCount = 2;
+	dynamicCreateInfo.pDynamicStates = dynamicStates;
+
+	VkPipelineShaderStageCreateInfo stages[2];
+	stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[0].pNext = NULL;
+	stages[0].flags = 0;
+	stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	stages[0].module = vertModule;
+	stages[0].pName = "main";
+	stages[0].pSpecializationInfo = NULL;
+
+	stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[1].pNext = NULL;
+	stages[1].flags = 0;
+	stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	stages[1].module = fragModule;
+	stages[1].pName = "main";
+	stages[1].pSpecializationInfo = NULL;
+
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo;
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.pNext = NULL;
+	pipelineCreateInfo.flags = 0;
+	pipelineCreateInfo.stageCount = 2;
+	pipelineCreateInfo.pStages = stages;
+	pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
+	pipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
+	pipelineCreateInfo.pTessellationState = NULL;
+	pipelineCreateInfo.pViewportState = &viewportCreateInfo;
+	pipelineCreateInfo.pRasterizationState = &rasterizationCreateInfo;
+	pipelineCreateInfo.pMultisampleState = &multisampleCreateInfo;
+	pipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;
+	pipelineCreateInfo.pColorBlendState = &colorBlendCreateInfo;
+	pipelineCreateInfo.pDynamicState = &dynamicCreateInfo;
+	pipelineCreateInfo.renderPass = renderPass;
+	pipelineCreateInfo.layout = drawLayout;
+	pipelineCreateInfo.subpass = subpass;
+	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineCreateInfo.basePipelineIndex = 0;
+
+	if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, NULL, &drawPipeline) != VK_SUCCESS)
+	{
+		drawPipeline = VK_NULL_HANDLE;
+		return false;
+	}
+
+	return true;
+}
+
+void ParticleSystem::Destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	VkPipeline pipelines[4] = { simulatePipeline, emitPipeline, preparePipeline, drawPipeline };
+
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		if (pipelines[i] != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(device, pipelines[i], NULL);
+		}
+	}
+
+	simulatePipeline = VK_NULL_HANDLE;
+	emitPipeline = VK_NULL_HANDLE;
+	preparePipeline = VK_NULL_HANDLE;
+	drawPipeline = VK_NULL_HANDLE;
+
+	VkPipelineLayout layouts[2] = { computeLayout, drawLayout };
+
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		if (layouts[i] != VK_NULL_HANDLE)
+		{
+			vkDestroyPipelineLayout(device, layouts[i], NULL);
+		}
+	}
+
+	computeLayout = VK_NULL_HANDLE;
+	drawLayout = VK_NULL_HANDLE;
+
+	VkShaderModule modules[5] = { simulateModule, emitModule, prepareModule, vertModule, fragModule };
+
+	for (uint32_t i = 0; i < 5; ++i)
+	{
+		if (modules[i] != VK_NULL_HANDLE)
+		{
+			vkDestroyShaderModule(device, modules[i], NULL);
+		}
+	}
+
+	simulateModule = VK_NULL_HANDLE;
+	emitModule = VK_NULL_HANDLE;
+	prepareModule = VK_NULL_HANDLE;
+	vertModule = VK_NULL_HANDLE;
+	fragModule = VK_NULL_HANDLE;
+
+	// Destroying the pool frees both sets
+	if (descriptorPool != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(device, descriptorPool, NULL);
+		descriptorPool = VK_NULL_HANDLE;
+	}
+
+	descriptorSets[0] = VK_NULL_HANDLE;
+	descriptorSets[1] = VK_NULL_HANDLE;
+
+	if (setLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorSetLayout(device, setLayout, NULL);
+		setLayout = VK_NULL_HANDLE;
+	}
+
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		if (particleBuffers[i] != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(device, particleBuffers[i], NULL);
+			particleBuffers[i] = VK_NULL_HANDLE;
+		}
+
+		if (particleMemory[i] != VK_NULL_HANDLE)
+		{
+			vkFreeMemory(device, particleMemory[i], NULL);
+			particleMemory[i] = VK_NULL_HANDLE;
+		}
+	}
+
+	if (stateBuffer != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(device, stateBuffer, NULL);
+		stateBuffer = VK_NULL_HANDLE;
+	}
+
+	if (stateMemory != VK_NULL_HANDLE)
+	{
+		vkFreeMemory(device, stateMemory, NULL);
+		stateMemory = VK_NULL_HANDLE;
+	}
+
+	memoryBytes = 0;
+	device = VK_NULL_HANDLE;
+}
+
+void ParticleSystem::SetEmitter(const float position[3], float spread, float gravity, float lifetime)
+{
+	emitter[0] = position[0];
+	emitter[1] = position[1];
+	emitter[2] = position[2];
+	emitter[3] = spread;
+	this->gravity = gravity;
+	this->lifetime = lifetime;
+}
+
+void ParticleSystem::Record(VkCommandBuffer commandBuffer, float deltaTime)
+{
+	// At this rate emission replaces what dies with a full pool, the excess is dropped on the GPU
+	float emitted = (float)capacity * deltaTime / (lifetime * MeanLifeFraction) + emitRemainder;
+	emitCount = emitted < (float)capacity ? (uint32_t)emitted : capacity;
+	emitRemainder = emitted < (float)capacity ? emitted - (float)emitCount : 0.0f;
+
+	ParticleConstants constants;
+	memcpy(constants.emitter, emitter, sizeof(emitter));
+	constants.deltaTime = deltaTime;
+	constants.gravity = gravity;
+	constants.lifetime = lifetime;
+	constants.seed = step * 0x9E3779B9u;
+	constants.source = source;
+	constants.emitCount = emitCount;
+	constants.capacity = capacity;
+
+	// The previous step's writes, including the counts the indirect dispatch reads, and the previous
+	// draw's reads of the buffer simulation is about to overwrite. A compute queue has no vertex
+	// stage, there the draw is waited for with a semaphore instead.
+	VkPipelineStageFlags drawStages = separateComputeQueue ? 0 : VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+
+	VkMemoryBarrier beginBarrier;
+	beginBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	beginBarrier.pNext = NULL;
+	beginBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	beginBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | drawStages, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &beginBarrier, 0, NULL, 0, NULL);
+
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computeLayout, 0, 1, &descriptorSets[source], 0, NULL);
+	vkCmdPushConstants(commandBuffer, computeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+	VkMemoryBarrier computeBarrier;
+	computeBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	computeBarrier.pNext = NULL;
+	computeBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	computeBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, simulatePipeline);
+	vkCmdDispatchIndirect(commandBuffer, stateBuffer, offsetof(ParticleState, simulateDispatch));
+
+	// Survivors reserve their slots before emission fills the rest
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &computeBarrier, 0, NULL, 0, NULL);
+
+	if (emitCount > 0)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, emitPipeline);
+		vkCmdDispatch(commandBuffer, (emitCount + GroupSize - 1) / GroupSize, 1, 1);
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &computeBarrier, 0, NULL, 0, NULL);
+	}
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, preparePipeline);
+	vkCmdDispatch(commandBuffer, 1, 1, 1);
+
+	VkMemoryBarrier drawBarrier;
+	drawBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	drawBarrier.pNext = NULL;
+	drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	drawBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | drawStages, 0, 1, &drawBarrier, 0, NULL, 0, NULL);
+
+	// Survivors and new particles are now in the other buffer
+	source = 1 - source;
+	++step;
+}
+
+void ParticleSystem::Draw(VkCommandBuffer commandBuffer, const float viewProjection[16])
+{
+	DrawConstants constants;
+	memcpy(constants.viewProjection, viewProjection, sizeof(constants.viewProjection));
+	constants.size[0] = ParticleSize;
+	constants.size[1] = ParticleSize;
+
+	// The set that wrote into the current source has it as its destination, binding 1
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, drawPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, drawLayout, 0, 1, &descriptorSets[1 - source], 0, NULL);
+	vkCmdPushConstants(commandBuffer, drawLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+	vkCmdDrawIndirect(commandBuffer, stateBuffer, offsetof(ParticleState, draw), 1, sizeof(VkDrawIndirectCommand));
+}
+
+uint32_t ParticleSystem::GetCapacity() const
+{
+	return capacity;
+}
+
+uint32_t ParticleSystem::GetEmitCount() const
+{
+	return emitCount;
+}
+
+VkDeviceSize ParticleSystem::GetMemoryBytes() const
+{
+	return memoryBytes;
+}
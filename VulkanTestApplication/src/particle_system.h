@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+
+#include "vulkan_helpers.h"
+
+// Particles simulated and drawn entirely on the GPU.
+//
+// Particle state lives in two device local storage buffers that swap roles every step. Record
+// dispatches three compute passes: simulation integrates the source buffer's particles and
+// compacts the survivors into the destination, emission appends new particles after them, and a
+// single invocation clamps the count and writes it into the indirect arguments of the draw and of
+// the next step's simulation dispatch. Draw is one indirect instanced draw of camera facing quads.
+// The live count never comes back to the CPU, which only decides how many to emit per step.
+class ParticleSystem
+{
+public:
+	// Emitted particles live between half and all of this, in seconds
+	static const float DefaultLifetime;
+
+	ParticleSystem();
+	~ParticleSystem();
+
+	// Draws in subpass of renderPass, testing against its depth attachment if it has one without
+	// writing it. The empty initial state is uploaded with a blocking submission to queue.
+	//
+	// Record runs on a queue of computeQueueFamily and Draw on one of drawQueueFamily. When they
+	// differ the buffers are shared concurrently by both families.
+	bool Create(VkDevice device, VkQueue queue, VkCommandPool commandPool, const VkMemoryType* memoryTypes, VkPipelineCache pipelineCache, VkRenderPass renderPass, uint32_t subpass, uint32_t capacity,
+		uint32_t drawQueueFamily, uint32_t computeQueueFamily);
+	void Destroy();
+
+	// Particles start at position with an upward velocity, spread widens it sideways. Gravity pulls
+	// along -y in units per second squared.
+	void SetEmitter(const float position[3], float spread, float gravity, float lifetime);
+
+	// Advances the simulation by deltaTime seconds, emitting enough to keep the buffers close to
+	// full. Recorded outside a render pass, before Draw.
+	//
+	// On a separate compute queue the barriers only cover the compute queue, the caller makes the
+	// submission wait for the previous Draw and the next Draw wait for it.
+	void Record(VkCommandBuffer commandBuffer, float deltaTime);
+
+	// Draws the particles the last Record left alive, viewProjection is column major. Viewport
+	// and scissor must already be set.
+	void Draw(VkCommandBuffer commandBuffer, const float viewProjection[16]);
+
+	uint32_t GetCapacity() const;
+
+	// Particles emitted by the last Record, the live count itself is only known to the GPU
+	uint32_t GetEmitCount() const;
+
+	VkDeviceSize GetMemoryBytes() const;
+
+private:
+	bool CreateBuffers(VkQueue queue, VkCommandPool commandPool, const VkMemoryType* memoryTypes, uint32_t drawQueueFamily, uint32_t computeQueueFamily);
+	bool CreateComputePipelines(VkPipelineCache pipelineCache);
+	bool CreateDrawPipeline(VkPipelineCache pipelineCache, VkRenderPass renderPass, uint32_t subpass);
+
+	VkDevice device;
+	uint32_t capacity;
+	bool separateComputeQueue;
+
+	VkBuffer particleBuffers[2];
+	VkDeviceMemory particleMemory[2];
+	VkBuffer stateBuffer;
+	VkDeviceMemory stateMemory;
+	VkDeviceSize memoryBytes;
+
+	// Set i reads particleBuffers[i] and writes the other one
+	VkDescriptorSetLayout setLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet descriptorSets[2];
+
+	VkShaderModule simulateModule;
+	VkShaderModule emitModule;
+	VkShaderModule prepareModule;
+	VkShaderModule vertModule;
+	VkShaderModule fragModule;
+	VkPipelineLayout computeLayout;
+	VkPipelineLayout drawLayout;
+	VkPipeline simulatePipeline;
+	VkPipeline emitPipeline;
+	VkPipeline preparePipeline;
+	VkPipeline drawPipeline;
+
+	float emitter[4];
+	float gravity;
+	float lifetime;
+	uint32_t source;			// Buffer the next Record simulates from
+	uint32_t step;
+	float emitRemainder;		// Fraction of a particle carried to the next step
+	uint32_t emitCount;
+};
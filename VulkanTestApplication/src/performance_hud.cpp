@@ -0,0 +1,678 @@
+#include "performance_hud.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "hud_font.h"
+#include "hud.vert.h"
+#include "hud.frag.h"
+
+// Glyphs per row of the atlas
+static const uint32_t AtlasColumns = 16;
+
+static const int32_t Margin = 8;
+static const int32_t LineHeight = (int32_t)HudGlyphHeight + 2;
+static const uint32_t MaxHeapLines = 4;
+
+// Each graph column is a CPU bar and a GPU bar side by side, one pixel wide each
+static const uint32_t GraphHeight = 60;
+static const float GraphMilliseconds = 33.3f;
+static const float TargetMilliseconds = 16.7f;
+
+struct HudConstants
+{
+	float pixelToClip[2];
+};
+
+static uint32_t PackColor(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+{
+	return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+static const uint32_t PanelColor = PackColor(0, 0, 0, 160);
+static const uint32_t TextColor = PackColor(255, 255, 255, 255);
+static const uint32_t CpuColor = PackColor(255, 170, 40, 255);
+static const uint32_t GpuColor = PackColor(80, 200, 255, 255);
+static const uint32_t TargetLineColor = PackColor(255, 255, 255, 96);
+
+PerformanceHud::PerformanceHud()
+	: device(VK_NULL_HANDLE)
+	, atlasImage(VK_NULL_HANDLE)
+	, atlasMemory(VK_NULL_HANDLE)
+	, atlasView(VK_NULL_HANDLE)
+	, sampler(VK_NULL_HANDLE)
+	, setLayout(VK_NULL_HANDLE)
+	, descriptorPool(VK_NULL_HANDLE)
+	, descriptorSet(VK_NULL_HANDLE)
+	, pipelineLayout(VK_NULL_HANDLE)
+	, vertModule(VK_NULL_HANDLE)
+	, fragModule(VK_NULL_HANDLE)
+	, pipeline(VK_NULL_HANDLE)
+	, graphCursor(0)
+{
+	memset(cpuHistory, 0, sizeof(cpuHistory));
+	memset(gpuHistory, 0, sizeof(gpuHistory));
+}
+
+PerformanceHud::~PerformanceHud()
+{
+	Destroy();
+}
+
+bool PerformanceHud::Create(VkDevice device, VkQueue queue, VkCommandPool commandPool, const VkMemoryType* memoryTypes, VkPipelineCache pipelineCache, VkRenderPass renderPass, uint32_t subpass, uint32_t frameCount)
+{
+	this->device = device;
+
+	if (CreateAtlas(queue, commandPool, memoryTypes) == false)
+	{
+		return false;
+	}
+
+	if (CreatePipeline(pipelineCache, renderPass, subpass) == false)
+	{
+		return false;
+	}
+
+	frames.resize(frameCount);
+
+	for (uint32_t i = 0; i < frameCount; ++i)
+	{
+		FrameData& frame = frames[i];
+		memset(&frame, 0, sizeof(frame));
+
+		if (CreateBuffer(device, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, memoryTypes, NULL, sizeof(Quad) * MaxQuads, &frame.quadBuffer, &frame.quadMemory) == false)
+		{
+			frame.quadBuffer = VK_NULL_HANDLE;
+			frame.quadMemory = VK_NULL_HANDLE;
+			return false;
+		}
+
+		if (vkMapMemory(device, frame.quadMemory, 0, VK_WHOLE_SIZE, 0, (void**)&frame.mappedQuads) != VK_SUCCESS)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool PerformanceHud::CreateAtlas(VkQueue queue, VkCommandPool commandPool, const VkMemoryType* memoryTypes)
+{
+	// Glyph bits expand to one coverage byte per texel
+	uint32_t atlasWidth = AtlasColumns * HudGlyphWidth;
+	uint32_t atlasHeight = (HudGlyphCount / AtlasColumns) * HudGlyphHeight;
+	std::vector<uint8_t> texels(atlasWidth * atlasHeight);
+
+	for (uint32_t glyph = 0; glyph < HudGlyphCount; ++glyph)
+	{
+		uint32_t originX = (glyph % AtlasColumns) * HudGlyphWidth;
+		uint32_t originY = (glyph / AtlasColumns) * HudGlyphHeight;
+
+		for (uint32_t y = 0; y < HudGlyphHeight; ++y)
+		{
+			for (uint32_t x = 0; x < HudGlyphWidth; ++x)
+			{
+				bool set = (HudGlyphRows[glyph][y] & (0x80 >> x)) != 0;
+				texels[(originY + y) * atlasWidth + originX + x] = set ? 255 : 0;
+			}
+		}
+	}
+
+	ImageMipData mipData;
+	mipData.data = texels.data();
+	mipData.dataSize = texels.size();
+
+	if (CreateImage2D(device, queue, commandPool, memoryTypes, atlasWidth, atlasHeight, 1, VK_FORMAT_R8_UNORM, &mipData, 1, &atlasImage, &atlasMemory) == false)
+	{
+		atlasImage = VK_NULL_HANDLE;
+		atlasMemory = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkImageViewCreateInfo viewCreateInfo;
+	viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewCreateInfo.pNext = NULL;
+	viewCreateInfo.flags = 0;
+	viewCreateInfo.image = atlasImage;
+	viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewCreateInfo.format = VK_FORMAT_R8_UNORM;
+	viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+	viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	if (vkCreateImageView(device, &viewCreateInfo, NULL, &atlasView) != VK_SUCCESS)
+	{
+		atlasView = VK_NULL_HANDLE;
+		return false;
+	}
+
+	// Only read with texelFetch, filtering doesn't apply
+	VkSamplerCreateInfo samplerCreateInfo;
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.pNext = NULL;
+	samplerCreateInfo.flags = 0;
+	samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.mipLodBias = 0.0f;
+	samplerCreateInfo.anisotropyEnable = VK_FALSE;
+	samplerCreateInfo.maxAnisotropy = 1.0f;
+	samplerCreateInfo.compareEnable = VK_FALSE;
+	samplerCreateInfo.compareOp = VK_COMPARE_OP_NEVER;
+	samplerCreateInfo.minLod = 0.0f;
+	samplerCreateInfo.maxLod = 0.0f;
+	samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+	samplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
+
+	if (vkCreateSampler(device, &samplerCreateInfo, NULL, &sampler) != VK_SUCCESS)
+	{
+		sampler = VK_NULL_HANDLE;
+		return false;
+	}
+
+	return true;
+}
+
+bool PerformanceHud::CreatePipeline(VkPipelineCache pipelineCache, VkRenderPass renderPass, uint32_t subpass)
+{
+	if (CreateShaderModule(device, hud_vert_spv, sizeof(hud_vert_spv), &vertModule) == false)
+	{
+		vertModule = VK_NULL_HANDLE;
+		return false;
+	}
+
+	if (CreateShaderModule(device, hud_frag_spv, sizeof(hud_frag_spv), &fragModule) == false)
+	{
+		fragModule = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkDescriptorSetLayoutBinding binding;
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	binding.pImmutableSamplers = NULL;
+
+	VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo;
+	setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutCreateInfo.pNext = NULL;
+	setLayoutCreateInfo.flags = 0;
+	setLayoutCreateInfo.bindingCount = 1;
+	setLayoutCreateInfo.pBindings = &binding;
+
+	if (vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, NULL, &setLayout) != VK_SUCCESS)
+	{
+		setLayout = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkPushConstantRange pushConstantRange;
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(HudConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo;
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.pNext = NULL;
+	pipelineLayoutCreateInfo.flags = 0;
+	pipelineLayoutCreateInfo.setLayoutCount = 1;
+	pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, NULL, &pipelineLayout) != VK_SUCCESS)
+	{
+		pipelineLayout = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkDescriptorPoolSize poolSize;
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo;
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.pNext = NULL;
+	poolCreateInfo.flags = 0;
+	poolCreateInfo.maxSets = 1;
+	poolCreateInfo.poolSizeCount = 1;
+	poolCreateInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(device, &poolCreateInfo, NULL, &descriptorPool) != VK_SUCCESS)
+	{
+		descriptorPool = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkDescriptorSetAllocateInfo setAllocateInfo;
+	setAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocateInfo.pNext = NULL;
+	setAllocateInfo.descriptorPool = descriptorPool;
+	setAllocateInfo.descriptorSetCount = 1;
+	setAllocateInfo.pSetLayouts = &setLayout;
+
+	if (vkAllocateDescriptorSets(device, &setAllocateInfo, &descriptorSet) != VK_SUCCESS)
+	{
+		descriptorSet = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkDescriptorImageInfo imageInfo;
+	imageInfo.sampler = sampler;
+	imageInfo.imageView = atlasView;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet write;
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.pNext = NULL;
+	write.dstSet = descriptorSet;
+	write.dstBinding = 0;
+	write.dstArrayElement = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+	write.pBufferInfo = NULL;
+	write.pTexelBufferView = NULL;
+	vkUpdateDescriptorSets(device, 1, &write, 0, NULL);
+
+	// Quads are per instance, corners come from the vertex index
+	VkVertexInputBindingDescription vertexBinding;
+	vertexBinding.binding = 0;
+	vertexBinding.stride = sizeof(Quad);
+	vertexBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+	VkVertexInputAttributeDescription vertexAttributes[4];
+	vertexAttributes[0].location = 0;
+	vertexAttributes[0].binding = 0;
+	vertexAttributes[0].format = VK_FORMAT_R16G16_SINT;
+	vertexAttributes[0].offset = offsetof(Quad, position);
+	vertexAttributes[1].location = 1;
+	vertexAttributes[1].binding = 0;
+	vertexAttributes[1].format = VK_FORMAT_R16G16_UINT;
+	vertexAttributes[1].offset = offsetof(Quad, size);
+	vertexAttributes[2].location = 2;
+	vertexAttributes[2].binding = 0;
+	vertexAttributes[2].format = VK_FORMAT_R32_UINT;
+	vertexAttributes[2].offset = offsetof(Quad, glyph);
+	vertexAttributes[3].location = 3;
+	vertexAttributes[3].binding = 0;
+	vertexAttributes[3].format = VK_FORMAT_R8G8B8A8_UNORM;
+	vertexAttributes[3].offset = offsetof(Quad, color);
+
+	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo;
+	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputCreateInfo.pNext = NULL;
+	vertexInputCreateInfo.flags = 0;
+	vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
+	vertexInputCreateInfo.pVertexBindingDescriptions = &vertexBinding;
+	vertexInputCreateInfo.vertexAttributeDescriptionCount = 4;
+	vertexInputCreateInfo.pVertexAttributeDescriptions = vertexAttributes;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo;
+	inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssemblyCreateInfo.pNext = NULL;
+	inputAssemblyCreateInfo.flags = 0;
+	inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+	inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
+
+	VkPipelineViewportStateCreateInfo viewportCreateInfo;
+	viewportCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportCreateInfo.pNext = NULL;
+	viewportCreateInfo.flags = 0;
+	viewportCreateInfo.viewportCount = 1;
+	viewportCreateInfo.pViewports = NULL;
+	viewportCreateInfo.scissorCount = 1;
+	viewportCreateInfo.pScissors = NULL;
+
+	VkPipelineRasterizationStateCreateInfo rasterizationCreateInfo;
+	rasterizationCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizationCreateInfo.pNext = NULL;
+	rasterizationCreateInfo.flags = 0;
+	rasterizationCreateInfo.depthClampEnable = VK_FALSE;
+	rasterizationCreateInfo.rasterizerDiscardEnable = VK_FALSE;
+	rasterizationCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizationCreateInfo.cullMode = VK_CULL_MODE_NONE;
+	rasterizationCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterizationCreateInfo.depthBiasEnable = VK_FALSE;
+	rasterizationCreateInfo.depthBiasConstantFactor = 0.f;
+	rasterizationCreateInfo.depthBiasClamp = 0.f;
+	rasterizationCreateInfo.depthBiasSlopeFactor = 0.f;
+	rasterizationCreateInfo.lineWidth = 1.f;
+
+	VkPipelineMultisampleStateCreateInfo multisampleCreateInfo;
+	multisampleCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampleCreateInfo.pNext = NULL;
+	multisampleCreateInfo.flags = 0;
+	multisampleCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampleCreateInfo.sampleShadingEnable = VK_FALSE;
+	multisampleCreateInfo.minSampleShading = 0.f;
+	multisampleCreateInfo.pSampleMask = NULL;
+	multisampleCreateInfo.alphaToCoverageEnable = VK_FALSE;
+	multisampleCreateInfo.alphaToOneEnable = VK_FALSE;
+
+	// Without post effects the overlay shares the scene's subpass and its depth attachment, it ignores depth either way
+	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo;
+	memset(&depthStencilCreateInfo, 0, sizeof(depthStencilCreateInfo));
+	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilCreateInfo.depthTestEnable = VK_FALSE;
+	depthStencilCreateInfo.depthWriteEnable = VK_FALSE;
+	depthStencilCreateInfo.depthCompareOp = VK_COMPARE_OP_ALWAYS;
+	depthStencilCreateInfo.maxDepthBounds = 1.0f;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachmentState;
+	memset(&colorBlendAttachmentState, 0, sizeof(colorBlendAttachmentState));
+	colorBlendAttachmentState.blendEnable = VK_TRUE;
+	colorBlendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorBlendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorBlendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	VkPipelineColorBlendStateCreateInfo colorBlendCreateInfo;
+	colorBlendCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlendCreateInfo.pNext = NULL;
+	colorBlendCreateInfo.flags = 0;
+	colorBlendCreateInfo.logicOpEnable = VK_FALSE;
+	colorBlendCreateInfo.logicOp = VK_LOGIC_OP_CLEAR;
+	colorBlendCreateInfo.attachmentCount = 1;
+	colorBlendCreateInfo.pAttachments = &colorBlendAttachmentState;
+	colorBlendCreateInfo.blendConstants[0] = 0.f;
+	colorBlendCreateInfo.blendConstants[1] = 0.f;
+	colorBlendCreateInfo.blendConstants[2] = 0.f;
+	colorBlendCreateInfo.blendConstants[3] = 0.f;
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	VkPipelineDynamicStateCreateInfo dynamicCreateInfo;
+	dynamicCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicCreateInfo.pNext = NULL;
+	dynamicCreateInfo.flags = 0;
+	dynamicCreateInfo.dynamicStateCount = 2;
+	dynamicCreateInfo.pDynamicStates = dynamicStates;
+
+	VkPipelineShaderStageCreateInfo stages[2];
+	stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[0].pNext = NULL;
+	stages[0].flags = 0;
+	stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	stages[0].module = vertModule;
+	stages[0].pName = "main";
+	stages[0].pSpecializationInfo = NULL;
+
+	stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[1].pNext = NULL;
+	stages[1].flags = 0;
+	stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	stages[1].module = fragModule;
+	stages[1].pName = "main";
+	stages[1].pSpecializationInfo = NULL;
+
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo;
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.pNext = NULL;
+	pipelineCreateInfo.flags = 0;
+	pipelineCreateInfo.stageCount = 2;
+	pipelineCreateInfo.pStages = stages;
+	pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
+	pipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
+	pipelineCreateInfo.pTessellationState = NULL;
+	pipelineCreateInfo.pViewportState = &viewportCreateInfo;
+	pipelineCreateInfo.pRasterizationState = &rasterizationCreateInfo;
+	pipelineCreateInfo.pMultisampleState = &multisampleCreateInfo;
+	pipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;
+	pipelineCreateInfo.pColorBlendState = &colorBlendCreateInfo;
+	pipelineCreateInfo.pDynamicState = &dynamicCreateInfo;
+	pipelineCreateInfo.renderPass = renderPass;
+	pipelineCreateInfo.layout = pipelineLayout;
+	pipelineCreateInfo.subpass = subpass;
+	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineCreateInfo.basePipelineIndex = 0;
+
+	if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, NULL, &pipeline) != VK_SUCCESS)
+	{
+		pipeline = VK_NULL_HANDLE;
+		return false;
+	}
+
+	return true;
+}
+
+void PerformanceHud::Destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < frames.size(); ++i)
+	{
+		FrameData& frame = frames[i];
+
+		if (frame.quadBuffer != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(device, frame.quadBuffer, NULL);
+		}
+
+		if (frame.quadMemory != VK_NULL_HANDLE)
+		{
+			vkFreeMemory(device, frame.quadMemory, NULL);
+		}
+	}
+
+	frames.clear();
+
+	if (pipeline != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline(device, pipeline, NULL);
+		pipeline = VK_NULL_HANDLE;
+	}
+
+	// Destroying the pool frees the set
+	if (descriptorPool != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(device, descriptorPool, NULL);
+		descriptorPool = VK_NULL_HANDLE;
+		descriptorSet = VK_NULL_HANDLE;
+	}
+
+	if (pipelineLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyPipelineLayout(device, pipelineLayout, NULL);
+		pipelineLayout = VK_NULL_HANDLE;
+	}
+
+	if (setLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorSetLayout(device, setLayout, NULL);
+		setLayout = VK_NULL_HANDLE;
+	}
+
+	if (vertModule != VK_NULL_HANDLE)
+	{
+		vkDestroyShaderModule(device, vertModule, NULL);
+		vertModule = VK_NULL_HANDLE;
+	}
+
+	if (fragModule != VK_NULL_HANDLE)
+	{
+		vkDestroyShaderModule(device, fragModule, NULL);
+		fragModule = VK_NULL_HANDLE;
+	}
+
+	if (sampler != VK_NULL_HANDLE)
+	{
+		vkDestroySampler(device, sampler, NULL);
+		sampler = VK_NULL_HANDLE;
+	}
+
+	if (atlasView != VK_NULL_HANDLE)
+	{
+		vkDestroyImageView(device, atlasView, NULL);
+		atlasView = VK_NULL_HANDLE;
+	}
+
+	if (atlasImage != VK_NULL_HANDLE)
+	{
+		vkDestroyImage(device, atlasImage, NULL);
+		atlasImage = VK_NULL_HANDLE;
+	}
+
+	if (atlasMemory != VK_NULL_HANDLE)
+	{
+		vkFreeMemory(device, atlasMemory, NULL);
+		atlasMemory = VK_NULL_HANDLE;
+	}
+
+	device = VK_NULL_HANDLE;
+}
+
+void PerformanceHud::Update(uint32_t frame, const HudStats& stats)
+{
+	cpuHistory[graphCursor] = stats.cpuMilliseconds;
+	gpuHistory[graphCursor] = stats.gpuMilliseconds > 0.0f ? stats.gpuMilliseconds : 0.0f;
+	graphCursor = (graphCursor + 1) % GraphFrames;
+
+	FrameData& frameData = frames[frame];
+	Quad* quads = frameData.mappedQuads;
+	uint32_t quadCount = 0;
+
+	uint32_t heapLines = stats.heapCount < MaxHeapLines ? stats.heapCount : MaxHeapLines;
+	uint32_t lineCount = 3 + heapLines;
+	int32_t panelWidth = (int32_t)(GraphFrames * 2) + Margin * 2;
+	int32_t panelHeight = Margin * 3 + lineCount * LineHeight + (int32_t)GraphHeight + LineHeight;
+
+	// The panel goes first so everything else blends over it
+	AddQuad(quads, &quadCount, 0, 0, panelWidth, panelHeight, HudSolidGlyph, PanelColor);
+
+	char line[64];
+	int32_t y = Margin;
+
+	float fps = stats.cpuMilliseconds > 0.0f ? 1000.0f / stats.cpuMilliseconds : 0.0f;
+	snprintf(line, sizeof(line), "CPU %6.2f ms %6.1f fps", stats.cpuMilliseconds, fps);
+	AddText(quads, &quadCount, Margin, y, line, TextColor);
+	y += LineHeight;
+
+	if (stats.gpuMilliseconds >= 0.0f)
+	{
+		snprintf(line, sizeof(line), "GPU %6.2f ms scale %4.2f", stats.gpuMilliseconds, stats.resolutionScale);
+	}
+	else
+	{
+		snprintf(line, sizeof(line), "GPU    n/a    scale %4.2f", stats.resolutionScale);
+	}
+
+	AddText(quads, &quadCount, Margin, y, line, TextColor);
+	y += LineHeight;
+
+	snprintf(line, sizeof(line), "Draws %u of %u", stats.drawCount, stats.totalDrawCount);
+	AddText(quads, &quadCount, Margin, y, line, TextColor);
+	y += LineHeight;
+
+	for (uint32_t heap = 0; heap < heapLines; ++heap)
+	{
+		snprintf(line, sizeof(line), "Heap %u %6u of %6u MB", heap, (uint32_t)(stats.heapUsage[heap] >> 20), (uint32_t)(stats.heapBudget[heap] >> 20));
+		AddText(quads, &quadCount, Margin, y, line, TextColor);
+		y += LineHeight;
+	}
+
+	// Oldest frame on the left, bars grow up from the graph's baseline
+	y += Margin;
+	int32_t baseline = y + (int32_t)GraphHeight;
+
+	for (uint32_t column = 0; column < GraphFrames; ++column)
+	{
+		uint32_t sample = (graphCursor + column) % GraphFrames;
+		int32_t x = Margin + (int32_t)column * 2;
+
+		uint32_t cpuHeight = (uint32_t)(GraphHeight * (cpuHistory[sample] < GraphMilliseconds ? cpuHistory[sample] : GraphMilliseconds) / GraphMilliseconds);
+		uint32_t gpuHeight = (uint32_t)(GraphHeight * (gpuHistory[sample] < GraphMilliseconds ? gpuHistory[sample] : GraphMilliseconds) / GraphMilliseconds);
+
+		if (cpuHeight > 0)
+		{
+			AddQuad(quads, &quadCount, x, baseline - (int32_t)cpuHeight, 1, cpuHeight, HudSolidGlyph, CpuColor);
+		}
+
+		if (gpuHeight > 0)
+		{
+			AddQuad(quads, &quadCount, x + 1, baseline - (int32_t)gpuHeight, 1, gpuHeight, HudSolidGlyph, GpuColor);
+		}
+	}
+
+	int32_t targetY = baseline - (int32_t)(GraphHeight * TargetMilliseconds / GraphMilliseconds);
+	AddQuad(quads, &quadCount, Margin, targetY, GraphFrames * 2, 1, HudSolidGlyph, TargetLineColor);
+
+	y = baseline + Margin / 2;
+	AddText(quads, &quadCount, Margin, y, "CPU", CpuColor);
+	AddText(quads, &quadCount, Margin + 4 * (int32_t)HudGlyphWidth, y, "GPU", GpuColor);
+	AddText(quads, &quadCount, Margin + 8 * (int32_t)HudGlyphWidth, y, "16.7 ms line", TextColor);
+
+	frameData.quadCount = quadCount;
+}
+
+void PerformanceHud::Record(VkCommandBuffer commandBuffer, uint32_t frame, VkExtent2D targetExtent)
+{
+	const FrameData& frameData = frames[frame];
+
+	if (frameData.quadCount == 0)
+	{
+		return;
+	}
+
+	HudConstants constants;
+	constants.pixelToClip[0] = 2.0f / (float)targetExtent.width;
+	constants.pixelToClip[1] = 2.0f / (float)targetExtent.height;
+
+	VkDeviceSize offset = 0;
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, NULL);
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &frameData.quadBuffer, &offset);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+	vkCmdDraw(commandBuffer, 4, frameData.quadCount, 0, 0);
+}
+
+uint32_t PerformanceHud::GetQuadCount(uint32_t frame) const
+{
+	return frames[frame].quadCount;
+}
+
+void PerformanceHud::AddQuad(Quad* quads, uint32_t* quadCount, int32_t x, int32_t y, uint32_t width, uint32_t height, uint32_t glyph, uint32_t color)
+{
+	if (*quadCount == MaxQuads)
+	{
+		return;
+	}
+
+	Quad& quad = quads[(*quadCount)++];
+	quad.position[0] = (int16_t)x;
+	quad.position[1] = (int16_t)y;
+	quad.size[0] = (uint16_t)width;
+	quad.size[1] = (uint16_t)height;
+	quad.glyph = glyph;
+	quad.color = color;
+}
+
+void PerformanceHud::AddText(Quad* quads, uint32_t* quadCount, int32_t x, int32_t y, const char* text, uint32_t color)
+{
+	for (; *text != '\0'; ++text, x += (int32_t)HudGlyphWidth)
+	{
+		uint32_t character = (uint8_t)*text;
+
+		// Spaces only advance, anything outside the atlas shows as a question mark
+		if (character == ' ')
+		{
+			continue;
+		}
+
+		if (character < HudFirstCharacter || character - HudFirstCharacter >= HudSolidGlyph)
+		{
+			character = '?';
+		}
+
+		AddQuad(quads, quadCount, x, y, HudGlyphWidth, HudGlyphHeight, character - HudFirstCharacter, color);
+	}
+}
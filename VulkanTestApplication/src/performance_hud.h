@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "vulkan_helpers.h"
+
+// What the HUD shows for a frame
+struct HudStats
+{
+	float cpuMilliseconds;		// Since the previous frame started
+	float gpuMilliseconds;		// Negative while there is no measurement
+	float resolutionScale;
+	uint32_t drawCount;			// Draws recorded after culling
+	uint32_t totalDrawCount;
+	uint32_t heapCount;
+	VkDeviceSize heapUsage[VK_MAX_MEMORY_HEAPS];
+	VkDeviceSize heapBudget[VK_MAX_MEMORY_HEAPS];
+};
+
+// Overlay of frame timings, a CPU and GPU timing graph, draw counts and memory use, drawn over the
+// scene inside the scene's render pass.
+//
+// Every character, the panel behind them and each bar of the graph is a quad, an instance of one
+// instanced triangle strip. Quads pick a glyph from an atlas baked into hud_font.h, so the whole
+// overlay is a single draw with a single pipeline and descriptor set. Update lays out the quads
+// into the frame's host visible instance buffer.
+class PerformanceHud
+{
+public:
+	static const uint32_t MaxQuads = 1024;
+	static const uint32_t GraphFrames = 120;
+
+	PerformanceHud();
+	~PerformanceHud();
+
+	// The pipeline is created for subpass of renderPass, which draws into a single colour attachment.
+	// The atlas is uploaded with a blocking submission to queue.
+	bool Create(VkDevice device, VkQueue queue, VkCommandPool commandPool, const VkMemoryType* memoryTypes, VkPipelineCache pipelineCache, VkRenderPass renderPass, uint32_t subpass, uint32_t frameCount);
+	void Destroy();
+
+	// Adds the frame to the graph and lays out the overlay in frame's instance buffer, whose previous
+	// draw must have completed
+	void Update(uint32_t frame, const HudStats& stats);
+
+	// Draws what Update laid out for frame. Positions are in pixels of targetExtent, the size the
+	// render area is finally shown at, so the overlay keeps its size when the scene is rendered at a
+	// lower resolution and upscaled. Viewport and scissor must cover the render area.
+	void Record(VkCommandBuffer commandBuffer, uint32_t frame, VkExtent2D targetExtent);
+
+	uint32_t GetQuadCount(uint32_t frame) const;
+
+private:
+	struct Quad
+	{
+		int16_t position[2];	// Top left, in pixels
+		uint16_t size[2];
+		uint32_t glyph;
+		uint32_t color;			// RGBA8, alpha blended
+	};
+
+	struct FrameData
+	{
+		VkBuffer quadBuffer;
+		VkDeviceMemory quadMemory;
+		Quad* mappedQuads;
+		uint32_t quadCount;
+	};
+
+	bool CreateAtlas(VkQueue queue, VkCommandPool commandPool, const VkMemoryType* memoryTypes);
+	bool CreatePipeline(VkPipelineCache pipelineCache, VkRenderPass renderPass, uint32_t subpass);
+
+	void AddQuad(Quad* quads, uint32_t* quadCount, int32_t x, int32_t y, uint32_t width, uint32_t height, uint32_t glyph, uint32_t color);
+	void AddText(Quad* quads, uint32_t* quadCount, int32_t x, int32_t y, const char* text, uint32_t color);
+
+	VkDevice device;
+
+	VkImage atlasImage;
+	VkDeviceMemory atlasMemory;
+	VkImageView atlasView;
+	VkSampler sampler;
+
+	VkDescriptorSetLayout setLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet descriptorSet;
+	VkPipelineLayout pipelineLayout;
+	VkShaderModule vertModule;
+	VkShaderModule fragModule;
+	VkPipeline pipeline;
+
+	std::vector<FrameData> frames;
+
+	// Ring of the last GraphFrames frames, graphCursor being the oldest
+	float cpuHistory[GraphFrames];
+	float gpuHistory[GraphFrames];
+	uint32_t graphCursor;
+};
@@ -0,0 +1,289 @@
+#include "render_queue.h"
+
+#include <cstring>
+
+#include "frame_capture.h"
+
+// Bits sorted per radix pass
+static const uint32_t RadixBits = 8;
+static const uint32_t RadixBuckets = 1 << RadixBits;
+static const uint32_t RadixPasses = 64 / RadixBits;
+
+static uint64_t PackField(uint64_t key, uint32_t value, uint32_t bits)
+{
+	uint32_t mask = (1u << bits) - 1;
+	return (key << bits) | (value & mask);
+}
+
+uint64_t MakeSortKey(uint32_t layer, uint32_t pipeline, uint32_t material, float depth, bool backToFront, uint32_t instanceData)
+{
+	if (depth < 0.0f)
+	{
+		depth = 0.0f;
+	}
+
+	if (depth > 1.0f)
+	{
+		depth = 1.0f;
+	}
+
+	uint32_t depthMax = (1u << SortKeyDepthBits) - 1;
+	uint32_t quantisedDepth = (uint32_t)(depth * depthMax);
+
+	if (backToFront)
+	{
+		quantisedDepth = depthMax - quantisedDepth;
+	}
+
+	uint64_t key = 0;
+	key = PackField(key, layer, SortKeyLayerBits);
+	key = PackField(key, pipeline, SortKeyPipelineBits);
+	key = PackField(key, material, SortKeyMaterialBits);
+	key = PackField(key, quantisedDepth, SortKeyDepthBits);
+	key = PackField(key, instanceData, SortKeyInstanceBits);
+	return key;
+}
+
+RenderQueue::RenderQueue()
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
+uint32_t RenderQueue::AddPipeline(VkPipeline pipeline, VkPipelineLayout layout)
+{
+	PipelineState state;
+	state.pipeline = pipeline;
+	state.layout = layout;
+	pipelines.push_back(state);
+	return (uint32_t)pipelines.size() - 1;
+}
+
+uint32_t RenderQueue::AddMaterial(VkDescriptorSet descriptorSet)
+{
+	materials.push_back(descriptorSet);
+	return (uint32_t)materials.size() - 1;
+}
+
+uint32_t RenderQueue::AddMesh(VkBuffer vertexBuffer, VkBuffer indexBuffer, VkIndexType indexType)
+{
+	MeshState state;
+	state.vertexBuffer = vertexBuffer;
+	state.indexBuffer = indexBuffer;
+	state.indexType = indexType;
+	meshes.push_back(state);
+	return (uint32_t)meshes.size() - 1;
+}
+
+void RenderQueue::SetPipeline(uint32_t pipeline, VkPipeline handle, VkPipelineLayout layout)
+{
+	pipelines[pipeline].pipeline = handle;
+	pipelines[pipeline].layout = layout;
+}
+
+void RenderQueue::SetMaterial(uint32_t material, VkDescriptorSet descriptorSet)
+{
+	materials[material] = descriptorSet;
+}
+
+void RenderQueue::SetMesh(uint32_t mesh, VkBuffer vertexBuffer, VkBuffer indexBuffer, VkIndexType indexType)
+{
+	meshes[mesh].vertexBuffer = vertexBuffer;
+	meshes[mesh].indexBuffer = indexBuffer;
+	meshes[mesh].indexType = indexType;
+}
+
+void RenderQueue::Clear()
+{
+	packets.clear();
+	keys.clear();
+	order.clear();
+}
+
+void RenderQueue::Submit(const DrawPacket& packet)
+{
+	packets.push_back(packet);
+}
+
+void RenderQueue::Sort()
+{
+	uint32_t count = (uint32_t)packets.size();
+
+	keys.resize(count);
+	sortedKeys.resize(count);
+	order.resize(count);
+	sortedOrder.resize(count);
+	stats.sortPasses = 0;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		keys[i] = packets[i].key;
+		order[i] = i;
+	}
+
+	if (count < 2)
+	{
+		return;
+	}
+
+	// Histograms for every pass in one read of the keys
+	std::vector<uint32_t> histograms(RadixPasses * RadixBuckets, 0);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint64_t key = keys[i];
+
+		for (uint32_t pass = 0; pass < RadixPasses; ++pass)
+		{
+			++histograms[pass * RadixBuckets + (uint32_t)((key >> (pass * RadixBits)) & (RadixBuckets - 1))];
+		}
+	}
+
+	for (uint32_t pass = 0; pass < RadixPasses; ++pass)
+	{
+		uint32_t* histogram = &histograms[pass * RadixBuckets];
+		uint32_t shift = pass * RadixBits;
+
+		// Every key has the same digit, this pass wouldn't change the order. Common for the
+		// high bytes when only a few layers and pipelines are in use.
+		if (histogram[(keys[0] >> shift) & (RadixBuckets - 1)] == count)
+		{
+			continue;
+		}
+
+		uint32_t offset = 0;
+
+		for (uint32_t bucket = 0; bucket < RadixBuckets; ++bucket)
+		{
+			uint32_t bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			uint32_t destination = histogram[(keys[i] >> shift) & (RadixBuckets - 1)]++;
+			sortedKeys[destination] = keys[i];
+			sortedOrder[destination] = order[i];
+		}
+
+		keys.swap(sortedKeys);
+		order.swap(sortedOrder);
+		++stats.sortPasses;
+	}
+}
+
+void RenderQueue::Record(VkCommandBuffer commandBuffer, FrameCapture* capture)
+{
+	stats.draws = 0;
+	stats.pipelineBinds = 0;
+	stats.descriptorSetBinds = 0;
+	stats.vertexBufferBinds = 0;
+	stats.indexBufferBinds = 0;
+	stats.skippedBinds = 0;
+
+	VkPipeline boundPipeline = VK_NULL_HANDLE;
+	VkPipelineLayout boundLayout = VK_NULL_HANDLE;
+	VkDescriptorSet boundDescriptorSet = VK_NULL_HANDLE;
+	VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+	VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+	VkIndexType boundIndexType = VK_INDEX_TYPE_UINT16;
+
+	if (capture != NULL && capture->IsCapturing() == false)
+	{
+		capture = NULL;
+	}
+
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		const DrawPacket& packet = packets[order[i]];
+		const PipelineState& pipeline = pipelines[packet.pipeline];
+		const MeshState& mesh = meshes[packet.mesh];
+		VkDescriptorSet descriptorSet = materials[packet.material];
+
+		if (pipeline.pipeline != boundPipeline)
+		{
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+			boundPipeline = pipeline.pipeline;
+			++stats.pipelineBinds;
+
+			if (capture != NULL)
+			{
+				capture->BindPipeline(pipeline.pipeline);
+			}
+		}
+		else
+		{
+			++stats.skippedBinds;
+		}
+
+		// Sets bound with another layout can't be relied on, so a layout change rebinds
+		if (descriptorSet != boundDescriptorSet || pipeline.layout != boundLayout)
+		{
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, 1, &descriptorSet, 0, NULL);
+			boundDescriptorSet = descriptorSet;
+			boundLayout = pipeline.layout;
+			++stats.descriptorSetBinds;
+
+			if (capture != NULL)
+			{
+				capture->BindDescriptorSet(descriptorSet);
+			}
+		}
+		else
+		{
+			++stats.skippedBinds;
+		}
+
+		if (mesh.vertexBuffer != boundVertexBuffer)
+		{
+			VkDeviceSize offset = 0;
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mesh.vertexBuffer, &offset);
+			boundVertexBuffer = mesh.vertexBuffer;
+			++stats.vertexBufferBinds;
+
+			if (capture != NULL)
+			{
+				capture->BindVertexBuffer(0, mesh.vertexBuffer, offset);
+			}
+		}
+		else
+		{
+			++stats.skippedBinds;
+		}
+
+		if (mesh.indexBuffer != boundIndexBuffer || mesh.indexType != boundIndexType)
+		{
+			vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer, 0, mesh.indexType);
+			boundIndexBuffer = mesh.indexBuffer;
+			boundIndexType = mesh.indexType;
+			++stats.indexBufferBinds;
+
+			if (capture != NULL)
+			{
+				capture->BindIndexBuffer(mesh.indexBuffer, 0, mesh.indexType);
+			}
+		}
+		else
+		{
+			++stats.skippedBinds;
+		}
+
+		vkCmdDrawIndexed(commandBuffer, packet.indexCount, packet.instanceCount, packet.firstIndex, packet.vertexOffset, packet.firstInstance);
+		++stats.draws;
+
+		if (capture != NULL)
+		{
+			capture->DrawIndexed(packet.indexCount, packet.instanceCount, packet.firstIndex, packet.vertexOffset, packet.firstInstance);
+		}
+	}
+}
+
+size_t RenderQueue::GetPacketCount() const
+{
+	return packets.size();
+}
+
+const RenderQueueStats& RenderQueue::GetStats() const
+{
+	return stats;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "vulkan_helpers.h"
+
+class FrameCapture;
+
+// 64 bit draw sort key, most significant field first:
+//
+//   layer 4 | pipeline 12 | material 16 | depth 24 | instance 8
+//
+// Sorting by key groups draws by layer, then by the state that is most expensive to change.
+// Depth is quantised from [0, 1] and inverted for back to front layers, the low bits are free
+// for per-instance data such as a LOD.
+const uint32_t SortKeyLayerBits = 4;
+const uint32_t SortKeyPipelineBits = 12;
+const uint32_t SortKeyMaterialBits = 16;
+const uint32_t SortKeyDepthBits = 24;
+const uint32_t SortKeyInstanceBits = 8;
+
+uint64_t MakeSortKey(uint32_t layer, uint32_t pipeline, uint32_t material, float depth, bool backToFront, uint32_t instanceData);
+
+// One indexed draw. pipeline, material and mesh are ids returned by the RenderQueue.
+struct DrawPacket
+{
+	uint64_t key;
+	uint32_t pipeline;
+	uint32_t material;
+	uint32_t mesh;
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t instanceCount;
+	uint32_t firstInstance;
+};
+
+struct RenderQueueStats
+{
+	uint32_t draws;
+	uint32_t pipelineBinds;
+	uint32_t descriptorSetBinds;
+	uint32_t vertexBufferBinds;
+	uint32_t indexBufferBinds;
+	uint32_t skippedBinds;		// Redundant binds not recorded
+	uint32_t sortPasses;		// Radix passes that weren't skipped
+};
+
+// Collects draw packets during a frame, radix sorts them by key and records them, binding
+// pipelines, descriptor sets and buffers only when they change from the previous draw.
+//
+// State is registered once and referred to by id, so packets stay small and comparing state is
+// an integer compare. Materials and meshes can be repointed between frames, for per frame
+// descriptor sets or buffers moved by the defragmenter.
+class RenderQueue
+{
+public:
+	RenderQueue();
+
+	uint32_t AddPipeline(VkPipeline pipeline, VkPipelineLayout layout);
+	uint32_t AddMaterial(VkDescriptorSet descriptorSet);
+	uint32_t AddMesh(VkBuffer vertexBuffer, VkBuffer indexBuffer, VkIndexType indexType);
+
+	void SetPipeline(uint32_t pipeline, VkPipeline handle, VkPipelineLayout layout);
+	void SetMaterial(uint32_t material, VkDescriptorSet descriptorSet);
+	void SetMesh(uint32_t mesh, VkBuffer vertexBuffer, VkBuffer indexBuffer, VkIndexType indexType);
+
+	void Clear();
+	void Submit(const DrawPacket& packet);
+
+	// Sorts by key, equal keys keep their submission order
+	void Sort();
+
+	// Records the sorted draws into commandBuffer inside the current render pass. Nothing is
+	// assumed bound beforehand. Commands are mirrored into capture when it is capturing, it may be
+	// NULL.
+	void Record(VkCommandBuffer commandBuffer, FrameCapture* capture);
+
+	size_t GetPacketCount() const;
+
+	// For the last Sort and Record
+	const RenderQueueStats& GetStats() const;
+
+private:
+	struct PipelineState
+	{
+		VkPipeline pipeline;
+		VkPipelineLayout layout;
+	};
+
+	struct MeshState
+	{
+		VkBuffer vertexBuffer;
+		VkBuffer indexBuffer;
+		VkIndexType indexType;
+	};
+
+	std::vector<PipelineState> pipelines;
+	std::vector<VkDescriptorSet> materials;
+	std::vector<MeshState> meshes;
+
+	std::vector<DrawPacket> packets;
+
+	// Radix sort works on (key, packet index) pairs so packets are never moved
+	std::vector<uint64_t> keys;
+	std::vector<uint64_t> sortedKeys;
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> sortedOrder;
+
+	RenderQueueStats stats;
+};
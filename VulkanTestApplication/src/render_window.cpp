@@ -11,7 +11,29 @@ RenderWindow::~RenderWindow()
 
 }
 
-void RenderWindow::Create()
+struct MonitorSearch
+{
+	uint32_t remaining;
+	RECT rect;
+	bool found;
+};
+
+static BOOL CALLBACK FindMonitor(HMONITOR monitor, HDC context, LPRECT rect, LPARAM data)
+{
+	MonitorSearch* search = (MonitorSearch*)data;
+
+	if (search->remaining == 0)
+	{
+		search->rect = *rect;
+		search->found = true;
+		return FALSE;
+	}
+
+	--search->remaining;
+	return TRUE;
+}
+
+void RenderWindow::Create(int x, int y)
 {
 	WNDCLASSEX windowClass;
 	windowClass.cbSize = sizeof(WNDCLASSEX);
@@ -33,8 +55,8 @@ void RenderWindow::Create()
 		windowClass.lpszClassName, 
 		TEXT("VulkanTestApplication"),
 		WS_OVERLAPPEDWINDOW | WS_CLIPCHILDREN | WS_CLIPSIBLINGS,
-		CW_USEDEFAULT, 
-		CW_USEDEFAULT,
+		x,
+		y,
 		800,
 		600, 
 		NULL,
@@ -74,6 +96,23 @@ HWND RenderWindow::GetNativeHandle() const
 	return windowHandle;
 }
 
+bool RenderWindow::GetMonitorOrigin(uint32_t monitor, int* x, int* y)
+{
+	MonitorSearch search;
+	search.remaining = monitor;
+	search.found = false;
+	EnumDisplayMonitors(NULL, NULL, &FindMonitor, (LPARAM)&search);
+
+	if (search.found == false)
+	{
+		return false;
+	}
+
+	*x = search.rect.left;
+	*y = search.rect.top;
+	return true;
+}
+
 LRESULT RenderWindow::WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
 	if (uMsg == WM_CLOSE)
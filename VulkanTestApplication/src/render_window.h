@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #include <Windows.h>
 
 class RenderWindow
@@ -10,7 +12,8 @@ private:
 public:
 	RenderWindow();
 	~RenderWindow();
-	void Create();
+	// x and y are the top left in desktop coordinates, CW_USEDEFAULT lets Windows place it
+	void Create(int x, int y);
 	void Show();
 	void Hide();
 	bool IsOpen() const;
@@ -18,6 +21,9 @@ public:
 
 	HWND GetNativeHandle() const;
 
+	// Top left of a display in desktop coordinates, false if there are fewer displays
+	static bool GetMonitorOrigin(uint32_t monitor, int* x, int* y);
+
 private:
 	LRESULT WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lparam);
 	static LRESULT CALLBACK StaticWindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
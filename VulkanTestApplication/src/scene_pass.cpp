@@ -0,0 +1,660 @@
+#include "scene_pass.h"
+
+#include <cstring>
+
+#include "post.vert.h"
+#include "post.frag.h"
+
+struct EffectConstants
+{
+	float sceneSize[2];
+};
+
+bool ParsePostEffects(const char* list, std::vector<PostEffect>* effects)
+{
+	effects->clear();
+
+	while (*list != '\0')
+	{
+		const char* end = strchr(list, ',');
+		size_t length = end != NULL ? (size_t)(end - list) : strlen(list);
+
+		if (length == 7 && strncmp(list, "tonemap", length) == 0)
+		{
+			effects->push_back(PostEffect_Tonemap);
+		}
+		else if (length == 8 && strncmp(list, "vignette", length) == 0)
+		{
+			effects->push_back(PostEffect_Vignette);
+		}
+		else if (length == 10 && strncmp(list, "desaturate", length) == 0)
+		{
+			effects->push_back(PostEffect_Desaturate);
+		}
+		else
+		{
+			return false;
+		}
+
+		list += end != NULL ? length + 1 : length;
+	}
+
+	return effects->size() <= ScenePass::MaxEffects;
+}
+
+ScenePass::ScenePass()
+	: device(VK_NULL_HANDLE)
+	, intermediateCount(0)
+	, renderPass(VK_NULL_HANDLE)
+	, framebuffer(VK_NULL_HANDLE)
+	, intermediateBytes(0)
+	, lazyMemory(false)
+	, setLayout(VK_NULL_HANDLE)
+	, descriptorPool(VK_NULL_HANDLE)
+	, pipelineLayout(VK_NULL_HANDLE)
+	, vertModule(VK_NULL_HANDLE)
+	, fragModule(VK_NULL_HANDLE)
+{
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		intermediateImages[i] = VK_NULL_HANDLE;
+		intermediateMemory[i] = VK_NULL_HANDLE;
+		intermediateViews[i] = VK_NULL_HANDLE;
+	}
+}
+
+ScenePass::~ScenePass()
+{
+}
+
+bool ScenePass::Create(VkDevice device, const VkMemoryType* memoryTypes, VkPipelineCache pipelineCache, const std::vector<PostEffect>& effects, VkFormat colorFormat, VkImageView outputView,
+	VkFormat depthFormat, VkImageView depthView, bool storeDepth, uint32_t width, uint32_t height)
+{
+	if (effects.size() > MaxEffects)
+	{
+		return false;
+	}
+
+	this->device = device;
+	this->effects = effects;
+
+	// The scene and each effect but the last write an intermediate, alternating between two
+	intermediateCount = effects.empty() ? 0 : (effects.size() == 1 ? 1 : 2);
+
+	if (CreateRenderPass(colorFormat, depthFormat, storeDepth) == false
+		|| CreateIntermediates(memoryTypes, colorFormat, width, height) == false)
+	{
+		return false;
+	}
+
+	VkImageView attachments[MaxAttachments] = { outputView, depthView, intermediateViews[0], intermediateViews[1] };
+
+	VkFramebufferCreateInfo framebufferCreateInfo;
+	framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferCreateInfo.pNext = NULL;
+	framebufferCreateInfo.flags = 0;
+	framebufferCreateInfo.renderPass = renderPass;
+	framebufferCreateInfo.attachmentCount = GetAttachmentCount();
+	framebufferCreateInfo.pAttachments = attachments;
+	framebufferCreateInfo.width = width;
+	framebufferCreateInfo.height = height;
+	framebufferCreateInfo.layers = 1;
+
+	if (vkCreateFramebuffer(device, &framebufferCreateInfo, NULL, &framebuffer) != VK_SUCCESS)
+	{
+		framebuffer = VK_NULL_HANDLE;
+		return false;
+	}
+
+	return effects.empty() || CreateEffectPipelines(pipelineCache);
+}
+
+bool ScenePass::CreateRenderPass(VkFormat colorFormat, VkFormat depthFormat, bool storeDepth)
+{
+	VkAttachmentDescription attachmentDescriptions[MaxAttachments];
+
+	// Written by the last subpass, so only cleared when the scene is drawn into it directly
+	attachmentDescriptions[OutputAttachment].flags = 0;
+	attachmentDescriptions[OutputAttachment].format = colorFormat;
+	attachmentDescriptions[OutputAttachment].samples = VK_SAMPLE_COUNT_1_BIT;
+	attachmentDescriptions[OutputAttachment].loadOp = effects.empty() ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachmentDescriptions[OutputAttachment].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	attachmentDescriptions[OutputAttachment].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachmentDescriptions[OutputAttachment].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachmentDescriptions[OutputAttachment].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	attachmentDescriptions[OutputAttachment].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	attachmentDescriptions[DepthAttachment].flags = 0;
+	attachmentDescriptions[DepthAttachment].format = depthFormat;
+	attachmentDescriptions[DepthAttachment].samples = VK_SAMPLE_COUNT_1_BIT;
+	attachmentDescriptions[DepthAttachment].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachmentDescriptions[DepthAttachment].storeOp = storeDepth ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachmentDescriptions[DepthAttachment].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachmentDescriptions[DepthAttachment].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachmentDescriptions[DepthAttachment].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	attachmentDescriptions[DepthAttachment].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	// The scene clears the first intermediate, effects cover every pixel of the second
+	for (uint32_t i = 0; i < intermediateCount; ++i)
+	{
+		VkAttachmentDescription& description = attachmentDescriptions[FirstIntermediateAttachment + i];
+		description.flags = 0;
+		description.format = colorFormat;
+		description.samples = VK_SAMPLE_COUNT_1_BIT;
+		description.loadOp = i == 0 ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		description.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		description.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		description.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+
+	uint32_t subpassCount = (uint32_t)effects.size() + 1;
+
+	// Subpass 0 writes colour reference 0 and depth, effect i reads input reference i and writes
+	// colour reference i + 1
+	VkAttachmentReference colorReferences[MaxEffects + 1];
+	VkAttachmentReference inputReferences[MaxEffects];
+	VkSubpassDescription subpassDescriptions[MaxEffects + 1];
+	VkSubpassDependency dependencies[MaxEffects];
+
+	VkAttachmentReference depthReference;
+	depthReference.attachment = DepthAttachment;
+	depthReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	for (uint32_t subpass = 0; subpass < subpassCount; ++subpass)
+	{
+		bool last = subpass + 1 == subpassCount;
+
+		colorReferences[subpass].attachment = last ? OutputAttachment : FirstIntermediateAttachment + subpass % 2;
+		colorReferences[subpass].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		VkSubpassDescription& description = subpassDescriptions[subpass];
+		description.flags = 0;
+		description.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		description.inputAttachmentCount = 0;
+		description.pInputAttachments = NULL;
+		description.colorAttachmentCount = 1;
+		description.pColorAttachments = &colorReferences[subpass];
+		description.pResolveAttachments = NULL;
+		description.pDepthStencilAttachment = subpass == 0 ? &depthReference : NULL;
+		description.preserveAttachmentCount = 0;
+		description.pPreserveAttachments = NULL;
+
+		if (subpass == 0)
+		{
+			continue;
+		}
+
+		inputReferences[subpass - 1].attachment = FirstIntermediateAttachment + (subpass - 1) % 2;
+		inputReferences[subpass - 1].layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		description.inputAttachmentCount = 1;
+		description.pInputAttachments = &inputReferences[subpass - 1];
+
+		// Colour written by the subpass before is read here, and the intermediate it read is
+		// written here, which the execution dependency alone orders. Both are per pixel.
+		VkSubpassDependency& dependency = dependencies[subpass - 1];
+		dependency.srcSubpass = subpass - 1;
+		dependency.dstSubpass = subpass;
+		dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependency.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependency.dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+	}
+
+	VkRenderPassCreateInfo renderPassCreateInfo;
+	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassCreateInfo.pNext = NULL;
+	renderPassCreateInfo.flags = 0;
+	renderPassCreateInfo.attachmentCount = GetAttachmentCount();
+	renderPassCreateInfo.pAttachments = attachmentDescriptions;
+	renderPassCreateInfo.subpassCount = subpassCount;
+	renderPassCreateInfo.pSubpasses = subpassDescriptions;
+	renderPassCreateInfo.dependencyCount = subpassCount - 1;
+	renderPassCreateInfo.pDependencies = dependencies;
+
+	if (vkCreateRenderPass(device, &renderPassCreateInfo, NULL, &renderPass) != VK_SUCCESS)
+	{
+		renderPass = VK_NULL_HANDLE;
+		return false;
+	}
+
+	return true;
+}
+
+bool ScenePass::CreateIntermediates(const VkMemoryType* memoryTypes, VkFormat colorFormat, uint32_t width, uint32_t height)
+{
+	intermediateBytes = 0;
+	lazyMemory = false;
+
+	for (uint32_t i = 0; i < intermediateCount; ++i)
+	{
+		if (CreateRenderTarget(device, memoryTypes, width, height, colorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+			VK_IMAGE_ASPECT_COLOR_BIT, &intermediateImages[i], &intermediateMemory[i], &intermediateViews[i]) == false)
+		{
+			intermediateImages[i] = VK_NULL_HANDLE;
+			intermediateMemory[i] = VK_NULL_HANDLE;
+			intermediateViews[i] = VK_NULL_HANDLE;
+			return false;
+		}
+
+		// CreateRenderTarget takes the first lazily allocated type that fits, if there is one
+		VkMemoryRequirements memoryRequirements;
+		vkGetImageMemoryRequirements(device, intermediateImages[i], &memoryRequirements);
+		uint32_t typeIndex;
+		lazyMemory = memory_type_from_properties(memoryTypes, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &typeIndex);
+		intermediateBytes += memoryRequirements.size;
+	}
+
+	return true;
+}
+
+bool ScenePass::CreateEffectPipelines(VkPipelineCache pipelineCache)
+{
+	if (CreateShaderModule(device, post_vert_spv, sizeof(post_vert_spv), &vertModule) == false)
+	{
+		vertModule = VK_NULL_HANDLE;
+		return false;
+	}
+
+	if (CreateShaderModule(device, post_frag_spv, sizeof(post_frag_spv), &fragModule) == false)
+	{
+		fragModule = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkDescriptorSetLayoutBinding binding;
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	binding.pImmutableSamplers = NULL;
+
+	VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo;
+	setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutCreateInfo.pNext = NULL;
+	setLayoutCreateInfo.flags = 0;
+	setLayoutCreateInfo.bindingCount = 1;
+	setLayoutCreateInfo.pBindings = &binding;
+
+	if (vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, NULL, &setLayout) != VK_SUCCESS)
+	{
+		setLayout = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkPushConstantRange pushConstantRange;
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(EffectConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo;
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.pNext = NULL;
+	pipelineLayoutCreateInfo.flags = 0;
+	pipelineLayoutCreateInfo.setLayoutCount = 1;
+	pipelineLayoutCreateInfo.pSetLayouts = &setLayout;
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, NULL, &pipelineLayout) != VK_SUCCESS)
+	{
+		pipelineLayout = VK_NULL_HANDLE;
+		return false;
+	}
+
+	uint32_t effectCount = (uint32_t)effects.size();
+
+	VkDescriptorPoolSize poolSize;
+	poolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+	poolSize.descriptorCount = effectCount;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo;
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.pNext = NULL;
+	poolCreateInfo.flags = 0;
+	poolCreateInfo.maxSets = effectCount;
+	poolCreateInfo.poolSizeCount = 1;
+	poolCreateInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(device, &poolCreateInfo, NULL, &descriptorPool) != VK_SUCCESS)
+	{
+		descriptorPool = VK_NULL_HANDLE;
+		return false;
+	}
+
+	std::vector<VkDescriptorSetLayout> setLayouts(effectCount, setLayout);
+	effectSets.resize(effectCount);
+
+	VkDescriptorSetAllocateInfo setAllocateInfo;
+	setAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocateInfo.pNext = NULL;
+	setAllocateInfo.descriptorPool = descriptorPool;
+	setAllocateInfo.descriptorSetCount = effectCount;
+	setAllocateInfo.pSetLayouts = setLayouts.data();
+
+	if (vkAllocateDescriptorSets(device, &setAllocateInfo, effectSets.data()) != VK_SUCCESS)
+	{
+		effectSets.clear();
+		return false;
+	}
+
+	for (uint32_t i = 0; i < effectCount; ++i)
+	{
+		VkDescriptorImageInfo imageInfo;
+		imageInfo.sampler = VK_NULL_HANDLE;
+		imageInfo.imageView = intermediateViews[i % 2];
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkWriteDescriptorSet write;
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.pNext = NULL;
+		write.dstSet = effectSets[i];
+		write.dstBinding = 0;
+		write.dstArrayElement = 0;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+		write.pImageInfo = &imageInfo;
+		write.pBufferInfo = NULL;
+		write.pTexelBufferView = NULL;
+		vkUpdateDescriptorSets(device, 1, &write, 0, NULL);
+	}
+
+	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo;
+	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputCreateInfo.pNext = NULL;
+	vertexInputCreateInfo.flags = 0;
+	vertexInputCreateInfo.vertexBindingDescriptionCount = 0;
+	vertexInputCreateInfo.pVertexBindingDescriptions = NULL;
+	vertexInputCreateInfo.vertexAttributeDescriptionCount = 0;
+	vertexInputCreateInfo.pVertexAttributeDescriptions = NULL;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo;
+	inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssemblyCreateInfo.pNext = NULL;
+	inputAssemblyCreateInfo.flags = 0;
+	inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
+
+	VkPipelineViewportStateCreateInfo viewportCreateInfo;
+	viewportCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportCreateInfo.pNext = NULL;
+	viewportCreateInfo.flags = 0;
+	viewportCreateInfo.viewportCount = 1;
+	viewportCreateInfo.pViewports = NULL;
+	viewportCreateInfo.scissorCount = 1;
+	viewportCreateInfo.pScissors = NULL;
+
+	VkPipelineRasterizationStateCreateInfo rasterizationCreateInfo;
+	rasterizationCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizationCreateInfo.pNext = NULL;
+	rasterizationCreateInfo.flags = 0;
+	rasterizationCreateInfo.depthClampEnable = VK_FALSE;
+	rasterizationCreateInfo.rasterizerDiscardEnable = VK_FALSE;
+	rasterizationCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizationCreateInfo.cullMode = VK_CULL_MODE_NONE;
+	rasterizationCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterizationCreateInfo.depthBiasEnable = VK_FALSE;
+	rasterizationCreateInfo.depthBiasConstantFactor = 0.f;
+	rasterizationCreateInfo.depthBiasClamp = 0.f;
+	rasterizationCreateInfo.depthBiasSlopeFactor = 0.f;
+	rasterizationCreateInfo.lineWidth = 1.f;
+
+	VkPipelineMultisampleStateCreateInfo multisampleCreateInfo;
+	multisampleCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampleCreateInfo.pNext = NULL;
+	multisampleCreateInfo.flags = 0;
+	multisampleCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampleCreateInfo.sampleShadingEnable = VK_FALSE;
+	multisampleCreateInfo.minSampleShading = 0.f;
+	multisampleCreateInfo.pSampleMask = NULL;
+	multisampleCreateInfo.alphaToCoverageEnable = VK_FALSE;
+	multisampleCreateInfo.alphaToOneEnable = VK_FALSE;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachmentState;
+	memset(&colorBlendAttachmentState, 0, sizeof(colorBlendAttachmentState));
+	colorBlendAttachmentState.blendEnable = VK_FALSE;
+	colorBlendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	VkPipelineColorBlendStateCreateInfo colorBlendCreateInfo;
+	colorBlendCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlendCreateInfo.pNext = NULL;
+	colorBlendCreateInfo.flags = 0;
+	colorBlendCreateInfo.logicOpEnable = VK_FALSE;
+	colorBlendCreateInfo.logicOp = VK_LOGIC_OP_CLEAR;
+	colorBlendCreateInfo.attachmentCount = 1;
+	colorBlendCreateInfo.pAttachments = &colorBlendAttachmentState;
+	colorBlendCreateInfo.blendConstants[0] = 0.f;
+	colorBlendCreateInfo.blendConstants[1] = 0.f;
+	colorBlendCreateInfo.blendConstants[2] = 0.f;
+	colorBlendCreateInfo.blendConstants[3] = 0.f;
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	VkPipelineDynamicStateCreateInfo dynamicCreateInfo;
+	dynamicCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicCreateInfo.pNext = NULL;
+	dynamicCreateInfo.flags = 0;
+	dynamicCreateInfo.dynamicStateCount = 2;
+	dynamicCreateInfo.pDynamicStates = dynamicStates;
+
+	// The effect is a specialisation constant, so each pipeline only contains its own branch
+	VkSpecializationMapEntry specializationEntry;
+	specializationEntry.constantID = 0;
+	specializationEntry.offset = 0;
+	specializationEntry.size = sizeof(int32_t);
+
+	std::vector<int32_t> effectIds(effectCount);
+	std::vector<VkSpecializationInfo> specializationInfos(effectCount);
+	std::vector<VkPipelineShaderStageCreateInfo> stages(effectCount * 2);
+	std::vector<VkGraphicsPipelineCreateInfo> pipelineCreateInfos(effectCount);
+
+	for (uint32_t i = 0; i < effectCount; ++i)
+	{
+		effectIds[i] = (int32_t)effects[i];
+
+		specializationInfos[i].mapEntryCount = 1;
+		specializationInfos[i].pMapEntries = &specializationEntry;
+		specializationInfos[i].dataSize = sizeof(int32_t);
+		specializationInfos[i].pData = &effectIds[i];
+
+		VkPipelineShaderStageCreateInfo* effectStages = &stages[i * 2];
+		effectStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		effectStages[0].pNext = NULL;
+		effectStages[0].flags = 0;
+		effectStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		effectStages[0].module = vertModule;
+		effectStages[0].pName = "main";
+		effectStages[0].pSpecializationInfo = NULL;
+
+		effectStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		effectStages[1].pNext = NULL;
+		effectStages[1].flags = 0;
+		effectStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		effectStages[1].module = fragModule;
+		effectStages[1].pName = "main";
+		effectStages[1].pSpecializationInfo = &specializationInfos[i];
+
+		VkGraphicsPipelineCreateInfo& pipelineCreateInfo = pipelineCreateInfos[i];
+		pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineCreateInfo.pNext = NULL;
+		pipelineCreateInfo.flags = 0;
+		pipelineCreateInfo.stageCount = 2;
+		pipelineCreateInfo.pStages = effectStages;
+		pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
+		pipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
+		pipelineCreateInfo.pTessellationState = NULL;
+		pipelineCreateInfo.pViewportState = &viewportCreateInfo;
+		pipelineCreateInfo.pRasterizationState = &rasterizationCreateInfo;
+		pipelineCreateInfo.pMultisampleState = &multisampleCreateInfo;
+		pipelineCreateInfo.pDepthStencilState = NULL;
+		pipelineCreateInfo.pColorBlendState = &colorBlendCreateInfo;
+		pipelineCreateInfo.pDynamicState = &dynamicCreateInfo;
+		pipelineCreateInfo.renderPass = renderPass;
+		pipelineCreateInfo.layout = pipelineLayout;
+		pipelineCreateInfo.subpass = i + 1;
+		pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+		pipelineCreateInfo.basePipelineIndex = 0;
+	}
+
+	effectPipelines.assign(effectCount, VK_NULL_HANDLE);
+
+	if (vkCreateGraphicsPipelines(device, pipelineCache, effectCount, pipelineCreateInfos.data(), NULL, effectPipelines.data()) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void ScenePass::Destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < effectPipelines.size(); ++i)
+	{
+		if (effectPipelines[i] != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(device, effectPipelines[i], NULL);
+		}
+	}
+
+	effectPipelines.clear();
+
+	// Destroying the pool frees every set
+	if (descriptorPool != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(device, descriptorPool, NULL);
+		descriptorPool = VK_NULL_HANDLE;
+	}
+
+	effectSets.clear();
+
+	if (pipelineLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyPipelineLayout(device, pipelineLayout, NULL);
+		pipelineLayout = VK_NULL_HANDLE;
+	}
+
+	if (setLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorSetLayout(device, setLayout, NULL);
+		setLayout = VK_NULL_HANDLE;
+	}
+
+	if (vertModule != VK_NULL_HANDLE)
+	{
+		vkDestroyShaderModule(device, vertModule, NULL);
+		vertModule = VK_NULL_HANDLE;
+	}
+
+	if (fragModule != VK_NULL_HANDLE)
+	{
+		vkDestroyShaderModule(device, fragModule, NULL);
+		fragModule = VK_NULL_HANDLE;
+	}
+
+	if (framebuffer != VK_NULL_HANDLE)
+	{
+		vkDestroyFramebuffer(device, framebuffer, NULL);
+		framebuffer = VK_NULL_HANDLE;
+	}
+
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		if (intermediateViews[i] != VK_NULL_HANDLE)
+		{
+			vkDestroyImageView(device, intermediateViews[i], NULL);
+			intermediateViews[i] = VK_NULL_HANDLE;
+		}
+
+		if (intermediateImages[i] != VK_NULL_HANDLE)
+		{
+			vkDestroyImage(device, intermediateImages[i], NULL);
+			intermediateImages[i] = VK_NULL_HANDLE;
+		}
+
+		if (intermediateMemory[i] != VK_NULL_HANDLE)
+		{
+			vkFreeMemory(device, intermediateMemory[i], NULL);
+			intermediateMemory[i] = VK_NULL_HANDLE;
+		}
+	}
+
+	if (renderPass != VK_NULL_HANDLE)
+	{
+		vkDestroyRenderPass(device, renderPass, NULL);
+		renderPass = VK_NULL_HANDLE;
+	}
+
+	device = VK_NULL_HANDLE;
+}
+
+VkRenderPass ScenePass::GetRenderPass() const
+{
+	return renderPass;
+}
+
+VkFramebuffer ScenePass::GetFramebuffer() const
+{
+	return framebuffer;
+}
+
+uint32_t ScenePass::GetAttachmentCount() const
+{
+	return FirstIntermediateAttachment + intermediateCount;
+}
+
+uint32_t ScenePass::GetEffectCount() const
+{
+	return (uint32_t)effects.size();
+}
+
+void ScenePass::RecordEffects(VkCommandBuffer commandBuffer, VkExtent2D sceneExtent)
+{
+	EffectConstants constants;
+	constants.sceneSize[0] = (float)sceneExtent.width;
+	constants.sceneSize[1] = (float)sceneExtent.height;
+
+	for (size_t i = 0; i < effects.size(); ++i)
+	{
+		vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, effectPipelines[i]);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &effectSets[i], 0, NULL);
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants), &constants);
+		vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+	}
+}
+
+bool ScenePass::UsesLazyMemory() const
+{
+	return lazyMemory;
+}
+
+VkDeviceSize ScenePass::GetIntermediateBytes() const
+{
+	return intermediateBytes;
+}
+
+VkDeviceSize ScenePass::GetCommittedBytes() const
+{
+	if (lazyMemory == false)
+	{
+		return intermediateBytes;
+	}
+
+	VkDeviceSize committed = 0;
+
+	for (uint32_t i = 0; i < intermediateCount; ++i)
+	{
+		VkDeviceSize bytes = 0;
+		vkGetDeviceMemoryCommitment(device, intermediateMemory[i], &bytes);
+		committed += bytes;
+	}
+
+	return committed;
+}
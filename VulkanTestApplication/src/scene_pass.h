@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+
+#include "vulkan_helpers.h"
+
+// Per-pixel effects applied after the scene, in post.frag
+enum PostEffect
+{
+	PostEffect_Tonemap = 0,		// Exposure and the Reinhard curve
+	PostEffect_Vignette = 1,	// Darkens towards the corners
+	PostEffect_Desaturate = 2,	// Halfway to luminance
+};
+
+// Parses a comma separated list of tonemap, vignette and desaturate
+bool ParsePostEffects(const char* list, std::vector<PostEffect>* effects);
+
+// The scene's render pass: the scene in subpass 0 followed by a chain of post effects, one subpass
+// each, writing the output image.
+//
+// Each effect reads the previous subpass's colour as an input attachment. Two intermediates are
+// alternated however long the chain is. They are transient attachments in lazily allocated memory
+// where the device has it, cleared or overwritten on load and never stored, so a tiled GPU keeps the
+// whole chain in tile memory and may never back them with physical pages. Input attachments only
+// read the pixel being shaded, which limits effects to per-pixel operations.
+//
+// Without effects the scene is drawn straight into the output.
+class ScenePass
+{
+public:
+	static const uint32_t MaxEffects = 8;
+
+	// Attachment indices, clear values are given in this order
+	static const uint32_t OutputAttachment = 0;
+	static const uint32_t DepthAttachment = 1;
+	static const uint32_t FirstIntermediateAttachment = 2;
+	static const uint32_t MaxAttachments = 4;
+
+	ScenePass();
+	~ScenePass();
+
+	// The output is left in COLOR_ATTACHMENT_OPTIMAL and depth in DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+	// both must be in those layouts when the pass begins. Depth is only stored if storeDepth is set.
+	bool Create(VkDevice device, const VkMemoryType* memoryTypes, VkPipelineCache pipelineCache, const std::vector<PostEffect>& effects, VkFormat colorFormat, VkImageView outputView,
+		VkFormat depthFormat, VkImageView depthView, bool storeDepth, uint32_t width, uint32_t height);
+	void Destroy();
+
+	// Scene pipelines are created against subpass 0
+	VkRenderPass GetRenderPass() const;
+	VkFramebuffer GetFramebuffer() const;
+	uint32_t GetAttachmentCount() const;
+	uint32_t GetEffectCount() const;
+
+	// Moves through the effect subpasses after the scene has been drawn in subpass 0. The viewport and
+	// scissor set for the scene carry over.
+	void RecordEffects(VkCommandBuffer commandBuffer, VkExtent2D sceneExtent);
+
+	bool UsesLazyMemory() const;
+
+	// Size of the intermediates, and how much of it the device has actually committed
+	VkDeviceSize GetIntermediateBytes() const;
+	VkDeviceSize GetCommittedBytes() const;
+
+private:
+	bool CreateRenderPass(VkFormat colorFormat, VkFormat depthFormat, bool storeDepth);
+	bool CreateIntermediates(const VkMemoryType* memoryTypes, VkFormat colorFormat, uint32_t width, uint32_t height);
+	bool CreateEffectPipelines(VkPipelineCache pipelineCache);
+
+	VkDevice device;
+	std::vector<PostEffect> effects;
+	uint32_t intermediateCount;
+
+	VkRenderPass renderPass;
+	VkFramebuffer framebuffer;
+
+	VkImage intermediateImages[2];
+	VkDeviceMemory intermediateMemory[2];
+	VkImageView intermediateViews[2];
+	VkDeviceSize intermediateBytes;
+	bool lazyMemory;
+
+	VkDescriptorSetLayout setLayout;
+	VkDescriptorPool descriptorPool;
+	VkPipelineLayout pipelineLayout;
+	VkShaderModule vertModule;
+	VkShaderModule fragModule;
+
+	// One per effect, reading the intermediate the subpass before wrote
+	std::vector<VkDescriptorSet> effectSets;
+	std::vector<VkPipeline> effectPipelines;
+};
@@ -0,0 +1,409 @@
+#include "shader_reload.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+
+#include "logger.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ShaderOptimizerFlags' default in config/SPIRVShader.targets
+static const char* const ShaderOptimizerFlags = "-O";
+
+static bool GetModifiedTime(const std::string& path, uint64_t* time)
+{
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+
+	if (GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes) == FALSE)
+	{
+		return false;
+	}
+
+	*time = ((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+#else
+	struct stat status;
+
+	if (stat(path.c_str(), &status) != 0)
+	{
+		return false;
+	}
+
+	*time = (uint64_t)status.st_mtim.tv_sec * 1000000000 + status.st_mtim.tv_nsec;
+#endif
+	return true;
+}
+
+ShaderReloader::ShaderReloader()
+	: device(VK_NULL_HANDLE)
+	, reloadReady(false)
+	, stopping(false)
+	, reloadCount(0)
+	, failureCount(0)
+{
+}
+
+ShaderReloader::~ShaderReloader()
+{
+	Stop();
+}
+
+void ShaderReloader::AddShader(const char* fileName)
+{
+	WatchedShader shader;
+	shader.fileName = fileName;
+	shader.modifiedTime = 0;
+	shaders.push_back(shader);
+}
+
+bool ShaderReloader::Start(VkDevice device, const char* sourceDirectory, const PipelineBuilder& builder)
+{
+	Stop();
+
+	this->device = device;
+	this->sourceDirectory = sourceDirectory;
+	this->builder = builder;
+
+	if (this->sourceDirectory.empty() == false && this->sourceDirectory.back() != '/' && this->sourceDirectory.back() != '\\')
+	{
+		this->sourceDirectory += '/';
+	}
+
+	// Sources as they are now are what the running pipelines were built from
+	for (size_t i = 0; i < shaders.size(); ++i)
+	{
+		if (GetModifiedTime(this->sourceDirectory + shaders[i].fileName, &shaders[i].modifiedTime) == false)
+		{
+			Log(LogSeverity_Warning, "Can't watch %s%s, it doesn't exist", this->sourceDirectory.c_str(), shaders[i].fileName.c_str());
+			return false;
+		}
+	}
+
+	stopping = false;
+	watcherThread = std::thread(&ShaderReloader::WatcherThread, this);
+	return true;
+}
+
+void ShaderReloader::Stop()
+{
+	if (watcherThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+
+		watcherThread.join();
+	}
+
+	// Never handed out, so the GPU hasn't used it
+	if (reloadReady)
+	{
+		DestroyReload(pendingReload);
+		reloadReady = false;
+	}
+}
+
+bool ShaderReloader::TakeReload(Reload* reload)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (reloadReady == false)
+	{
+		return false;
+	}
+
+	reload->modules.swap(pendingReload.modules);
+	reload->pipelines.swap(pendingReload.pipelines);
+	pendingReload.modules.clear();
+	pendingReload.pipelines.clear();
+	reloadReady = false;
+	return true;
+}
+
+uint32_t ShaderReloader::GetReloadCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return reloadCount;
+}
+
+uint32_t ShaderReloader::GetFailureCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return failureCount;
+}
+
+void ShaderReloader::WatcherThread()
+{
+#ifdef _WIN32
+	HANDLE notification = FindFirstChangeNotificationA(sourceDirectory.c_str(), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+
+	if (notification == INVALID_HANDLE_VALUE)
+	{
+		Log(LogSeverity_Warning, "Can't watch %s for shader changes", sourceDirectory.c_str());
+		return;
+	}
+#else
+	int notification = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	// Editors either rewrite the file or write a new one and rename it over the old
+	if (notification < 0 || inotify_add_watch(notification, sourceDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+	{
+		Log(LogSeverity_Warning, "Can't watch %s for shader changes", sourceDirectory.c_str());
+
+		if (notification >= 0)
+		{
+			close(notification);
+		}
+
+		return;
+	}
+#endif
+
+	bool changed = false;
+	std::chrono::steady_clock::time_point lastChange;
+
+	for (;;)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (stopping)
+			{
+				break;
+			}
+		}
+
+		// Waits at most PollMilliseconds so Stop is noticed
+		bool notified = false;
+
+#ifdef _WIN32
+		if (WaitForSingleObject(notification, PollMilliseconds) == WAIT_OBJECT_0)
+		{
+			notified = true;
+			FindNextChangeNotification(notification);
+		}
+#else
+		pollfd descriptor;
+		descriptor.fd = notification;
+		descriptor.events = POLLIN;
+		descriptor.revents = 0;
+
+		if (poll(&descriptor, 1, PollMilliseconds) > 0)
+		{
+			// Only whether something happened matters, modification times say which files changed
+			char events[4096];
+
+			while (read(notification, events, sizeof(events)) > 0)
+			{
+				notified = true;
+			}
+		}
+#endif
+
+		if (notified)
+		{
+			changed = true;
+			lastChange = std::chrono::steady_clock::now();
+			continue;
+		}
+
+		if (changed && std::chrono::steady_clock::now() - lastChange >= std::chrono::milliseconds((int64_t)DebounceMilliseconds))
+		{
+			changed = false;
+
+			if (CheckModified())
+			{
+				Rebuild();
+			}
+		}
+	}
+
+#ifdef _WIN32
+	FindCloseChangeNotification(notification);
+#else
+	close(notification);
+#endif
+}
+
+bool ShaderReloader::CheckModified()
+{
+	bool modified = false;
+
+	for (size_t i = 0; i < shaders.size(); ++i)
+	{
+		uint64_t modifiedTime;
+
+		// Missing while an editor replaces it, the rename that follows is another notification
+		if (GetModifiedTime(sourceDirectory + shaders[i].fileName, &modifiedTime) && modifiedTime != shaders[i].modifiedTime)
+		{
+			shaders[i].modifiedTime = modifiedTime;
+			modified = true;
+		}
+	}
+
+	return modified;
+}
+
+void ShaderReloader::Rebuild()
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// Every shader is recompiled, so a reload always carries a full set of modules
+	Reload reload;
+	bool succeeded = true;
+
+	for (size_t i = 0; i < shaders.size() && succeeded; ++i)
+	{
+		VkShaderModule module;
+		succeeded = CompileShader(sourceDirectory + shaders[i].fileName, &module);
+
+		if (succeeded)
+		{
+			reload.modules.push_back(module);
+		}
+	}
+
+	if (succeeded)
+	{
+		succeeded = builder(reload.modules, &reload.pipelines);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (succeeded == false)
+	{
+		reload.pipelines.clear();
+		DestroyReload(reload);
+		++failureCount;
+		Log(LogSeverity_Warning, "Shader reload failed, keeping the previous pipelines");
+		return;
+	}
+
+	// An earlier reload the render thread hasn't taken yet is superseded
+	if (reloadReady)
+	{
+		DestroyReload(pendingReload);
+	}
+
+	pendingReload = reload;
+	reloadReady = true;
+	++reloadCount;
+
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	Log(LogSeverity_Info, "Shaders rebuilt in %.1f ms, %u pipelines ready for the next frame", milliseconds, (uint32_t)reload.pipelines.size());
+}
+
+// Quotes a path for the shell behind std::system
+static bool QuoteArgument(const std::string& argument, std::string* quoted)
+{
+#ifdef _WIN32
+	// cmd.exe has no escape inside quotes and expands %...% even there, '"' can't be in a path anyway
+	if (argument.find_first_of("\"%") != std::string::npos)
+	{
+		return false;
+	}
+
+	*quoted = "\"" + argument + "\"";
+#else
+	// Nothing is special inside single quotes, a quote itself closes, escapes and reopens
+	*quoted = "'";
+
+	for (size_t i = 0; i < argument.size(); ++i)
+	{
+		if (argument[i] == '\'')
+		{
+			quoted->append("'\\''");
+		}
+		else
+		{
+			quoted->push_back(argument[i]);
+		}
+	}
+
+	quoted->push_back('\'');
+#endif
+	return true;
+}
+
+bool ShaderReloader::CompileShader(const std::string& sourcePath, VkShaderModule* module)
+{
+	// Same steps and optimiser flags as the build rule in config/SPIRVShader.targets, minus the embedding
+	std::string compiledPath = sourcePath + ".spv";
+	std::string outputPath = sourcePath + ".opt.spv";
+	std::string quotedSource, quotedCompiled, quotedOutput;
+
+	if (QuoteArgument(sourcePath, &quotedSource) == false || QuoteArgument(compiledPath, &quotedCompiled) == false || QuoteArgument(outputPath, &quotedOutput) == false)
+	{
+		Log(LogSeverity_Warning, "Can't pass %s to the shader compiler", sourcePath.c_str());
+		return false;
+	}
+
+	std::string command = "glslangValidator -V " + quotedSource + " -o " + quotedCompiled;
+
+	if (std::system(command.c_str()) != 0)
+	{
+		Log(LogSeverity_Warning, "Couldn't compile %s", sourcePath.c_str());
+		return false;
+	}
+
+	command = std::string("spirv-opt ") + ShaderOptimizerFlags + " " + quotedCompiled + " -o " + quotedOutput;
+
+	if (std::system(command.c_str()) != 0)
+	{
+		Log(LogSeverity_Warning, "Couldn't optimise %s", compiledPath.c_str());
+		return false;
+	}
+
+	std::ifstream file(outputPath.c_str(), std::ios::binary | std::ios::ate);
+
+	if (file.is_open() == false)
+	{
+		Log(LogSeverity_Warning, "Couldn't read %s", outputPath.c_str());
+		return false;
+	}
+
+	size_t size = (size_t)file.tellg();
+
+	if (size == 0 || size % sizeof(uint32_t) != 0)
+	{
+		Log(LogSeverity_Warning, "%s isn't valid SPIR-V", outputPath.c_str());
+		return false;
+	}
+
+	std::vector<uint32_t> code(size / sizeof(uint32_t));
+	file.seekg(0);
+	file.read((char*)code.data(), size);
+
+	if (file.good() == false || CreateShaderModule(device, code.data(), size, module) == false)
+	{
+		Log(LogSeverity_Warning, "Couldn't create a shader module from %s", outputPath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+void ShaderReloader::DestroyReload(Reload& reload)
+{
+	for (size_t i = 0; i < reload.pipelines.size(); ++i)
+	{
+		vkDestroyPipeline(device, reload.pipelines[i], NULL);
+	}
+
+	for (size_t i = 0; i < reload.modules.size(); ++i)
+	{
+		vkDestroyShaderModule(device, reload.modules[i], NULL);
+	}
+
+	reload.pipelines.clear();
+	reload.modules.clear();
+}
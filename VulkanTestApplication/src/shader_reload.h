@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vulkan_helpers.h"
+
+// Rebuilds pipelines when their GLSL sources change on disk, without stalling the frame loop.
+//
+// A watcher thread waits for change notifications on the source directory (a change notification
+// handle on Windows, inotify elsewhere). Once a watched file's modification time has moved and the
+// directory has been quiet for DebounceMilliseconds, every watched shader is compiled with
+// glslangValidator to <source>.spv beside it, turned into shader modules and handed to the pipeline
+// builder, all on the watcher thread. The render thread collects finished results with TakeReload at
+// a frame boundary and retires the objects they replace. Compile or build failures are logged and the
+// previous pipelines stay in use.
+class ShaderReloader
+{
+public:
+	// Creates pipelines from freshly compiled modules, given in the order the shaders were added.
+	// Runs on the watcher thread while the render thread records frames, so it must only create
+	// objects. On failure it destroys whatever pipelines it made.
+	typedef std::function<bool(const std::vector<VkShaderModule>& modules, std::vector<VkPipeline>* pipelines)> PipelineBuilder;
+
+	struct Reload
+	{
+		std::vector<VkShaderModule> modules;
+		std::vector<VkPipeline> pipelines;
+	};
+
+	// Editors often save in several writes, changes are compiled once the directory settles
+	static const uint32_t DebounceMilliseconds = 150;
+
+	// How often the watcher checks whether it has been stopped
+	static const uint32_t PollMilliseconds = 100;
+
+	ShaderReloader();
+	~ShaderReloader();
+
+	// fileName is relative to the source directory, call before Start
+	void AddShader(const char* fileName);
+
+	bool Start(VkDevice device, const char* sourceDirectory, const PipelineBuilder& builder);
+	void Stop();
+
+	// Returns true and fills reload with the newest successful rebuild not yet taken. The caller owns
+	// the objects from then on and must retire the ones they replace.
+	bool TakeReload(Reload* reload);
+
+	uint32_t GetReloadCount() const;
+	uint32_t GetFailureCount() const;
+
+private:
+	struct WatchedShader
+	{
+		std::string fileName;
+		uint64_t modifiedTime;
+	};
+
+	void WatcherThread();
+	bool CheckModified();
+	void Rebuild();
+	bool CompileShader(const std::string& sourcePath, VkShaderModule* module);
+	void DestroyReload(Reload& reload);
+
+	VkDevice device;
+	std::string sourceDirectory;
+	PipelineBuilder builder;
+	std::vector<WatchedShader> shaders;
+
+	std::thread watcherThread;
+	mutable std::mutex mutex;
+	Reload pendingReload;
+	bool reloadReady;
+	bool stopping;
+	uint32_t reloadCount;
+	uint32_t failureCount;
+};
@@ -0,0 +1,463 @@
+#include "submission_scheduler.h"
+
+#include <cstring>
+
+#include "logger.h"
+
+SubmissionScheduler::SubmissionScheduler()
+	: device(VK_NULL_HANDLE)
+	, timelineSemaphores(false)
+	, currentFrame(0)
+{
+	memset(&frameStats, 0, sizeof(frameStats));
+	memset(&totalStats, 0, sizeof(totalStats));
+}
+
+SubmissionScheduler::~SubmissionScheduler()
+{
+}
+
+bool SubmissionScheduler::Create(VkDevice device, bool timelineSemaphores)
+{
+	this->device = device;
+	this->timelineSemaphores = false;
+
+#ifdef VK_KHR_timeline_semaphore
+	this->timelineSemaphores = timelineSemaphores;
+#endif
+
+	currentFrame = 0;
+	memset(&frameStats, 0, sizeof(frameStats));
+	memset(&totalStats, 0, sizeof(totalStats));
+	return true;
+}
+
+void SubmissionScheduler::Destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < queues.size(); ++i)
+	{
+		if (queues[i].timeline != VK_NULL_HANDLE)
+		{
+			vkDestroySemaphore(device, queues[i].timeline, NULL);
+		}
+	}
+
+	for (size_t i = 0; i < freeSemaphores.size(); ++i)
+	{
+		vkDestroySemaphore(device, freeSemaphores[i], NULL);
+	}
+
+	for (size_t i = 0; i < usedSemaphores.size(); ++i)
+	{
+		vkDestroySemaphore(device, usedSemaphores[i].semaphore, NULL);
+	}
+
+	queues.clear();
+	queueOrder.clear();
+	dependencies.clear();
+	freeSemaphores.clear();
+	usedSemaphores.clear();
+	device = VK_NULL_HANDLE;
+}
+
+void SubmissionScheduler::BeginFrame(uint64_t frameIndex, uint64_t completedFrameIndex)
+{
+	currentFrame = frameIndex;
+	memset(&frameStats, 0, sizeof(frameStats));
+
+	for (size_t i = 0; i < usedSemaphores.size();)
+	{
+		if (usedSemaphores[i].frameIndex <= completedFrameIndex)
+		{
+			freeSemaphores.push_back(usedSemaphores[i].semaphore);
+			usedSemaphores[i] = usedSemaphores.back();
+			usedSemaphores.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+void SubmissionScheduler::AddWait(VkQueue queue, VkSemaphore semaphore, VkPipelineStageFlags stageMask)
+{
+	Batch& batch = GetBatchForWait(GetQueueWork(queue));
+	batch.waitSemaphores.push_back(semaphore);
+	batch.waitValues.push_back(0);
+	batch.waitStages.push_back(stageMask);
+}
+
+void SubmissionScheduler::AddCommandBuffer(VkQueue queue, VkCommandBuffer commandBuffer)
+{
+	Batch& batch = GetBatchForCommands(GetQueueWork(queue));
+	batch.commandBuffers.push_back(commandBuffer);
+}
+
+void SubmissionScheduler::AddSignal(VkQueue queue, VkSemaphore semaphore)
+{
+	Batch& batch = GetBatchForSignal(GetQueueWork(queue));
+	batch.signalSemaphores.push_back(semaphore);
+	batch.signalValues.push_back(0);
+}
+
+bool SubmissionScheduler::SignalQueue(VkQueue queue, QueueSyncPoint* syncPoint)
+{
+	uint32_t work = GetQueueWork(queue);
+	syncPoint->queue = queue;
+
+#ifdef VK_KHR_timeline_semaphore
+	if (timelineSemaphores)
+	{
+		if (queues[work].timeline == VK_NULL_HANDLE)
+		{
+			VkSemaphoreTypeCreateInfoKHR semaphoreTypeCreateInfo;
+			semaphoreTypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+			semaphoreTypeCreateInfo.pNext = NULL;
+			semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+			semaphoreTypeCreateInfo.initialValue = 0;
+
+			VkSemaphoreCreateInfo semaphoreCreateInfo;
+			semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+			semaphoreCreateInfo.flags = 0;
+
+			if (vkCreateSemaphore(device, &semaphoreCreateInfo, NULL, &queues[work].timeline) != VK_SUCCESS)
+			{
+				queues[work].timeline = VK_NULL_HANDLE;
+				return false;
+			}
+		}
+
+		syncPoint->semaphore = queues[work].timeline;
+		syncPoint->value = ++queues[work].timelineValue;
+
+		Batch& batch = GetBatchForSignal(work);
+		batch.signalSemaphores.push_back(syncPoint->semaphore);
+		batch.signalValues.push_back(syncPoint->value);
+		return true;
+	}
+#endif
+
+	if (AcquireBinarySemaphore(&syncPoint->semaphore) == false)
+	{
+		return false;
+	}
+
+	syncPoint->value = 0;
+
+	PooledSemaphore used = { syncPoint->semaphore, currentFrame };
+	usedSemaphores.push_back(used);
+
+	Batch& batch = GetBatchForSignal(work);
+	batch.signalSemaphores.push_back(syncPoint->semaphore);
+	batch.signalValues.push_back(0);
+	return true;
+}
+
+void SubmissionScheduler::WaitForQueue(VkQueue queue, const QueueSyncPoint& syncPoint, VkPipelineStageFlags stageMask)
+{
+	uint32_t work = GetQueueWork(queue);
+
+	Batch& batch = GetBatchForWait(work);
+	batch.waitSemaphores.push_back(syncPoint.semaphore);
+	batch.waitValues.push_back(syncPoint.value);
+	batch.waitStages.push_back(stageMask);
+
+	// Binary semaphores need their signal submitted first, which already happened if the
+	// signalling queue was flushed since
+	if (timelineSemaphores == false && syncPoint.queue != queue)
+	{
+		uint32_t signalling = FindQueueWork(syncPoint.queue);
+
+		if (signalling < queues.size() && queues[signalling].queued)
+		{
+			QueueDependency dependency = { work, signalling };
+			dependencies.push_back(dependency);
+		}
+	}
+}
+
+bool SubmissionScheduler::Flush(VkQueue fenceQueue, VkFence fence)
+{
+	if (dependencies.empty() == false)
+	{
+		OrderQueues();
+	}
+
+	bool success = true;
+	bool fenceSubmitted = false;
+
+	for (size_t i = 0; i < queueOrder.size(); ++i)
+	{
+		QueueWork& work = queues[queueOrder[i]];
+		VkFence queueFence = VK_NULL_HANDLE;
+
+		if (work.queue == fenceQueue)
+		{
+			queueFence = fence;
+			fenceSubmitted = true;
+		}
+
+		if (SubmitQueue(work, queueFence) == false)
+		{
+			success = false;
+		}
+
+		work.batchCount = 0;
+		work.queued = false;
+	}
+
+	queueOrder.clear();
+	dependencies.clear();
+
+	if (fenceSubmitted == false && fence != VK_NULL_HANDLE)
+	{
+		if (vkQueueSubmit(fenceQueue, 0, NULL, fence) != VK_SUCCESS)
+		{
+			success = false;
+		}
+
+		++frameStats.submitCalls;
+		++totalStats.submitCalls;
+	}
+
+	return success;
+}
+
+bool SubmissionScheduler::UsesTimelineSemaphores() const
+{
+	return timelineSemaphores;
+}
+
+SubmissionStats SubmissionScheduler::GetFrameStats() const
+{
+	return frameStats;
+}
+
+SubmissionStats SubmissionScheduler::GetTotalStats() const
+{
+	return totalStats;
+}
+
+uint32_t SubmissionScheduler::FindQueueWork(VkQueue queue) const
+{
+	uint32_t index = 0;
+
+	while (index < queues.size() && queues[index].queue != queue)
+	{
+		++index;
+	}
+
+	return index;
+}
+
+uint32_t SubmissionScheduler::GetQueueWork(VkQueue queue)
+{
+	uint32_t index = FindQueueWork(queue);
+
+	if (index == queues.size())
+	{
+		QueueWork work;
+		work.queue = queue;
+		work.batchCount = 0;
+		work.queued = false;
+		work.timeline = VK_NULL_HANDLE;
+		work.timelineValue = 0;
+		queues.push_back(work);
+	}
+
+	if (queues[index].queued == false)
+	{
+		queues[index].queued = true;
+		queueOrder.push_back(index);
+	}
+
+	return index;
+}
+
+SubmissionScheduler::Batch& SubmissionScheduler::GetBatchForWait(uint32_t work)
+{
+	QueueWork& queueWork = queues[work];
+
+	// Waits happen before a batch's commands, so they can't join one that already has any
+	if (queueWork.batchCount == 0)
+	{
+		return AddBatch(work);
+	}
+
+	Batch& last = queueWork.batches[queueWork.batchCount - 1];
+
+	if (last.commandBuffers.empty() == false || last.signalSemaphores.empty() == false)
+	{
+		return AddBatch(work);
+	}
+
+	return last;
+}
+
+SubmissionScheduler::Batch& SubmissionScheduler::GetBatchForCommands(uint32_t work)
+{
+	QueueWork& queueWork = queues[work];
+
+	// Signals happen after a batch's commands, later commands need a batch of their own
+	if (queueWork.batchCount == 0 || queueWork.batches[queueWork.batchCount - 1].signalSemaphores.empty() == false)
+	{
+		return AddBatch(work);
+	}
+
+	return queueWork.batches[queueWork.batchCount - 1];
+}
+
+SubmissionScheduler::Batch& SubmissionScheduler::GetBatchForSignal(uint32_t work)
+{
+	QueueWork& queueWork = queues[work];
+
+	if (queueWork.batchCount == 0)
+	{
+		return AddBatch(work);
+	}
+
+	return queueWork.batches[queueWork.batchCount - 1];
+}
+
+SubmissionScheduler::Batch& SubmissionScheduler::AddBatch(uint32_t work)
+{
+	QueueWork& queueWork = queues[work];
+
+	if (queueWork.batchCount == queueWork.batches.size())
+	{
+		queueWork.batches.push_back(Batch());
+	}
+
+	Batch& batch = queueWork.batches[queueWork.batchCount++];
+	batch.waitSemaphores.clear();
+	batch.waitValues.clear();
+	batch.waitStages.clear();
+	batch.commandBuffers.clear();
+	batch.signalSemaphores.clear();
+	batch.signalValues.clear();
+	return batch;
+}
+
+bool SubmissionScheduler::AcquireBinarySemaphore(VkSemaphore* semaphore)
+{
+	if (freeSemaphores.empty() == false)
+	{
+		*semaphore = freeSemaphores.back();
+		freeSemaphores.pop_back();
+		return true;
+	}
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo;
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreCreateInfo.pNext = NULL;
+	semaphoreCreateInfo.flags = 0;
+	return vkCreateSemaphore(device, &semaphoreCreateInfo, NULL, semaphore) == VK_SUCCESS;
+}
+
+void SubmissionScheduler::OrderQueues()
+{
+	// Stable topological sort, a queue goes first once every queue it waits for has gone
+	std::vector<uint32_t> remaining = queueOrder;
+	queueOrder.clear();
+
+	while (remaining.empty() == false)
+	{
+		size_t next = remaining.size();
+
+		for (size_t i = 0; i < remaining.size() && next == remaining.size(); ++i)
+		{
+			bool ready = true;
+
+			for (size_t d = 0; d < dependencies.size() && ready; ++d)
+			{
+				if (dependencies[d].waiting != remaining[i])
+				{
+					continue;
+				}
+
+				for (size_t j = 0; j < remaining.size(); ++j)
+				{
+					if (remaining[j] == dependencies[d].signalling)
+					{
+						ready = false;
+						break;
+					}
+				}
+			}
+
+			if (ready)
+			{
+				next = i;
+			}
+		}
+
+		if (next == remaining.size())
+		{
+			Log(LogSeverity_Error, "Queue dependencies form a cycle, submitting in the order queues were used");
+			queueOrder.insert(queueOrder.end(), remaining.begin(), remaining.end());
+			break;
+		}
+
+		queueOrder.push_back(remaining[next]);
+		remaining.erase(remaining.begin() + next);
+	}
+}
+
+bool SubmissionScheduler::SubmitQueue(QueueWork& work, VkFence fence)
+{
+	submitInfos.resize(work.batchCount);
+
+#ifdef VK_KHR_timeline_semaphore
+	timelineSubmitInfos.resize(work.batchCount);
+#endif
+
+	for (uint32_t i = 0; i < work.batchCount; ++i)
+	{
+		const Batch& batch = work.batches[i];
+
+		VkSubmitInfo& submitInfo = submitInfos[i];
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = NULL;
+		submitInfo.waitSemaphoreCount = (uint32_t)batch.waitSemaphores.size();
+		submitInfo.pWaitSemaphores = batch.waitSemaphores.data();
+		submitInfo.pWaitDstStageMask = batch.waitStages.data();
+		submitInfo.commandBufferCount = (uint32_t)batch.commandBuffers.size();
+		submitInfo.pCommandBuffers = batch.commandBuffers.data();
+		submitInfo.signalSemaphoreCount = (uint32_t)batch.signalSemaphores.size();
+		submitInfo.pSignalSemaphores = batch.signalSemaphores.data();
+
+#ifdef VK_KHR_timeline_semaphore
+		// Values for binary semaphores in the batch are ignored
+		if (timelineSemaphores)
+		{
+			VkTimelineSemaphoreSubmitInfoKHR& timelineSubmitInfo = timelineSubmitInfos[i];
+			timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+			timelineSubmitInfo.pNext = NULL;
+			timelineSubmitInfo.waitSemaphoreValueCount = (uint32_t)batch.waitValues.size();
+			timelineSubmitInfo.pWaitSemaphoreValues = batch.waitValues.data();
+			timelineSubmitInfo.signalSemaphoreValueCount = (uint32_t)batch.signalValues.size();
+			timelineSubmitInfo.pSignalSemaphoreValues = batch.signalValues.data();
+			submitInfo.pNext = &timelineSubmitInfo;
+		}
+#endif
+
+		frameStats.commandBuffers += submitInfo.commandBufferCount;
+		totalStats.commandBuffers += submitInfo.commandBufferCount;
+	}
+
+	VkResult result = vkQueueSubmit(work.queue, work.batchCount, submitInfos.data(), fence);
+
+	++frameStats.submitCalls;
+	++totalStats.submitCalls;
+	frameStats.batches += work.batchCount;
+	totalStats.batches += work.batchCount;
+
+	return result == VK_SUCCESS;
+}
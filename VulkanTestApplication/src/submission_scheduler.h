@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "vulkan_helpers.h"
+
+// Point in a queue's work another queue can wait for
+struct QueueSyncPoint
+{
+	VkQueue queue;
+	VkSemaphore semaphore;
+	uint64_t value;		// Timeline value, 0 for a binary semaphore
+};
+
+struct SubmissionStats
+{
+	uint32_t submitCalls;		// vkQueueSubmit calls
+	uint32_t batches;			// VkSubmitInfo structures across those calls
+	uint32_t commandBuffers;
+};
+
+// Collects the command buffers and semaphores subsystems produce during a frame and submits them
+// in as few vkQueueSubmit calls and VkSubmitInfo batches as their ordering allows.
+//
+// Work for a queue keeps the order it was added in. A batch waits before and signals after all of
+// its command buffers, so consecutive command buffers share one and a new batch only starts when
+// a wait follows commands or commands follow a signal. Flush submits every batch for a queue in a
+// single vkQueueSubmit.
+//
+// Dependencies between queues go through SignalQueue and WaitForQueue. With
+// VK_KHR_timeline_semaphore each queue has one timeline semaphore and a sync point is a value on
+// it, so waits may even be submitted before their signal. Without it each sync point takes a
+// binary semaphore from a pool, recycled once its frame has completed, and Flush orders queues so
+// signals are submitted before their waits. Every binary sync point must be waited for once, and
+// such dependencies must not form a cycle within a frame.
+class SubmissionScheduler
+{
+public:
+	SubmissionScheduler();
+	~SubmissionScheduler();
+
+	// timelineSemaphores requires VK_KHR_timeline_semaphore and its feature enabled on the device
+	bool Create(VkDevice device, bool timelineSemaphores);
+
+	// The device must be idle
+	void Destroy();
+
+	// Starts counting stats for frameIndex and recycles semaphores of completed frames
+	void BeginFrame(uint64_t frameIndex, uint64_t completedFrameIndex);
+
+	void AddWait(VkQueue queue, VkSemaphore semaphore, VkPipelineStageFlags stageMask);
+	void AddCommandBuffer(VkQueue queue, VkCommandBuffer commandBuffer);
+	void AddSignal(VkQueue queue, VkSemaphore semaphore);
+
+	// Sync point after everything added to queue so far
+	bool SignalQueue(VkQueue queue, QueueSyncPoint* syncPoint);
+	void WaitForQueue(VkQueue queue, const QueueSyncPoint& syncPoint, VkPipelineStageFlags stageMask);
+
+	// Submits everything added since the last flush. fence, if not VK_NULL_HANDLE, goes with the
+	// submission to fenceQueue, which is made even when that queue has no work.
+	bool Flush(VkQueue fenceQueue, VkFence fence);
+
+	bool UsesTimelineSemaphores() const;
+
+	// Since the last BeginFrame
+	SubmissionStats GetFrameStats() const;
+	SubmissionStats GetTotalStats() const;
+
+private:
+	struct Batch
+	{
+		std::vector<VkSemaphore> waitSemaphores;
+		std::vector<uint64_t> waitValues;
+		std::vector<VkPipelineStageFlags> waitStages;
+		std::vector<VkCommandBuffer> commandBuffers;
+		std::vector<VkSemaphore> signalSemaphores;
+		std::vector<uint64_t> signalValues;
+	};
+
+	// Batches are kept between flushes so their vectors keep their capacity
+	struct QueueWork
+	{
+		VkQueue queue;
+		std::vector<Batch> batches;
+		uint32_t batchCount;
+		bool queued;			// Has work waiting for the next Flush
+		VkSemaphore timeline;	// Created on first use of SignalQueue
+		uint64_t timelineValue;
+	};
+
+	struct QueueDependency
+	{
+		uint32_t waiting;
+		uint32_t signalling;
+	};
+
+	struct PooledSemaphore
+	{
+		VkSemaphore semaphore;
+		uint64_t frameIndex;
+	};
+
+	uint32_t FindQueueWork(VkQueue queue) const;
+	uint32_t GetQueueWork(VkQueue queue);
+	Batch& GetBatchForWait(uint32_t work);
+	Batch& GetBatchForCommands(uint32_t work);
+	Batch& GetBatchForSignal(uint32_t work);
+	Batch& AddBatch(uint32_t work);
+	bool AcquireBinarySemaphore(VkSemaphore* semaphore);
+	void OrderQueues();
+	bool SubmitQueue(QueueWork& work, VkFence fence);
+
+	VkDevice device;
+	bool timelineSemaphores;
+	uint64_t currentFrame;
+
+	std::vector<QueueWork> queues;
+	std::vector<uint32_t> queueOrder;		// Queues with work, in the order they were first used
+	std::vector<QueueDependency> dependencies;
+
+	std::vector<VkSemaphore> freeSemaphores;
+	std::vector<PooledSemaphore> usedSemaphores;
+
+	std::vector<VkSubmitInfo> submitInfos;
+#ifdef VK_KHR_timeline_semaphore
+	std::vector<VkTimelineSemaphoreSubmitInfoKHR> timelineSubmitInfos;
+#endif
+
+	SubmissionStats frameStats;
+	SubmissionStats totalStats;
+};
@@ -0,0 +1,228 @@
+#include "swapchain.h"
+
+Swapchain::Swapchain()
+	: device(VK_NULL_HANDLE)
+	, swapchain(VK_NULL_HANDLE)
+	, currentImage(0)
+{
+	extent.width = 0;
+	extent.height = 0;
+}
+
+Swapchain::~Swapchain()
+{
+	Destroy();
+}
+
+bool Swapchain::Create(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface, VkFormat format, VkColorSpaceKHR colorSpace, VkImageUsageFlags extraUsage, uint32_t frameCount)
+{
+	this->device = device;
+
+	VkSurfaceCapabilitiesKHR surfaceCapabilities;
+
+	if (vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCapabilities) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | extraUsage;
+
+	if ((surfaceCapabilities.supportedUsageFlags & usage) != usage)
+	{
+		return false;
+	}
+
+	extent = surfaceCapabilities.currentExtent;
+
+	VkSwapchainCreateInfoKHR swapchainCreateInfo;
+	swapchainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+	swapchainCreateInfo.pNext = NULL;
+	swapchainCreateInfo.flags = 0;
+	swapchainCreateInfo.surface = surface;
+	swapchainCreateInfo.minImageCount = 2;
+	swapchainCreateInfo.imageFormat = format;
+	swapchainCreateInfo.imageColorSpace = colorSpace;
+	swapchainCreateInfo.imageExtent = extent; 	// Window width / height
+	swapchainCreateInfo.imageArrayLayers = 1;
+	swapchainCreateInfo.imageUsage = usage;
+	swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	swapchainCreateInfo.queueFamilyIndexCount = 0;
+	swapchainCreateInfo.pQueueFamilyIndices = NULL;
+	swapchainCreateInfo.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+	swapchainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	swapchainCreateInfo.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+	swapchainCreateInfo.clipped = true;
+	swapchainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+
+	if (vkCreateSwapchainKHR(device, &swapchainCreateInfo, NULL, &swapchain) != VK_SUCCESS)
+	{
+		swapchain = VK_NULL_HANDLE;
+		return false;
+	}
+
+	uint32_t imageCount;
+
+	if (vkGetSwapchainImagesKHR(device, swapchain, &imageCount, NULL) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	images.resize(imageCount);
+
+	if (vkGetSwapchainImagesKHR(device, swapchain, &imageCount, images.data()) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo;
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreCreateInfo.pNext = NULL;
+	semaphoreCreateInfo.flags = 0;
+
+	acquiredSemaphores.resize(frameCount, VK_NULL_HANDLE);
+
+	for (uint32_t i = 0; i < frameCount; ++i)
+	{
+		if (vkCreateSemaphore(device, &semaphoreCreateInfo, NULL, &acquiredSemaphores[i]) != VK_SUCCESS)
+		{
+			acquiredSemaphores[i] = VK_NULL_HANDLE;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Swapchain::Destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < acquiredSemaphores.size(); ++i)
+	{
+		vkDestroySemaphore(device, acquiredSemaphores[i], NULL);
+	}
+
+	// Images belong to the swapchain
+	vkDestroySwapchainKHR(device, swapchain, NULL);
+
+	acquiredSemaphores.clear();
+	images.clear();
+	swapchain = VK_NULL_HANDLE;
+	currentImage = 0;
+	device = VK_NULL_HANDLE;
+}
+
+bool Swapchain::SupportsFormat(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkFormat format)
+{
+	uint32_t formatCount;
+
+	if (vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &formatCount, NULL) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	std::vector<VkSurfaceFormatKHR> surfaceFormats(formatCount);
+
+	if (vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &formatCount, surfaceFormats.data()) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	// A single undefined format means any format may be used
+	if (formatCount == 1 && surfaceFormats[0].format == VK_FORMAT_UNDEFINED)
+	{
+		return true;
+	}
+
+	for (uint32_t i = 0; i < formatCount; ++i)
+	{
+		if (surfaceFormats[i].format == format)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool Swapchain::Acquire(uint32_t frame)
+{
+	return vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, acquiredSemaphores[frame], VK_NULL_HANDLE, &currentImage) == VK_SUCCESS;
+}
+
+VkSwapchainKHR Swapchain::GetHandle() const
+{
+	return swapchain;
+}
+
+VkExtent2D Swapchain::GetExtent() const
+{
+	return extent;
+}
+
+const std::vector<VkImage>& Swapchain::GetImages() const
+{
+	return images;
+}
+
+VkImage Swapchain::GetCurrentImage() const
+{
+	return images[currentImage];
+}
+
+uint32_t Swapchain::GetCurrentImageIndex() const
+{
+	return currentImage;
+}
+
+VkSemaphore Swapchain::GetAcquiredSemaphore(uint32_t frame) const
+{
+	return acquiredSemaphores[frame];
+}
+
+bool Swapchain::Present(VkQueue queue, Swapchain* const* swapchains, uint32_t count, VkSemaphore waitSemaphore)
+{
+	if (count == 0 || count > MaxSwapchains)
+	{
+		return false;
+	}
+
+	VkSwapchainKHR handles[MaxSwapchains];
+	uint32_t imageIndices[MaxSwapchains];
+	VkResult results[MaxSwapchains];
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		handles[i] = swapchains[i]->swapchain;
+		imageIndices[i] = swapchains[i]->currentImage;
+		results[i] = VK_SUCCESS;
+	}
+
+	VkPresentInfoKHR presentInfo;
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.pNext = NULL;
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = &waitSemaphore;
+	presentInfo.swapchainCount = count;
+	presentInfo.pSwapchains = handles;
+	presentInfo.pImageIndices = imageIndices;
+	presentInfo.pResults = results;
+
+	if (vkQueuePresentKHR(queue, &presentInfo) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (results[i] != VK_SUCCESS)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+#include "vulkan_helpers.h"
+
+// A window's swapchain and the semaphores its images are acquired with.
+//
+// Each frame in flight acquires with its own semaphore, so acquiring for the next frame never
+// reuses one an earlier frame's submission may still be waiting on. Several swapchains on one
+// device are presented together with Present, in a single vkQueuePresentKHR.
+class Swapchain
+{
+public:
+	// Windows presented by one Present call
+	static const uint32_t MaxSwapchains = 4;
+
+	Swapchain();
+	~Swapchain();
+
+	// Sized to the surface's current extent. Images are colour attachments and transfer destinations
+	// plus any extra usage, which fails the creation if the surface doesn't support it.
+	bool Create(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface, VkFormat format, VkColorSpaceKHR colorSpace, VkImageUsageFlags extraUsage, uint32_t frameCount);
+
+	// The device must be idle
+	void Destroy();
+
+	// Whether surface can present images in format
+	static bool SupportsFormat(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkFormat format);
+
+	// Acquires the next image, GetAcquiredSemaphore(frame) is signalled once it can be written
+	bool Acquire(uint32_t frame);
+
+	VkSwapchainKHR GetHandle() const;
+	VkExtent2D GetExtent() const;
+	const std::vector<VkImage>& GetImages() const;
+
+	// The image the last Acquire returned
+	VkImage GetCurrentImage() const;
+	uint32_t GetCurrentImageIndex() const;
+
+	VkSemaphore GetAcquiredSemaphore(uint32_t frame) const;
+
+	// Presents the current image of each swapchain once waitSemaphore is signalled. Fails if any of
+	// them failed to present.
+	static bool Present(VkQueue queue, Swapchain* const* swapchains, uint32_t count, VkSemaphore waitSemaphore);
+
+private:
+	VkDevice device;
+	VkSwapchainKHR swapchain;
+	VkExtent2D extent;
+	std::vector<VkImage> images;
+	std::vector<VkSemaphore> acquiredSemaphores;
+	uint32_t currentImage;
+};
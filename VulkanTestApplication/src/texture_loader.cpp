@@ -0,0 +1,649 @@
+#include "texture_loader.h"
+#include "mip_generation.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+static uint32_t ReadU32(const unsigned char* data)
+{
+	uint32_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static uint64_t ReadU64(const unsigned char* data)
+{
+	uint64_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static uint32_t MakeFourCC(char a, char b, char c, char d)
+{
+	return (uint32_t)(unsigned char)a | ((uint32_t)(unsigned char)b << 8) | ((uint32_t)(unsigned char)c << 16) | ((uint32_t)(unsigned char)d << 24);
+}
+
+bool GetFormatBlockInfo(VkFormat format, uint32_t* blockWidth, uint32_t* blockHeight, uint32_t* blockSize)
+{
+	*blockWidth = 4;
+	*blockHeight = 4;
+
+	switch (format)
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+		*blockWidth = 1;
+		*blockHeight = 1;
+		*blockSize = 4;
+		return true;
+
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC4_SNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+	case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+	case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+		*blockSize = 8;
+		return true;
+
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC5_SNORM_BLOCK:
+	case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+	case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+	case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+	case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+		*blockSize = 16;
+		return true;
+
+	default:
+		break;
+	}
+
+	// ASTC is always 16 bytes per block, UNORM and SRGB variants alternate from 4x4
+	static const uint32_t astcBlockSizes[][2] = {
+		{ 4, 4 }, { 5, 4 }, { 5, 5 }, { 6, 5 }, { 6, 6 }, { 8, 5 }, { 8, 6 },
+		{ 8, 8 }, { 10, 5 }, { 10, 6 }, { 10, 8 }, { 10, 10 }, { 12, 10 }, { 12, 12 }
+	};
+
+	if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK)
+	{
+		uint32_t index = (uint32_t)(format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) / 2;
+		*blockWidth = astcBlockSizes[index][0];
+		*blockHeight = astcBlockSizes[index][1];
+		*blockSize = 16;
+		return true;
+	}
+
+	return false;
+}
+
+size_t GetMipLevelSize(VkFormat format, uint32_t width, uint32_t height)
+{
+	uint32_t blockWidth;
+	uint32_t blockHeight;
+	uint32_t blockSize;
+
+	if (GetFormatBlockInfo(format, &blockWidth, &blockHeight, &blockSize) == false)
+	{
+		return 0;
+	}
+
+	size_t blocksX = (width + blockWidth - 1) / blockWidth;
+	size_t blocksY = (height + blockHeight - 1) / blockHeight;
+
+	return blocksX * blocksY * blockSize;
+}
+
+static VkFormat FormatFromDXGI(uint32_t dxgiFormat)
+{
+	switch (dxgiFormat)
+	{
+	case 28: return VK_FORMAT_R8G8B8A8_UNORM;
+	case 29: return VK_FORMAT_R8G8B8A8_SRGB;
+	case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+	case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+	case 74: return VK_FORMAT_BC2_UNORM_BLOCK;
+	case 75: return VK_FORMAT_BC2_SRGB_BLOCK;
+	case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+	case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+	case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+	case 81: return VK_FORMAT_BC4_SNORM_BLOCK;
+	case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+	case 84: return VK_FORMAT_BC5_SNORM_BLOCK;
+	case 87: return VK_FORMAT_B8G8R8A8_UNORM;
+	case 91: return VK_FORMAT_B8G8R8A8_SRGB;
+	case 95: return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+	case 96: return VK_FORMAT_BC6H_SFLOAT_BLOCK;
+	case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+	case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+	default: return VK_FORMAT_UNDEFINED;
+	}
+}
+
+// Rejects empty images and more levels than a full chain has, before anything is sized from them
+static bool CheckDimensions(const char* container, uint32_t width, uint32_t height, uint32_t levelCount)
+{
+	if (width == 0 || height == 0)
+	{
+		std::cout << container << ": empty image" << std::endl;
+		return false;
+	}
+
+	if (levelCount == 0 || levelCount > GetMipLevelCount(width, height))
+	{
+		std::cout << container << ": bad level count " << levelCount << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+static bool LoadDDS(const unsigned char* data, size_t size, TextureData* texture)
+{
+	// Magic, DDS_HEADER
+	const size_t headerSize = 4 + 124;
+
+	if (size < headerSize)
+	{
+		std::cout << "DDS: truncated header" << std::endl;
+		return false;
+	}
+
+	const unsigned char* header = data + 4;
+	uint32_t height = ReadU32(header + 8);
+	uint32_t width = ReadU32(header + 12);
+	uint32_t mipMapCount = ReadU32(header + 24);
+
+	const unsigned char* pixelFormat = header + 72;
+	uint32_t pixelFormatFlags = ReadU32(pixelFormat + 4);
+	uint32_t fourCC = ReadU32(pixelFormat + 8);
+	uint32_t rgbBitCount = ReadU32(pixelFormat + 12);
+	uint32_t redMask = ReadU32(pixelFormat + 16);
+	uint32_t caps2 = ReadU32(header + 108);
+
+	const uint32_t DDPF_FOURCC = 0x4;
+	const uint32_t DDPF_RGB = 0x40;
+	const uint32_t DDSCAPS2_CUBEMAP = 0x200;
+	const uint32_t DDSCAPS2_VOLUME = 0x200000;
+
+	if (caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME))
+	{
+		std::cout << "DDS: only 2D textures are supported" << std::endl;
+		return false;
+	}
+
+	size_t dataOffset = headerSize;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+
+	if (pixelFormatFlags & DDPF_FOURCC)
+	{
+		if (fourCC == MakeFourCC('D', 'X', '1', '0'))
+		{
+			// DDS_HEADER_DXT10
+			if (size < headerSize + 20)
+			{
+				std::cout << "DDS: truncated DX10 header" << std::endl;
+				return false;
+			}
+
+			const unsigned char* dx10Header = data + headerSize;
+			uint32_t resourceDimension = ReadU32(dx10Header + 4);
+			uint32_t arraySize = ReadU32(dx10Header + 12);
+
+			// D3D10_RESOURCE_DIMENSION_TEXTURE2D
+			if (resourceDimension != 3 || arraySize > 1)
+			{
+				std::cout << "DDS: only single 2D textures are supported" << std::endl;
+				return false;
+			}
+
+			format = FormatFromDXGI(ReadU32(dx10Header));
+			dataOffset += 20;
+		}
+		else if (fourCC == MakeFourCC('D', 'X', 'T', '1'))
+		{
+			format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		}
+		else if (fourCC == MakeFourCC('D', 'X', 'T', '2') || fourCC == MakeFourCC('D', 'X', 'T', '3'))
+		{
+			format = VK_FORMAT_BC2_UNORM_BLOCK;
+		}
+		else if (fourCC == MakeFourCC('D', 'X', 'T', '4') || fourCC == MakeFourCC('D', 'X', 'T', '5'))
+		{
+			format = VK_FORMAT_BC3_UNORM_BLOCK;
+		}
+		else if (fourCC == MakeFourCC('A', 'T', 'I', '1') || fourCC == MakeFourCC('B', 'C', '4', 'U'))
+		{
+			format = VK_FORMAT_BC4_UNORM_BLOCK;
+		}
+		else if (fourCC == MakeFourCC('B', 'C', '4', 'S'))
+		{
+			format = VK_FORMAT_BC4_SNORM_BLOCK;
+		}
+		else if (fourCC == MakeFourCC('A', 'T', 'I', '2') || fourCC == MakeFourCC('B', 'C', '5', 'U'))
+		{
+			format = VK_FORMAT_BC5_UNORM_BLOCK;
+		}
+		else if (fourCC == MakeFourCC('B', 'C', '5', 'S'))
+		{
+			format = VK_FORMAT_BC5_SNORM_BLOCK;
+		}
+	}
+	else if ((pixelFormatFlags & DDPF_RGB) && rgbBitCount == 32)
+	{
+		format = redMask == 0x000000ff ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_B8G8R8A8_UNORM;
+	}
+
+	if (format == VK_FORMAT_UNDEFINED)
+	{
+		std::cout << "DDS: unsupported pixel format" << std::endl;
+		return false;
+	}
+
+	// A mip count of zero is written by tools that only store the base level
+	uint32_t levelCount = mipMapCount > 0 ? mipMapCount : 1;
+
+	if (CheckDimensions("DDS", width, height, levelCount) == false)
+	{
+		return false;
+	}
+
+	texture->format = format;
+	texture->width = width;
+	texture->height = height;
+	texture->mipLevels = levelCount;
+	texture->levels.resize(levelCount);
+
+	// Levels are stored consecutively, largest first
+	size_t offset = dataOffset;
+
+	for (uint32_t level = 0; level < texture->mipLevels; ++level)
+	{
+		size_t levelSize = GetMipLevelSize(format, GetMipDimension(width, level), GetMipDimension(height, level));
+
+		if (offset > size || levelSize > size - offset)
+		{
+			std::cout << "DDS: truncated level " << level << std::endl;
+			return false;
+		}
+
+		texture->levels[level].data = data + offset;
+		texture->levels[level].dataSize = levelSize;
+		offset += levelSize;
+	}
+
+	return true;
+}
+
+static bool LoadKTX2(const unsigned char* data, size_t size, TextureData* texture)
+{
+	// Identifier, header, index
+	const size_t headerSize = 12 + 36 + 32;
+
+	if (size < headerSize)
+	{
+		std::cout << "KTX2: truncated header" << std::endl;
+		return false;
+	}
+
+	const unsigned char* header = data + 12;
+	VkFormat format = (VkFormat)ReadU32(header);
+	uint32_t width = ReadU32(header + 8);
+	uint32_t height = ReadU32(header + 12);
+	uint32_t depth = ReadU32(header + 16);
+	uint32_t layerCount = ReadU32(header + 20);
+	uint32_t faceCount = ReadU32(header + 24);
+	uint32_t levelCount = ReadU32(header + 28);
+	uint32_t supercompressionScheme = ReadU32(header + 32);
+
+	if (depth > 0 || layerCount > 1 || faceCount != 1)
+	{
+		std::cout << "KTX2: only single 2D textures are supported" << std::endl;
+		return false;
+	}
+
+	if (supercompressionScheme != 0)
+	{
+		std::cout << "KTX2: supercompressed textures are not supported" << std::endl;
+		return false;
+	}
+
+	uint32_t blockWidth;
+	uint32_t blockHeight;
+	uint32_t blockSize;
+
+	if (format == VK_FORMAT_UNDEFINED || GetFormatBlockInfo(format, &blockWidth, &blockHeight, &blockSize) == false)
+	{
+		std::cout << "KTX2: unsupported format " << format << std::endl;
+		return false;
+	}
+
+	// A level count of zero asks the loader to generate mips, only the base level is stored
+	uint32_t storedLevels = levelCount > 0 ? levelCount : 1;
+
+	if (CheckDimensions("KTX2", width, height, storedLevels) == false)
+	{
+		return false;
+	}
+
+	if (size < headerSize + (size_t)storedLevels * 24)
+	{
+		std::cout << "KTX2: truncated level index" << std::endl;
+		return false;
+	}
+
+	texture->format = format;
+	texture->width = width;
+	texture->height = height;
+	texture->mipLevels = storedLevels;
+	texture->levels.resize(storedLevels);
+
+	const unsigned char* levelIndex = data + headerSize;
+
+	for (uint32_t level = 0; level < storedLevels; ++level)
+	{
+		uint64_t byteOffset = ReadU64(levelIndex + level * 24);
+		uint64_t byteLength = ReadU64(levelIndex + level * 24 + 8);
+
+		if (byteOffset > size || byteLength > size - byteOffset || byteLength < GetMipLevelSize(format, GetMipDimension(width, level), GetMipDimension(height, level)))
+		{
+			std::cout << "KTX2: bad level " << level << std::endl;
+			return false;
+		}
+
+		texture->levels[level].data = data + byteOffset;
+		texture->levels[level].dataSize = (size_t)byteLength;
+	}
+
+	return true;
+}
+
+bool LoadTextureFromMemory(const void* fileData, size_t fileSize, TextureData* texture)
+{
+	static const unsigned char ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	const unsigned char* data = (const unsigned char*)fileData;
+
+	if (fileSize >= sizeof(ktx2Identifier) && memcmp(data, ktx2Identifier, sizeof(ktx2Identifier)) == 0)
+	{
+		return LoadKTX2(data, fileSize, texture);
+	}
+
+	if (fileSize >= 4 && ReadU32(data) == MakeFourCC('D', 'D', 'S', ' '))
+	{
+		return LoadDDS(data, fileSize, texture);
+	}
+
+	std::cout << "Unrecognised texture container" << std::endl;
+	return false;
+}
+
+bool LoadTextureFile(const char* path, TextureData* texture)
+{
+	std::ifstream file(path, std::ios::binary);
+
+	if (file.is_open() == false)
+	{
+		std::cout << "Couldn't read " << path << std::endl;
+		return false;
+	}
+
+	texture->storage.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	return LoadTextureFromMemory(texture->storage.data(), texture->storage.size(), texture);
+}
+
+bool IsTextureFormatSupported(VkPhysicalDevice physicalDevice, VkFormat format)
+{
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+
+	return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
+// Expands an RGB565 endpoint to 8 bits per channel
+static void DecodeRGB565(uint16_t color, unsigned char* rgb)
+{
+	uint32_t r = (color >> 11) & 0x1f;
+	uint32_t g = (color >> 5) & 0x3f;
+	uint32_t b = color & 0x1f;
+
+	rgb[0] = (unsigned char)((r << 3) | (r >> 2));
+	rgb[1] = (unsigned char)((g << 2) | (g >> 4));
+	rgb[2] = (unsigned char)((b << 3) | (b >> 2));
+}
+
+// BC1 colour block into the rgb (and for BC1 alpha) channels of a 4x4 RGBA block
+static void DecodeColorBlock(const unsigned char* block, bool allowPunchThrough, unsigned char* rgba)
+{
+	uint16_t color0 = (uint16_t)(block[0] | (block[1] << 8));
+	uint16_t color1 = (uint16_t)(block[2] | (block[3] << 8));
+	uint32_t indices = ReadU32(block + 4);
+
+	unsigned char palette[4][4];
+	DecodeRGB565(color0, palette[0]);
+	DecodeRGB565(color1, palette[1]);
+	palette[0][3] = 255;
+	palette[1][3] = 255;
+
+	if (color0 > color1 || allowPunchThrough == false)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (unsigned char)((2 * palette[0][c] + palette[1][c] + 1) / 3);
+			palette[3][c] = (unsigned char)((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+		}
+
+		palette[2][3] = 255;
+		palette[3][3] = 255;
+	}
+	else
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (unsigned char)((palette[0][c] + palette[1][c]) / 2);
+			palette[3][c] = 0;
+		}
+
+		palette[2][3] = 255;
+		palette[3][3] = 0;
+	}
+
+	for (int i = 0; i < 16; ++i)
+	{
+		memcpy(rgba + i * 4, palette[(indices >> (i * 2)) & 3], 4);
+	}
+}
+
+// BC3 alpha / BC4 block into one channel of a 4x4 RGBA block
+static void DecodeAlphaBlock(const unsigned char* block, unsigned char* rgba, int channel)
+{
+	uint32_t alpha[8];
+	alpha[0] = block[0];
+	alpha[1] = block[1];
+
+	if (alpha[0] > alpha[1])
+	{
+		for (int i = 1; i < 7; ++i)
+		{
+			alpha[i + 1] = ((7 - i) * alpha[0] + i * alpha[1] + 3) / 7;
+		}
+	}
+	else
+	{
+		for (int i = 1; i < 5; ++i)
+		{
+			alpha[i + 1] = ((5 - i) * alpha[0] + i * alpha[1] + 2) / 5;
+		}
+
+		alpha[6] = 0;
+		alpha[7] = 255;
+	}
+
+	uint64_t indices = 0;
+
+	for (int i = 0; i < 6; ++i)
+	{
+		indices |= (uint64_t)block[2 + i] << (i * 8);
+	}
+
+	for (int i = 0; i < 16; ++i)
+	{
+		rgba[i * 4 + channel] = (unsigned char)alpha[(indices >> (i * 3)) & 7];
+	}
+}
+
+static bool DecodeBlock(VkFormat format, const unsigned char* block, unsigned char* rgba)
+{
+	switch (format)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		DecodeColorBlock(block, true, rgba);
+		for (int i = 0; i < 16; ++i)
+		{
+			rgba[i * 4 + 3] = 255;
+		}
+		return true;
+
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		DecodeColorBlock(block, true, rgba);
+		return true;
+
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+		DecodeColorBlock(block + 8, false, rgba);
+		for (int i = 0; i < 16; ++i)
+		{
+			uint32_t alpha = (block[i / 2] >> ((i & 1) * 4)) & 0xf;
+			rgba[i * 4 + 3] = (unsigned char)(alpha * 17);
+		}
+		return true;
+
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+		DecodeColorBlock(block + 8, false, rgba);
+		DecodeAlphaBlock(block, rgba, 3);
+		return true;
+
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+		for (int i = 0; i < 16; ++i)
+		{
+			rgba[i * 4 + 1] = 0;
+			rgba[i * 4 + 2] = 0;
+			rgba[i * 4 + 3] = 255;
+		}
+		DecodeAlphaBlock(block, rgba, 0);
+		return true;
+
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+		for (int i = 0; i < 16; ++i)
+		{
+			rgba[i * 4 + 2] = 0;
+			rgba[i * 4 + 3] = 255;
+		}
+		DecodeAlphaBlock(block, rgba, 0);
+		DecodeAlphaBlock(block + 8, rgba, 1);
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+static bool IsSRGBFormat(VkFormat format)
+{
+	return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK
+		|| format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+		|| format == VK_FORMAT_BC2_SRGB_BLOCK
+		|| format == VK_FORMAT_BC3_SRGB_BLOCK;
+}
+
+bool DecompressTexture(const TextureData& source, TextureData* decoded)
+{
+	uint32_t blockWidth;
+	uint32_t blockHeight;
+	uint32_t blockSize;
+
+	if (GetFormatBlockInfo(source.format, &blockWidth, &blockHeight, &blockSize) == false)
+	{
+		return false;
+	}
+
+	decoded->format = IsSRGBFormat(source.format) ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	decoded->width = source.width;
+	decoded->height = source.height;
+	decoded->mipLevels = source.mipLevels;
+
+	std::vector<size_t> offsets(source.mipLevels);
+	size_t totalSize = 0;
+
+	for (uint32_t level = 0; level < source.mipLevels; ++level)
+	{
+		offsets[level] = totalSize;
+		totalSize += (size_t)GetMipDimension(source.width, level) * GetMipDimension(source.height, level) * 4;
+	}
+
+	decoded->storage.resize(totalSize);
+	decoded->levels.resize(source.mipLevels);
+
+	unsigned char blockTexels[16 * 4];
+
+	for (uint32_t level = 0; level < source.mipLevels; ++level)
+	{
+		uint32_t width = GetMipDimension(source.width, level);
+		uint32_t height = GetMipDimension(source.height, level);
+		uint32_t blocksX = (width + 3) / 4;
+		uint32_t blocksY = (height + 3) / 4;
+
+		const unsigned char* block = (const unsigned char*)source.levels[level].data;
+		unsigned char* texels = decoded->storage.data() + offsets[level];
+
+		for (uint32_t by = 0; by < blocksY; ++by)
+		{
+			for (uint32_t bx = 0; bx < blocksX; ++bx)
+			{
+				if (DecodeBlock(source.format, block, blockTexels) == false)
+				{
+					std::cout << "No CPU decoder for texture format " << source.format << std::endl;
+					return false;
+				}
+
+				block += blockSize;
+
+				// Edge blocks of non multiple of 4 levels are cropped
+				for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y)
+				{
+					for (uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x)
+					{
+						memcpy(texels + ((by * 4 + y) * width + bx * 4 + x) * 4, blockTexels + (y * 4 + x) * 4, 4);
+					}
+				}
+			}
+		}
+
+		decoded->levels[level].data = texels;
+		decoded->levels[level].dataSize = (size_t)width * height * 4;
+	}
+
+	return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include "vulkan_helpers.h"
+
+// A 2D texture with a full or partial mip chain in its stored format
+struct TextureData
+{
+	VkFormat format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevels;
+
+	// Backing storage when the texture owns its texels, empty when levels point into caller memory
+	std::vector<unsigned char> storage;
+	std::vector<ImageMipData> levels;
+};
+
+// Parses a KTX2 or DDS container. Levels point directly into fileData, which must outlive texture.
+bool LoadTextureFromMemory(const void* fileData, size_t fileSize, TextureData* texture);
+
+// Reads and parses a KTX2 or DDS file, texture owns the file contents
+bool LoadTextureFile(const char* path, TextureData* texture);
+
+// Block dimensions and size in bytes, blocks are 1x1 for uncompressed formats.
+// Returns false for formats the loader doesn't understand.
+bool GetFormatBlockInfo(VkFormat format, uint32_t* blockWidth, uint32_t* blockHeight, uint32_t* blockSize);
+
+size_t GetMipLevelSize(VkFormat format, uint32_t width, uint32_t height);
+
+// True if the format can be sampled from an optimally tiled image on this device
+bool IsTextureFormatSupported(VkPhysicalDevice physicalDevice, VkFormat format);
+
+// Decodes a block compressed texture to RGBA8 on the CPU, for devices that can't sample it.
+// Supports BC1-BC5 (unsigned), other formats return false.
+bool DecompressTexture(const TextureData& source, TextureData* decoded);
@@ -0,0 +1,667 @@
+#include "texture_streamer.h"
+#include "mip_generation.h"
+
+#include <cstring>
+
+// Loads in flight at once, keeps loaded but not yet uploaded data bounded
+static const size_t MaxPendingLoads = 2;
+
+static VkDeviceSize AlignStagingOffset(VkDeviceSize offset)
+{
+	return (offset + 15) & ~(VkDeviceSize)15;
+}
+
+TextureStreamer::TextureStreamer() :
+	device(VK_NULL_HANDLE),
+	memoryTypes(NULL),
+	deletionQueue(NULL),
+	memoryBudget(0),
+	uploadBudgetPerFrame(0),
+	residentBytes(0),
+	pendingBytes(0),
+	stopping(false)
+{
+
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	Destroy();
+}
+
+bool TextureStreamer::Create(VkDevice device, const VkMemoryType* memoryTypes, DeletionQueue* deletionQueue, uint32_t frameCount, VkDeviceSize memoryBudget, VkDeviceSize uploadBudgetPerFrame)
+{
+	this->device = device;
+	this->memoryTypes = memoryTypes;
+	this->deletionQueue = deletionQueue;
+	this->memoryBudget = memoryBudget;
+	this->uploadBudgetPerFrame = uploadBudgetPerFrame;
+
+	StagingBuffer emptyStaging = { VK_NULL_HANDLE, VK_NULL_HANDLE, 0, NULL };
+	staging.assign(frameCount, emptyStaging);
+
+	for (uint32_t i = 0; i < frameCount; ++i)
+	{
+		if (ReserveStaging(staging[i], uploadBudgetPerFrame) == false)
+		{
+			return false;
+		}
+	}
+
+	stopping = false;
+	streamingThread = std::thread(&TextureStreamer::StreamingThread, this);
+
+	return true;
+}
+
+void TextureStreamer::Destroy()
+{
+	if (streamingThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+
+		requestAvailable.notify_all();
+		streamingThread.join();
+	}
+
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		vkDestroyImageView(device, textures[i].view, NULL);
+		vkDestroyImage(device, textures[i].image, NULL);
+		vkFreeMemory(device, textures[i].memory, NULL);
+		vkDestroyImage(device, textures[i].pendingImage, NULL);
+	}
+
+	for (size_t i = 0; i < staging.size(); ++i)
+	{
+		DestroyStaging(staging[i]);
+	}
+
+	staging.clear();
+	textures.clear();
+	requests.clear();
+	results.clear();
+	deferredResults.clear();
+	residentBytes = 0;
+	pendingBytes = 0;
+	device = VK_NULL_HANDLE;
+}
+
+bool TextureStreamer::AddTexture(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, const MipLoader& loader, uint32_t* texture)
+{
+	if (mipLevels == 0)
+	{
+		return false;
+	}
+
+	StreamedTexture streamed;
+	streamed.width = width;
+	streamed.height = height;
+	streamed.mipLevels = mipLevels;
+	streamed.format = format;
+	streamed.loader = loader;
+	streamed.image = VK_NULL_HANDLE;
+	streamed.memory = VK_NULL_HANDLE;
+	streamed.memorySize = 0;
+	streamed.view = VK_NULL_HANDLE;
+	streamed.residentMip = mipLevels;
+	streamed.pendingImage = VK_NULL_HANDLE;
+	streamed.pendingSize = 0;
+	streamed.loadPending = false;
+	streamed.loadFailed = false;
+	streamed.budgetLimited = false;
+	streamed.tailFirstMip = mipLevels - 1;
+
+	while (streamed.tailFirstMip > 0
+		&& GetMipDimension(width, streamed.tailFirstMip - 1) <= MipTailSize
+		&& GetMipDimension(height, streamed.tailFirstMip - 1) <= MipTailSize)
+	{
+		--streamed.tailFirstMip;
+	}
+
+	std::vector<unsigned char> levelData;
+
+	for (uint32_t mip = streamed.tailFirstMip; mip < mipLevels; ++mip)
+	{
+		levelData.clear();
+
+		if (loader(mip, &levelData) == false)
+		{
+			return false;
+		}
+
+		size_t offset = (size_t)AlignStagingOffset(streamed.tailData.size());
+		streamed.tailData.resize(offset + levelData.size());
+		memcpy(&streamed.tailData[offset], levelData.data(), levelData.size());
+		streamed.tailOffsets.push_back(offset);
+	}
+
+	// Offset of the end of the tail, gives each level's size by subtraction
+	streamed.tailOffsets.push_back(streamed.tailData.size());
+
+	*texture = (uint32_t)textures.size();
+	textures.push_back(streamed);
+
+	return true;
+}
+
+bool TextureStreamer::Update(VkCommandBuffer commandBuffer, uint32_t frame, uint64_t frameIndex, std::vector<uint32_t>* changedTextures)
+{
+	// The frame's previous submission has completed, so its staging buffer is free to overwrite
+	StagingBuffer& frameStaging = staging[frame];
+	VkDeviceSize stagingUsed = 0;
+
+	// Mip tails are small and always uploaded, so every texture becomes usable on its first frame
+	for (uint32_t i = 0; i < textures.size(); ++i)
+	{
+		StreamedTexture& texture = textures[i];
+
+		if (texture.tailData.empty())
+		{
+			continue;
+		}
+
+		VkDeviceSize offset = AlignStagingOffset(stagingUsed);
+
+		if (offset + texture.tailData.size() > frameStaging.size)
+		{
+			if (stagingUsed > 0)
+			{
+				break;
+			}
+
+			if (ReserveStaging(frameStaging, texture.tailData.size()) == false)
+			{
+				return false;
+			}
+		}
+
+		if (UploadTail(commandBuffer, frameStaging, texture, offset) == false)
+		{
+			return false;
+		}
+
+		stagingUsed = offset + texture.tailData.size();
+		texture.tailData.clear();
+		texture.tailOffsets.clear();
+		changedTextures->push_back(i);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			deferredResults.push_back(std::move(results[i]));
+		}
+
+		results.clear();
+	}
+
+	size_t resultIndex = 0;
+
+	for (; resultIndex < deferredResults.size(); ++resultIndex)
+	{
+		LoadResult& loadResult = deferredResults[resultIndex];
+		StreamedTexture& texture = textures[loadResult.texture];
+
+		if (loadResult.success == false)
+		{
+			vkDestroyImage(device, texture.pendingImage, NULL);
+			pendingBytes -= texture.pendingSize - texture.memorySize;
+			texture.pendingImage = VK_NULL_HANDLE;
+			texture.pendingSize = 0;
+			texture.loadPending = false;
+			texture.loadFailed = true;
+			continue;
+		}
+
+		VkDeviceSize offset = AlignStagingOffset(stagingUsed);
+		VkDeviceSize dataSize = loadResult.data.size();
+
+		// Past the per frame upload budget, a single oversized level may still go through on its own
+		if (stagingUsed > 0 && offset + dataSize > uploadBudgetPerFrame)
+		{
+			break;
+		}
+
+		if (offset + dataSize > frameStaging.size)
+		{
+			if (stagingUsed > 0)
+			{
+				break;
+			}
+
+			if (ReserveStaging(frameStaging, dataSize) == false)
+			{
+				return false;
+			}
+		}
+
+		if (UploadPromotion(commandBuffer, frameStaging, texture, loadResult.data, offset, frameIndex) == false)
+		{
+			return false;
+		}
+
+		stagingUsed = offset + dataSize;
+		changedTextures->push_back(loadResult.texture);
+	}
+
+	deferredResults.erase(deferredResults.begin(), deferredResults.begin() + resultIndex);
+
+	if (stagingUsed > 0)
+	{
+		VkMappedMemoryRange flushRange;
+		flushRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		flushRange.pNext = NULL;
+		flushRange.memory = frameStaging.memory;
+		flushRange.offset = 0;
+		flushRange.size = VK_WHOLE_SIZE;
+
+		if (vkFlushMappedMemoryRanges(device, 1, &flushRange) != VK_SUCCESS)
+		{
+			return false;
+		}
+	}
+
+	RequestLoads();
+
+	return true;
+}
+
+VkImageView TextureStreamer::GetImageView(uint32_t texture) const
+{
+	return textures[texture].view;
+}
+
+uint32_t TextureStreamer::GetResidentMipLevel(uint32_t texture) const
+{
+	return textures[texture].residentMip;
+}
+
+VkDeviceSize TextureStreamer::GetResidentBytes() const
+{
+	return residentBytes;
+}
+
+bool TextureStreamer::CreateStreamImage(const StreamedTexture& texture, uint32_t firstMip, VkImage* image, VkDeviceSize* size)
+{
+	VkImageCreateInfo imageCreateInfo;
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.pNext = NULL;
+	imageCreateInfo.flags = 0;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format = texture.format;
+	imageCreateInfo.extent = { GetMipDimension(texture.width, firstMip), GetMipDimension(texture.height, firstMip), 1 };
+	imageCreateInfo.mipLevels = texture.mipLevels - firstMip;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.queueFamilyIndexCount = 0;
+	imageCreateInfo.pQueueFamilyIndices = NULL;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(device, &imageCreateInfo, NULL, image) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, *image, &memoryRequirements);
+	*size = memoryRequirements.size;
+
+	return true;
+}
+
+bool TextureStreamer::CreateView(StreamedTexture& texture)
+{
+	VkImageViewCreateInfo imageViewCreateInfo;
+	imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	imageViewCreateInfo.pNext = NULL;
+	imageViewCreateInfo.flags = 0;
+	imageViewCreateInfo.image = texture.image;
+	imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	imageViewCreateInfo.format = texture.format;
+	imageViewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+	imageViewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.mipLevels - texture.residentMip, 0, 1 };
+
+	return vkCreateImageView(device, &imageViewCreateInfo, NULL, &texture.view) == VK_SUCCESS;
+}
+
+bool TextureStreamer::ReserveStaging(StagingBuffer& staging, VkDeviceSize size)
+{
+	if (size <= staging.size)
+	{
+		return true;
+	}
+
+	// Only called when nothing has been written this update, and the frame's previous update has executed
+	DestroyStaging(staging);
+
+	if (CreateBuffer(device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, memoryTypes, NULL, (size_t)size, &staging.buffer, &staging.memory) == false)
+	{
+		return false;
+	}
+
+	void* mapped;
+
+	if (vkMapMemory(device, staging.memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	staging.mapped = (unsigned char*)mapped;
+	staging.size = size;
+
+	return true;
+}
+
+void TextureStreamer::DestroyStaging(StagingBuffer& staging)
+{
+	if (staging.mapped != NULL)
+	{
+		vkUnmapMemory(device, staging.memory);
+	}
+
+	vkDestroyBuffer(device, staging.buffer, NULL);
+	vkFreeMemory(device, staging.memory, NULL);
+	staging.buffer = VK_NULL_HANDLE;
+	staging.memory = VK_NULL_HANDLE;
+	staging.mapped = NULL;
+	staging.size = 0;
+}
+
+bool TextureStreamer::UploadTail(VkCommandBuffer commandBuffer, const StagingBuffer& staging, StreamedTexture& texture, VkDeviceSize stagingOffset)
+{
+	VkDeviceSize imageSize;
+
+	if (CreateStreamImage(texture, texture.tailFirstMip, &texture.image, &imageSize) == false)
+	{
+		return false;
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, texture.image, &memoryRequirements);
+
+	if (CreateDeviceMemory(device, memoryTypes, &memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, (size_t)imageSize, &texture.memory) == false)
+	{
+		vkDestroyImage(device, texture.image, NULL);
+		texture.image = VK_NULL_HANDLE;
+		texture.memory = VK_NULL_HANDLE;
+		return false;
+	}
+
+	if (vkBindImageMemory(device, texture.image, texture.memory, 0) != VK_SUCCESS)
+	{
+		vkDestroyImage(device, texture.image, NULL);
+		vkFreeMemory(device, texture.memory, NULL);
+		texture.image = VK_NULL_HANDLE;
+		texture.memory = VK_NULL_HANDLE;
+		return false;
+	}
+
+	memcpy(staging.mapped + stagingOffset, texture.tailData.data(), texture.tailData.size());
+
+	uint32_t levelCount = texture.mipLevels - texture.tailFirstMip;
+	std::vector<VkBufferImageCopy> copyRegions(levelCount);
+
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		uint32_t mip = texture.tailFirstMip + level;
+
+		copyRegions[level].bufferOffset = stagingOffset + texture.tailOffsets[level];
+		copyRegions[level].bufferRowLength = 0;
+		copyRegions[level].bufferImageHeight = 0;
+		copyRegions[level].imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+		copyRegions[level].imageOffset = { 0, 0, 0 };
+		copyRegions[level].imageExtent = { GetMipDimension(texture.width, mip), GetMipDimension(texture.height, mip), 1 };
+	}
+
+	VkImageMemoryBarrier barrier;
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.pNext = NULL;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = texture.image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+	vkCmdCopyBufferToImage(commandBuffer, staging.buffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levelCount, copyRegions.data());
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+	texture.memorySize = imageSize;
+	texture.residentMip = texture.tailFirstMip;
+	residentBytes += imageSize;
+
+	return CreateView(texture);
+}
+
+bool TextureStreamer::UploadPromotion(VkCommandBuffer commandBuffer, const StagingBuffer& staging, StreamedTexture& texture, const std::vector<unsigned char>& data, VkDeviceSize stagingOffset, uint64_t frameIndex)
+{
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, texture.pendingImage, &memoryRequirements);
+
+	VkDeviceMemory promotedMemory;
+
+	if (CreateDeviceMemory(device, memoryTypes, &memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, (size_t)memoryRequirements.size, &promotedMemory) == false)
+	{
+		return false;
+	}
+
+	if (vkBindImageMemory(device, texture.pendingImage, promotedMemory, 0) != VK_SUCCESS)
+	{
+		vkFreeMemory(device, promotedMemory, NULL);
+		return false;
+	}
+
+	memcpy(staging.mapped + stagingOffset, data.data(), data.size());
+
+	uint32_t promotedMip = texture.residentMip - 1;
+	uint32_t residentLevelCount = texture.mipLevels - texture.residentMip;
+
+	VkImageMemoryBarrier barriers[2];
+	barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barriers[0].pNext = NULL;
+	barriers[0].srcAccessMask = 0;
+	barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].image = texture.pendingImage;
+	barriers[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, residentLevelCount + 1, 0, 1 };
+
+	barriers[1] = barriers[0];
+	barriers[1].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barriers[1].image = texture.image;
+	barriers[1].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, residentLevelCount, 0, 1 };
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 2, barriers);
+
+	// Existing levels move down one level in the promoted image
+	std::vector<VkImageCopy> imageCopies(residentLevelCount);
+
+	for (uint32_t level = 0; level < residentLevelCount; ++level)
+	{
+		uint32_t mip = texture.residentMip + level;
+
+		imageCopies[level].srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+		imageCopies[level].srcOffset = { 0, 0, 0 };
+		imageCopies[level].dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level + 1, 0, 1 };
+		imageCopies[level].dstOffset = { 0, 0, 0 };
+		imageCopies[level].extent = { GetMipDimension(texture.width, mip), GetMipDimension(texture.height, mip), 1 };
+	}
+
+	vkCmdCopyImage(commandBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture.pendingImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, residentLevelCount, imageCopies.data());
+
+	VkBufferImageCopy copyRegion;
+	copyRegion.bufferOffset = stagingOffset;
+	copyRegion.bufferRowLength = 0;
+	copyRegion.bufferImageHeight = 0;
+	copyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	copyRegion.imageOffset = { 0, 0, 0 };
+	copyRegion.imageExtent = { GetMipDimension(texture.width, promotedMip), GetMipDimension(texture.height, promotedMip), 1 };
+	vkCmdCopyBufferToImage(commandBuffer, staging.buffer, texture.pendingImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+	barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barriers[0]);
+
+	// The copy above reads the old image, so it lives until this frame completes
+	Retire(texture, frameIndex);
+
+	residentBytes += texture.pendingSize - texture.memorySize;
+	pendingBytes -= texture.pendingSize - texture.memorySize;
+
+	texture.image = texture.pendingImage;
+	texture.memory = promotedMemory;
+	texture.memorySize = texture.pendingSize;
+	texture.residentMip = promotedMip;
+	texture.pendingImage = VK_NULL_HANDLE;
+	texture.pendingSize = 0;
+	texture.loadPending = false;
+
+	return CreateView(texture);
+}
+
+void TextureStreamer::RequestLoads()
+{
+	size_t pendingLoads = 0;
+
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		if (textures[i].loadPending)
+		{
+			++pendingLoads;
+		}
+	}
+
+	while (pendingLoads < MaxPendingLoads)
+	{
+		// Lowest resolution texture first so everything sharpens evenly
+		StreamedTexture* candidate = NULL;
+		uint32_t candidateIndex = 0;
+
+		for (uint32_t i = 0; i < textures.size(); ++i)
+		{
+			StreamedTexture& texture = textures[i];
+
+			if (texture.view == VK_NULL_HANDLE || texture.residentMip == 0 || texture.loadPending || texture.loadFailed || texture.budgetLimited)
+			{
+				continue;
+			}
+
+			uint32_t size = GetMipDimension(texture.width, texture.residentMip) * GetMipDimension(texture.height, texture.residentMip);
+
+			if (candidate == NULL || size < GetMipDimension(candidate->width, candidate->residentMip) * GetMipDimension(candidate->height, candidate->residentMip))
+			{
+				candidate = &texture;
+				candidateIndex = i;
+			}
+		}
+
+		if (candidate == NULL)
+		{
+			return;
+		}
+
+		if (CreateStreamImage(*candidate, candidate->residentMip - 1, &candidate->pendingImage, &candidate->pendingSize) == false)
+		{
+			candidate->loadFailed = true;
+			continue;
+		}
+
+		VkDeviceSize growth = candidate->pendingSize - candidate->memorySize;
+
+		if (residentBytes + pendingBytes + growth > memoryBudget)
+		{
+			// Resident memory only grows, so this texture has reached its final resolution
+			vkDestroyImage(device, candidate->pendingImage, NULL);
+			candidate->pendingImage = VK_NULL_HANDLE;
+			candidate->pendingSize = 0;
+			candidate->budgetLimited = true;
+			continue;
+		}
+
+		pendingBytes += growth;
+		candidate->loadPending = true;
+		++pendingLoads;
+
+		LoadRequest request;
+		request.texture = candidateIndex;
+		request.mipLevel = candidate->residentMip - 1;
+		request.loader = candidate->loader;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			requests.push_back(request);
+		}
+
+		requestAvailable.notify_one();
+	}
+}
+
+void TextureStreamer::Retire(StreamedTexture& texture, uint64_t frameIndex)
+{
+	deletionQueue->RetireImageView(texture.view, frameIndex);
+	deletionQueue->RetireImage(texture.image, frameIndex);
+	deletionQueue->RetireMemory(texture.memory, frameIndex);
+
+	texture.image = VK_NULL_HANDLE;
+	texture.memory = VK_NULL_HANDLE;
+	texture.view = VK_NULL_HANDLE;
+}
+
+void TextureStreamer::StreamingThread()
+{
+	for (;;)
+	{
+		LoadRequest request;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			requestAvailable.wait(lock, [this] { return stopping || requests.empty() == false; });
+
+			if (stopping)
+			{
+				return;
+			}
+
+			request = requests.front();
+			requests.pop_front();
+		}
+
+		LoadResult result;
+		result.texture = request.texture;
+		result.success = request.loader(request.mipLevel, &result.data);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			results.push_back(std::move(result));
+		}
+	}
+}
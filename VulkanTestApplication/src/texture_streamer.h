@@ -0,0 +1,132 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "deletion_queue.h"
+#include "vulkan_helpers.h"
+
+// Streams texture mip levels in from a background thread, smallest levels first.
+//
+// Each texture starts with only its mip tail resident so it is usable immediately at low
+// resolution. Larger levels are loaded on the streaming thread and promoted one at a time by
+// reallocating the image one level larger, so device memory only ever holds resident levels.
+// Promotions stop once the memory budget would be exceeded. Replaced images are handed to the
+// deletion queue, and each frame in flight uploads through its own staging buffer.
+class TextureStreamer
+{
+public:
+	// Fills data with the tightly packed texels of mipLevel. Called on the streaming thread for
+	// every level except the mip tail, which is loaded on the calling thread by AddTexture.
+	typedef std::function<bool(uint32_t mipLevel, std::vector<unsigned char>* data)> MipLoader;
+
+	// Levels no larger than this in either dimension are loaded up front
+	static const uint32_t MipTailSize = 32;
+
+	TextureStreamer();
+	~TextureStreamer();
+
+	bool Create(VkDevice device, const VkMemoryType* memoryTypes, DeletionQueue* deletionQueue, uint32_t frameCount, VkDeviceSize memoryBudget, VkDeviceSize uploadBudgetPerFrame);
+	void Destroy();
+
+	bool AddTexture(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, const MipLoader& loader, uint32_t* texture);
+
+	// Records uploads for loaded levels into commandBuffer, submitted as frameIndex, and queues
+	// further loads. The command buffer of the last Update for frame must have finished executing.
+	// Textures whose image view was replaced are appended to changedTextures, their descriptors
+	// must be rewritten before the next use. Replaced images are retired for frameIndex.
+	bool Update(VkCommandBuffer commandBuffer, uint32_t frame, uint64_t frameIndex, std::vector<uint32_t>* changedTextures);
+
+	// VK_NULL_HANDLE until the mip tail has been uploaded
+	VkImageView GetImageView(uint32_t texture) const;
+
+	// Largest resident level, as an index into the texture's full mip chain
+	uint32_t GetResidentMipLevel(uint32_t texture) const;
+
+	VkDeviceSize GetResidentBytes() const;
+
+private:
+	struct StreamedTexture
+	{
+		uint32_t width;
+		uint32_t height;
+		uint32_t mipLevels;
+		VkFormat format;
+		MipLoader loader;
+
+		VkImage image;
+		VkDeviceMemory memory;
+		VkDeviceSize memorySize;
+		VkImageView view;
+		uint32_t residentMip;
+
+		// Image one level larger than the resident one, created when its load is requested
+		VkImage pendingImage;
+		VkDeviceSize pendingSize;
+		bool loadPending;
+		bool loadFailed;
+		bool budgetLimited;
+
+		// Mip tail loaded by AddTexture, waiting for its first upload
+		uint32_t tailFirstMip;
+		std::vector<unsigned char> tailData;
+		std::vector<size_t> tailOffsets;
+	};
+
+	struct LoadRequest
+	{
+		uint32_t texture;
+		uint32_t mipLevel;
+		MipLoader loader;
+	};
+
+	struct LoadResult
+	{
+		uint32_t texture;
+		bool success;
+		std::vector<unsigned char> data;
+	};
+
+	struct StagingBuffer
+	{
+		VkBuffer buffer;
+		VkDeviceMemory memory;
+		VkDeviceSize size;
+		unsigned char* mapped;
+	};
+
+	bool CreateStreamImage(const StreamedTexture& texture, uint32_t firstMip, VkImage* image, VkDeviceSize* size);
+	bool CreateView(StreamedTexture& texture);
+	bool ReserveStaging(StagingBuffer& staging, VkDeviceSize size);
+	void DestroyStaging(StagingBuffer& staging);
+	bool UploadTail(VkCommandBuffer commandBuffer, const StagingBuffer& staging, StreamedTexture& texture, VkDeviceSize stagingOffset);
+	bool UploadPromotion(VkCommandBuffer commandBuffer, const StagingBuffer& staging, StreamedTexture& texture, const std::vector<unsigned char>& data, VkDeviceSize stagingOffset, uint64_t frameIndex);
+	void RequestLoads();
+	void Retire(StreamedTexture& texture, uint64_t frameIndex);
+	void StreamingThread();
+
+	VkDevice device;
+	const VkMemoryType* memoryTypes;
+	DeletionQueue* deletionQueue;
+	VkDeviceSize memoryBudget;
+	VkDeviceSize uploadBudgetPerFrame;
+	VkDeviceSize residentBytes;
+	VkDeviceSize pendingBytes;
+
+	// One per frame in flight, reused once that frame's previous submission has completed
+	std::vector<StagingBuffer> staging;
+
+	std::vector<StreamedTexture> textures;
+	std::vector<LoadResult> deferredResults;
+
+	std::thread streamingThread;
+	std::mutex mutex;
+	std::condition_variable requestAvailable;
+	std::deque<LoadRequest> requests;
+	std::vector<LoadResult> results;
+	bool stopping;
+};
@@ -0,0 +1,254 @@
+#include "transform_hierarchy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Column major, result = a * b
+static void MultiplyMatrices(const float* a, const float* b, float* result)
+{
+	for (int column = 0; column < 4; ++column)
+	{
+		for (int row = 0; row < 4; ++row)
+		{
+			result[column * 4 + row] = a[row] * b[column * 4] + a[4 + row] * b[column * 4 + 1] + a[8 + row] * b[column * 4 + 2] + a[12 + row] * b[column * 4 + 3];
+		}
+	}
+}
+
+static bool CompareRanges(const TransformHierarchy::Range& a, const TransformHierarchy::Range& b)
+{
+	return a.begin < b.begin;
+}
+
+TransformHierarchy::TransformHierarchy()
+{
+}
+
+void TransformHierarchy::Initialize(uint32_t frameCount)
+{
+	pendingRanges.assign(frameCount, std::vector<Range>());
+	MarkPending(0, GetNodeCount());
+}
+
+uint32_t TransformHierarchy::AddNode(uint32_t parentNode, const float localMatrix[16])
+{
+	uint32_t count = GetNodeCount();
+	uint32_t parentIndex = parentNode == NoParent ? NoParent : indexOfNode[parentNode];
+
+	// Directly after the parent's existing subtree, roots go at the end
+	uint32_t position = parentIndex == NoParent ? count : parentIndex + subtreeSize[parentIndex];
+	uint32_t node = (uint32_t)indexOfNode.size();
+
+	Matrix matrix;
+	memcpy(matrix.m, localMatrix, sizeof(matrix.m));
+
+	local.insert(local.begin() + position, matrix);
+	world.insert(world.begin() + position, matrix);
+	parent.insert(parent.begin() + position, parentIndex);
+	subtreeSize.insert(subtreeSize.begin() + position, 1);
+	dirty.insert(dirty.begin() + position, 1);
+	nodeAtIndex.insert(nodeAtIndex.begin() + position, node);
+	indexOfNode.push_back(position);
+	dirtyNodes.push_back(node);
+
+	for (uint32_t ancestor = parentIndex; ancestor != NoParent; ancestor = parent[ancestor])
+	{
+		++subtreeSize[ancestor];
+	}
+
+	// Everything after the insertion moved up one instance
+	if (position < count)
+	{
+		for (uint32_t i = position + 1; i <= count; ++i)
+		{
+			if (parent[i] != NoParent && parent[i] >= position)
+			{
+				++parent[i];
+			}
+
+			indexOfNode[nodeAtIndex[i]] = i;
+		}
+
+		MarkPending(position + 1, count + 1);
+	}
+
+	return node;
+}
+
+void TransformHierarchy::SetLocal(uint32_t node, const float localMatrix[16])
+{
+	uint32_t index = indexOfNode[node];
+	memcpy(local[index].m, localMatrix, sizeof(local[index].m));
+
+	if (dirty[index] == 0)
+	{
+		dirty[index] = 1;
+		dirtyNodes.push_back(node);
+	}
+}
+
+const float* TransformHierarchy::GetLocal(uint32_t node) const
+{
+	return local[indexOfNode[node]].m;
+}
+
+const float* TransformHierarchy::GetWorld(uint32_t node) const
+{
+	return world[indexOfNode[node]].m;
+}
+
+uint32_t TransformHierarchy::GetInstanceIndex(uint32_t node) const
+{
+	return indexOfNode[node];
+}
+
+uint32_t TransformHierarchy::GetNodeCount() const
+{
+	return (uint32_t)local.size();
+}
+
+uint32_t TransformHierarchy::Update()
+{
+	updatedRanges.clear();
+
+	if (dirtyNodes.empty())
+	{
+		return 0;
+	}
+
+	// Reuse the list as positions, ascending so an ancestor comes before any dirty descendant
+	for (size_t i = 0; i < dirtyNodes.size(); ++i)
+	{
+		dirtyNodes[i] = indexOfNode[dirtyNodes[i]];
+	}
+
+	std::sort(dirtyNodes.begin(), dirtyNodes.end());
+
+	uint32_t recomputed = 0;
+	uint32_t coveredEnd = 0;
+
+	for (size_t i = 0; i < dirtyNodes.size(); ++i)
+	{
+		uint32_t begin = dirtyNodes[i];
+
+		// Inside a subtree already recomputed
+		if (begin < coveredEnd)
+		{
+			continue;
+		}
+
+		uint32_t end = begin + subtreeSize[begin];
+
+		// Parents precede children, so each parent's world matrix is current by the time it's read
+		for (uint32_t index = begin; index < end; ++index)
+		{
+			if (parent[index] == NoParent)
+			{
+				world[index] = local[index];
+			}
+			else
+			{
+				MultiplyMatrices(world[parent[index]].m, local[index].m, world[index].m);
+			}
+
+			dirty[index] = 0;
+		}
+
+		// Adjacent subtrees become one range
+		if (updatedRanges.empty() == false && updatedRanges.back().end == begin)
+		{
+			updatedRanges.back().end = end;
+		}
+		else
+		{
+			Range range;
+			range.begin = begin;
+			range.end = end;
+			updatedRanges.push_back(range);
+		}
+
+		recomputed += end - begin;
+		coveredEnd = end;
+	}
+
+	dirtyNodes.clear();
+
+	for (size_t i = 0; i < updatedRanges.size(); ++i)
+	{
+		MarkPending(updatedRanges[i].begin, updatedRanges[i].end);
+	}
+
+	return recomputed;
+}
+
+const std::vector<TransformHierarchy::Range>& TransformHierarchy::GetUpdatedRanges() const
+{
+	return updatedRanges;
+}
+
+uint32_t TransformHierarchy::WriteInstances(uint32_t frame, void* mappedInstances)
+{
+	std::vector<Range>& ranges = pendingRanges[frame];
+
+	if (ranges.empty())
+	{
+		return 0;
+	}
+
+	std::sort(ranges.begin(), ranges.end(), CompareRanges);
+
+	Matrix* instances = (Matrix*)mappedInstances;
+	uint32_t written = 0;
+	uint32_t writtenEnd = 0;
+
+	// Ranges from several updates may overlap, each instance is copied once
+	for (size_t i = 0; i < ranges.size(); ++i)
+	{
+		uint32_t begin = std::max(ranges[i].begin, writtenEnd);
+		uint32_t end = ranges[i].end;
+
+		if (begin < end)
+		{
+			memcpy(instances + begin, &world[begin], sizeof(Matrix) * (end - begin));
+			written += end - begin;
+			writtenEnd = end;
+		}
+	}
+
+	ranges.clear();
+	return written;
+}
+
+void TransformHierarchy::MarkPending(uint32_t begin, uint32_t end)
+{
+	if (begin >= end)
+	{
+		return;
+	}
+
+	Range range;
+	range.begin = begin;
+	range.end = end;
+
+	for (size_t frame = 0; frame < pendingRanges.size(); ++frame)
+	{
+		pendingRanges[frame].push_back(range);
+	}
+}
+
+void TransformBounds(const float matrix[16], const float center[3], const float extent[3], float transformedCenter[3], float transformedExtent[3])
+{
+	// Each axis of the result spans the absolute contribution of every source axis
+	for (int row = 0; row < 3; ++row)
+	{
+		transformedCenter[row] = matrix[12 + row];
+		transformedExtent[row] = 0.0f;
+
+		for (int column = 0; column < 3; ++column)
+		{
+			transformedCenter[row] += matrix[column * 4 + row] * center[column];
+			transformedExtent[row] += fabsf(matrix[column * 4 + row]) * extent[column];
+		}
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Parent-child transforms held in flat arrays in depth first order, so every parent precedes its
+// children and each subtree is one contiguous range. Changing a node's local matrix marks it dirty,
+// and Update recomputes world matrices for the dirty subtrees only, walking each range front to
+// back. The cost of a frame follows what changed rather than how many nodes there are.
+//
+// A node's instance index is its position in the arrays, and world matrices are copied to per frame
+// instance buffers at the same index. Nodes are addressed by ids that stay valid as nodes are
+// inserted. Adding a child anywhere but under the most recent branch shifts the nodes after it,
+// which costs a pass over them and a rewrite of their instances, so build in depth first order.
+class TransformHierarchy
+{
+public:
+	static const uint32_t NoParent = 0xffffffff;
+
+	struct Range
+	{
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	TransformHierarchy();
+
+	// frameCount instance buffers are kept up to date, one per frame in flight
+	void Initialize(uint32_t frameCount);
+
+	// Column major local matrix relative to parent, which must exist. Returns the node's id.
+	uint32_t AddNode(uint32_t parent, const float local[16]);
+
+	void SetLocal(uint32_t node, const float local[16]);
+	const float* GetLocal(uint32_t node) const;
+
+	// Valid after the Update following the node's last change
+	const float* GetWorld(uint32_t node) const;
+
+	uint32_t GetInstanceIndex(uint32_t node) const;
+	uint32_t GetNodeCount() const;
+
+	// Recomputes world matrices under every node changed since the last call, returning how many
+	uint32_t Update();
+
+	// Instance ranges recomputed by the last Update, ascending and disjoint
+	const std::vector<Range>& GetUpdatedRanges() const;
+
+	// Copies world matrices changed since frame's buffer was last written, 64 bytes per instance.
+	// mappedInstances must hold GetNodeCount matrices. Returns the number of matrices written.
+	uint32_t WriteInstances(uint32_t frame, void* mappedInstances);
+
+private:
+	struct Matrix
+	{
+		float m[16];
+	};
+
+	void MarkPending(uint32_t begin, uint32_t end);
+
+	// Indexed by position
+	std::vector<Matrix> local;
+	std::vector<Matrix> world;
+	std::vector<uint32_t> parent;			// Position of the parent, NoParent for roots
+	std::vector<uint32_t> subtreeSize;		// Including the node itself
+	std::vector<uint8_t> dirty;
+	std::vector<uint32_t> nodeAtIndex;
+
+	// Indexed by id
+	std::vector<uint32_t> indexOfNode;
+
+	std::vector<uint32_t> dirtyNodes;
+	std::vector<Range> updatedRanges;
+
+	// Ranges each frame's instance buffer has yet to receive
+	std::vector<std::vector<Range>> pendingRanges;
+};
+
+// Axis aligned bounds of a box transformed by a column major matrix
+void TransformBounds(const float matrix[16], const float center[3], const float extent[3], float transformedCenter[3], float transformedExtent[3]);
@@ -0,0 +1,295 @@
+#include "vertex_format.h"
+
+#include <cmath>
+#include <cstring>
+
+VertexFormat GetDefaultVertexFormat()
+{
+	VertexFormat format;
+	format.position = VertexPositionFormat_Float32;
+	format.attribute = VertexAttributeFormat_Float32;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		format.positionScale[axis] = 1.0f;
+		format.positionOffset[axis] = 0.0f;
+	}
+
+	return format;
+}
+
+uint32_t GetPositionSize(VertexPositionFormat format)
+{
+	return format == VertexPositionFormat_Float32 ? 12 : 8;
+}
+
+uint32_t GetAttributeSize(VertexAttributeFormat format)
+{
+	return format == VertexAttributeFormat_Float32 ? 12 : 4;
+}
+
+uint32_t GetVertexStride(const VertexFormat& format)
+{
+	return GetPositionSize(format.position) + GetAttributeSize(format.attribute);
+}
+
+void ComputePositionQuantization(const float* positions, uint32_t positionCount, uint32_t positionStride, VertexFormat* format)
+{
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		format->positionScale[axis] = 1.0f;
+		format->positionOffset[axis] = 0.0f;
+	}
+
+	if (format->position != VertexPositionFormat_Snorm16 || positionCount == 0)
+	{
+		return;
+	}
+
+	float minimum[3];
+	float maximum[3];
+	memcpy(minimum, positions, sizeof(minimum));
+	memcpy(maximum, positions, sizeof(maximum));
+
+	for (uint32_t i = 1; i < positionCount; ++i)
+	{
+		const float* position = (const float*)((const unsigned char*)positions + (size_t)i * positionStride);
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			minimum[axis] = position[axis] < minimum[axis] ? position[axis] : minimum[axis];
+			maximum[axis] = position[axis] > maximum[axis] ? position[axis] : maximum[axis];
+		}
+	}
+
+	// Map the bounding box onto [-1, 1] per axis
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float halfExtent = (maximum[axis] - minimum[axis]) * 0.5f;
+		format->positionOffset[axis] = (maximum[axis] + minimum[axis]) * 0.5f;
+		format->positionScale[axis] = halfExtent > 0.0f ? halfExtent : 1.0f;
+	}
+}
+
+static float Saturate(float value)
+{
+	return value < 0.0f ? 0.0f : value > 1.0f ? 1.0f : value;
+}
+
+static uint32_t QuantizeUnorm(float value, uint32_t maximum)
+{
+	return (uint32_t)(Saturate(value) * (float)maximum + 0.5f);
+}
+
+static int16_t QuantizeSnorm16(float value)
+{
+	value = value < -1.0f ? -1.0f : value > 1.0f ? 1.0f : value;
+	return (int16_t)floorf(value * 32767.0f + 0.5f);
+}
+
+uint16_t FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t exponent = (bits >> 23) & 0xff;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	// Inf and NaN, keeping NaNs quiet
+	if (exponent == 0xff)
+	{
+		return (uint16_t)(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+	}
+
+	int halfExponent = (int)exponent - 127 + 15;
+
+	if (halfExponent >= 0x1f)
+	{
+		return (uint16_t)(sign | 0x7c00);
+	}
+
+	if (halfExponent <= 0)
+	{
+		// Denormal or zero
+		if (halfExponent < -10)
+		{
+			return (uint16_t)sign;
+		}
+
+		mantissa |= 0x800000;
+		uint32_t shift = (uint32_t)(14 - halfExponent);
+		uint32_t halfMantissa = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+
+		if (remainder > halfway || (remainder == halfway && (halfMantissa & 1)))
+		{
+			++halfMantissa;
+		}
+
+		return (uint16_t)(sign | halfMantissa);
+	}
+
+	uint32_t half = sign | ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1fff;
+
+	// A carry out of the mantissa correctly bumps the exponent, up to infinity
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+	{
+		++half;
+	}
+
+	return (uint16_t)half;
+}
+
+float HalfToFloat(uint16_t value)
+{
+	uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+	uint32_t bits;
+
+	if (exponent == 0x1f)
+	{
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	}
+	else if (exponent != 0)
+	{
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+	else if (mantissa != 0)
+	{
+		// Denormal, normalise the mantissa
+		exponent = 127 - 15 + 1;
+
+		while ((mantissa & 0x400) == 0)
+		{
+			mantissa <<= 1;
+			--exponent;
+		}
+
+		bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+	}
+	else
+	{
+		bits = sign;
+	}
+
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+static void DecodePosition(const VertexFormat& format, const unsigned char* input, float* position)
+{
+	switch (format.position)
+	{
+	case VertexPositionFormat_Float32:
+		memcpy(position, input, 12);
+		break;
+
+	case VertexPositionFormat_Snorm16:
+	{
+		int16_t quantized[3];
+		memcpy(quantized, input, sizeof(quantized));
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float value = quantized[axis] < -32767 ? -1.0f : quantized[axis] / 32767.0f;
+			position[axis] = value * format.positionScale[axis] + format.positionOffset[axis];
+		}
+
+		break;
+	}
+
+	case VertexPositionFormat_Half:
+	{
+		uint16_t halves[3];
+		memcpy(halves, input, sizeof(halves));
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			position[axis] = HalfToFloat(halves[axis]);
+		}
+
+		break;
+	}
+	}
+}
+
+void GetPositionBounds(const VertexFormat& format, const void* vertexData, uint32_t vertexCount, float minimum[3], float maximum[3])
+{
+	uint32_t stride = GetVertexStride(format);
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		minimum[axis] = 0.0f;
+		maximum[axis] = 0.0f;
+	}
+
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		float position[3];
+		DecodePosition(format, (const unsigned char*)vertexData + (size_t)i * stride, position);
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			minimum[axis] = (i == 0 || position[axis] < minimum[axis]) ? position[axis] : minimum[axis];
+			maximum[axis] = (i == 0 || position[axis] > maximum[axis]) ? position[axis] : maximum[axis];
+		}
+	}
+}
+
+void EncodeVertex(const VertexFormat& format, const float* position, const float* attribute, unsigned char* output)
+{
+	switch (format.position)
+	{
+	case VertexPositionFormat_Float32:
+		memcpy(output, position, 12);
+		break;
+
+	case VertexPositionFormat_Snorm16:
+	{
+		int16_t quantized[4] = { 0, 0, 0, 0 };
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			quantized[axis] = QuantizeSnorm16((position[axis] - format.positionOffset[axis]) / format.positionScale[axis]);
+		}
+
+		memcpy(output, quantized, sizeof(quantized));
+		break;
+	}
+
+	case VertexPositionFormat_Half:
+	{
+		uint16_t halves[4] = { FloatToHalf(position[0]), FloatToHalf(position[1]), FloatToHalf(position[2]), 0 };
+		memcpy(output, halves, sizeof(halves));
+		break;
+	}
+	}
+
+	output += GetPositionSize(format.position);
+
+	switch (format.attribute)
+	{
+	case VertexAttributeFormat_Float32:
+		memcpy(output, attribute, 12);
+		break;
+
+	case VertexAttributeFormat_Unorm8:
+		output[0] = (unsigned char)QuantizeUnorm(attribute[0], 255);
+		output[1] = (unsigned char)QuantizeUnorm(attribute[1], 255);
+		output[2] = (unsigned char)QuantizeUnorm(attribute[2], 255);
+		output[3] = 255;
+		break;
+
+	case VertexAttributeFormat_Unorm10:
+	{
+		uint32_t packed = QuantizeUnorm(attribute[0], 1023) | (QuantizeUnorm(attribute[1], 1023) << 10) | (QuantizeUnorm(attribute[2], 1023) << 20) | (3u << 30);
+		memcpy(output, &packed, sizeof(packed));
+		break;
+	}
+	}
+}
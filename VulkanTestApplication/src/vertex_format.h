@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+// Storage formats for the two vertex inputs. Everything decodes to floats in the vertex shader,
+// quantised positions are rescaled with the mesh's position scale and offset.
+enum VertexPositionFormat
+{
+	VertexPositionFormat_Float32 = 0,	// R32G32B32_SFLOAT, 12 bytes
+	VertexPositionFormat_Snorm16 = 1,	// R16G16B16A16_SNORM, 8 bytes, quantised to the bounding box
+	VertexPositionFormat_Half = 2,		// R16G16B16A16_SFLOAT, 8 bytes
+};
+
+enum VertexAttributeFormat
+{
+	VertexAttributeFormat_Float32 = 0,	// R32G32B32_SFLOAT, 12 bytes
+	VertexAttributeFormat_Unorm8 = 1,	// R8G8B8A8_UNORM, 4 bytes, for colours
+	VertexAttributeFormat_Unorm10 = 2,	// A2B10G10R10_UNORM_PACK32, 4 bytes, for remapped normals
+};
+
+struct VertexFormat
+{
+	VertexPositionFormat position;
+	VertexAttributeFormat attribute;
+
+	// Shader side dequantisation, position = stored * scale + offset
+	float positionScale[3];
+	float positionOffset[3];
+};
+
+// Full precision layout with an identity position transform
+VertexFormat GetDefaultVertexFormat();
+
+uint32_t GetPositionSize(VertexPositionFormat format);
+uint32_t GetAttributeSize(VertexAttributeFormat format);
+
+// Position first, attribute immediately after
+uint32_t GetVertexStride(const VertexFormat& format);
+
+// Sets positionScale and positionOffset for the bounds of the given positions.
+// Only Snorm16 needs them, other formats get the identity transform.
+void ComputePositionQuantization(const float* positions, uint32_t positionCount, uint32_t positionStride, VertexFormat* format);
+
+// Writes one vertex in format to output, which must have GetVertexStride bytes
+void EncodeVertex(const VertexFormat& format, const float* position, const float* attribute, unsigned char* output);
+
+// Reads vertexCount positions back from vertex data in format, returning their bounding box
+void GetPositionBounds(const VertexFormat& format, const void* vertexData, uint32_t vertexCount, float minimum[3], float maximum[3]);
+
+// IEEE 754 binary16, rounding to nearest even
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
@@ -0,0 +1,433 @@
+#include "vulkan_helpers.h"
+#include "mip_generation.h"
+
+#include <cstring>
+#include <vector>
+
+bool memory_type_from_properties(const VkMemoryType* memoryTypes, uint32_t typeBits, VkFlags requirementsMask, uint32_t* typeIndex)
+{
+	for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++)
+	{
+		if (typeBits & 1 && (memoryTypes[i].propertyFlags & requirementsMask) == requirementsMask)
+		{
+			*typeIndex = i;
+			return true;
+		}
+		typeBits >>= 1;
+	}
+
+	return false;
+}
+
+bool CreateDeviceMemory(VkDevice device, const VkMemoryType* memoryTypes, const VkMemoryRequirements* memoryRequirements, VkFlags requirementsMask, size_t dataSize, VkDeviceMemory* memory)
+{
+	VkMemoryAllocateInfo bufferAllocateInfo;
+	bufferAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	bufferAllocateInfo.pNext = NULL;
+	bufferAllocateInfo.allocationSize = dataSize;
+	bufferAllocateInfo.memoryTypeIndex = 0;
+
+	bool validMemoryType = memory_type_from_properties(memoryTypes, memoryRequirements->memoryTypeBits, requirementsMask, &bufferAllocateInfo.memoryTypeIndex);
+
+	if (validMemoryType == false)
+	{
+		return false;
+	}
+
+	VkResult result = vkAllocateMemory(device, &bufferAllocateInfo, NULL, memory);
+
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool SetDeviceMemory(VkDevice device, VkDeviceMemory memory, const void* data, size_t dataSize)
+{
+	void* mappedMem;
+	VkResult result = vkMapMemory(device, memory, 0, dataSize, 0, &mappedMem);
+
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	memcpy(mappedMem, data, dataSize);
+
+	vkUnmapMemory(device, memory);
+
+	return true;
+}
+
+bool CreateBuffer(VkDevice device, VkBufferUsageFlags usageFlags, const VkMemoryType* memoryTypes, const void* data, size_t dataSize, VkBuffer* buffer, VkDeviceMemory* memory)
+{
+	VkBufferCreateInfo bufferCreateInfo;
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.pNext = NULL;
+	bufferCreateInfo.flags = 0;
+	bufferCreateInfo.usage = usageFlags;
+	bufferCreateInfo.size = dataSize;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	bufferCreateInfo.queueFamilyIndexCount = 0;
+	bufferCreateInfo.pQueueFamilyIndices = NULL;
+
+	VkResult result = vkCreateBuffer(device, &bufferCreateInfo, NULL, buffer);
+
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(device, *buffer, &memoryRequirements);
+
+	if (CreateDeviceMemory(device, memoryTypes, &memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, (size_t)memoryRequirements.size, memory) == false)
+	{
+		return false;
+	}
+
+	if (data != NULL)
+	{
+		if (SetDeviceMemory(device, *memory, data, dataSize) == false)
+		{
+			return false;
+		}
+	}
+
+	result = vkBindBufferMemory(device, *buffer, *memory, 0);
+
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool CreateShaderModule(VkDevice device, const uint32_t* code, size_t codeSize, VkShaderModule* module)
+{
+	VkShaderModuleCreateInfo moduleCreateInfo;
+	moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleCreateInfo.pNext = NULL;
+	moduleCreateInfo.flags = 0;
+	moduleCreateInfo.codeSize = codeSize;
+	moduleCreateInfo.pCode = code;
+
+	VkResult result = vkCreateShaderModule(device, &moduleCreateInfo, NULL, module);
+
+	return result == VK_SUCCESS;
+}
+
+bool BeginOneTimeCommands(VkDevice device, VkCommandPool commandPool, VkCommandBuffer* commandBuffer)
+{
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo;
+	commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	commandBufferAllocateInfo.pNext = NULL;
+	commandBufferAllocateInfo.commandPool = commandPool;
+	commandBufferAllocateInfo.commandBufferCount = 1;
+	commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+	VkResult result = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, commandBuffer);
+
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkCommandBufferBeginInfo commandBufferBeginInfo;
+	commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	commandBufferBeginInfo.pNext = NULL;
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	commandBufferBeginInfo.pInheritanceInfo = NULL;
+
+	result = vkBeginCommandBuffer(*commandBuffer, &commandBufferBeginInfo);
+
+	if (result != VK_SUCCESS)
+	{
+		vkFreeCommandBuffers(device, commandPool, 1, commandBuffer);
+		return false;
+	}
+
+	return true;
+}
+
+bool EndOneTimeCommands(VkDevice device, VkQueue queue, VkCommandPool commandPool, VkCommandBuffer commandBuffer)
+{
+	VkResult result = vkEndCommandBuffer(commandBuffer);
+
+	if (result == VK_SUCCESS)
+	{
+		VkSubmitInfo submitInfo;
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = NULL;
+		submitInfo.waitSemaphoreCount = 0;
+		submitInfo.pWaitSemaphores = NULL;
+		submitInfo.pWaitDstStageMask = NULL;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		submitInfo.signalSemaphoreCount = 0;
+		submitInfo.pSignalSemaphores = NULL;
+		result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+	}
+
+	if (result == VK_SUCCESS)
+	{
+		result = vkQueueWaitIdle(queue);
+	}
+
+	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+
+	return result == VK_SUCCESS;
+}
+
+bool CreateImage2D(VkDevice device, VkQueue queue, VkCommandPool commandPool, const VkMemoryType* memoryTypes, uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, const ImageMipData* mipData, uint32_t mipDataCount, VkImage* image, VkDeviceMemory* memory)
+{
+	if (mipDataCount == 0 || mipDataCount > mipLevels)
+	{
+		return false;
+	}
+
+	VkImageCreateInfo imageCreateInfo;
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.pNext = NULL;
+	imageCreateInfo.flags = 0;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format = format;
+	imageCreateInfo.extent = { width, height, 1 };
+	imageCreateInfo.mipLevels = mipLevels;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.queueFamilyIndexCount = 0;
+	imageCreateInfo.pQueueFamilyIndices = NULL;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (mipDataCount < mipLevels)
+	{
+		// Blit sources
+		imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	}
+
+	VkResult result = vkCreateImage(device, &imageCreateInfo, NULL, image);
+
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, *image, &memoryRequirements);
+
+	if (CreateDeviceMemory(device, memoryTypes, &memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, (size_t)memoryRequirements.size, memory) == false)
+	{
+		vkDestroyImage(device, *image, NULL);
+		*image = VK_NULL_HANDLE;
+		return false;
+	}
+
+	result = vkBindImageMemory(device, *image, *memory, 0);
+
+	if (result != VK_SUCCESS)
+	{
+		vkDestroyImage(device, *image, NULL);
+		vkFreeMemory(device, *memory, NULL);
+		*image = VK_NULL_HANDLE;
+		*memory = VK_NULL_HANDLE;
+		return false;
+	}
+
+	// Pack all supplied levels into one staging buffer, offsets aligned for any block size
+	std::vector<VkBufferImageCopy> copyRegions(mipDataCount);
+	std::vector<unsigned char> stagingData;
+
+	for (uint32_t i = 0; i < mipDataCount; ++i)
+	{
+		size_t offset = (stagingData.size() + 15) & ~(size_t)15;
+		stagingData.resize(offset + mipData[i].dataSize);
+		memcpy(&stagingData[offset], mipData[i].data, mipData[i].dataSize);
+
+		copyRegions[i].bufferOffset = offset;
+		copyRegions[i].bufferRowLength = 0;
+		copyRegions[i].bufferImageHeight = 0;
+		copyRegions[i].imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1 };
+		copyRegions[i].imageOffset = { 0, 0, 0 };
+		copyRegions[i].imageExtent = { GetMipDimension(width, i), GetMipDimension(height, i), 1 };
+	}
+
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingMemory;
+
+	if (CreateBuffer(device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, memoryTypes, stagingData.data(), stagingData.size(), &stagingBuffer, &stagingMemory) == false)
+	{
+		vkDestroyImage(device, *image, NULL);
+		vkFreeMemory(device, *memory, NULL);
+		*image = VK_NULL_HANDLE;
+		*memory = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkCommandBuffer commandBuffer;
+	bool success = BeginOneTimeCommands(device, commandPool, &commandBuffer);
+
+	if (success)
+	{
+		VkImageMemoryBarrier uploadBarrier;
+		uploadBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		uploadBarrier.pNext = NULL;
+		uploadBarrier.srcAccessMask = 0;
+		uploadBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		uploadBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		uploadBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		uploadBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		uploadBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		uploadBarrier.image = *image;
+		uploadBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &uploadBarrier);
+
+		vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, *image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)copyRegions.size(), copyRegions.data());
+
+		// The last uploaded level seeds the blit chain, all other uploaded levels are final
+		uint32_t finalLevelCount = mipDataCount < mipLevels ? mipDataCount - 1 : mipDataCount;
+
+		if (finalLevelCount > 0)
+		{
+			VkImageMemoryBarrier readBarrier = uploadBarrier;
+			readBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			readBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			readBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			readBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			readBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, finalLevelCount, 0, 1 };
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &readBarrier);
+		}
+
+		if (mipDataCount < mipLevels)
+		{
+			RecordBlitMipChain(commandBuffer, *image, width, height, mipDataCount, mipLevels);
+		}
+
+		success = EndOneTimeCommands(device, queue, commandPool, commandBuffer);
+	}
+
+	vkDestroyBuffer(device, stagingBuffer, NULL);
+	vkFreeMemory(device, stagingMemory, NULL);
+
+	// The upload was waited on, or never submitted, so the image is unused
+	if (success == false)
+	{
+		vkDestroyImage(device, *image, NULL);
+		vkFreeMemory(device, *memory, NULL);
+		*image = VK_NULL_HANDLE;
+		*memory = VK_NULL_HANDLE;
+	}
+
+	return success;
+}
+
+bool CreateRenderTarget(VkDevice device, const VkMemoryType* memoryTypes, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, VkImage* image, VkDeviceMemory* memory, VkImageView* view)
+{
+	VkImageCreateInfo imageCreateInfo;
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.pNext = NULL;
+	imageCreateInfo.flags = 0;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format = format;
+	imageCreateInfo.extent = { width, height, 1 };
+	imageCreateInfo.mipLevels = 1;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.usage = usage;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.queueFamilyIndexCount = 0;
+	imageCreateInfo.pQueueFamilyIndices = NULL;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(device, &imageCreateInfo, NULL, image) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, *image, &memoryRequirements);
+
+	// Lazily allocated memory is only offered for transient attachments
+	bool lazilyAllocated = (usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0
+		&& CreateDeviceMemory(device, memoryTypes, &memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, memoryRequirements.size, memory);
+
+	if (lazilyAllocated == false && CreateDeviceMemory(device, memoryTypes, &memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memoryRequirements.size, memory) == false)
+	{
+		vkDestroyImage(device, *image, NULL);
+		return false;
+	}
+
+	if (vkBindImageMemory(device, *image, *memory, 0) != VK_SUCCESS)
+	{
+		vkDestroyImage(device, *image, NULL);
+		vkFreeMemory(device, *memory, NULL);
+		return false;
+	}
+
+	VkImageViewCreateInfo imageViewCreateInfo;
+	imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	imageViewCreateInfo.pNext = NULL;
+	imageViewCreateInfo.flags = 0;
+	imageViewCreateInfo.image = *image;
+	imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	imageViewCreateInfo.format = format;
+	imageViewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+	imageViewCreateInfo.subresourceRange = { aspect, 0, 1, 0, 1 };
+
+	if (vkCreateImageView(device, &imageViewCreateInfo, NULL, view) != VK_SUCCESS)
+	{
+		vkDestroyImage(device, *image, NULL);
+		vkFreeMemory(device, *memory, NULL);
+		return false;
+	}
+
+	return true;
+}
+
+bool FindDepthFormat(VkPhysicalDevice physicalDevice, VkFormatFeatureFlags requiredFeatures, VkFormat* format)
+{
+	static const VkFormat depthFormats[] = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM };
+
+	requiredFeatures |= VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+	for (size_t i = 0; i < sizeof(depthFormats) / sizeof(depthFormats[0]); ++i)
+	{
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, depthFormats[i], &properties);
+
+		if ((properties.optimalTilingFeatures & requiredFeatures) == requiredFeatures)
+		{
+			*format = depthFormats[i];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void GetVertexInputDescriptions(const VertexFormat& format, VkVertexInputBindingDescription* binding, VkVertexInputAttributeDescription attributes[2])
+{
+	binding->binding = 0;
+	binding->stride = GetVertexStride(format);
+	binding->inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	static const VkFormat positionFormats[] = { VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R16G16B16A16_SNORM, VK_FORMAT_R16G16B16A16_SFLOAT };
+	static const VkFormat attributeFormats[] = { VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_A2B10G10R10_UNORM_PACK32 };
+
+	attributes[0].binding = 0;
+	attributes[0].location = 0;
+	attributes[0].format = positionFormats[format.position];
+	attributes[0].offset = 0;
+
+	attributes[1].binding = 0;
+	attributes[1].location = 1;
+	attributes[1].format = attributeFormats[format.attribute];
+	attributes[1].offset = GetPositionSize(format.position);
+}
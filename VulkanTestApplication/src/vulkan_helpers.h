@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined(_WIN32) && !defined(VK_USE_PLATFORM_WIN32_KHR)
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include <vulkan/vulkan.h>
+
+#include "vertex_format.h"
+
+// Source data for a single mip level, tightly packed
+struct ImageMipData
+{
+	const void* data;
+	size_t dataSize;
+};
+
+bool memory_type_from_properties(const VkMemoryType* memoryTypes, uint32_t typeBits, VkFlags requirementsMask, uint32_t* typeIndex);
+
+bool CreateDeviceMemory(VkDevice device, const VkMemoryType* memoryTypes, const VkMemoryRequirements* memoryRequirements, VkFlags requirementsMask, size_t dataSize, VkDeviceMemory* memory);
+
+bool SetDeviceMemory(VkDevice device, VkDeviceMemory memory, const void* data, size_t dataSize);
+
+bool CreateBuffer(VkDevice device, VkBufferUsageFlags usageFlags, const VkMemoryType* memoryTypes, const void* data, size_t dataSize, VkBuffer* buffer, VkDeviceMemory* memory);
+
+bool CreateShaderModule(VkDevice device, const uint32_t* code, size_t codeSize, VkShaderModule* module);
+
+// Allocates and begins a primary command buffer for a blocking one-off submission
+bool BeginOneTimeCommands(VkDevice device, VkCommandPool commandPool, VkCommandBuffer* commandBuffer);
+
+// Ends, submits and waits for a command buffer from BeginOneTimeCommands, then frees it
+bool EndOneTimeCommands(VkDevice device, VkQueue queue, VkCommandPool commandPool, VkCommandBuffer commandBuffer);
+
+// Creates a device local, optimally tiled, sampled image.
+// The first mipDataCount levels are uploaded through a staging buffer, any remaining levels up to
+// mipLevels are generated on the GPU by blitting (check SupportsBlitMipGeneration first).
+// The whole image is left in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+bool CreateImage2D(VkDevice device, VkQueue queue, VkCommandPool commandPool, const VkMemoryType* memoryTypes, uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, const ImageMipData* mipData, uint32_t mipDataCount, VkImage* image, VkDeviceMemory* memory);
+
+// Creates a device local, optimally tiled image with its own memory and a view of it, for use as
+// an attachment. Layout is left VK_IMAGE_LAYOUT_UNDEFINED. Transient attachments get lazily
+// allocated memory if the device has it.
+bool CreateRenderTarget(VkDevice device, const VkMemoryType* memoryTypes, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, VkImage* image, VkDeviceMemory* memory, VkImageView* view);
+
+// First of D32_SFLOAT, X8_D24 and D16 with optimal tiling support for a depth attachment and
+// requiredFeatures, false if there isn't one
+bool FindDepthFormat(VkPhysicalDevice physicalDevice, VkFormatFeatureFlags requiredFeatures, VkFormat* format);
+
+// Binding 0 and attributes for locations 0 (position) and 1 (attribute) matching format
+void GetVertexInputDescriptions(const VertexFormat& format, VkVertexInputBindingDescription* binding, VkVertexInputAttributeDescription attributes[2]);
@@ -0,0 +1,52 @@
+# Portable version of the SPIRVShader.targets build rule, for builds not driven by MSBuild.
+# Compiles each shader with glslangValidator, optimises it with spirv-opt and embeds it as a
+# constexpr uint32_t array in <name>.<stage>.h under OUTPUT_DIR, the same headers the
+# MSBuild rule generates.
+#
+#	cmake -DSHADERS=<file>[;<file>...] -DOUTPUT_DIR=<dir> -DEMBED_TOOL=<AssetPacker>
+#		[-DOPTIMIZER_FLAGS=-O] -P config/compile_shader.cmake
+#
+# glslangValidator and spirv-opt are looked up on the PATH, as the MSBuild rule does.
+
+cmake_minimum_required(VERSION 3.5)
+
+if(NOT SHADERS OR NOT OUTPUT_DIR OR NOT EMBED_TOOL)
+	message(FATAL_ERROR "Usage: cmake -DSHADERS=<files> -DOUTPUT_DIR=<dir> -DEMBED_TOOL=<AssetPacker> [-DOPTIMIZER_FLAGS=-O] -P compile_shader.cmake")
+endif()
+
+if(NOT DEFINED OPTIMIZER_FLAGS)
+	set(OPTIMIZER_FLAGS -O)
+endif()
+
+separate_arguments(OPTIMIZER_FLAGS)
+file(MAKE_DIRECTORY "${OUTPUT_DIR}")
+
+foreach(SHADER ${SHADERS})
+	get_filename_component(NAME "${SHADER}" NAME_WE)
+	get_filename_component(STAGE "${SHADER}" EXT)
+	string(SUBSTRING "${STAGE}" 1 -1 STAGE)
+
+	set(SPIRV "${OUTPUT_DIR}/${NAME}.${STAGE}.spv")
+	set(OPTIMIZED "${OUTPUT_DIR}/${NAME}.${STAGE}.opt.spv")
+	set(HEADER "${OUTPUT_DIR}/${NAME}.${STAGE}.h")
+
+	message(STATUS "Generating code: ${SHADER}")
+
+	execute_process(COMMAND glslangValidator -V "${SHADER}" -o "${SPIRV}" RESULT_VARIABLE RESULT)
+
+	if(NOT RESULT EQUAL 0)
+		message(FATAL_ERROR "glslangValidator failed on ${SHADER}")
+	endif()
+
+	execute_process(COMMAND spirv-opt ${OPTIMIZER_FLAGS} "${SPIRV}" -o "${OPTIMIZED}" RESULT_VARIABLE RESULT)
+
+	if(NOT RESULT EQUAL 0)
+		message(FATAL_ERROR "spirv-opt failed on ${SPIRV}")
+	endif()
+
+	execute_process(COMMAND "${EMBED_TOOL}" --embed "${OPTIMIZED}" "${HEADER}" "${NAME}_${STAGE}_spv" RESULT_VARIABLE RESULT)
+
+	if(NOT RESULT EQUAL 0)
+		message(FATAL_ERROR "${EMBED_TOOL} --embed failed on ${OPTIMIZED}")
+	endif()
+endforeach()